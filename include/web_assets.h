@@ -0,0 +1,320 @@
+// Generated by tools/embed_web_assets.py from web/. Do not edit.
+#pragma once
+
+#include <Arduino.h>
+
+// app.css: 6476 bytes, 1756 gzipped
+#define WEB_APP_CSS_PATH "/static/app.css"
+#define WEB_APP_CSS_TYPE "text/css"
+#define WEB_APP_CSS_ETAG "d4058e21bbb33019"
+const size_t WEB_APP_CSS_GZ_LEN = 1756;
+const uint8_t WEB_APP_CSS_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xcd, 0x58, 0xdf, 0x6f, 0xdb, 0x36,
+  0x10, 0x7e, 0xf7, 0x5f, 0xc1, 0x21, 0x28, 0x90, 0x14, 0x96, 0x23, 0xdb, 0x71, 0xea, 0xc8, 0xdb,
+  0xb0, 0x1f, 0x40, 0x9f, 0x0b, 0xf4, 0x65, 0xc0, 0xd0, 0x07, 0x4a, 0xa2, 0x2d, 0x2e, 0x12, 0x29,
+  0x90, 0x74, 0x1c, 0x57, 0xc8, 0xff, 0xbe, 0x23, 0x25, 0x4a, 0xa2, 0x44, 0x39, 0x69, 0xbb, 0x87,
+  0x25, 0x08, 0x22, 0x51, 0x77, 0xc7, 0x8f, 0xc7, 0xbb, 0xef, 0x8e, 0xbc, 0x7d, 0x8f, 0x3e, 0x67,
+  0x58, 0x90, 0x14, 0x49, 0x75, 0xce, 0x89, 0xcc, 0x08, 0x51, 0x68, 0xcf, 0x05, 0xc2, 0x79, 0x8e,
+  0x4a, 0x7c, 0x20, 0x72, 0x81, 0x3e, 0x13, 0xf1, 0x04, 0x02, 0x87, 0xaf, 0xb4, 0x2c, 0xe1, 0xff,
+  0x5e, 0xf0, 0x02, 0xdd, 0x4a, 0x85, 0x15, 0x4d, 0x6e, 0x71, 0x59, 0x2e, 0x12, 0x29, 0x17, 0x33,
+  0x84, 0xd0, 0x27, 0x10, 0x47, 0xb2, 0x24, 0x09, 0xdd, 0xd3, 0x04, 0x89, 0x23, 0x98, 0x43, 0x60,
+  0x1a, 0xc9, 0x84, 0x6b, 0xbd, 0xf8, 0x8c, 0x54, 0x46, 0x50, 0x92, 0x63, 0x29, 0x11, 0x67, 0xe8,
+  0xe7, 0x98, 0xa7, 0xe7, 0x5f, 0x17, 0xe8, 0xfd, 0xed, 0x6c, 0x76, 0xfb, 0x1e, 0x05, 0x41, 0x80,
+  0xfe, 0xe4, 0x45, 0x01, 0x5f, 0xf4, 0x23, 0x8c, 0xea, 0xef, 0xd5, 0x9e, 0x33, 0x15, 0xec, 0x71,
+  0x41, 0xf3, 0x73, 0xf4, 0xbb, 0xa0, 0x38, 0x9f, 0x4b, 0xcc, 0x64, 0x20, 0x89, 0xa0, 0xfb, 0x5d,
+  0x8c, 0x93, 0xc7, 0x83, 0xe0, 0x47, 0x96, 0x46, 0x57, 0xfb, 0x3b, 0xf8, 0x7d, 0xd8, 0x25, 0x3c,
+  0xe7, 0x22, 0xba, 0x5a, 0xaf, 0xd7, 0xbb, 0x97, 0xd9, 0x22, 0xc1, 0x22, 0xad, 0x0a, 0x2c, 0x0e,
+  0x94, 0x45, 0xab, 0xb0, 0x7c, 0x46, 0xf8, 0xa8, 0xf8, 0xae, 0xc4, 0x69, 0x4a, 0xd9, 0xc1, 0x8c,
+  0xec, 0x0a, 0xfc, 0x1c, 0x9c, 0x68, 0xaa, 0xb2, 0x68, 0x13, 0xea, 0x77, 0xc7, 0xe6, 0x1e, 0xe6,
+  0xe0, 0x22, 0x25, 0x22, 0x10, 0x38, 0xa5, 0x47, 0x19, 0x2d, 0x8d, 0x08, 0x7f, 0x0e, 0x64, 0x86,
+  0x53, 0x7e, 0x8a, 0x42, 0x74, 0x07, 0x56, 0xef, 0xe1, 0x4f, 0x1c, 0x62, 0x7c, 0x1d, 0xce, 0xcd,
+  0xef, 0x62, 0x79, 0x63, 0x67, 0x47, 0xd9, 0xaa, 0x01, 0x10, 0x28, 0x5e, 0x46, 0xa1, 0x05, 0x18,
+  0x86, 0x1f, 0xfe, 0xf8, 0xf8, 0x51, 0x4b, 0x65, 0xbc, 0x20, 0x41, 0xac, 0x58, 0x55, 0xa3, 0x58,
+  0x86, 0xe1, 0xbb, 0x16, 0xe1, 0x72, 0x05, 0x96, 0xc3, 0x9d, 0x71, 0x82, 0xa4, 0x5f, 0x49, 0xb4,
+  0x5c, 0x2c, 0x49, 0xe1, 0x60, 0x6c, 0x0c, 0x35, 0x66, 0x3b, 0xc4, 0x11, 0xe3, 0x8c, 0x0c, 0xd0,
+  0x03, 0x4e, 0x3d, 0xa3, 0x56, 0xff, 0x81, 0x19, 0x31, 0xc6, 0x6f, 0x9f, 0xae, 0xb7, 0x76, 0xe3,
+  0x3b, 0xeb, 0x96, 0xf8, 0xa8, 0x14, 0x67, 0x73, 0xf3, 0xa2, 0xb1, 0xcc, 0x17, 0x29, 0x85, 0xd8,
+  0x61, 0x92, 0xd4, 0x6f, 0x09, 0xce, 0x69, 0x5c, 0x3f, 0x96, 0x82, 0x16, 0xcd, 0xa8, 0xf5, 0xd5,
+  0xbc, 0x5d, 0xc3, 0x7c, 0x21, 0x08, 0xc3, 0xcd, 0x68, 0x6d, 0x14, 0x74, 0x59, 0x42, 0xf2, 0x4a,
+  0x09, 0x88, 0x14, 0xaa, 0x28, 0x67, 0x51, 0x07, 0x1f, 0x85, 0x8b, 0x95, 0x1c, 0xa0, 0x88, 0x32,
+  0xfe, 0x44, 0x44, 0x87, 0xc5, 0xbe, 0xf7, 0x11, 0x75, 0x32, 0x0d, 0x2e, 0x3b, 0xd0, 0xa2, 0xb3,
+  0x03, 0x16, 0xa3, 0x7d, 0xef, 0xf0, 0xd5, 0x23, 0x55, 0x07, 0x26, 0x68, 0x83, 0x61, 0x73, 0x1f,
+  0xaf, 0xd1, 0x4f, 0xb4, 0x28, 0xb9, 0x50, 0x98, 0x29, 0x0d, 0xb0, 0x35, 0xbc, 0x90, 0xda, 0x7b,
+  0x53, 0xba, 0xab, 0xe5, 0x76, 0xbb, 0xde, 0x0e, 0x74, 0xbb, 0x39, 0x1b, 0x67, 0x34, 0x60, 0x1c,
+  0x07, 0x59, 0x80, 0xd6, 0x95, 0x93, 0x53, 0x6c, 0xb7, 0x43, 0xfb, 0x8a, 0x63, 0xa9, 0xaa, 0x92,
+  0x37, 0xee, 0xdd, 0xd3, 0x67, 0x92, 0xee, 0x34, 0xca, 0xb5, 0xde, 0xe3, 0x9c, 0xec, 0x15, 0x64,
+  0xd3, 0xbb, 0x9d, 0xd9, 0x01, 0x60, 0x93, 0x22, 0x32, 0x4f, 0x39, 0x56, 0xe4, 0xaf, 0xeb, 0x00,
+  0xbe, 0xdc, 0x38, 0x01, 0xb5, 0xda, 0xe2, 0x0f, 0x77, 0x9b, 0x7e, 0x4c, 0xb5, 0xd1, 0xb8, 0x85,
+  0x68, 0x5c, 0xaf, 0x4c, 0xce, 0xf5, 0x23, 0x0b, 0x86, 0x9d, 0x10, 0x5d, 0xe9, 0x10, 0xed, 0x67,
+  0xa5, 0x8e, 0xe2, 0xed, 0x28, 0x2b, 0x37, 0x37, 0xbb, 0xaf, 0x01, 0x65, 0x29, 0x79, 0x8e, 0x1e,
+  0xe0, 0x07, 0x56, 0xd2, 0x32, 0x8f, 0xde, 0x56, 0x01, 0xf8, 0x2c, 0xf9, 0x34, 0x1b, 0x7d, 0xc2,
+  0x82, 0x01, 0x10, 0xbb, 0xcd, 0xcd, 0x6b, 0xd5, 0x40, 0x8d, 0xd7, 0x21, 0xfc, 0x0c, 0x29, 0x63,
+  0x9d, 0xa4, 0x36, 0x29, 0x96, 0x00, 0x41, 0xf2, 0x9c, 0xa6, 0x08, 0x3e, 0x10, 0x12, 0x63, 0x4f,
+  0x86, 0xb4, 0x6b, 0x0d, 0xbb, 0x74, 0x89, 0x39, 0xec, 0x53, 0x61, 0x96, 0xef, 0xac, 0x33, 0xdc,
+  0xc0, 0x42, 0x5f, 0x66, 0x5d, 0x14, 0x7a, 0x53, 0xf8, 0xee, 0xd5, 0x14, 0x4e, 0x93, 0xf5, 0xc6,
+  0xf5, 0xf8, 0x9b, 0xb2, 0xd8, 0xc2, 0xd2, 0x48, 0x93, 0xa3, 0x90, 0xa0, 0x5c, 0x72, 0xca, 0x14,
+  0x11, 0x0e, 0xa8, 0x08, 0x12, 0x07, 0xc7, 0x39, 0x49, 0xab, 0x11, 0x6d, 0xd4, 0x4a, 0x8c, 0xab,
+  0x00, 0x0a, 0x0c, 0x3f, 0x41, 0xd4, 0xbc, 0xcc, 0xae, 0x12, 0x10, 0x50, 0xb0, 0x6f, 0xac, 0x1a,
+  0xee, 0xa9, 0x4b, 0x96, 0x1e, 0x14, 0x8a, 0x3c, 0x6b, 0x53, 0xf4, 0xc0, 0xa2, 0x84, 0xb8, 0x40,
+  0x72, 0x1c, 0x03, 0x09, 0x0c, 0xbd, 0xe0, 0xda, 0xd0, 0xfe, 0xd5, 0x59, 0x9e, 0xe3, 0x73, 0x14,
+  0xe7, 0x3c, 0x79, 0xec, 0xd4, 0x29, 0x2b, 0x8f, 0xca, 0xeb, 0xde, 0x70, 0xb0, 0x29, 0xc6, 0xb9,
+  0x23, 0x97, 0x8d, 0x23, 0x20, 0x49, 0x92, 0xe1, 0x12, 0xee, 0x2d, 0x23, 0xea, 0x19, 0xe5, 0x31,
+  0x2e, 0xa8, 0xfa, 0xce, 0x1d, 0xfd, 0xd6, 0x32, 0x30, 0xda, 0x3e, 0x9b, 0x09, 0x9f, 0x74, 0xa0,
+  0xb7, 0x59, 0xd0, 0x92, 0xd0, 0xff, 0x26, 0xd0, 0x2e, 0xb3, 0xba, 0x4b, 0x9a, 0x95, 0x87, 0x65,
+  0xfa, 0x42, 0x11, 0x4e, 0x14, 0x7d, 0x22, 0x15, 0x2f, 0x71, 0x42, 0xd5, 0x39, 0x0a, 0x17, 0x7d,
+  0x4e, 0xf8, 0x7c, 0x2c, 0x00, 0xce, 0x19, 0x61, 0xb0, 0x9f, 0x64, 0x98, 0x31, 0x92, 0xa3, 0x02,
+  0x33, 0xe8, 0x72, 0x0a, 0x08, 0xb5, 0xce, 0x45, 0x07, 0xd8, 0x39, 0x23, 0x39, 0xd7, 0xcf, 0x8d,
+  0xa4, 0xed, 0x3a, 0xc2, 0xd6, 0x5b, 0xa1, 0x99, 0xba, 0x15, 0x46, 0x75, 0x05, 0x2a, 0xfb, 0x4a,
+  0x76, 0xcc, 0x2a, 0xeb, 0xf5, 0x23, 0xbf, 0x9e, 0xad, 0x9f, 0x23, 0xe5, 0xfa, 0x43, 0xe5, 0x46,
+  0x75, 0x6f, 0xf3, 0x5c, 0xd3, 0x53, 0x41, 0x6d, 0x42, 0xa4, 0xb7, 0x69, 0x9e, 0x92, 0x65, 0xe2,
+  0x6d, 0x7a, 0x37, 0x37, 0x5e, 0x8e, 0x98, 0x58, 0x47, 0x5b, 0x4c, 0xfd, 0xab, 0x79, 0xa5, 0x70,
+  0x6a, 0xc3, 0xba, 0x1f, 0x3d, 0x4a, 0xd0, 0xa6, 0x65, 0xbb, 0x76, 0xca, 0x72, 0xca, 0x60, 0xa3,
+  0x8d, 0x0b, 0xec, 0x4a, 0xef, 0xea, 0xca, 0x30, 0xec, 0xeb, 0x56, 0xce, 0xfa, 0xc3, 0x85, 0x26,
+  0x5a, 0xf3, 0x7e, 0x22, 0xf4, 0x90, 0xa9, 0x28, 0xe6, 0x79, 0x6a, 0xa3, 0xd3, 0xd4, 0xb7, 0x6d,
+  0x93, 0xba, 0x30, 0x61, 0x20, 0x8e, 0x4c, 0x97, 0x85, 0x00, 0x18, 0xad, 0xba, 0x1c, 0xfd, 0xb5,
+  0x0b, 0xda, 0x35, 0x66, 0x04, 0x6b, 0x10, 0x3a, 0x0c, 0x61, 0xcf, 0xf6, 0x39, 0xc7, 0x2a, 0x12,
+  0x7a, 0xbe, 0x7e, 0xdf, 0x14, 0x34, 0x53, 0xf5, 0x15, 0x9b, 0x02, 0x2f, 0x60, 0x42, 0xbb, 0xda,
+  0x7d, 0x4e, 0x9e, 0x77, 0x07, 0x5c, 0x1a, 0x64, 0x86, 0x12, 0x03, 0xaa, 0x48, 0x21, 0x2d, 0x31,
+  0xfe, 0x73, 0x94, 0x8a, 0xee, 0xcf, 0xe0, 0x3a, 0x78, 0x65, 0xaa, 0xc7, 0x97, 0x1e, 0xc3, 0x35,
+  0xfb, 0x69, 0x93, 0xd1, 0xb2, 0x75, 0xdd, 0xa0, 0x1a, 0x7d, 0x03, 0xed, 0x65, 0xb5, 0x13, 0x57,
+  0x5d, 0xa1, 0xa6, 0x5f, 0xb5, 0xc5, 0x46, 0x1f, 0x46, 0x76, 0x6d, 0xbe, 0xf8, 0x01, 0x75, 0x14,
+  0xb4, 0xda, 0xb8, 0x5c, 0xec, 0x32, 0xd0, 0x25, 0x50, 0x75, 0x94, 0x5e, 0x24, 0xcd, 0x41, 0xc4,
+  0xb6, 0xa0, 0x5e, 0x61, 0x1d, 0x2f, 0x5e, 0xdb, 0x87, 0x0e, 0x8b, 0xe0, 0x0f, 0xd8, 0x1a, 0x25,
+  0x82, 0x69, 0xce, 0x06, 0x6a, 0x6e, 0x17, 0xfc, 0xdd, 0xb3, 0x7b, 0x7a, 0x45, 0xcf, 0xc4, 0x2d,
+  0x59, 0x26, 0x19, 0x49, 0xe1, 0xc8, 0xe7, 0xd0, 0xa2, 0x1d, 0x5b, 0xe8, 0x1e, 0xd0, 0x04, 0xab,
+  0xbf, 0xfe, 0xf5, 0x65, 0xeb, 0xb2, 0xed, 0xd2, 0x97, 0xab, 0x75, 0x6f, 0xc3, 0xb0, 0x49, 0x4d,
+  0x38, 0xb7, 0xf9, 0x32, 0xd3, 0x5a, 0x0c, 0x94, 0xee, 0x45, 0x82, 0x93, 0x80, 0xb3, 0x2a, 0x2c,
+  0xa1, 0x47, 0x85, 0x7a, 0x49, 0x90, 0x73, 0xa7, 0xe0, 0x39, 0x32, 0xe7, 0x42, 0xbb, 0xdb, 0xf5,
+  0x29, 0xd1, 0x1f, 0xa6, 0x2f, 0x33, 0x63, 0x6e, 0x60, 0xbd, 0x72, 0x08, 0xd6, 0x1e, 0x28, 0xfb,
+  0x7c, 0x7b, 0xd1, 0x68, 0xf3, 0x08, 0x71, 0x98, 0xe3, 0x52, 0x92, 0xc8, 0x3e, 0x0c, 0x7d, 0xa3,
+  0xb2, 0xb9, 0xfb, 0x9e, 0x56, 0xfd, 0xdc, 0x1c, 0x37, 0x43, 0x53, 0x6b, 0x18, 0x58, 0xad, 0x2e,
+  0x27, 0xc5, 0x50, 0x1e, 0x32, 0x49, 0x65, 0x9a, 0x6a, 0xf3, 0xf4, 0x9a, 0x3c, 0x11, 0x76, 0xe3,
+  0xe8, 0xef, 0x1f, 0xf4, 0xef, 0x50, 0xc9, 0x10, 0xca, 0xdf, 0xea, 0x5c, 0x92, 0x5f, 0xd8, 0xb1,
+  0x88, 0x89, 0xf8, 0xd2, 0xf8, 0xec, 0x43, 0x38, 0x8e, 0x81, 0x9e, 0xb0, 0x82, 0x52, 0x6d, 0x45,
+  0x97, 0x2b, 0x8f, 0x6c, 0x53, 0xef, 0x1a, 0x37, 0xeb, 0x9e, 0xff, 0x6e, 0xd0, 0x54, 0xa3, 0x55,
+  0xf8, 0x0a, 0x71, 0x6d, 0x7e, 0x84, 0x23, 0xbc, 0x78, 0xa6, 0xb2, 0xcf, 0x2b, 0xdc, 0xf6, 0xcb,
+  0xf3, 0xb1, 0x17, 0xfc, 0xbd, 0x34, 0x21, 0x64, 0xd7, 0x1d, 0xce, 0xc0, 0xea, 0x6f, 0x05, 0x49,
+  0x29, 0x46, 0xd7, 0x5d, 0xf0, 0xdd, 0xeb, 0xdb, 0x8c, 0x9b, 0xca, 0xcd, 0x43, 0x73, 0x1f, 0xe2,
+  0xd4, 0xfc, 0x97, 0xd7, 0x02, 0xac, 0x5f, 0x14, 0x1f, 0x74, 0x55, 0xb4, 0xea, 0xf7, 0x23, 0xed,
+  0xf1, 0x1e, 0xcf, 0xdf, 0xb2, 0xad, 0x0f, 0x3a, 0x4b, 0x20, 0x79, 0x2d, 0x6e, 0x6d, 0xb7, 0x47,
+  0x2c, 0x67, 0x09, 0x55, 0x0c, 0x49, 0xa2, 0x14, 0xcc, 0x2a, 0x1d, 0x7e, 0xb1, 0x63, 0x6f, 0xe1,
+  0x17, 0x2b, 0xfb, 0x7d, 0xfc, 0x32, 0x30, 0xd2, 0x5f, 0x09, 0x24, 0x5d, 0xb3, 0x4e, 0xcf, 0x57,
+  0xc7, 0x0f, 0x9e, 0xef, 0x25, 0x96, 0xf2, 0x04, 0x91, 0x37, 0x90, 0x90, 0x24, 0x27, 0xc9, 0x7f,
+  0x7f, 0xfa, 0x98, 0xa4, 0x03, 0x49, 0x4c, 0x07, 0x12, 0x28, 0xaa, 0x80, 0xcc, 0x86, 0xe6, 0xfb,
+  0xce, 0xb8, 0x6f, 0xc9, 0xb6, 0x3e, 0x9c, 0x87, 0xe6, 0x98, 0xed, 0xb9, 0xd6, 0x82, 0x4d, 0x4f,
+  0x1e, 0xf5, 0x84, 0xa3, 0x1e, 0xc5, 0xd3, 0x9b, 0xe8, 0xb6, 0xc5, 0x73, 0xfe, 0x35, 0x0d, 0x07,
+  0xa8, 0x18, 0xf2, 0x86, 0xd4, 0xd4, 0xff, 0x86, 0xb6, 0xfb, 0xde, 0xb4, 0xe3, 0x5f, 0xda, 0xee,
+  0xdb, 0x5c, 0xcd, 0x85, 0xba, 0x45, 0xd0, 0x66, 0x64, 0x26, 0x28, 0x7b, 0x8c, 0x46, 0xdb, 0xe9,
+  0x1a, 0xac, 0x23, 0xa4, 0x2d, 0xfd, 0xa7, 0x0c, 0xa0, 0x06, 0x12, 0x8e, 0x08, 0xc4, 0x42, 0xf0,
+  0x36, 0x98, 0x50, 0x4c, 0x14, 0x85, 0x93, 0x5c, 0xc3, 0xc0, 0x05, 0x4d, 0xd3, 0xdc, 0x30, 0x38,
+  0x94, 0x6f, 0x7f, 0xa3, 0xd6, 0x5f, 0xb1, 0xb9, 0x20, 0x6b, 0x2a, 0x57, 0xa3, 0x50, 0xdf, 0x47,
+  0xd5, 0xbd, 0xe1, 0xd8, 0xc0, 0x44, 0x3b, 0x77, 0xd9, 0xb9, 0xee, 0x55, 0xa7, 0x53, 0x9a, 0x90,
+  0x4e, 0x96, 0xba, 0x48, 0x4d, 0x43, 0x40, 0xfa, 0x43, 0xdd, 0x16, 0x1e, 0x19, 0xb8, 0xaf, 0x97,
+  0xb7, 0x2d, 0x39, 0xb7, 0x12, 0xcb, 0x57, 0x2f, 0x15, 0xbf, 0xe5, 0x84, 0x7a, 0xa1, 0x6f, 0x19,
+  0x82, 0x68, 0xd7, 0xd5, 0xf4, 0xfa, 0x5d, 0x78, 0x36, 0xd5, 0x4c, 0xaf, 0xae, 0xc0, 0x94, 0xbd,
+  0x5e, 0xf7, 0xb4, 0xe4, 0x04, 0x95, 0x8f, 0x05, 0x53, 0xcc, 0x0e, 0x83, 0x26, 0xc9, 0x7b, 0x02,
+  0xd0, 0xb2, 0xc7, 0x32, 0xc5, 0x8a, 0x54, 0x97, 0xaf, 0xc1, 0x7a, 0x50, 0x3d, 0x0d, 0x58, 0x77,
+  0xf8, 0xe9, 0x50, 0x4e, 0x37, 0x88, 0x1d, 0x40, 0x8f, 0x4c, 0x73, 0x91, 0xe5, 0x60, 0xf3, 0x88,
+  0xd5, 0x77, 0x8d, 0xe3, 0xec, 0xd1, 0x27, 0xb5, 0x4b, 0x20, 0xa6, 0x2f, 0x12, 0x27, 0xec, 0x4c,
+  0x20, 0xb8, 0x74, 0xe7, 0x39, 0x59, 0x01, 0xaf, 0x4a, 0xc1, 0x0f, 0x82, 0x48, 0xf9, 0x07, 0xee,
+  0x77, 0x7f, 0x7d, 0x6d, 0xb7, 0x65, 0x73, 0xec, 0xb6, 0xda, 0x1f, 0x69, 0xae, 0x49, 0x61, 0x52,
+  0xf0, 0x65, 0xf6, 0x2f, 0xc4, 0x62, 0xbc, 0xe3, 0x4c, 0x19, 0x00, 0x00,
+};
+
+// app.js: 10807 bytes, 3035 gzipped
+#define WEB_APP_JS_PATH "/static/app.js"
+#define WEB_APP_JS_TYPE "application/javascript"
+#define WEB_APP_JS_ETAG "0fce65650ebb0f52"
+const size_t WEB_APP_JS_GZ_LEN = 3035;
+const uint8_t WEB_APP_JS_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xe5, 0x5a, 0x6d, 0x6f, 0xdb, 0x38,
+  0x12, 0xfe, 0xde, 0x5f, 0xc1, 0xdd, 0xde, 0x56, 0xf2, 0x36, 0x96, 0x9d, 0x5c, 0xb3, 0x2d, 0xec,
+  0xa6, 0x45, 0x93, 0x36, 0x68, 0x71, 0x49, 0x5b, 0x24, 0x69, 0xef, 0x80, 0xc5, 0x02, 0x4b, 0x4b,
+  0xb4, 0xa5, 0x46, 0x12, 0x75, 0x24, 0x65, 0xc7, 0xcd, 0xe6, 0xbf, 0xdf, 0x0c, 0x5f, 0x64, 0xc9,
+  0x2f, 0x8a, 0x9b, 0xb4, 0x87, 0x03, 0xee, 0x43, 0x6b, 0x9b, 0xe4, 0x0c, 0x87, 0x33, 0xcf, 0x0c,
+  0x9f, 0x91, 0xd2, 0xeb, 0x91, 0xf3, 0x98, 0x0a, 0x16, 0x11, 0x19, 0x8a, 0xa4, 0x50, 0x92, 0x8c,
+  0xb9, 0x20, 0x34, 0x4d, 0x49, 0x41, 0x27, 0x4c, 0x06, 0xe4, 0x9c, 0x89, 0x29, 0xcc, 0x4e, 0xbe,
+  0x26, 0x45, 0x01, 0x9f, 0x63, 0xc1, 0x33, 0xd2, 0x93, 0x8a, 0xaa, 0x24, 0xec, 0xd1, 0xa2, 0x08,
+  0xbe, 0xc8, 0xe0, 0x41, 0xaf, 0x47, 0x3e, 0xd3, 0xb4, 0x64, 0x92, 0xa8, 0x98, 0x2a, 0x12, 0x25,
+  0xe3, 0x31, 0x13, 0xa4, 0x80, 0x7f, 0x82, 0xfd, 0x1b, 0x86, 0x15, 0x81, 0x1d, 0x40, 0xa1, 0x94,
+  0xa0, 0x21, 0xc9, 0x09, 0x95, 0x30, 0x30, 0x29, 0x33, 0x96, 0xc3, 0x7e, 0xb0, 0x5d, 0x44, 0x15,
+  0xed, 0x12, 0xaa, 0x94, 0x48, 0x46, 0xa5, 0x82, 0x5d, 0x1f, 0xa0, 0xca, 0x6e, 0xb7, 0x4b, 0x8e,
+  0x68, 0x9a, 0x8c, 0x04, 0x55, 0x0c, 0x7f, 0x3d, 0x18, 0x97, 0x79, 0xa8, 0x12, 0x9e, 0x13, 0xd8,
+  0x5f, 0xa8, 0x23, 0x5e, 0xe6, 0x2a, 0xe2, 0xb3, 0xdc, 0x97, 0x2c, 0xe4, 0x79, 0x24, 0x3b, 0xe4,
+  0xfa, 0x01, 0x21, 0x53, 0x2a, 0xc8, 0x48, 0xe5, 0xe4, 0x80, 0x44, 0x3c, 0xd4, 0x7b, 0x04, 0x13,
+  0xa6, 0xde, 0xa4, 0x0c, 0xbf, 0x1e, 0xce, 0xdf, 0x45, 0xbe, 0x17, 0xa2, 0xd6, 0x43, 0x95, 0x7b,
+  0x9d, 0xa1, 0x15, 0x88, 0x79, 0xc6, 0x0e, 0xdb, 0x85, 0xec, 0x92, 0x85, 0xcc, 0x88, 0x86, 0x97,
+  0xb7, 0xc8, 0xd8, 0x25, 0x0b, 0x99, 0xd0, 0xd9, 0xdc, 0x6a, 0x9e, 0x5b, 0x64, 0xe4, 0xe0, 0x30,
+  0x41, 0x94, 0x48, 0x3a, 0x4a, 0xc1, 0x7b, 0x07, 0x44, 0x89, 0x92, 0xe1, 0xb0, 0xb5, 0x67, 0xdd,
+  0x94, 0xdd, 0x76, 0xdd, 0x14, 0x1a, 0xa1, 0x92, 0x8c, 0x9d, 0xb0, 0xb1, 0x82, 0x61, 0xeb, 0x39,
+  0x9c, 0xa9, 0x76, 0x0d, 0x92, 0x3c, 0x67, 0xe2, 0x82, 0x5d, 0xe1, 0x02, 0xcf, 0x45, 0x20, 0xc9,
+  0x27, 0x41, 0x10, 0x10, 0x8f, 0x3c, 0x5e, 0xc8, 0x3f, 0x26, 0x9e, 0x84, 0x10, 0x67, 0x34, 0xc9,
+  0x61, 0xda, 0x73, 0xfa, 0x93, 0x5c, 0x01, 0x68, 0x68, 0xaa, 0xf5, 0xab, 0x77, 0xf6, 0x97, 0xef,
+  0xa2, 0xe7, 0x9b, 0x38, 0x91, 0x4a, 0x4f, 0xb7, 0x3b, 0xd4, 0xbf, 0xbf, 0x8f, 0x05, 0x84, 0x24,
+  0x63, 0xe2, 0x57, 0x2b, 0x9e, 0x1f, 0x90, 0xbe, 0xdb, 0x10, 0xb6, 0x48, 0x19, 0x15, 0x95, 0x45,
+  0xce, 0xd0, 0xce, 0xd0, 0x4d, 0xaf, 0xb7, 0xc0, 0x73, 0xf3, 0x4b, 0xa1, 0x18, 0xd3, 0x54, 0x32,
+  0x37, 0xb7, 0x26, 0x1e, 0x8d, 0xf9, 0x35, 0x41, 0xa9, 0xcd, 0xdf, 0xc0, 0xff, 0x37, 0x3b, 0x64,
+  0xb7, 0xdf, 0xef, 0x83, 0x35, 0x37, 0x55, 0x02, 0x7c, 0x14, 0x70, 0x90, 0x26, 0xf8, 0x15, 0x9f,
+  0x4c, 0x52, 0xa6, 0x27, 0xfc, 0x30, 0xa6, 0x60, 0x68, 0xba, 0x35, 0xf2, 0x0b, 0x94, 0x3a, 0x2c,
+  0x95, 0xe2, 0x35, 0x50, 0x62, 0x36, 0x33, 0x90, 0xc2, 0xd3, 0x81, 0xc0, 0x2b, 0x97, 0x87, 0xbe,
+  0xa7, 0x13, 0x53, 0x4f, 0x7b, 0x1d, 0x72, 0x70, 0x00, 0xae, 0xd8, 0xf5, 0xc8, 0x4b, 0xe2, 0xf5,
+  0x3d, 0x32, 0xc0, 0xef, 0x4e, 0xc3, 0x55, 0x2c, 0x40, 0x3e, 0x67, 0x33, 0xf2, 0xaf, 0xd3, 0x93,
+  0xb7, 0x4a, 0x15, 0x67, 0x26, 0xef, 0x7d, 0xbd, 0x07, 0xcc, 0x06, 0xbc, 0x60, 0xb9, 0xef, 0x7d,
+  0xfc, 0x70, 0x7e, 0xe1, 0xed, 0x10, 0xaf, 0xa7, 0xed, 0x80, 0x6f, 0x08, 0xcb, 0x6a, 0x0d, 0x80,
+  0xc5, 0xca, 0xbd, 0x65, 0x34, 0x62, 0xc2, 0xf7, 0x8e, 0x38, 0x44, 0x28, 0x57, 0xdd, 0x8b, 0x79,
+  0x81, 0xab, 0x3d, 0x28, 0x38, 0x69, 0x12, 0x52, 0x74, 0x43, 0xef, 0xaa, 0x3b, 0x9b, 0xcd, 0xba,
+  0x50, 0xad, 0xb2, 0x6e, 0x29, 0x52, 0x96, 0x87, 0x3c, 0x62, 0x91, 0x57, 0x53, 0x96, 0x63, 0x2a,
+  0x19, 0xff, 0x1c, 0x20, 0x68, 0xec, 0x77, 0xc4, 0xcc, 0x23, 0x7d, 0x26, 0x3d, 0xaa, 0xbf, 0x55,
+  0x79, 0x26, 0x37, 0x1d, 0x7f, 0x67, 0x69, 0xe1, 0x14, 0xeb, 0x1d, 0x02, 0xdc, 0xf8, 0x6e, 0xe1,
+  0x9a, 0xd7, 0x3c, 0x67, 0xda, 0x3b, 0xe7, 0x58, 0xa3, 0x3c, 0xb7, 0x3e, 0x4c, 0xa1, 0xfa, 0xbd,
+  0xa7, 0xd9, 0x5a, 0x19, 0xed, 0x8d, 0x2e, 0x86, 0x4e, 0x2a, 0x5e, 0x68, 0xe9, 0x6a, 0xc8, 0xd3,
+  0x68, 0x98, 0x25, 0x39, 0xc0, 0x32, 0xa0, 0x51, 0xf4, 0x66, 0x0a, 0x0e, 0x39, 0x49, 0x24, 0xf8,
+  0x05, 0x3d, 0x94, 0x72, 0x1a, 0x81, 0x71, 0x4b, 0xb9, 0x75, 0x17, 0x24, 0x60, 0xd6, 0xfc, 0x04,
+  0x42, 0x1d, 0xc8, 0x27, 0x55, 0x8a, 0x7c, 0xf9, 0xa4, 0x2d, 0x07, 0x6a, 0x5a, 0x0b, 0xda, 0x1c,
+  0x7a, 0xcf, 0xcb, 0x2c, 0xa3, 0x62, 0x3e, 0x20, 0x19, 0xcd, 0x4b, 0x28, 0x08, 0x11, 0x97, 0xcb,
+  0x95, 0x3c, 0xe6, 0xb3, 0x53, 0x3d, 0xf9, 0x1a, 0xe6, 0x00, 0xcf, 0x8b, 0x03, 0xc8, 0x36, 0xf3,
+  0xb3, 0x4a, 0xe6, 0x9c, 0x69, 0x4d, 0x26, 0xc2, 0xfa, 0x24, 0xd2, 0x64, 0xef, 0xdb, 0x8b, 0xd3,
+  0x13, 0x50, 0xf1, 0xe7, 0xf3, 0x28, 0x99, 0x82, 0x63, 0xe7, 0x29, 0x04, 0x1c, 0x92, 0xaf, 0x48,
+  0xe9, 0x7c, 0x30, 0x4e, 0xd9, 0xd5, 0x70, 0x42, 0x8b, 0xc1, 0xb3, 0xe2, 0x6a, 0x08, 0xf5, 0x65,
+  0x92, 0x77, 0x13, 0xc5, 0x32, 0x39, 0x08, 0x19, 0xd6, 0x84, 0xe1, 0x97, 0x52, 0xaa, 0x64, 0x3c,
+  0xef, 0x86, 0x06, 0x80, 0x6e, 0xd8, 0x7b, 0xf1, 0x3c, 0xc9, 0x8b, 0x52, 0x91, 0x24, 0x02, 0x5d,
+  0xb0, 0xf9, 0x67, 0x9e, 0xfe, 0xed, 0x3a, 0x8c, 0x6f, 0x3c, 0xa2, 0x00, 0xa2, 0x07, 0x5e, 0x5e,
+  0x66, 0x23, 0x26, 0x3c, 0x92, 0x25, 0xf9, 0x81, 0xd7, 0x0f, 0x20, 0xbc, 0x10, 0xa8, 0xc2, 0x7e,
+  0x85, 0x9d, 0x43, 0x16, 0xf3, 0x14, 0xa0, 0x7d, 0xe0, 0x81, 0x24, 0x9c, 0x8c, 0xf8, 0x59, 0xda,
+  0xf1, 0x9c, 0x75, 0xb3, 0x24, 0x52, 0xf1, 0xe0, 0x49, 0xff, 0x97, 0x61, 0x01, 0x91, 0x86, 0x82,
+  0xa6, 0xcd, 0x1b, 0x83, 0x0d, 0x5d, 0x99, 0x7c, 0x65, 0x83, 0x5d, 0x96, 0x0d, 0x47, 0x5c, 0x80,
+  0x7c, 0x57, 0xd0, 0x28, 0x29, 0xe5, 0xe0, 0x37, 0x98, 0x37, 0x23, 0x83, 0xdd, 0xe2, 0x8a, 0x48,
+  0x9e, 0x26, 0x11, 0x79, 0x18, 0x86, 0x21, 0x9a, 0x3a, 0xd2, 0xd1, 0xad, 0x6c, 0x85, 0xe2, 0x63,
+  0x6d, 0x35, 0xdb, 0xfd, 0x6c, 0xb6, 0xdb, 0xdb, 0x5f, 0x6c, 0xb7, 0xdb, 0x07, 0x25, 0xfd, 0xe5,
+  0x1d, 0xa1, 0x70, 0x4d, 0x04, 0x54, 0xc6, 0x68, 0xf0, 0xb0, 0xdf, 0x7f, 0x7a, 0x78, 0x7c, 0x3c,
+  0x0c, 0x79, 0xca, 0xc5, 0xe0, 0xe1, 0x78, 0x3c, 0x76, 0xbb, 0xe7, 0x00, 0xfb, 0x35, 0xb6, 0xfd,
+  0x4c, 0x78, 0x1e, 0x42, 0xca, 0x5e, 0x1a, 0x13, 0xde, 0xf3, 0x99, 0xaf, 0x6d, 0xe8, 0x78, 0x2f,
+  0x30, 0x76, 0xcf, 0x7b, 0xc6, 0xc6, 0x86, 0xad, 0x21, 0xcd, 0x43, 0x96, 0x7e, 0x0f, 0x6b, 0x29,
+  0xa5, 0x77, 0x32, 0xd5, 0x58, 0x50, 0x83, 0xa5, 0xb3, 0xf9, 0x48, 0x4f, 0x2c, 0xac, 0xee, 0x01,
+  0xb4, 0x5e, 0x68, 0x7c, 0x39, 0x27, 0x57, 0xa4, 0xa4, 0x61, 0x3c, 0xc0, 0x55, 0x4c, 0x92, 0xbc,
+  0x0b, 0xd9, 0xbd, 0x1c, 0xd2, 0x00, 0x8d, 0xb6, 0x46, 0x5a, 0xef, 0x7a, 0x56, 0xf1, 0x9f, 0x3a,
+  0xf5, 0xab, 0x54, 0x59, 0xb1, 0xea, 0x87, 0x24, 0x8b, 0x0d, 0x84, 0x4e, 0x6f, 0xf4, 0x84, 0x88,
+  0x74, 0x5e, 0x37, 0x21, 0x0a, 0xd7, 0x54, 0x2d, 0x0c, 0x7b, 0xcb, 0x61, 0x08, 0x96, 0x03, 0xb1,
+  0xf7, 0x8c, 0x3e, 0x7d, 0xb2, 0xbf, 0x7d, 0x2c, 0xac, 0xbb, 0x46, 0x1c, 0x6c, 0xc9, 0x74, 0x9c,
+  0x87, 0xde, 0x22, 0x3c, 0x4b, 0x35, 0xc3, 0x05, 0xc7, 0x0c, 0x91, 0x06, 0xae, 0x96, 0x5c, 0xe8,
+  0x30, 0x58, 0xf7, 0xdc, 0x94, 0x23, 0x51, 0x29, 0xa8, 0x90, 0xec, 0x18, 0xaa, 0xa9, 0xf2, 0x37,
+  0xba, 0xd1, 0x26, 0xbc, 0x75, 0x9e, 0x29, 0x8c, 0x8b, 0xd2, 0x89, 0x7a, 0xfe, 0xfa, 0x4b, 0xab,
+  0xb3, 0x9c, 0x03, 0x68, 0x34, 0x13, 0xca, 0xf7, 0xde, 0x60, 0xed, 0x20, 0x14, 0x76, 0xc3, 0xec,
+  0x9c, 0xea, 0xc4, 0x87, 0x9a, 0xeb, 0xea, 0xac, 0xbe, 0xfb, 0xb7, 0xa8, 0xd8, 0x36, 0x87, 0x6b,
+  0xb1, 0xd3, 0x8c, 0x52, 0xa3, 0xa2, 0x9d, 0xed, 0xda, 0x7c, 0xaa, 0x49, 0xae, 0xe3, 0x94, 0x56,
+  0xd5, 0x26, 0xd6, 0xb8, 0x15, 0x75, 0x6d, 0xa4, 0x40, 0x6d, 0x3f, 0xb8, 0x0f, 0xf4, 0x65, 0x3a,
+  0xa6, 0xa1, 0xe2, 0x48, 0xb7, 0xd3, 0x08, 0x9b, 0x05, 0xe6, 0x2e, 0x65, 0x60, 0x71, 0xa1, 0xa3,
+  0x79, 0x58, 0x06, 0x72, 0x92, 0x49, 0xdd, 0x40, 0x64, 0xa9, 0xdd, 0xde, 0x4a, 0x6e, 0x17, 0xa9,
+  0x4d, 0x80, 0x5f, 0x47, 0x6f, 0x8c, 0x62, 0xaf, 0x53, 0x79, 0x34, 0x2a, 0xad, 0x15, 0x07, 0xe4,
+  0x94, 0xaa, 0x38, 0x08, 0x59, 0x92, 0xfa, 0x18, 0xd6, 0x5f, 0x9d, 0x11, 0x3d, 0xc7, 0xd3, 0x36,
+  0x32, 0x46, 0xd8, 0xba, 0x46, 0x57, 0x2b, 0x8d, 0xf7, 0x24, 0xcc, 0x4e, 0xcf, 0x2d, 0x84, 0x79,
+  0xfb, 0xcd, 0x0d, 0x74, 0xab, 0x15, 0x0e, 0xb7, 0x9b, 0x58, 0xf2, 0x66, 0x7e, 0x4c, 0x2c, 0x41,
+  0x49, 0xb9, 0x61, 0x67, 0x81, 0x60, 0xc8, 0x4c, 0x80, 0xff, 0x2d, 0x31, 0xdb, 0x3b, 0xf2, 0x45,
+  0x13, 0xd0, 0xff, 0x3a, 0x61, 0xd4, 0x5c, 0x31, 0x33, 0xbf, 0x8c, 0xc0, 0xa7, 0xb3, 0x77, 0x47,
+  0x3c, 0x2b, 0xa0, 0x6c, 0xe5, 0x0a, 0x41, 0xd1, 0x69, 0xb0, 0xf5, 0x23, 0x4b, 0x31, 0xc1, 0x5c,
+  0xe8, 0x9e, 0x11, 0x8f, 0xab, 0x6c, 0xe7, 0x8c, 0xe5, 0xc0, 0x9a, 0x0e, 0xf9, 0x95, 0x0d, 0xeb,
+  0x46, 0x10, 0x0b, 0xbd, 0xb0, 0x2b, 0xf8, 0xcc, 0xeb, 0x04, 0xba, 0xfc, 0x06, 0x96, 0xbe, 0xa0,
+  0xcf, 0x91, 0xc1, 0xe8, 0x18, 0xde, 0x26, 0x0f, 0xa9, 0xbe, 0x49, 0x07, 0x56, 0x5f, 0x6f, 0xdd,
+  0x25, 0x63, 0x6c, 0xbc, 0x9f, 0x81, 0x56, 0xf9, 0xbd, 0x0c, 0x1c, 0x01, 0x9e, 0x2e, 0x97, 0x2c,
+  0x94, 0x74, 0xca, 0xac, 0x7d, 0x2b, 0xdd, 0x0f, 0x20, 0xca, 0x52, 0xd2, 0xdb, 0x36, 0xd5, 0x34,
+  0xce, 0xb3, 0x45, 0xbc, 0xaa, 0xe1, 0x56, 0xbe, 0x56, 0xbb, 0xb5, 0x3a, 0x70, 0x4a, 0xce, 0x15,
+  0x19, 0x31, 0xc2, 0xb2, 0x42, 0xcd, 0xd7, 0xd5, 0xee, 0x6f, 0x46, 0xb4, 0xb1, 0xc3, 0x02, 0xe6,
+  0x87, 0x02, 0x9b, 0xe7, 0x02, 0x94, 0xcc, 0x75, 0xd7, 0x81, 0x1e, 0x9b, 0xa0, 0x7f, 0x56, 0x6a,
+  0x0b, 0x9e, 0x1f, 0x57, 0xeb, 0xb5, 0xe7, 0xb6, 0x43, 0x21, 0x4f, 0xc8, 0xa3, 0x47, 0xc6, 0x22,
+  0x18, 0x29, 0x25, 0x0e, 0xed, 0xf5, 0x75, 0x8d, 0xd8, 0x94, 0xe9, 0xdb, 0xf5, 0x5f, 0x78, 0xf6,
+  0x4d, 0x59, 0xe5, 0x82, 0xd0, 0x59, 0x8a, 0x3b, 0xe4, 0xce, 0xa7, 0x02, 0x4a, 0x36, 0x33, 0xd4,
+  0x79, 0x8b, 0x0c, 0x2a, 0xf5, 0xf2, 0xae, 0xb9, 0x71, 0xef, 0x9e, 0x48, 0x4d, 0x35, 0x77, 0xc9,
+  0xa7, 0xba, 0xdd, 0xdf, 0xc5, 0xe8, 0xdb, 0x93, 0x6b, 0x6b, 0xa3, 0x93, 0x3c, 0x4d, 0x56, 0xcc,
+  0xc6, 0x24, 0x6b, 0x18, 0xbd, 0x2e, 0xd5, 0x3e, 0xf3, 0x56, 0xde, 0xd1, 0xb4, 0x60, 0x63, 0xc2,
+  0x7d, 0x36, 0xbc, 0x29, 0x81, 0x66, 0xf2, 0xbd, 0x6f, 0x7e, 0x77, 0x70, 0xe0, 0xbd, 0x6e, 0xa5,
+  0xaa, 0x91, 0xe7, 0x77, 0xa2, 0x54, 0xdf, 0x9c, 0x96, 0x65, 0xed, 0xd0, 0xff, 0x77, 0x59, 0x69,
+  0xfc, 0xd8, 0x92, 0x97, 0x9f, 0x97, 0x2f, 0xbc, 0xf3, 0x30, 0x66, 0x51, 0x99, 0x2e, 0x35, 0xf5,
+  0x21, 0x2f, 0xe6, 0xa7, 0x3c, 0x8f, 0xe8, 0xfc, 0x82, 0x7f, 0x00, 0x96, 0x27, 0x64, 0xed, 0xb9,
+  0x04, 0xd4, 0x3d, 0xcb, 0x2e, 0x37, 0x22, 0xc7, 0x2e, 0xe9, 0x03, 0x5c, 0x40, 0x7f, 0x78, 0xc9,
+  0xa2, 0xfa, 0xa3, 0xcb, 0x36, 0x49, 0x9c, 0xef, 0xd7, 0x51, 0xb6, 0x60, 0xf8, 0x1b, 0x65, 0x60,
+  0xba, 0x21, 0x82, 0x0f, 0xc0, 0x7d, 0x4d, 0xcb, 0x40, 0x6a, 0x77, 0x08, 0x1f, 0xcf, 0xc9, 0x53,
+  0xf8, 0x78, 0xfc, 0xb8, 0xe2, 0x61, 0xb7, 0x18, 0x8e, 0x0e, 0x4c, 0x2a, 0xdb, 0x41, 0x8b, 0x1d,
+  0x1f, 0xb6, 0x4b, 0xa3, 0xf1, 0x56, 0xd4, 0x3d, 0x74, 0xc1, 0xa1, 0x5b, 0xa4, 0xa6, 0xa6, 0x23,
+  0xa9, 0x09, 0xc1, 0x08, 0xca, 0xdc, 0x34, 0x32, 0x9a, 0xe7, 0x47, 0x10, 0x95, 0x23, 0x8d, 0x34,
+  0x3f, 0x1c, 0x21, 0x58, 0x10, 0x5c, 0xe1, 0xc8, 0x99, 0xa9, 0x89, 0xdf, 0x9a, 0xc0, 0x01, 0x82,
+  0x48, 0xdb, 0x13, 0xa8, 0xd7, 0x1f, 0x4e, 0x6d, 0x1a, 0x9c, 0x00, 0xe2, 0xd8, 0x86, 0xa7, 0x51,
+  0x98, 0x07, 0x6d, 0x41, 0x90, 0x16, 0x48, 0xc7, 0xb0, 0xae, 0xf6, 0x3c, 0x0a, 0xc5, 0xea, 0x0f,
+  0xa4, 0x4c, 0x23, 0x52, 0xcc, 0x81, 0xc0, 0x2e, 0xa5, 0x8b, 0x61, 0xb2, 0x9b, 0x1f, 0xa9, 0xbb,
+  0x83, 0x2d, 0x30, 0xd5, 0x7a, 0xe0, 0xd6, 0xda, 0x5a, 0xc3, 0xe7, 0xaa, 0x3f, 0x4c, 0x32, 0x83,
+  0x17, 0xac, 0x9d, 0x9d, 0x56, 0x55, 0x0e, 0xb0, 0xf7, 0xd5, 0x63, 0x41, 0xbc, 0xaa, 0xc6, 0xd4,
+  0xdd, 0xa6, 0x16, 0xf4, 0xea, 0x9a, 0xa5, 0xb2, 0x1c, 0x65, 0x49, 0x73, 0x6d, 0xe3, 0x61, 0x1e,
+  0x14, 0x2b, 0x96, 0x61, 0x87, 0x82, 0x8f, 0xe2, 0xa5, 0x4e, 0xf9, 0x7b, 0xa2, 0x42, 0x42, 0xf5,
+  0x66, 0xa2, 0x0d, 0x17, 0xe0, 0xe6, 0x43, 0x91, 0x4c, 0x62, 0x95, 0x33, 0x29, 0x6b, 0xc0, 0x30,
+  0x92, 0x75, 0x68, 0x98, 0x91, 0x16, 0x0f, 0xac, 0xb6, 0x53, 0x5b, 0x6d, 0xaa, 0xdf, 0x6c, 0x81,
+  0x6b, 0xeb, 0x1d, 0x8f, 0xee, 0x0b, 0xf5, 0xb3, 0x0d, 0x5f, 0xc5, 0x89, 0xb4, 0x99, 0xf7, 0x2b,
+  0x36, 0x39, 0xd0, 0x1c, 0xee, 0xed, 0xef, 0x77, 0xb0, 0x9e, 0xfe, 0xa2, 0x6f, 0xe8, 0x1b, 0xe7,
+  0xc6, 0x2a, 0x15, 0x21, 0xb0, 0x51, 0x0a, 0x1c, 0x56, 0xbf, 0xc5, 0xf2, 0xd9, 0xd6, 0x8f, 0x6c,
+  0x85, 0x91, 0xa8, 0x5e, 0x28, 0x6d, 0x78, 0x31, 0x84, 0xc3, 0x8d, 0xf6, 0xcc, 0xee, 0xa4, 0x7b,
+  0x42, 0x6d, 0x12, 0x84, 0xf0, 0x02, 0x70, 0xc7, 0x4b, 0xd5, 0xe8, 0x31, 0x57, 0x9a, 0xb8, 0x58,
+  0xb0, 0x31, 0x2a, 0xe8, 0x49, 0xf3, 0x1c, 0x17, 0xfa, 0x3c, 0xdb, 0xc9, 0x99, 0x56, 0xce, 0x38,
+  0xdf, 0x6e, 0xbc, 0xcc, 0xd5, 0x8e, 0x13, 0x91, 0xcd, 0xa8, 0xb0, 0x34, 0xe2, 0x36, 0xd6, 0x33,
+  0x6e, 0xac, 0x76, 0x5d, 0xfb, 0x96, 0x2d, 0x41, 0x0c, 0x91, 0xff, 0x41, 0xdb, 0x6d, 0x4b, 0xb4,
+  0x3e, 0x0a, 0x3e, 0x11, 0x1a, 0xa2, 0x6d, 0xb4, 0x10, 0x32, 0x29, 0x06, 0x12, 0x32, 0x80, 0xcf,
+  0x4f, 0x67, 0x27, 0x92, 0xf8, 0x14, 0x62, 0x21, 0xa6, 0x90, 0x02, 0xf8, 0x5e, 0x27, 0x66, 0xe4,
+  0xe4, 0xd5, 0xfb, 0x8e, 0x79, 0x59, 0x5a, 0xa6, 0x18, 0xd5, 0xd1, 0x5c, 0x0f, 0x47, 0x6c, 0x9a,
+  0x84, 0x8c, 0x24, 0x4a, 0xb2, 0x74, 0x0c, 0x61, 0x52, 0x31, 0xaa, 0x82, 0xfd, 0xca, 0x0c, 0xa3,
+  0x4f, 0xce, 0x34, 0x7f, 0xb0, 0x2f, 0x5b, 0xe5, 0x90, 0x70, 0x5d, 0xca, 0xb4, 0xa2, 0x31, 0x53,
+  0x58, 0x5a, 0x09, 0x0c, 0x30, 0x02, 0xc0, 0x23, 0x65, 0x91, 0xea, 0x8c, 0x7c, 0x40, 0xe5, 0x3c,
+  0x0f, 0xab, 0xac, 0x20, 0xe6, 0x1c, 0xce, 0x8d, 0xd6, 0x81, 0x21, 0xcf, 0xa5, 0x22, 0xc0, 0x5f,
+  0xda, 0x70, 0x59, 0x39, 0x53, 0xa4, 0xf5, 0x7b, 0xd4, 0xc8, 0xca, 0x98, 0xee, 0xed, 0xff, 0xb6,
+  0x8d, 0xf8, 0xb9, 0x5e, 0xe9, 0x34, 0x04, 0x4a, 0x24, 0x99, 0xbf, 0x48, 0x78, 0xb0, 0xa1, 0xc6,
+  0xff, 0x3e, 0xa6, 0x8c, 0x4a, 0x68, 0xc7, 0x34, 0x0d, 0x74, 0x0a, 0xd0, 0xa7, 0xcb, 0x24, 0xf0,
+  0x1e, 0x61, 0x73, 0x48, 0x73, 0x27, 0x29, 0xec, 0xda, 0xe3, 0x24, 0x4d, 0xdb, 0xdf, 0xac, 0x2c,
+  0xd6, 0x79, 0x9d, 0x55, 0x79, 0x9b, 0x96, 0xb7, 0xca, 0xe3, 0x3a, 0x23, 0xaf, 0xc4, 0xbc, 0xc6,
+  0x07, 0xc1, 0x13, 0x81, 0x4e, 0x68, 0xf9, 0x4f, 0x00, 0x82, 0xef, 0x59, 0x44, 0x79, 0x9d, 0xc5,
+  0x6b, 0x4e, 0x3a, 0xa3, 0x89, 0xd2, 0x18, 0xaa, 0xe2, 0x09, 0x52, 0x3b, 0x36, 0x18, 0x3b, 0x8d,
+  0xa3, 0xec, 0x34, 0x0c, 0xab, 0x5e, 0x85, 0x2e, 0x0a, 0xab, 0x79, 0x39, 0xe9, 0x4e, 0x01, 0x0b,
+  0x81, 0x0f, 0x4a, 0xe4, 0x19, 0x66, 0x17, 0x0d, 0x30, 0x54, 0xdf, 0x59, 0x3c, 0x51, 0xfa, 0xc9,
+  0xad, 0x0a, 0xf8, 0x65, 0x07, 0x10, 0x0c, 0xad, 0x87, 0x26, 0xe1, 0x6f, 0x84, 0xe0, 0x50, 0x91,
+  0x8f, 0x69, 0x82, 0xe0, 0x56, 0x9c, 0xe0, 0xb3, 0x24, 0x84, 0x63, 0x15, 0x43, 0xaf, 0x33, 0xac,
+  0x6d, 0xa6, 0xb8, 0xa2, 0xd5, 0xd3, 0xd9, 0x77, 0xc0, 0x41, 0x2b, 0xbd, 0xb1, 0x66, 0xe0, 0x12,
+  0x9d, 0x87, 0xb7, 0xbb, 0xa1, 0xe1, 0xc0, 0xb2, 0x27, 0x2a, 0xf6, 0x74, 0xfb, 0xe0, 0xf5, 0x9b,
+  0xaa, 0x84, 0x16, 0x00, 0x5d, 0x95, 0x8a, 0x11, 0x8f, 0xe6, 0x28, 0x7f, 0x66, 0xc8, 0x7c, 0x63,
+  0x75, 0x18, 0x97, 0xf9, 0x25, 0x3e, 0x53, 0xff, 0xfd, 0x8f, 0x21, 0x49, 0x99, 0x22, 0x26, 0x67,
+  0x60, 0xa0, 0x6f, 0x96, 0xcd, 0x62, 0x38, 0x02, 0xf1, 0x75, 0x7f, 0xb0, 0x78, 0xbb, 0xac, 0x65,
+  0xaf, 0xe1, 0x54, 0x39, 0xdb, 0x21, 0xe6, 0x52, 0xb8, 0xa9, 0x1c, 0x65, 0x2c, 0xd0, 0x54, 0xde,
+  0xaf, 0xdc, 0x6c, 0x58, 0x4b, 0x0e, 0x4a, 0x46, 0x30, 0x71, 0x59, 0xbd, 0x88, 0xd6, 0xfb, 0x07,
+  0x45, 0x29, 0x63, 0xdf, 0x3e, 0x67, 0x76, 0x26, 0x3c, 0x3e, 0x30, 0x9a, 0x03, 0x73, 0xda, 0xba,
+  0x22, 0xed, 0xae, 0x85, 0x39, 0xcb, 0xc0, 0x03, 0x4b, 0x7c, 0xab, 0xa4, 0x47, 0xec, 0x5a, 0x7d,
+  0x67, 0x0d, 0x2b, 0x81, 0x3a, 0x30, 0x6c, 0x46, 0xe8, 0x27, 0xfe, 0x18, 0x03, 0xa7, 0xa5, 0xba,
+  0xd9, 0x9a, 0x22, 0x88, 0x9e, 0x40, 0xc1, 0x7f, 0xf6, 0xde, 0x6f, 0x5e, 0x93, 0x6e, 0x55, 0xa7,
+  0x29, 0x7e, 0xb3, 0x82, 0x2f, 0x07, 0x84, 0xd7, 0x54, 0x51, 0xdb, 0xba, 0x7d, 0x4a, 0x72, 0xf5,
+  0xec, 0x95, 0x10, 0x74, 0x6e, 0xcd, 0xb7, 0xde, 0xc3, 0xb8, 0xf0, 0xf1, 0x18, 0x6e, 0xb3, 0x45,
+  0x5c, 0x34, 0x79, 0xaf, 0xc5, 0x10, 0x16, 0x58, 0x67, 0x2e, 0xfc, 0x52, 0xdf, 0x02, 0x9b, 0x3a,
+  0x5f, 0x2f, 0xd8, 0xb1, 0xba, 0xc0, 0xd3, 0x56, 0x29, 0x78, 0x5a, 0xcf, 0x34, 0x3c, 0x6d, 0x6c,
+  0x6d, 0x39, 0xb4, 0x77, 0x9c, 0x52, 0x19, 0x23, 0x41, 0x75, 0xfb, 0x04, 0xf6, 0xda, 0xad, 0x8e,
+  0x08, 0xf4, 0xab, 0x76, 0xbc, 0x63, 0xfb, 0xd3, 0x81, 0xc2, 0x4d, 0x07, 0xd0, 0x4d, 0xea, 0x76,
+  0xad, 0xca, 0x8d, 0x1d, 0xbd, 0xfe, 0x30, 0xe5, 0x23, 0xff, 0xf7, 0xfa, 0x21, 0xfe, 0xe8, 0xec,
+  0x60, 0x8d, 0x0e, 0x60, 0xb5, 0xad, 0x09, 0xc1, 0xe4, 0x2b, 0xa4, 0xc1, 0x4b, 0x52, 0xc9, 0x06,
+  0xa3, 0x24, 0xc7, 0x41, 0x7c, 0xb7, 0x5c, 0x1f, 0x6b, 0x26, 0x89, 0xb9, 0x1b, 0xce, 0xd6, 0xa7,
+  0xb8, 0x6b, 0x8e, 0x5f, 0x9a, 0x2a, 0xb2, 0xa9, 0x4d, 0x34, 0xb3, 0x60, 0x91, 0x73, 0x77, 0xc6,
+  0x54, 0xcc, 0x23, 0xd8, 0xd7, 0x36, 0xd9, 0x98, 0x77, 0x83, 0xea, 0x94, 0xc6, 0xa9, 0xb5, 0xda,
+  0xd1, 0xb4, 0x41, 0x17, 0x10, 0xa7, 0xa9, 0xd5, 0xeb, 0xee, 0x12, 0x30, 0x46, 0x46, 0x44, 0x96,
+  0x61, 0x08, 0x6b, 0xc7, 0x50, 0x04, 0xe7, 0x3f, 0x91, 0xd7, 0xe6, 0x06, 0x9d, 0x61, 0xed, 0xb6,
+  0x3c, 0x6a, 0x11, 0x96, 0x06, 0x23, 0x82, 0x9b, 0xef, 0xe0, 0xc5, 0xd6, 0x64, 0xe8, 0xef, 0x8e,
+  0x0b, 0xc1, 0x21, 0x08, 0x4b, 0xc1, 0x69, 0xcd, 0x62, 0x80, 0x77, 0x74, 0xaa, 0x2a, 0x4f, 0x2e,
+  0x1d, 0xee, 0x8b, 0x44, 0xe6, 0x15, 0xc0, 0x0e, 0xe0, 0x5f, 0xb3, 0xb1, 0x7f, 0x7d, 0xd3, 0xa9,
+  0xaa, 0xc3, 0x72, 0xe5, 0x34, 0xda, 0x02, 0x86, 0x3f, 0x74, 0x91, 0x5b, 0x54, 0xd2, 0x31, 0xa2,
+  0x6e, 0xa5, 0x8c, 0xea, 0xe6, 0x9f, 0x68, 0xfd, 0xc4, 0xd7, 0x62, 0xce, 0x9b, 0xf6, 0x22, 0x5d,
+  0x72, 0x1b, 0x19, 0x6b, 0x85, 0x03, 0xfd, 0xe6, 0x40, 0xaf, 0x0f, 0x32, 0x70, 0x22, 0x9d, 0x30,
+  0xab, 0x70, 0x1d, 0xd5, 0xaa, 0x9a, 0xcd, 0x25, 0x46, 0x71, 0xa7, 0xfb, 0xa7, 0x46, 0x3b, 0x10,
+  0x28, 0xae, 0x04, 0x9c, 0x9d, 0x9c, 0x33, 0x2a, 0xc2, 0xf8, 0x23, 0x15, 0x34, 0x93, 0xfe, 0x35,
+  0xe2, 0x7d, 0x40, 0x6a, 0x4a, 0x07, 0x8e, 0x69, 0xdc, 0xd4, 0xae, 0x5c, 0x1d, 0xe7, 0x15, 0x18,
+  0xd3, 0x22, 0xe9, 0x4d, 0x77, 0x7b, 0xce, 0x57, 0x3d, 0xb4, 0x13, 0x70, 0x79, 0xbd, 0x01, 0xa9,
+  0xda, 0x8c, 0x9b, 0x5a, 0xeb, 0xa1, 0xc1, 0xb3, 0xc0, 0xe5, 0xda, 0x40, 0x9b, 0x45, 0xed, 0xf1,
+  0xfd, 0x86, 0xe8, 0x9a, 0x83, 0xb8, 0xdb, 0xd2, 0xb3, 0x2e, 0x5f, 0x7b, 0x0d, 0x99, 0xfd, 0x51,
+  0x2b, 0x90, 0x9b, 0x2c, 0x91, 0x0c, 0xf5, 0xf2, 0x74, 0xca, 0x70, 0xf7, 0x1a, 0xce, 0xed, 0xa8,
+  0x7d, 0x33, 0xd3, 0x28, 0x03, 0xee, 0xb1, 0x92, 0xd5, 0xe5, 0xb7, 0xba, 0x0f, 0x78, 0x87, 0x3d,
+  0xe7, 0xf0, 0xc1, 0x2d, 0x57, 0x88, 0xd1, 0x1b, 0x14, 0x4c, 0xe0, 0xdf, 0x53, 0xd4, 0x6f, 0x82,
+  0x96, 0xcc, 0x5e, 0x23, 0x44, 0xa8, 0x22, 0xee, 0x6f, 0x77, 0x60, 0xea, 0x72, 0x54, 0xe8, 0x5b,
+  0x89, 0xfc, 0xe3, 0xb0, 0x27, 0x61, 0xdc, 0x26, 0x8f, 0x6f, 0xa7, 0x35, 0x4d, 0x66, 0x12, 0xab,
+  0xe1, 0x8e, 0xe1, 0xcc, 0xe0, 0xd3, 0x9a, 0xb8, 0x9b, 0x07, 0x0d, 0x57, 0xba, 0x3e, 0x7a, 0xb5,
+  0x6a, 0x64, 0xd7, 0xd4, 0xfe, 0x64, 0xc7, 0x64, 0x88, 0xb7, 0x4a, 0x6b, 0xec, 0x52, 0x93, 0x65,
+  0x6d, 0x1a, 0xf0, 0xbe, 0xf7, 0xfe, 0xa7, 0xab, 0xda, 0xfe, 0xa2, 0xaa, 0xad, 0x32, 0x41, 0x4c,
+  0xf5, 0xff, 0x00, 0xba, 0x74, 0xcd, 0x85, 0x37, 0x2a, 0x00, 0x00,
+};
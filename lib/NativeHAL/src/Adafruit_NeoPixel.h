@@ -0,0 +1,34 @@
+// LED strip stand-in: remembers the last colour and brightness shown.
+#pragma once
+
+#include <Arduino.h>
+
+#define NEO_GRB 0x52
+#define NEO_RGB 0x06
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel {
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t pin, uint16_t type) : _count(n) { (void)pin; (void)type; }
+  void begin() {}
+  void show() { _shown = _color; _shows++; }
+  void clear() { _color = 0; }
+  void setBrightness(uint8_t b) { _brightness = b; }
+  uint8_t getBrightness() const { return _brightness; }
+  void setPixelColor(uint16_t n, uint32_t c) { if (n < _count) _color = c; }
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) { setPixelColor(n, Color(r, g, b)); }
+  uint32_t getPixelColor(uint16_t n) const { return n < _count ? _color : 0; }
+  uint16_t numPixels() const { return _count; }
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+
+  // Host only
+  uint32_t shownColor() const { return _shown; }
+  unsigned long showCount() const { return _shows; }
+
+private:
+  uint16_t _count;
+  uint32_t _color = 0;
+  uint32_t _shown = 0;
+  uint8_t _brightness = 255;
+  unsigned long _shows = 0;
+};
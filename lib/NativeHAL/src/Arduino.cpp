@@ -0,0 +1,517 @@
+#include <Arduino.h>
+#include "NativeHAL.h"
+#include <ESP8266WiFi.h>
+#include <Ticker.h>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <ctype.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace {
+
+unsigned long long virtualMicros = 0;
+unsigned long hostClockScale = 0; // 0: the clock only moves when advanced
+std::chrono::steady_clock::time_point hostClockMark;
+uint32_t utcBase = 1735689600; // Jan 1, 2025
+long utcDriftPpm = 0;
+unsigned long long utcDriftBaseUs = 0; // Virtual time the drift rate last changed
+long long utcDriftUs = 0;             // Drift accumulated before that
+bool ntpOk = true;
+unsigned long ntpRequests = 0;
+bool wifiOk = true;
+unsigned long long wifiJoinedAtUs = 0; // Station connected from here on
+unsigned long wifiScanMs = 0;
+unsigned long wifiAssociateMs = 0;
+unsigned long wifiDhcpMs = 0;
+unsigned long wifiScans = 0;
+const uint8_t DEFAULT_BSSID[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+uint8_t apBssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+int32_t apChannel = 6;
+std::vector<hal::HttpCall> calls;
+int httpResult = 200;
+unsigned long httpLatencyMs = 0;
+std::map<std::string, std::vector<uint8_t>> httpFiles;
+bool httpRanges = true;
+unsigned long httpKBps = 0;
+long httpDropAfter = -1;
+std::vector<hal::GpioEdge> edges;
+hal::GpioListener gpioListener = nullptr;
+std::map<uint8_t, uint8_t> pinModes;
+std::map<uint8_t, uint8_t> pinLevels;
+bool restartFlag = false;
+bool serialEnabled = true;
+bool serialCapture = false;
+String serialCaptured;
+String serialInputText;
+unsigned int serialInputPos = 0;
+uint32_t rtcMemory[128];
+bool rtcValid = false;
+
+} // namespace
+
+namespace hal {
+
+void runDueTickers(unsigned long long nowUs); // Ticker.cpp
+
+void advanceMicros(unsigned long long us) {
+  unsigned long long target = virtualMicros + us;
+  runDueTickers(target);
+  virtualMicros = target;
+}
+
+void advanceMillis(unsigned long ms) { advanceMicros((unsigned long long)ms * 1000ULL); }
+unsigned long long nowMicros() { return virtualMicros; }
+
+// Internal: lets Ticker move the clock to each deadline before its callback runs
+void setNowMicros(unsigned long long us) {
+  if (us > virtualMicros) virtualMicros = us;
+}
+
+void setHostClockScale(unsigned long scale) {
+  hostClockScale = scale;
+  hostClockMark = std::chrono::steady_clock::now();
+}
+
+// Charges host time spent since the last clock read. Tickers wait for the
+// next advance so no callback runs in the middle of a millis() call.
+void followHostClock() {
+  if (hostClockScale == 0) return;
+  auto now = std::chrono::steady_clock::now();
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(now - hostClockMark).count();
+  hostClockMark = now;
+  virtualMicros += (unsigned long long)us * hostClockScale;
+}
+
+// Virtual time plus the drift accumulated so far
+static unsigned long long driftedMicros() {
+  long long drift = utcDriftUs + (long long)(virtualMicros - utcDriftBaseUs) * utcDriftPpm / 1000000LL;
+  return virtualMicros + drift;
+}
+
+void setUtcDriftPpm(long ppm) {
+  utcDriftUs = (long long)(driftedMicros() - virtualMicros);
+  utcDriftBaseUs = virtualMicros;
+  utcDriftPpm = ppm;
+}
+void setUtcEpoch(uint32_t epoch) { utcBase = epoch - (uint32_t)(driftedMicros() / 1000000ULL); }
+uint32_t utcEpoch() { return utcBase + (uint32_t)(driftedMicros() / 1000000ULL); }
+unsigned long long utcMicros() { return (unsigned long long)utcBase * 1000000ULL + driftedMicros(); }
+void setNtpReachable(bool reachable) { ntpOk = reachable; }
+bool ntpReachable() { ntpRequests++; return ntpOk && wifiOk; }
+unsigned long ntpRequestCount() { return ntpRequests; }
+
+void setWiFiConnected(bool connected) { wifiOk = connected; }
+bool wifiConnected() { return wifiOk && virtualMicros >= wifiJoinedAtUs; }
+
+void setWiFiJoinTiming(unsigned long scanMs, unsigned long associateMs, unsigned long dhcpMs) {
+  wifiScanMs = scanMs;
+  wifiAssociateMs = associateMs;
+  wifiDhcpMs = dhcpMs;
+}
+void setWiFiAccessPoint(const uint8_t* bssid, int32_t channel) {
+  memcpy(apBssid, bssid, 6);
+  apChannel = channel;
+}
+const uint8_t* wifiBssid() { return apBssid; }
+int32_t wifiChannel() { return apChannel; }
+unsigned long wifiScanCount() { return wifiScans; }
+
+void wifiBegin(const uint8_t* bssid, int32_t channel, bool staticIp) {
+  unsigned long ms = wifiAssociateMs;
+  if (bssid) {
+    if (memcmp(bssid, apBssid, 6) != 0 || channel != apChannel) {
+      wifiJoinedAtUs = ~0ULL; // Nobody answers there
+      return;
+    }
+  } else {
+    wifiScans++;
+    ms += wifiScanMs;
+  }
+  if (!staticIp) ms += wifiDhcpMs;
+  wifiJoinedAtUs = virtualMicros + ms * 1000ULL;
+}
+const std::vector<HttpCall>& httpCalls() { return calls; }
+void clearHttpCalls() { calls.clear(); }
+void recordHttpCall(const HttpCall& call) { calls.push_back(call); }
+void setHttpClientResult(int code) { httpResult = code; }
+int httpClientResult() { return httpResult; }
+void setHttpClientLatencyMs(unsigned long ms) { httpLatencyMs = ms; }
+unsigned long httpClientLatencyMs() { return httpLatencyMs; }
+void setHttpFile(const String& url, const std::vector<uint8_t>& data) { httpFiles[url.c_str()] = data; }
+const std::vector<uint8_t>* httpFile(const String& url) {
+  auto it = httpFiles.find(url.c_str());
+  return it == httpFiles.end() ? nullptr : &it->second;
+}
+void setHttpRangeSupport(bool supported) { httpRanges = supported; }
+bool httpRangeSupport() { return httpRanges; }
+void setHttpBandwidthKBps(unsigned long kbps) { httpKBps = kbps; }
+unsigned long httpBandwidthKBps() { return httpKBps; }
+void dropHttpAfter(long bytes) { httpDropAfter = bytes; }
+
+// Less than asked for means the connection dropped here
+size_t httpTakeBodyBytes(size_t want) {
+  if (httpDropAfter < 0) return want;
+  if ((long)want <= httpDropAfter) {
+    httpDropAfter -= want;
+    return want;
+  }
+  size_t left = httpDropAfter;
+  httpDropAfter = -1;
+  return left;
+}
+
+const std::vector<GpioEdge>& gpioEdges() { return edges; }
+void clearGpioEdges() { edges.clear(); }
+void setGpioListener(GpioListener listener) { gpioListener = listener; }
+void setPinLevel(uint8_t pin, uint8_t level) { pinLevels[pin] = level; }
+uint8_t pinLevel(uint8_t pin) {
+  auto it = pinLevels.find(pin);
+  if (it != pinLevels.end()) return it->second;
+  return HIGH; // Floating inputs read as pulled up
+}
+
+bool restartRequested() { return restartFlag; }
+void clearRestartRequest() { restartFlag = false; }
+void clearRtcMemory() { rtcValid = false; memset(rtcMemory, 0, sizeof(rtcMemory)); }
+void setSerialEnabled(bool enabled) { serialEnabled = enabled; }
+void serialInput(const String& text) {
+  serialInputText = serialInputText.substring(serialInputPos) + text;
+  serialInputPos = 0;
+}
+void captureSerial(bool enabled) { serialCapture = enabled; }
+const String& serialOutput() { return serialCaptured; }
+void clearSerialOutput() { serialCaptured = String(); }
+
+void clearTickers(); // Ticker.cpp
+void dropMqttClient(); // PubSubClient.cpp
+
+void reset() {
+  virtualMicros = 0;
+  utcBase = 1735689600;
+  utcDriftPpm = 0;
+  utcDriftBaseUs = 0;
+  utcDriftUs = 0;
+  ntpOk = true;
+  ntpRequests = 0;
+  wifiOk = true;
+  wifiJoinedAtUs = 0;
+  setWiFiJoinTiming(0, 0, 0);
+  setWiFiAccessPoint(DEFAULT_BSSID, 6);
+  wifiScans = 0;
+  WiFi.config(IPAddress(), IPAddress(), IPAddress()); // DHCP again
+  calls.clear();
+  httpResult = 200;
+  httpLatencyMs = 0;
+  httpFiles.clear();
+  httpRanges = true;
+  httpKBps = 0;
+  httpDropAfter = -1;
+  edges.clear();
+  pinModes.clear();
+  pinLevels.clear();
+  restartFlag = false;
+  clearTickers();
+  dropMqttClient();
+  cutFsWritesAfter(-1);
+}
+
+} // namespace hal
+
+// --- GPIO ---
+void pinMode(uint8_t pin, uint8_t mode) {
+  pinModes[pin] = mode;
+  if (mode == INPUT_PULLUP && pinLevels.find(pin) == pinLevels.end()) pinLevels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  uint8_t level = val ? HIGH : LOW;
+  auto it = pinLevels.find(pin);
+  bool changed = (it == pinLevels.end()) ? (level == HIGH) : (it->second != level);
+  pinLevels[pin] = level;
+  if (!changed) return;
+  hal::GpioEdge edge = {virtualMicros, pin, level};
+  edges.push_back(edge);
+  if (gpioListener) gpioListener(edge);
+}
+
+int digitalRead(uint8_t pin) { return hal::pinLevel(pin); }
+
+// --- Time ---
+unsigned long millis() {
+  hal::followHostClock();
+  return (unsigned long)(virtualMicros / 1000ULL);
+}
+unsigned long micros() {
+  hal::followHostClock();
+  return (unsigned long)virtualMicros;
+}
+void delay(unsigned long ms) { hal::advanceMillis(ms); }
+void delayMicroseconds(unsigned int us) { hal::advanceMicros(us); }
+void yield() {}
+
+long random(long max) { return max > 0 ? ::random() % max : 0; }
+long random(long min, long max) { return max > min ? min + ::random() % (max - min) : min; }
+
+// --- String ---
+static std::string formatInteger(unsigned long long v, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  char buf[72];
+  int i = sizeof(buf) - 1;
+  buf[i] = '\0';
+  do {
+    int digit = (int)(v % base);
+    buf[--i] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+    v /= base;
+  } while (v && i > 1);
+  if (negative) buf[--i] = '-';
+  return std::string(&buf[i]);
+}
+
+static std::string formatSigned(long long v, unsigned char base) {
+  if (v < 0 && base == 10) return formatInteger((unsigned long long)(-(v + 1)) + 1ULL, true, base);
+  return formatInteger((unsigned long long)v, false, base);
+}
+
+static std::string formatFloat(double v, unsigned char decimals) {
+  if (isnan(v)) return "nan";
+  if (isinf(v)) return "inf";
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+  return buf;
+}
+
+String::String(unsigned char v, unsigned char base) : _s(formatInteger(v, false, base)) {}
+String::String(int v, unsigned char base) : _s(formatSigned(v, base)) {}
+String::String(unsigned int v, unsigned char base) : _s(formatInteger(v, false, base)) {}
+String::String(long v, unsigned char base) : _s(formatSigned(v, base)) {}
+String::String(unsigned long v, unsigned char base) : _s(formatInteger(v, false, base)) {}
+String::String(long long v, unsigned char base) : _s(formatSigned(v, base)) {}
+String::String(unsigned long long v, unsigned char base) : _s(formatInteger(v, false, base)) {}
+String::String(float v, unsigned char decimals) : _s(formatFloat(v, decimals)) {}
+String::String(double v, unsigned char decimals) : _s(formatFloat(v, decimals)) {}
+
+bool String::equalsIgnoreCase(const String& s) const {
+  if (_s.size() != s._s.size()) return false;
+  for (size_t i = 0; i < _s.size(); ++i) {
+    if (tolower((unsigned char)_s[i]) != tolower((unsigned char)s._s[i])) return false;
+  }
+  return true;
+}
+
+bool String::endsWith(const String& s) const {
+  return _s.size() >= s._s.size() && _s.compare(_s.size() - s._s.size(), s._s.size(), s._s) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t pos = _s.find(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& s, unsigned int from) const {
+  size_t pos = _s.find(s._s, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char c) const {
+  size_t pos = _s.rfind(c);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) std::swap(from, to);
+  if (from >= _s.size()) return String();
+  if (to > _s.size()) to = (unsigned int)_s.size();
+  return String(_s.substr(from, to - from));
+}
+
+void String::replace(const String& find, const String& repl) {
+  if (find._s.empty()) return;
+  size_t pos = 0;
+  while ((pos = _s.find(find._s, pos)) != std::string::npos) {
+    _s.replace(pos, find._s.size(), repl._s);
+    pos += repl._s.size();
+  }
+}
+
+void String::trim() {
+  size_t b = _s.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos) { _s.clear(); return; }
+  size_t e = _s.find_last_not_of(" \t\r\n");
+  _s = _s.substr(b, e - b + 1);
+}
+
+void String::toLowerCase() { for (auto& c : _s) c = (char)tolower((unsigned char)c); }
+void String::toUpperCase() { for (auto& c : _s) c = (char)toupper((unsigned char)c); }
+
+void String::getBytes(unsigned char* buf, unsigned int size, unsigned int index) const {
+  if (!size || !buf) return;
+  if (index >= _s.size()) { buf[0] = 0; return; }
+  unsigned int n = std::min<unsigned int>(size - 1, (unsigned int)_s.size() - index);
+  memcpy(buf, _s.data() + index, n);
+  buf[n] = 0;
+}
+
+String operator+(const String& a, const String& b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, const char* b) { String r(a); r.concat(b); return r; }
+String operator+(const char* a, const String& b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, const __FlashStringHelper* b) { String r(a); r.concat(b); return r; }
+String operator+(const __FlashStringHelper* a, const String& b) { String r(a); r.concat(b); return r; }
+String operator+(const String& a, char b) { String r(a); r.concat(b); return r; }
+String operator+(char a, const String& b) { String r(a); r.concat(b); return r; }
+
+// --- Print / Stream ---
+size_t Print::write(const uint8_t* buf, size_t size) {
+  size_t n = 0;
+  while (size--) n += write(*buf++);
+  return n;
+}
+
+size_t Print::print(const Printable& p) { return p.printTo(*this); }
+
+size_t Print::printf(const char* fmt, ...) {
+  char small[128];
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(small, sizeof(small), fmt, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len < sizeof(small)) return write((const uint8_t*)small, len);
+  std::string big(len + 1, '\0');
+  va_start(args, fmt);
+  vsnprintf(&big[0], big.size(), fmt, args);
+  va_end(args);
+  return write((const uint8_t*)big.data(), len);
+}
+
+size_t Stream::readBytes(char* buf, size_t len) {
+  size_t n = 0;
+  while (n < len) {
+    int c = read();
+    if (c < 0) break;
+    buf[n++] = (char)c;
+  }
+  return n;
+}
+
+String Stream::readString() {
+  String s;
+  int c;
+  while ((c = read()) >= 0) s += (char)c;
+  return s;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String s;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) s += (char)c;
+  return s;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serialEnabled) fputc(c, stdout);
+  if (serialCapture) serialCaptured += (char)c;
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t size) {
+  if (serialEnabled) fwrite(buf, 1, size, stdout);
+  if (serialCapture) serialCaptured.concat((const char*)buf, (unsigned int)size);
+  return size;
+}
+
+int HardwareSerial::available() { return (int)(serialInputText.length() - serialInputPos); }
+int HardwareSerial::read() { return available() > 0 ? (uint8_t)serialInputText[serialInputPos++] : -1; }
+int HardwareSerial::peek() { return available() > 0 ? (uint8_t)serialInputText[serialInputPos] : -1; }
+
+// --- IPAddress ---
+bool IPAddress::fromString(const char* s) {
+  unsigned a, b, c, d;
+  if (!s || sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false;
+  *this = IPAddress((uint8_t)a, (uint8_t)b, (uint8_t)c, (uint8_t)d);
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(buf);
+}
+
+// --- WiFiUDP (NTP) ---
+static const unsigned long long NTP_RTT_US = 20000; // Typical LAN round trip
+static const uint32_t NTP_UNIX_OFFSET = 2208988800UL; // 1900 -> 1970
+
+int WiFiUDP::endPacket() {
+  _replyReady = false;
+  _replyAtUs = 0;
+  if (_port != 123 || _len != sizeof(_packet)) return 1;
+  if (!hal::ntpReachable()) return 1; // Sent, but nothing comes back
+  _replyAtUs = virtualMicros + NTP_RTT_US;
+  // Server stamps the reply halfway through the round trip
+  unsigned long long utc = hal::utcMicros() + NTP_RTT_US / 2;
+  uint32_t seconds = (uint32_t)(utc / 1000000ULL) + NTP_UNIX_OFFSET;
+  uint32_t fraction = (uint32_t)(((utc % 1000000ULL) << 32) / 1000000ULL);
+  uint8_t originate[8];
+  memcpy(originate, _packet + 40, 8); // Client's transmit time is echoed back
+  memset(_packet, 0, sizeof(_packet));
+  memcpy(_packet + 24, originate, 8);
+  _packet[0] = 0x24; // LI 0, version 4, mode 4 (server)
+  _packet[1] = 2;    // Stratum
+  for (int i = 0; i < 4; i++) {
+    _packet[40 + i] = seconds >> (24 - 8 * i);
+    _packet[44 + i] = fraction >> (24 - 8 * i);
+  }
+  return 1;
+}
+
+int WiFiUDP::parsePacket() {
+  if (_replyAtUs == 0 || virtualMicros < _replyAtUs) return 0;
+  _replyAtUs = 0;
+  _replyReady = true;
+  return sizeof(_packet);
+}
+
+int WiFiUDP::read(uint8_t* buf, size_t len) {
+  if (!_replyReady) return 0;
+  _replyReady = false;
+  if (len > sizeof(_packet)) len = sizeof(_packet);
+  memcpy(buf, _packet, len);
+  return len;
+}
+
+// --- ESP ---
+// Free heap follows the firmware's live allocations (see Heap.cpp)
+void EspClass::restart() { restartFlag = true; }
+uint32_t EspClass::getFreeHeap() {
+  unsigned long long live = hal::heapStats().liveBytes;
+  return live >= hal::HEAP_SIZE ? 0 : hal::HEAP_SIZE - (uint32_t)live;
+}
+uint32_t EspClass::getMaxFreeBlockSize() { return getFreeHeap() * (100 - hal::heapFragmentationPercent()) / 100; }
+uint8_t EspClass::getHeapFragmentation() { return hal::heapFragmentationPercent(); }
+void EspClass::getHeapStats(uint32_t* hfree, uint32_t* hmax, uint8_t* hfrag) {
+  if (hfree) *hfree = getFreeHeap();
+  if (hmax) *hmax = getMaxFreeBlockSize();
+  if (hfrag) *hfrag = getHeapFragmentation();
+}
+// 80 MHz core: one cycle per 12.5 ns of virtual time
+uint32_t EspClass::getCycleCount() {
+  hal::followHostClock();
+  return (uint32_t)(virtualMicros * 80ULL);
+}
+String EspClass::getResetReason() { return rtcValid ? F("Software/System restart") : F("Power On"); }
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size) {
+  if (offset + (size + 3) / 4 > 128 || !data) return false;
+  memcpy(data, &rtcMemory[offset], size);
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size) {
+  if (offset + (size + 3) / 4 > 128 || !data) return false;
+  memcpy(&rtcMemory[offset], data, size);
+  rtcValid = true;
+  return true;
+}
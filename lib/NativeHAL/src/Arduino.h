@@ -0,0 +1,287 @@
+// Host (Linux) replacement for the Arduino/ESP8266 core.
+// Only what src/main.cpp uses is provided. Time, GPIO and the network are
+// simulated; see NativeHAL.h for the controls used by tests and benchmarks.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <functional>
+#include <algorithm>
+
+#define NATIVE_HAL 1
+
+// --- Flash helpers (no separate flash address space on the host) ---
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define pgm_read_byte(addr) (*(const unsigned char*)(addr))
+#define pgm_read_word(addr) (*(const unsigned short*)(addr))
+#define pgm_read_dword(addr) (*(const unsigned long*)(addr))
+#define pgm_read_float(addr) (*(const float*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+class __FlashStringHelper;
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper*>(p))
+#define F(s) FPSTR(s)
+
+// --- GPIO ---
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0x01
+
+// NodeMCU pin labels
+static const uint8_t D0 = 16;
+static const uint8_t D1 = 5;
+static const uint8_t D2 = 4;
+static const uint8_t D3 = 0;
+static const uint8_t D4 = 2;
+static const uint8_t D5 = 14;
+static const uint8_t D6 = 12;
+static const uint8_t D7 = 13;
+static const uint8_t D8 = 15;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// --- Time (virtual clock) ---
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// --- String ---
+class String {
+public:
+  String() {}
+  String(const char* s) { if (s) _s = s; }
+  String(const std::string& s) : _s(s) {}
+  String(const __FlashStringHelper* s) { if (s) _s = reinterpret_cast<const char*>(s); }
+  String(const String& s) = default;
+  String(String&& s) = default;
+  explicit String(char c) : _s(1, c) {}
+  explicit String(unsigned char v, unsigned char base = 10);
+  explicit String(int v, unsigned char base = 10);
+  explicit String(unsigned int v, unsigned char base = 10);
+  explicit String(long v, unsigned char base = 10);
+  explicit String(unsigned long v, unsigned char base = 10);
+  explicit String(long long v, unsigned char base = 10);
+  explicit String(unsigned long long v, unsigned char base = 10);
+  explicit String(float v, unsigned char decimals = 2);
+  explicit String(double v, unsigned char decimals = 2);
+
+  String& operator=(const String& s) = default;
+  String& operator=(String&& s) = default;
+  String& operator=(const char* s) { _s = s ? s : ""; return *this; }
+  String& operator=(const __FlashStringHelper* s) { return *this = reinterpret_cast<const char*>(s); }
+
+  bool concat(const String& s) { _s += s._s; return true; }
+  bool concat(const char* s) { if (s) _s += s; return true; }
+  bool concat(const char* s, unsigned int len) { if (s) _s.append(s, len); return true; }
+  bool concat(const __FlashStringHelper* s) { return concat(reinterpret_cast<const char*>(s)); }
+  bool concat(char c) { _s += c; return true; }
+  template <typename T> bool concat(T v) { return concat(String(v)); }
+
+  String& operator+=(const String& s) { concat(s); return *this; }
+  String& operator+=(const char* s) { concat(s); return *this; }
+  String& operator+=(const __FlashStringHelper* s) { concat(s); return *this; }
+  String& operator+=(char c) { concat(c); return *this; }
+  template <typename T> String& operator+=(T v) { concat(String(v)); return *this; }
+
+  const char* c_str() const { return _s.c_str(); }
+  unsigned int length() const { return (unsigned int)_s.size(); }
+  bool isEmpty() const { return _s.empty(); }
+  bool reserve(unsigned int size) { _s.reserve(size); return true; }
+  char charAt(unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  char& operator[](unsigned int i) { return _s[i]; }
+  void setCharAt(unsigned int i, char c) { if (i < _s.size()) _s[i] = c; }
+
+  bool equals(const String& s) const { return _s == s._s; }
+  bool equals(const char* s) const { return _s == (s ? s : ""); }
+  bool equalsIgnoreCase(const String& s) const;
+  bool startsWith(const String& s) const { return _s.compare(0, s._s.size(), s._s) == 0; }
+  bool endsWith(const String& s) const;
+  int compareTo(const String& s) const { return _s.compare(s._s); }
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String& s, unsigned int from = 0) const;
+  int lastIndexOf(char c) const;
+  String substring(unsigned int from) const { return substring(from, length()); }
+  String substring(unsigned int from, unsigned int to) const;
+  void replace(const String& find, const String& repl);
+  void replace(char find, char repl) { std::replace(_s.begin(), _s.end(), find, repl); }
+  void remove(unsigned int index) { if (index < _s.size()) _s.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < _s.size()) _s.erase(index, count); }
+  void trim();
+  void toLowerCase();
+  void toUpperCase();
+  long toInt() const { return atol(_s.c_str()); }
+  float toFloat() const { return (float)atof(_s.c_str()); }
+  double toDouble() const { return atof(_s.c_str()); }
+  void getBytes(unsigned char* buf, unsigned int size, unsigned int index = 0) const;
+  void toCharArray(char* buf, unsigned int size, unsigned int index = 0) const { getBytes((unsigned char*)buf, size, index); }
+
+  bool operator==(const String& s) const { return _s == s._s; }
+  bool operator==(const char* s) const { return equals(s); }
+  bool operator!=(const String& s) const { return _s != s._s; }
+  bool operator!=(const char* s) const { return !equals(s); }
+  bool operator<(const String& s) const { return _s < s._s; }
+
+  const std::string& str() const { return _s; }
+
+private:
+  std::string _s;
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const String& a, const char* b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, const __FlashStringHelper* b);
+String operator+(const __FlashStringHelper* a, const String& b);
+String operator+(const String& a, char b);
+String operator+(char a, const String& b);
+
+// --- Print / Stream ---
+class Printable;
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t size);
+  size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* buf, size_t size) { return write((const uint8_t*)buf, size); }
+  virtual void flush() {}
+
+  size_t print(const String& s) { return write(s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(const __FlashStringHelper* s) { return write(reinterpret_cast<const char*>(s)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned int v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(long long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+  size_t print(double v, int decimals = 2) { return print(String(v, (unsigned char)decimals)); }
+  size_t print(const Printable& p);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(const T& v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print& p) const = 0;
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t readBytes(char* buf, size_t len);
+  size_t readBytes(uint8_t* buf, size_t len) { return readBytes((char*)buf, len); }
+  String readString();
+  String readStringUntil(char terminator);
+  void setTimeout(unsigned long ms) { _timeout = ms; }
+  unsigned long getTimeout() const { return _timeout; }
+
+protected:
+  unsigned long _timeout = 1000;
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  void setDebugOutput(bool on) { (void)on; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// --- IPAddress ---
+class IPAddress : public Printable {
+public:
+  IPAddress() : _addr(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _addr(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+  IPAddress(uint32_t addr) : _addr(addr) {}
+  operator uint32_t() const { return _addr; }
+  uint8_t operator[](int i) const { return (_addr >> (8 * i)) & 0xFF; }
+  bool operator==(const IPAddress& o) const { return _addr == o._addr; }
+  bool operator!=(const IPAddress& o) const { return _addr != o._addr; }
+  bool isSet() const { return _addr != 0; }
+  bool fromString(const char* s);
+  bool fromString(const String& s) { return fromString(s.c_str()); }
+  String toString() const;
+  size_t printTo(Print& p) const override { return p.print(toString()); }
+
+private:
+  uint32_t _addr;
+};
+
+// --- ESP system ---
+class EspClass {
+public:
+  void restart();
+  void reset() { restart(); }
+  uint32_t getFreeHeap();
+  uint32_t getMaxFreeBlockSize();
+  uint8_t getHeapFragmentation();
+  void getHeapStats(uint32_t* hfree, uint32_t* hmax, uint8_t* hfrag);
+  uint32_t getFreeContStack() { return 4096; }
+  uint32_t getFreeSketchSpace() { return 1024 * 1024; }
+  uint32_t getSketchSize() { return 512 * 1024; }
+  uint32_t getChipId() { return 0x00C0FFEE; }
+  uint32_t getCycleCount();
+  uint8_t getCpuFreqMHz() { return 80; }
+  String getResetReason();
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+};
+
+extern EspClass ESP;
+
+template <typename T> T constrain(T v, T lo, T hi) { return v < lo ? lo : (v > hi ? hi : v); }
+#define bit(b) (1UL << (b))
+// The ESP8266 core exposes these unqualified as well
+using std::min;
+using std::max;
+long random(long max);
+long random(long min, long max);
@@ -0,0 +1,44 @@
+// OTA listener stand-in; never receives an update on the host.
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum {
+  OTA_AUTH_ERROR,
+  OTA_BEGIN_ERROR,
+  OTA_CONNECT_ERROR,
+  OTA_RECEIVE_ERROR,
+  OTA_END_ERROR
+} ota_error_t;
+
+class ArduinoOTAClass {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+  typedef std::function<void(ota_error_t)> THandlerFunction_Error;
+  typedef std::function<void(unsigned int, unsigned int)> THandlerFunction_Progress;
+
+  void setPassword(const char* password) { (void)password; }
+  void setHostname(const char* hostname) { (void)hostname; }
+  void setPort(uint16_t port) { (void)port; }
+  void onStart(THandlerFunction fn) { _start = fn; }
+  void onEnd(THandlerFunction fn) { _end = fn; }
+  void onError(THandlerFunction_Error fn) { _error = fn; }
+  void onProgress(THandlerFunction_Progress fn) { _progress = fn; }
+  void begin(bool useMDNS = true) { (void)useMDNS; }
+  void handle() {}
+
+  // Host only: run the registered callbacks as a successful update would
+  void simulateUpdate(unsigned int total) {
+    if (_start) _start();
+    if (_progress) _progress(total, total);
+    if (_end) _end();
+  }
+
+private:
+  THandlerFunction _start;
+  THandlerFunction _end;
+  THandlerFunction_Error _error;
+  THandlerFunction_Progress _progress;
+};
+
+extern ArduinoOTAClass ArduinoOTA;
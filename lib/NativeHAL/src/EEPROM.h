@@ -0,0 +1,31 @@
+// Emulated EEPROM (flash sector on the ESP8266). Survives hal::reset().
+#pragma once
+
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+  void begin(size_t size) { _size = size < sizeof(_data) ? size : sizeof(_data); }
+  uint8_t read(int address) const { return (address >= 0 && (size_t)address < _size) ? _data[address] : 0; }
+  void write(int address, uint8_t value) { if (address >= 0 && (size_t)address < _size) _data[address] = value; }
+  bool commit() { _commits++; return true; }
+  bool end() { return commit(); }
+  size_t length() const { return _size; }
+  unsigned long commitCount() const { return _commits; }
+
+  template <typename T> T& get(int address, T& t) {
+    if (address >= 0 && address + sizeof(T) <= _size) memcpy(&t, &_data[address], sizeof(T));
+    return t;
+  }
+  template <typename T> const T& put(int address, const T& t) {
+    if (address >= 0 && address + sizeof(T) <= _size) memcpy(&_data[address], &t, sizeof(T));
+    return t;
+  }
+
+private:
+  uint8_t _data[4096] = {0};
+  size_t _size = 0;
+  unsigned long _commits = 0;
+};
+
+extern EEPROMClass EEPROM;
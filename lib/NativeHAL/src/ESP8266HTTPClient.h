@@ -0,0 +1,152 @@
+// Outgoing HTTP on the host: requests are recorded in hal::httpCalls() and
+// answered with hal::httpClientResult() after hal::httpClientLatencyMs().
+// A GET of a URL registered with hal::setHttpFile() is answered with the file
+// (or the requested Range of it), readable through getStreamPtr().
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <NativeHAL.h>
+#include <vector>
+#include <utility>
+
+#define HTTPC_ERROR_CONNECTION_FAILED (-1)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_PARTIAL_CONTENT 206
+#define HTTP_CODE_NOT_FOUND 404
+#define HTTP_CODE_RANGE_NOT_SATISFIABLE 416
+
+// Response body of a served file. Reading charges the simulated bandwidth;
+// a dropped connection delivers what got through, then waits out the timeout.
+class HttpBodyClient : public WiFiClient {
+public:
+  void reset(const uint8_t* data, size_t len) {
+    _data = data;
+    _len = len;
+    _pos = 0;
+    _dropped = false;
+  }
+  int available() override { return _dropped ? 0 : (int)(_len - _pos); }
+  int read() override {
+    uint8_t c;
+    return readBytes((char*)&c, 1) == 1 ? c : -1;
+  }
+  int peek() override { return available() ? _data[_pos] : -1; }
+  size_t readBytes(char* buf, size_t len) override {
+    if (len > _len - _pos) len = _len - _pos;
+    if (_dropped) len = 0;
+    size_t n = hal::httpTakeBodyBytes(len);
+    if (n < len) _dropped = true;
+    memcpy(buf, _data + _pos, n);
+    _pos += n;
+    unsigned long kbps = hal::httpBandwidthKBps();
+    if (kbps) hal::advanceMicros((unsigned long long)n * 1000000ULL / (kbps * 1024ULL));
+    if (n < len) delay(getTimeout());
+    return n;
+  }
+  uint8_t connected() override { return !_dropped && _pos < _len; }
+
+private:
+  const uint8_t* _data = nullptr;
+  size_t _len = 0;
+  size_t _pos = 0;
+  bool _dropped = false;
+};
+
+class HTTPClient {
+public:
+  bool begin(WiFiClient& client, const String& url) { (void)client; return begin(url); }
+  bool begin(const String& url) {
+    _url = url;
+    _headers.clear();
+    _responseHeaders.clear();
+    _size = -1;
+    _body.reset(nullptr, 0);
+    return true;
+  }
+  void end() { _body.reset(nullptr, 0); }
+  void setTimeout(uint16_t ms) { _timeout = ms; }
+  void setReuse(bool reuse) { (void)reuse; }
+  void addHeader(const String& name, const String& value) { _headers.push_back(std::make_pair(name, value)); }
+  void collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    _collect.assign(headerKeys, headerKeys + headerKeysCount);
+  }
+  String header(const char* name) {
+    for (auto& h : _responseHeaders)
+      if (h.first.equalsIgnoreCase(name)) return h.second;
+    return String();
+  }
+  int GET() { return sendRequest("GET", String()); }
+  int POST(const String& payload) { return sendRequest("POST", payload); }
+  int POST(const uint8_t* payload, size_t size) { String p; p.concat((const char*)payload, (unsigned int)size); return sendRequest("POST", p); }
+  int sendRequest(const char* method, const String& payload) {
+    hal::HttpCall call;
+    call.method = method;
+    call.url = _url;
+    call.body = payload;
+    call.headers = _headers;
+    hal::recordHttpCall(call);
+    if (!hal::wifiConnected()) {
+      delay(_timeout);
+      return HTTPC_ERROR_CONNECTION_FAILED;
+    }
+    unsigned long latency = hal::httpClientLatencyMs();
+    if (latency > _timeout) {
+      delay(_timeout);
+      return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    delay(latency);
+    const std::vector<uint8_t>* file = hal::httpFile(_url);
+    if (file && strcmp(method, "GET") == 0) return serveFile(*file);
+    return hal::httpClientResult();
+  }
+  String getString() {
+    String s;
+    char buf[256];
+    size_t n;
+    while ((n = _body.readBytes(buf, sizeof(buf))) > 0) s.concat(buf, n);
+    return s;
+  }
+  int getSize() { return _size; }
+  WiFiClient* getStreamPtr() { return &_body; }
+  static String errorToString(int error) { return String(F("HTTP error ")) + String(error); }
+
+private:
+  int serveFile(const std::vector<uint8_t>& file) {
+    size_t first = 0, last = file.size() - 1;
+    bool partial = false;
+    for (auto& h : _headers) {
+      unsigned long a, b;
+      if (!hal::httpRangeSupport() || !h.first.equalsIgnoreCase("Range")) continue;
+      int fields = sscanf(h.second.c_str(), "bytes=%lu-%lu", &a, &b);
+      if (fields < 1) continue;
+      if (a >= file.size()) return HTTP_CODE_RANGE_NOT_SATISFIABLE;
+      first = a;
+      if (fields == 2 && b < last) last = b;
+      partial = true;
+    }
+    if (partial) {
+      char range[64];
+      snprintf(range, sizeof(range), "bytes %zu-%zu/%zu", first, last, file.size());
+      addResponseHeader("Content-Range", range);
+    }
+    _size = last - first + 1;
+    _body.reset(file.data() + first, _size);
+    _body.setTimeout(_timeout);
+    return partial ? HTTP_CODE_PARTIAL_CONTENT : HTTP_CODE_OK;
+  }
+
+  void addResponseHeader(const char* name, const char* value) {
+    for (auto& key : _collect)
+      if (strcasecmp(key, name) == 0) _responseHeaders.push_back(std::make_pair(String(name), String(value)));
+  }
+
+  String _url;
+  std::vector<std::pair<String, String>> _headers;
+  std::vector<const char*> _collect;
+  std::vector<std::pair<String, String>> _responseHeaders;
+  int _size = -1;
+  HttpBodyClient _body;
+  uint16_t _timeout = 5000;
+};
@@ -0,0 +1,204 @@
+#include <ESP8266WebServer.h>
+#include <NativeHAL.h>
+
+ESP8266WiFiClass WiFi;
+
+static String urlDecode(const String& s) {
+  String out;
+  for (unsigned int i = 0; i < s.length(); ++i) {
+    char c = s[i];
+    if (c == '+') {
+      out += ' ';
+    } else if (c == '%' && i + 2 < s.length()) {
+      char hex[3] = {s[i + 1], s[i + 2], 0};
+      out += (char)strtol(hex, nullptr, 16);
+      i += 2;
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+String HttpResponse::header(const String& name) const {
+  for (const auto& h : headers) {
+    if (h.first.equalsIgnoreCase(name)) return h.second;
+  }
+  return String();
+}
+
+size_t CapturingClient::write(const uint8_t* buf, size_t size) {
+  _server->appendBody((const char*)buf, size);
+  return size;
+}
+
+void ESP8266WebServer::on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+  _routes.push_back(Route{uri, method, fn, ufn});
+}
+
+void ESP8266WebServer::collectHeaders(const char* headerKeys[], size_t count) {
+  (void)headerKeys;
+  (void)count; // All injected headers are kept
+}
+
+String ESP8266WebServer::arg(const String& name) const {
+  for (const auto& a : _args) {
+    if (a.first == name) return a.second;
+  }
+  return String();
+}
+
+bool ESP8266WebServer::hasArg(const String& name) const {
+  for (const auto& a : _args) {
+    if (a.first == name) return true;
+  }
+  return false;
+}
+
+String ESP8266WebServer::header(const String& name) const {
+  for (const auto& h : _requestHeaders) {
+    if (h.first.equalsIgnoreCase(name)) return h.second;
+  }
+  return String();
+}
+
+bool ESP8266WebServer::hasHeader(const String& name) const {
+  for (const auto& h : _requestHeaders) {
+    if (h.first.equalsIgnoreCase(name)) return true;
+  }
+  return false;
+}
+
+void ESP8266WebServer::sendHeader(const String& name, const String& value, bool first) {
+  hal::UncountedHeap uncounted;
+  if (first) {
+    _pendingHeaders.insert(_pendingHeaders.begin(), std::make_pair(name, value));
+  } else {
+    _pendingHeaders.push_back(std::make_pair(name, value));
+  }
+}
+
+void ESP8266WebServer::send(int code, const char* contentType, const String& content) {
+  send(code, contentType, content.c_str(), content.length());
+}
+
+void ESP8266WebServer::send(int code, const char* contentType, const char* content, size_t length) {
+  hal::UncountedHeap uncounted;
+  _response.code = code;
+  _response.contentType = contentType ? contentType : "";
+  for (const auto& h : _pendingHeaders) _response.headers.push_back(h);
+  _pendingHeaders.clear();
+  if (_contentLength != CONTENT_LENGTH_NOT_SET && _contentLength != CONTENT_LENGTH_UNKNOWN) {
+    _response.headers.push_back(std::make_pair(String(F("Content-Length")), String((unsigned long)_contentLength)));
+  }
+  appendBody(content, length);
+}
+
+void ESP8266WebServer::sendContent(const char* content, size_t length) {
+  _response.contentChunks++;
+  appendBody(content, length);
+}
+
+size_t ESP8266WebServer::streamFile(File& file, const String& contentType, HTTPMethod requestMethod) {
+  setContentLength(file.size());
+  send(200, contentType.c_str(), "", 0);
+  if (requestMethod == HTTP_HEAD) return 0;
+  char buf[256];
+  size_t total = 0;
+  int n;
+  while ((n = file.read((uint8_t*)buf, sizeof(buf))) > 0) {
+    appendBody(buf, n);
+    total += n;
+  }
+  return total;
+}
+
+void ESP8266WebServer::appendBody(const char* data, size_t len) {
+  if (!data || !len) return;
+  hal::UncountedHeap uncounted;
+  _response.body.concat(data, (unsigned int)len);
+  _bytesSent += len;
+}
+
+const ESP8266WebServer::Route* ESP8266WebServer::findRoute(HTTPMethod method, const String& path) const {
+  for (const auto& r : _routes) {
+    if (r.uri == path && (r.method == HTTP_ANY || r.method == method)) return &r;
+  }
+  return nullptr;
+}
+
+void ESP8266WebServer::beginRequest(HTTPMethod method, const String& uri, const Args& args, const Args& headers) {
+  hal::UncountedHeap uncounted;
+  _response = HttpResponse();
+  _pendingHeaders.clear();
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+  _method = method;
+  _requestHeaders = headers;
+  _args.clear();
+  int q = uri.indexOf('?');
+  _uri = (q >= 0) ? uri.substring(0, q) : uri;
+  if (q >= 0) {
+    String query = uri.substring(q + 1);
+    while (query.length()) {
+      int amp = query.indexOf('&');
+      String pair = (amp >= 0) ? query.substring(0, amp) : query;
+      query = (amp >= 0) ? query.substring(amp + 1) : String();
+      int eq = pair.indexOf('=');
+      if (eq >= 0) {
+        _args.push_back(std::make_pair(urlDecode(pair.substring(0, eq)), urlDecode(pair.substring(eq + 1))));
+      } else if (pair.length()) {
+        _args.push_back(std::make_pair(urlDecode(pair), String()));
+      }
+    }
+  }
+  for (const auto& a : args) _args.push_back(a);
+}
+
+HttpResponse ESP8266WebServer::inject(HTTPMethod method, const String& uri, const Args& args, const Args& headers) {
+  beginRequest(method, uri, args, headers);
+  const Route* route = findRoute(method, _uri);
+  if (route && route->fn) {
+    route->fn();
+  } else if (_notFound) {
+    _notFound();
+  } else {
+    send(404, "text/plain", String(F("Not found: ")) + _uri);
+  }
+  hal::UncountedHeap uncounted; // The caller's copy of the response
+  return _response;
+}
+
+HttpResponse ESP8266WebServer::injectUpload(const String& uri, const String& filename, const uint8_t* data, size_t len,
+                                            const Args& args, size_t chunkSize) {
+  beginRequest(HTTP_POST, uri, args, Args());
+  const Route* route = findRoute(HTTP_POST, _uri);
+  if (!route) {
+    send(404, "text/plain", String(F("Not found: ")) + _uri);
+    return _response;
+  }
+  if (chunkSize == 0 || chunkSize > HTTP_UPLOAD_BUFLEN) chunkSize = HTTP_UPLOAD_BUFLEN;
+  if (route->ufn) {
+    _upload.filename = filename;
+    _upload.name = F("update");
+    _upload.type = F("application/octet-stream");
+    _upload.totalSize = 0;
+    _upload.currentSize = 0;
+    _upload.status = UPLOAD_FILE_START;
+    route->ufn();
+    size_t offset = 0;
+    while (offset < len) {
+      size_t n = std::min(chunkSize, len - offset);
+      memcpy(_upload.buf, data + offset, n);
+      _upload.currentSize = n;
+      _upload.status = UPLOAD_FILE_WRITE;
+      route->ufn();
+      _upload.totalSize += n;
+      offset += n;
+    }
+    _upload.currentSize = 0;
+    _upload.status = UPLOAD_FILE_END;
+    route->ufn();
+  }
+  if (route->fn) route->fn();
+  return _response;
+}
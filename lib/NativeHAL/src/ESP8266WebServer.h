@@ -0,0 +1,132 @@
+// In-process web server. Nothing listens on a socket: requests are injected
+// with inject()/injectUpload() and the full response is captured for inspection.
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <FS.h>
+#include <vector>
+#include <utility>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+#define HTTP_UPLOAD_BUFLEN 2048
+
+struct HTTPUpload {
+  HTTPUploadStatus status;
+  String filename;
+  String name;
+  String type;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+struct HttpResponse {
+  int code = 0;
+  String contentType;
+  String body;
+  std::vector<std::pair<String, String>> headers;
+  unsigned int contentChunks = 0;
+  String header(const String& name) const;
+};
+
+class ESP8266WebServer;
+
+// Anything written to server.client() is appended to the captured response
+class CapturingClient : public WiFiClient {
+public:
+  explicit CapturingClient(ESP8266WebServer* server) : _server(server) {}
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t size) override;
+  using Print::write;
+  uint8_t connected() override { return 1; }
+
+private:
+  ESP8266WebServer* _server;
+};
+
+class ESP8266WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+  typedef std::vector<std::pair<String, String>> Args;
+
+  explicit ESP8266WebServer(int port = 80) : _port(port), _client(this) {}
+
+  void begin() { _started = true; }
+  void close() { _started = false; }
+  void stop() { close(); }
+  void handleClient() {}
+
+  void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction fn) { on(uri, method, fn, nullptr); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+  void onNotFound(THandlerFunction fn) { _notFound = fn; }
+  void collectHeaders(const char* headerKeys[], size_t count);
+
+  // --- Request accessors used by handlers ---
+  String uri() const { return _uri; }
+  HTTPMethod method() const { return _method; }
+  String arg(const String& name) const;
+  String arg(int i) const { return i >= 0 && i < (int)_args.size() ? _args[i].second : String(); }
+  String argName(int i) const { return i >= 0 && i < (int)_args.size() ? _args[i].first : String(); }
+  int args() const { return (int)_args.size(); }
+  bool hasArg(const String& name) const;
+  String header(const String& name) const;
+  bool hasHeader(const String& name) const;
+  HTTPUpload& upload() { return _upload; }
+  WiFiClient& client() { return _client; }
+
+  // --- Response ---
+  void setContentLength(size_t len) { _contentLength = len; }
+  void sendHeader(const String& name, const String& value, bool first = false);
+  void send(int code, const char* contentType = nullptr, const String& content = String());
+  void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+  void send(int code, const char* contentType, const char* content, size_t length);
+  void send_P(int code, PGM_P contentType, PGM_P content) { send(code, contentType, String(content)); }
+  void send_P(int code, PGM_P contentType, PGM_P content, size_t length) { send(code, contentType, content, length); }
+  void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+  void sendContent(const char* content, size_t length);
+  void sendContent_P(PGM_P content) { sendContent(content, strlen(content)); }
+  void sendContent_P(PGM_P content, size_t length) { sendContent(content, length); }
+  size_t streamFile(File& file, const String& contentType, HTTPMethod requestMethod = HTTP_GET);
+
+  // --- Injection (host only) ---
+  HttpResponse inject(HTTPMethod method, const String& uri, const Args& args = Args(), const Args& headers = Args());
+  HttpResponse injectUpload(const String& uri, const String& filename, const uint8_t* data, size_t len,
+                            const Args& args = Args(), size_t chunkSize = HTTP_UPLOAD_BUFLEN);
+  // Bytes of response body produced since construction (all requests)
+  unsigned long long bytesSent() const { return _bytesSent; }
+
+  // Used by CapturingClient
+  void appendBody(const char* data, size_t len);
+
+private:
+  struct Route {
+    String uri;
+    HTTPMethod method;
+    THandlerFunction fn;
+    THandlerFunction ufn;
+  };
+
+  const Route* findRoute(HTTPMethod method, const String& path) const;
+  void beginRequest(HTTPMethod method, const String& uri, const Args& args, const Args& headers);
+
+  int _port;
+  bool _started = false;
+  std::vector<Route> _routes;
+  THandlerFunction _notFound;
+  String _uri;
+  HTTPMethod _method = HTTP_GET;
+  Args _args;
+  Args _requestHeaders;
+  Args _pendingHeaders;
+  size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+  HTTPUpload _upload;
+  CapturingClient _client;
+  HttpResponse _response;
+  unsigned long long _bytesSent = 0;
+};
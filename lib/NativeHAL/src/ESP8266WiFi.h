@@ -0,0 +1,107 @@
+// Simulated station interface. Connection state comes from hal::setWiFiConnected()
+// and the join timing set with hal::setWiFiJoinTiming().
+#pragma once
+
+#include <Arduino.h>
+#include "NativeHAL.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_WRONG_PASSWORD = 6,
+  WL_DISCONNECTED = 7
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } WiFiMode_t;
+
+class WiFiClient : public Stream {
+public:
+  virtual ~WiFiClient() {}
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t size) override { (void)buf; return size; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  virtual uint8_t connected() { return 0; }
+  virtual void stop() {}
+  void setTimeout(unsigned long ms) { Stream::setTimeout(ms); }
+  void setNoDelay(bool on) { (void)on; }
+  operator bool() { return connected(); }
+};
+
+// Only NTP is simulated: a 48-byte request to port 123 is answered ~20 ms later
+// with hal::utcEpoch(), unless NTP is unreachable (then no reply arrives).
+class WiFiUDP {
+public:
+  uint8_t begin(uint16_t port) { (void)port; return 1; }
+  void stop() { _replyAtUs = 0; }
+  int beginPacket(const char* host, uint16_t port) {
+    (void)host;
+    _port = port;
+    _len = 0;
+    return hal::wifiConnected() ? 1 : 0;
+  }
+  size_t write(const uint8_t* buf, size_t size) {
+    for (size_t i = 0; i < size && _len < sizeof(_packet); i++) _packet[_len++] = buf[i];
+    return size;
+  }
+  int endPacket();
+  int parsePacket();
+  int read(uint8_t* buf, size_t len);
+
+private:
+  uint8_t _packet[48];
+  size_t _len = 0;
+  uint16_t _port = 0;
+  unsigned long long _replyAtUs = 0;
+  bool _replyReady = false;
+};
+
+class ESP8266WiFiClass {
+public:
+  wl_status_t status() { return hal::wifiConnected() ? WL_CONNECTED : WL_DISCONNECTED; }
+  bool isConnected() { return hal::wifiConnected(); }
+  String macAddress() { return F("5C:CF:7F:12:34:AB"); }
+  uint8_t* macAddress(uint8_t* mac) { static const uint8_t m[6] = {0x5C, 0xCF, 0x7F, 0x12, 0x34, 0xAB}; memcpy(mac, m, 6); return mac; }
+  IPAddress localIP() { return hal::wifiConnected() ? (_staticIp.isSet() ? _staticIp : IPAddress(192, 168, 1, 50)) : IPAddress(); }
+  IPAddress gatewayIP() { return hal::wifiConnected() ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+  IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsIP(uint8_t n = 0) { (void)n; return gatewayIP(); }
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+  String SSID() { return hal::wifiConnected() ? F("SimNet") : F(""); }
+  String psk() { return F(""); }
+  uint8_t* BSSID() { static uint8_t b[6]; memcpy(b, hal::wifiBssid(), 6); return b; }
+  int32_t channel() { return hal::wifiChannel(); }
+  int32_t RSSI() { return hal::wifiConnected() ? -58 : 0; }
+  WiFiMode_t getMode() { return _mode; }
+  bool mode(WiFiMode_t m) { _mode = m; return true; }
+  bool disconnect(bool wifiOff = false) { (void)wifiOff; return true; }
+  bool reconnect() { return true; }
+  bool setAutoReconnect(bool on) { (void)on; return true; }
+  bool persistent(bool on) { (void)on; return true; }
+  bool hostname(const char* name) { (void)name; return true; }
+  bool config(IPAddress ip, IPAddress gw, IPAddress mask, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress()) {
+    (void)gw; (void)mask; (void)dns1; (void)dns2;
+    _staticIp = ip; // 0.0.0.0 turns DHCP back on
+    return true;
+  }
+  wl_status_t begin() {
+    hal::wifiBegin(nullptr, 0, _staticIp.isSet());
+    return status();
+  }
+  wl_status_t begin(const char* ssid, const char* pass = nullptr, int32_t ch = 0, const uint8_t* bssid = nullptr, bool connect = true) {
+    (void)ssid; (void)pass;
+    if (connect) hal::wifiBegin(bssid, ch, _staticIp.isSet());
+    return status();
+  }
+
+private:
+  WiFiMode_t _mode = WIFI_STA;
+  IPAddress _staticIp;
+};
+
+extern ESP8266WiFiClass WiFi;
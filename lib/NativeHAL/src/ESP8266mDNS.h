@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Arduino.h>
+
+class MDNSResponder {
+public:
+  bool begin(const char* hostname) { _hostname = hostname ? hostname : ""; return true; }
+  bool begin(const String& hostname) { return begin(hostname.c_str()); }
+  void update() {}
+  bool addService(const char* service, const char* proto, uint16_t port) {
+    (void)service; (void)proto; (void)port;
+    return true;
+  }
+  const String& hostname() const { return _hostname; }
+
+private:
+  String _hostname;
+};
+
+extern MDNSResponder MDNS;
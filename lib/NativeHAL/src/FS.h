@@ -0,0 +1,96 @@
+// File system backed by a host directory (see hal::setFsRoot()).
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FileImpl;
+
+class File : public Stream {
+public:
+  File() {}
+  explicit File(std::shared_ptr<FileImpl> impl) : _impl(impl) {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t* buf, size_t size);
+  size_t readBytes(char* buf, size_t len) override { return read((uint8_t*)buf, len); }
+  void flush() override;
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  bool truncate(uint32_t size);
+  void close();
+  const char* name() const;
+  const char* fullName() const;
+  bool isDirectory() const { return false; }
+  operator bool() const;
+
+private:
+  std::shared_ptr<FileImpl> _impl;
+};
+
+struct FSInfo {
+  size_t totalBytes;
+  size_t usedBytes;
+  size_t blockSize;
+  size_t pageSize;
+  size_t maxOpenFiles;
+  size_t maxPathLength;
+};
+
+class FS {
+public:
+  bool begin();
+  void end() {}
+  bool format();
+  bool info(FSInfo& info);
+  File open(const char* path, const char* mode);
+  File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+  bool exists(const char* path);
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool remove(const char* path);
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool rename(const char* from, const char* to);
+  bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+  bool mkdir(const char* path);
+  bool mkdir(const String& path) { return mkdir(path.c_str()); }
+
+  // Host only: counts of file opens and bytes written, used by benchmarks
+  unsigned long openCount() const { return _opens; }
+  unsigned long long bytesWritten() const { return _bytesWritten; }
+  void countWrite(size_t n) { _bytesWritten += n; }
+
+  // Host only: what the writes cost in flash. LittleFS is copy-on-write: when
+  // a file is synced, every block from the first one written to the end of the
+  // file goes to a freshly erased block, so an append still copies the file's
+  // unfinished last block. Metadata commits are not counted.
+  static const size_t BLOCK_SIZE = 8192; // LittleFS block on a 4 MB ESP8266
+  unsigned long long flashBytes() const { return _flashBytes; }
+  unsigned long blockErases() const { return _blockErases; }
+  void countSync(size_t firstChanged, size_t size);
+
+private:
+  unsigned long _opens = 0;
+  unsigned long long _bytesWritten = 0;
+  unsigned long long _flashBytes = 0;
+  unsigned long _blockErases = 0;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::FSInfo;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
@@ -0,0 +1,12 @@
+// Storage for the core singletons declared in the stand-in headers.
+#include <EEPROM.h>
+#include <ESP8266mDNS.h>
+#include <ArduinoOTA.h>
+#include <Updater.h>
+#include <WiFiManager.h>
+
+EEPROMClass EEPROM;
+MDNSResponder MDNS;
+ArduinoOTAClass ArduinoOTA;
+UpdaterClass Update;
+unsigned long WiFiManager::_resets = 0;
@@ -0,0 +1,79 @@
+// Counting replacements for the global operator new/delete, so benchmarks can
+// see what the firmware allocates and ESP.getFreeHeap() moves with it.
+// Single threaded like the rest of the HAL.
+#include <NativeHAL.h>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Each block remembers its size and whether it was counted, so freeing a
+// counted block comes off the live total
+struct alignas(alignof(std::max_align_t)) BlockHeader {
+  std::size_t size;
+  bool counted;
+};
+
+static unsigned long heapAllocations = 0;
+static unsigned long long heapBytes = 0;
+static unsigned long long heapLiveBytes = 0;
+static int uncountedDepth = 0;
+static uint8_t heapFragmentation = 20;
+
+static void* countedAlloc(std::size_t size) {
+  BlockHeader* block = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size));
+  if (!block) throw std::bad_alloc();
+  block->size = size;
+  block->counted = (uncountedDepth == 0);
+  if (block->counted) {
+    heapAllocations++;
+    heapBytes += size;
+    heapLiveBytes += size;
+  }
+  return block + 1;
+}
+
+static void countedFree(void* p) {
+  if (!p) return;
+  BlockHeader* block = static_cast<BlockHeader*>(p) - 1;
+  if (block->counted) heapLiveBytes -= block->size;
+  std::free(block);
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  try { return countedAlloc(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  try { return countedAlloc(size); } catch (...) { return nullptr; }
+}
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+
+namespace hal {
+
+HeapStats heapStats() {
+  return HeapStats{heapAllocations, heapBytes, heapLiveBytes};
+}
+
+void resetHeapStats() {
+  heapAllocations = 0;
+  heapBytes = 0;
+}
+
+UncountedHeap::UncountedHeap() { uncountedDepth++; }
+UncountedHeap::~UncountedHeap() { uncountedDepth--; }
+
+void setHeapFragmentation(uint8_t percent) {
+  heapFragmentation = percent > 100 ? 100 : percent;
+}
+
+uint8_t heapFragmentationPercent() {
+  return heapFragmentation;
+}
+
+} // namespace hal
@@ -0,0 +1,225 @@
+#include <LittleFS.h>
+#include "NativeHAL.h"
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdint.h>
+
+fs::FS LittleFS;
+
+namespace {
+std::string rootDir = "native_fs";
+long writesLeft = -1; // Bytes until the simulated power cut, -1 = never
+}
+
+namespace hal {
+
+void setFsRoot(const std::string& dir) { rootDir = dir; }
+const std::string& fsRoot() { return rootDir; }
+
+static void removeTree(const std::string& dir, bool removeSelf) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) return;
+  struct dirent* e;
+  while ((e = readdir(d)) != nullptr) {
+    std::string name = e->d_name;
+    if (name == "." || name == "..") continue;
+    std::string path = dir + "/" + name;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+      removeTree(path, true);
+    } else {
+      unlink(path.c_str());
+    }
+  }
+  closedir(d);
+  if (removeSelf) rmdir(dir.c_str());
+}
+
+void formatFs() { removeTree(rootDir, false); }
+
+void cutFsWritesAfter(long bytes) { writesLeft = bytes; }
+
+} // namespace hal
+
+static std::string hostPath(const char* path) {
+  std::string p = path ? path : "";
+  if (p.empty() || p[0] != '/') p = "/" + p;
+  return hal::fsRoot() + p;
+}
+
+namespace fs {
+
+class FileImpl {
+public:
+  FILE* fp = nullptr;
+  std::string name;
+  std::string fullName;
+  bool append = false;
+  size_t syncedSize = 0;        // Size at the last sync
+  size_t dirtyFrom = SIZE_MAX;  // First byte changed since then
+  ~FileImpl() { close(); }
+
+  size_t size() {
+    fflush(fp);
+    struct stat st;
+    return fstat(fileno(fp), &st) == 0 ? (size_t)st.st_size : 0;
+  }
+  void sync() {
+    if (!fp || dirtyFrom == SIZE_MAX) return;
+    size_t now = size();
+    LittleFS.countSync(std::min(dirtyFrom, syncedSize), now);
+    syncedSize = now;
+    dirtyFrom = SIZE_MAX;
+  }
+  void close() {
+    if (!fp) return;
+    sync();
+    fclose(fp);
+    fp = nullptr;
+  }
+};
+
+size_t File::write(const uint8_t* buf, size_t size) {
+  if (!_impl || !_impl->fp) return 0;
+  if (writesLeft >= 0 && size > (size_t)writesLeft) size = writesLeft;
+  size_t pos = _impl->append ? _impl->size() : (size_t)ftell(_impl->fp);
+  size_t n = fwrite(buf, 1, size, _impl->fp);
+  if (n) _impl->dirtyFrom = std::min(_impl->dirtyFrom, pos);
+  if (writesLeft >= 0) writesLeft -= n;
+  LittleFS.countWrite(n);
+  return n;
+}
+
+int File::available() {
+  if (!_impl || !_impl->fp) return 0;
+  long pos = ftell(_impl->fp);
+  return (int)(size() - (size_t)pos);
+}
+
+int File::read() {
+  if (!_impl || !_impl->fp) return -1;
+  int c = fgetc(_impl->fp);
+  return c == EOF ? -1 : c;
+}
+
+int File::peek() {
+  if (!_impl || !_impl->fp) return -1;
+  int c = fgetc(_impl->fp);
+  if (c == EOF) return -1;
+  ungetc(c, _impl->fp);
+  return c;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+  if (!_impl || !_impl->fp) return 0;
+  return fread(buf, 1, size, _impl->fp);
+}
+
+void File::flush() {
+  if (_impl && _impl->fp) {
+    fflush(_impl->fp);
+    _impl->sync();
+  }
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!_impl || !_impl->fp) return false;
+  int whence = mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END);
+  return fseek(_impl->fp, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+  if (!_impl || !_impl->fp) return 0;
+  return (size_t)ftell(_impl->fp);
+}
+
+size_t File::size() const {
+  if (!_impl || !_impl->fp) return 0;
+  return _impl->size();
+}
+
+bool File::truncate(uint32_t size) {
+  if (!_impl || !_impl->fp) return false;
+  size_t was = _impl->size();
+  if (ftruncate(fileno(_impl->fp), size) != 0) return false;
+  if (size != was) _impl->dirtyFrom = std::min(_impl->dirtyFrom, std::min((size_t)size, was));
+  return true;
+}
+
+void File::close() {
+  if (_impl) _impl->close();
+  _impl.reset();
+}
+
+const char* File::name() const { return _impl ? _impl->name.c_str() : ""; }
+const char* File::fullName() const { return _impl ? _impl->fullName.c_str() : ""; }
+File::operator bool() const { return _impl && _impl->fp; }
+
+bool FS::begin() {
+  // mkdir -p
+  const std::string& root = hal::fsRoot();
+  for (size_t pos = root.find('/', 1); pos != std::string::npos; pos = root.find('/', pos + 1)) {
+    ::mkdir(root.substr(0, pos).c_str(), 0755);
+  }
+  ::mkdir(root.c_str(), 0755);
+  struct stat st;
+  return stat(hal::fsRoot().c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+void FS::countSync(size_t firstChanged, size_t size) {
+  size_t start = firstChanged / BLOCK_SIZE * BLOCK_SIZE;
+  if (size <= start) return;
+  _flashBytes += size - start;
+  _blockErases += (size + BLOCK_SIZE - 1) / BLOCK_SIZE - start / BLOCK_SIZE;
+}
+
+bool FS::format() {
+  hal::formatFs();
+  return true;
+}
+
+bool FS::info(FSInfo& info) {
+  info.totalBytes = 1024 * 1024;
+  info.usedBytes = 0;
+  info.blockSize = BLOCK_SIZE;
+  info.pageSize = 256;
+  info.maxOpenFiles = 5;
+  info.maxPathLength = 32;
+  return true;
+}
+
+File FS::open(const char* path, const char* mode) {
+  std::string m = mode ? mode : "r";
+  // Same mode strings as fopen(): "r"/"r+" fail on a missing file, "w"/"a" create it
+  std::string fm = m;
+  if (fm.find('b') == std::string::npos) fm += "b";
+  std::string full = hostPath(path);
+  FILE* fp = fopen(full.c_str(), fm.c_str());
+  if (!fp) return File();
+  _opens++;
+  auto impl = std::make_shared<FileImpl>();
+  impl->fp = fp;
+  impl->append = m[0] == 'a';
+  impl->syncedSize = impl->size();
+  impl->fullName = path ? path : "";
+  size_t slash = impl->fullName.rfind('/');
+  impl->name = slash == std::string::npos ? impl->fullName : impl->fullName.substr(slash + 1);
+  return File(impl);
+}
+
+bool FS::exists(const char* path) {
+  struct stat st;
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) { return ::unlink(hostPath(path).c_str()) == 0; }
+
+bool FS::rename(const char* from, const char* to) { return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0; }
+
+bool FS::mkdir(const char* path) { return ::mkdir(hostPath(path).c_str(), 0755) == 0; }
+
+} // namespace fs
@@ -0,0 +1,172 @@
+// Controls for the simulated hardware used by the native build.
+// Tests, the schedule simulator and benchmarks drive the firmware through
+// these instead of real time, pins, flash and network.
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+#include <utility>
+
+namespace hal {
+
+// --- Virtual clock ---
+// millis()/micros() only move when the clock is advanced. delay() advances it.
+// Due Ticker callbacks fire while advancing, in deadline order.
+void advanceMillis(unsigned long ms);
+void advanceMicros(unsigned long long us);
+unsigned long long nowMicros();
+// Benchmarks: also charge host time spent between clock reads, multiplied by
+// scale (roughly how much slower the target runs the same code). 0 turns it
+// off; hal::reset() leaves it as is.
+void setHostClockScale(unsigned long scale);
+void followHostClock(); // Called by millis(), micros() and ESP.getCycleCount()
+
+// Real UTC time seen by the NTP client (independent of what the firmware believes)
+void setUtcEpoch(uint32_t epoch);
+uint32_t utcEpoch();
+// Real time gains this many ppm on the local oscillator (millis() runs slow)
+void setUtcDriftPpm(long ppm);
+// UTC in microseconds, what a simulated NTP server answers with
+unsigned long long utcMicros();
+// When false, NTP requests time out
+void setNtpReachable(bool reachable);
+bool ntpReachable();
+unsigned long ntpRequestCount();
+
+// --- Network ---
+// The access point is in range; the station is connected once a join started
+// by WiFi.begin() has finished
+void setWiFiConnected(bool connected);
+bool wifiConnected();
+// Cost of joining: a plain begin() scans, associates and runs DHCP; a begin()
+// naming the AP's BSSID and channel skips the scan and a static config skips
+// DHCP. Naming any other BSSID or channel never associates. All 0 (joins at
+// once) until set.
+void setWiFiJoinTiming(unsigned long scanMs, unsigned long associateMs, unsigned long dhcpMs);
+void setWiFiAccessPoint(const uint8_t* bssid, int32_t channel);
+const uint8_t* wifiBssid();
+int32_t wifiChannel();
+void wifiBegin(const uint8_t* bssid, int32_t channel, bool staticIp); // Called by WiFi.begin()
+unsigned long wifiScanCount(); // Joins that had to scan
+struct HttpCall {
+  String method;
+  String url;
+  String body;
+  std::vector<std::pair<String, String>> headers;
+};
+// Outgoing HTTPClient requests made by the firmware
+const std::vector<HttpCall>& httpCalls();
+void clearHttpCalls();
+void recordHttpCall(const HttpCall& call); // Called by the HTTPClient stand-in
+// Status returned by HTTPClient::GET/POST (negative = connection error)
+void setHttpClientResult(int code);
+int httpClientResult();
+// Extra latency charged to the virtual clock for each outgoing request
+void setHttpClientLatencyMs(unsigned long ms);
+unsigned long httpClientLatencyMs();
+// Files served to HTTPClient GETs (a local firmware server). A Range header
+// is answered with 206 and Content-Range unless range support is turned off.
+void setHttpFile(const String& url, const std::vector<uint8_t>& data);
+const std::vector<uint8_t>* httpFile(const String& url); // nullptr if not served
+void setHttpRangeSupport(bool supported);
+bool httpRangeSupport();
+// Body download speed; reading a served body advances the clock (0 = instant)
+void setHttpBandwidthKBps(unsigned long kbps);
+unsigned long httpBandwidthKBps();
+// Connection lost after this many more body bytes (-1 = never). Once.
+void dropHttpAfter(long bytes);
+size_t httpTakeBodyBytes(size_t want); // Called by the body stream
+
+// --- MQTT ---
+// One broker for PubSubClient. It keeps retained messages and the client's
+// will, records every publish and delivers messages to matching
+// subscriptions on the client's next loop(). A connect attempt to an
+// unreachable broker (or without WiFi) costs the WiFiClient timeout.
+struct MqttMessage {
+  String topic;
+  String payload;
+  bool retained;
+};
+void setMqttBrokerReachable(bool reachable); // Going away drops the client
+bool mqttBrokerReachable();
+// Publishes that reached the broker, including the will when it fires
+const std::vector<MqttMessage>& mqttPublished();
+void clearMqttPublished();
+// Retained payload on a topic, empty if none
+String mqttRetained(const String& topic);
+// Publish from another client (Home Assistant, mosquitto_pub)
+void mqttInject(const String& topic, const String& payload, bool retained = false);
+unsigned long mqttConnectCount();
+// Client id, user and password of the last successful connect
+const String& mqttClientId();
+const String& mqttUser();
+const String& mqttPassword();
+bool mqttTopicMatches(const String& filter, const String& topic);
+
+// --- GPIO ---
+struct GpioEdge {
+  unsigned long long us;
+  uint8_t pin;
+  uint8_t level;
+};
+// Only level changes on OUTPUT pins are recorded
+const std::vector<GpioEdge>& gpioEdges();
+void clearGpioEdges();
+typedef void (*GpioListener)(const GpioEdge& edge);
+void setGpioListener(GpioListener listener);
+// Drive an input pin (buttons idle HIGH because of INPUT_PULLUP)
+void setPinLevel(uint8_t pin, uint8_t level);
+uint8_t pinLevel(uint8_t pin);
+
+// --- Filesystem ---
+// LittleFS is backed by this host directory (created on demand)
+void setFsRoot(const std::string& dir);
+const std::string& fsRoot();
+// Remove every file below the root, like LittleFS.format()
+void formatFs();
+// Power cut: file writes stop after this many more bytes (-1 = never).
+// hal::reset() restores power.
+void cutFsWritesAfter(long bytes);
+
+// --- Heap ---
+// Every operator new is counted. The web server's request parsing, header
+// storage and response capture stand in for the core's own buffers and are
+// left out, so the counts are what the firmware itself allocates.
+// ESP.getFreeHeap() is HEAP_SIZE less the live counted bytes.
+const uint32_t HEAP_SIZE = 48 * 1024;
+struct HeapStats {
+  unsigned long allocations;   // Since resetHeapStats()
+  unsigned long long bytes;    // Since resetHeapStats()
+  unsigned long long liveBytes;
+};
+HeapStats heapStats();
+void resetHeapStats();
+// ESP.getHeapFragmentation(); the largest free block shrinks to match
+void setHeapFragmentation(uint8_t percent);
+uint8_t heapFragmentationPercent();
+// Allocations made while one of these is alive are not counted
+class UncountedHeap {
+public:
+  UncountedHeap();
+  ~UncountedHeap();
+};
+
+// --- System ---
+bool restartRequested();
+void clearRestartRequest();
+// Drop RTC user memory, as after a power cycle
+void clearRtcMemory();
+// Serial output goes to stdout unless disabled (benchmarks turn it off)
+void setSerialEnabled(bool enabled);
+// Text typed into the serial console, read by Serial.read()
+void serialInput(const String& text);
+// Keep a copy of what the firmware prints to Serial
+void captureSerial(bool enabled);
+const String& serialOutput();
+void clearSerialOutput();
+
+// Reset clock, pins, network and counters to power-on defaults.
+// The filesystem root is kept so persisted state survives a simulated reboot.
+void reset();
+
+} // namespace hal
@@ -0,0 +1,28 @@
+// Entry point for `pio run -e native`: boots the firmware and runs loop()
+// with the virtual clock following wall time. Test and benchmark builds
+// provide their own main() and drive setup()/loop() directly.
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include "NativeHAL.h"
+#include <unistd.h>
+
+void setup();
+void loop();
+
+int main() {
+  hal::setUtcEpoch((uint32_t)time(nullptr));
+  setup();
+  for (;;) {
+    loop();
+    hal::advanceMillis(1);
+    usleep(1000);
+    if (hal::restartRequested()) {
+      hal::clearRestartRequest();
+      Serial.println(F("[HAL] Restart"));
+      setup();
+    }
+  }
+}
+
+#endif
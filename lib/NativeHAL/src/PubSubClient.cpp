@@ -0,0 +1,202 @@
+// In-process MQTT broker behind the PubSubClient stand-in. One client session
+// at a time; QoS 0 only, like PubSubClient's publish(). The broker's own
+// storage is kept off the firmware's heap counts.
+#include <PubSubClient.h>
+#include <NativeHAL.h>
+#include <deque>
+#include <cstring>
+
+namespace {
+
+bool brokerReachable = true;
+std::vector<hal::MqttMessage> published;
+std::vector<hal::MqttMessage> retained;
+unsigned long session = 0;     // Session of the connected client, 0 if none
+unsigned long lastSession = 0;
+hal::MqttMessage will;
+std::vector<String> subscriptions;
+std::deque<hal::MqttMessage> inbound; // Waiting for the client's loop()
+unsigned long connects = 0;
+String clientId;
+String clientUser;
+String clientPassword;
+
+bool subscribed(const String& topic) {
+  for (const String& filter : subscriptions) {
+    if (hal::mqttTopicMatches(filter, topic)) return true;
+  }
+  return false;
+}
+
+void brokerPublish(const hal::MqttMessage& m) {
+  hal::UncountedHeap uncounted;
+  published.push_back(m);
+  if (m.retained) {
+    for (size_t i = 0; i < retained.size(); i++) {
+      if (retained[i].topic == m.topic) {
+        retained.erase(retained.begin() + i);
+        break;
+      }
+    }
+    if (m.payload.length() > 0) retained.push_back(m); // Empty retained payload clears the topic
+  }
+  if (session != 0 && subscribed(m.topic)) inbound.push_back({m.topic, m.payload, false});
+}
+
+void endSession(bool sendWill) {
+  if (session == 0) return;
+  session = 0;
+  subscriptions.clear();
+  inbound.clear();
+  if (sendWill && will.topic.length() > 0) brokerPublish(will);
+}
+
+} // namespace
+
+namespace hal {
+
+void setMqttBrokerReachable(bool reachable) {
+  brokerReachable = reachable;
+  if (!reachable) endSession(true);
+}
+bool mqttBrokerReachable() { return brokerReachable; }
+const std::vector<MqttMessage>& mqttPublished() { return published; }
+void clearMqttPublished() { published.clear(); }
+
+String mqttRetained(const String& topic) {
+  for (const MqttMessage& m : retained) {
+    if (m.topic == topic) return m.payload;
+  }
+  return String();
+}
+
+void mqttInject(const String& topic, const String& payload, bool retain) {
+  UncountedHeap uncounted;
+  brokerPublish({topic, payload, retain});
+}
+
+unsigned long mqttConnectCount() { return connects; }
+const String& mqttClientId() { return clientId; }
+const String& mqttUser() { return clientUser; }
+const String& mqttPassword() { return clientPassword; }
+
+// Level by level; "+" matches one level, "#" that level and everything below
+bool mqttTopicMatches(const String& filter, const String& topic) {
+  const char* f = filter.c_str();
+  const char* t = topic.c_str();
+  while (true) {
+    const char* fEnd = strchrnul(f, '/');
+    const char* tEnd = strchrnul(t, '/');
+    size_t fLen = fEnd - f;
+    if (fLen == 1 && *f == '#') return true;
+    bool plus = fLen == 1 && *f == '+';
+    if (!plus && (fLen != (size_t)(tEnd - t) || strncmp(f, t, fLen) != 0)) return false;
+    if (!*fEnd) return !*tEnd;
+    if (!*tEnd) return strcmp(fEnd, "/#") == 0; // "a/#" also matches "a"
+    f = fEnd + 1;
+    t = tEnd + 1;
+  }
+}
+
+// Called from hal::reset(): the device went away without saying goodbye
+void dropMqttClient() {
+  brokerReachable = true;
+  endSession(true);
+}
+
+} // namespace hal
+
+bool PubSubClient::setBufferSize(uint16_t size) {
+  if (size == 0) return false;
+  _bufferSize = size;
+  _buffer.assign(size, 0);
+  return true;
+}
+
+bool PubSubClient::connect(const char* id, const char* user, const char* pass, const char* willTopic,
+                           uint8_t willQos, bool willRetain, const char* willMessage) {
+  (void)willQos;
+  if (!_domain || !hal::wifiConnected() || !brokerReachable) {
+    delay(_client ? _client->getTimeout() : 1000);
+    _session = 0;
+    _state = MQTT_CONNECTION_TIMEOUT;
+    return false;
+  }
+  hal::UncountedHeap uncounted;
+  endSession(true); // Same client id takes over
+  session = _session = ++lastSession;
+  will = {willTopic ? String(willTopic) : String(), willMessage ? String(willMessage) : String(), willRetain};
+  connects++;
+  clientId = id;
+  clientUser = user ? user : "";
+  clientPassword = pass ? pass : "";
+  _state = MQTT_CONNECTED;
+  return true;
+}
+
+bool PubSubClient::connected() {
+  if (_session == 0) return false;
+  if (_session == session && hal::wifiConnected() && brokerReachable) return true;
+  if (_session == session) endSession(true);
+  _session = 0;
+  _state = MQTT_CONNECTION_LOST;
+  return false;
+}
+
+void PubSubClient::disconnect() {
+  if (_session != 0 && _session == session) endSession(false);
+  _session = 0;
+  _state = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload, bool retained) {
+  if (!connected()) return false;
+  // Fixed header, topic length and topic must fit in the buffer with the payload
+  if (5 + 2 + strlen(topic) + strlen(payload) > _bufferSize) return false;
+  hal::UncountedHeap uncounted;
+  brokerPublish({topic, payload, retained});
+  return true;
+}
+
+bool PubSubClient::subscribe(const char* topic) {
+  if (!connected()) return false;
+  if (9 + strlen(topic) > _bufferSize) return false;
+  hal::UncountedHeap uncounted;
+  subscriptions.push_back(topic);
+  for (const hal::MqttMessage& m : ::retained) {
+    if (hal::mqttTopicMatches(topic, m.topic)) inbound.push_back(m);
+  }
+  return true;
+}
+
+bool PubSubClient::unsubscribe(const char* topic) {
+  if (!connected()) return false;
+  for (size_t i = 0; i < subscriptions.size(); i++) {
+    if (subscriptions[i] == topic) {
+      subscriptions.erase(subscriptions.begin() + i);
+      break;
+    }
+  }
+  return true;
+}
+
+// Delivers at most one message per call, like the real client
+bool PubSubClient::loop() {
+  if (!connected()) return false;
+  if (inbound.empty()) return true;
+  char* topic = reinterpret_cast<char*>(_buffer.data());
+  size_t payloadLen;
+  {
+    hal::UncountedHeap uncounted;
+    hal::MqttMessage m = inbound.front();
+    inbound.pop_front();
+    size_t topicLen = m.topic.length();
+    payloadLen = m.payload.length();
+    if (5 + 2 + topicLen + payloadLen + 1 > _bufferSize) return true; // Too big, dropped
+    memcpy(topic, m.topic.c_str(), topicLen);
+    topic[topicLen] = '\0';
+    memcpy(topic + topicLen + 1, m.payload.c_str(), payloadLen);
+  }
+  if (_callback) _callback(topic, reinterpret_cast<uint8_t*>(topic + strlen(topic) + 1), payloadLen);
+  return true;
+}
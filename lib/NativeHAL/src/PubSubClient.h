@@ -0,0 +1,54 @@
+// MQTT client stand-in, talking to the in-process broker in PubSubClient.cpp
+// (see the MQTT controls in NativeHAL.h).
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <vector>
+
+#define MQTT_CONNECTION_TIMEOUT (-4)
+#define MQTT_CONNECTION_LOST (-3)
+#define MQTT_CONNECT_FAILED (-2)
+#define MQTT_DISCONNECTED (-1)
+#define MQTT_CONNECTED 0
+
+#define MQTT_MAX_PACKET_SIZE 256
+
+class PubSubClient {
+public:
+  typedef std::function<void(char*, uint8_t*, unsigned int)> callback_t;
+
+  PubSubClient() {}
+  explicit PubSubClient(WiFiClient& client) : _client(&client) {}
+  PubSubClient& setClient(WiFiClient& client) { _client = &client; return *this; }
+  PubSubClient& setServer(const char* domain, uint16_t port) { _domain = domain; _port = port; return *this; }
+  PubSubClient& setCallback(callback_t callback) { _callback = callback; return *this; }
+  PubSubClient& setSocketTimeout(uint16_t seconds) { _socketTimeout = seconds; return *this; }
+  PubSubClient& setKeepAlive(uint16_t seconds) { _keepAlive = seconds; return *this; }
+  bool setBufferSize(uint16_t size);
+  uint16_t getBufferSize() { return _bufferSize; }
+
+  bool connect(const char* id) { return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr); }
+  bool connect(const char* id, const char* user, const char* pass) { return connect(id, user, pass, nullptr, 0, false, nullptr); }
+  bool connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos,
+               bool willRetain, const char* willMessage);
+  bool connected();
+  void disconnect();
+  bool publish(const char* topic, const char* payload, bool retained = false);
+  bool subscribe(const char* topic);
+  bool unsubscribe(const char* topic);
+  bool loop();
+  int state() { return _state; }
+
+private:
+  WiFiClient* _client = nullptr;
+  const char* _domain = nullptr;
+  uint16_t _port = 1883;
+  uint16_t _socketTimeout = 15;
+  uint16_t _keepAlive = 15;
+  uint16_t _bufferSize = MQTT_MAX_PACKET_SIZE;
+  std::vector<uint8_t> _buffer = std::vector<uint8_t>(MQTT_MAX_PACKET_SIZE);
+  callback_t _callback;
+  int _state = MQTT_DISCONNECTED;
+  unsigned long _session = 0; // Broker session this client holds, 0 if none
+};
@@ -0,0 +1,47 @@
+// Helpers shared by the native test suites: run loop() on the virtual clock,
+// power-cycle the device and read the JSON API.
+#pragma once
+
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <ESP8266WebServer.h>
+#include <ArduinoJson.h>
+#include <functional>
+
+void setup();
+void loop();
+
+extern ESP8266WebServer server;
+extern int32_t timezoneOffset;
+extern String deviceName;
+extern String mqttPassword;
+
+// Calls loop() every step ms of virtual time until ms have passed
+inline void runLoopFor(unsigned long long ms, unsigned long step = 100) {
+  for (unsigned long long t = 0; t < ms; t += step) {
+    loop();
+    hal::advanceMillis(step);
+  }
+}
+
+// Power cycle: the simulated hardware resets, flash and RTC memory are kept.
+// prepare runs before setup() to set up what the device wakes up to.
+inline void reboot(const std::function<void()>& prepare = {}) {
+  hal::reset();
+  if (prepare) prepare();
+  setup();
+}
+
+// Scribbles over settings held in RAM so only what was stored comes back
+inline void forgetSettings() {
+  timezoneOffset = 0;
+  deviceName = "";
+  mqttPassword = "";
+}
+
+inline JsonDocument api(const char* uri) {
+  JsonDocument doc;
+  HttpResponse r = server.inject(HTTP_GET, uri);
+  deserializeJson(doc, r.body);
+  return doc;
+}
@@ -0,0 +1,56 @@
+#include <Ticker.h>
+#include "NativeHAL.h"
+#include <vector>
+
+namespace {
+std::vector<Ticker*> armedTickers;
+}
+
+namespace hal {
+
+void setNowMicros(unsigned long long us); // Arduino.cpp
+
+void runDueTickers(unsigned long long nowUs) {
+  for (;;) {
+    Ticker* next = nullptr;
+    for (Ticker* t : armedTickers) {
+      if (t->deadline() <= nowUs && (!next || t->deadline() < next->deadline())) next = t;
+    }
+    if (!next) return;
+    setNowMicros(next->deadline());
+    next->fire();
+  }
+}
+
+void clearTickers() {
+  std::vector<Ticker*> armed = armedTickers;
+  for (Ticker* t : armed) t->detach();
+}
+
+} // namespace hal
+
+void Ticker::arm(unsigned long long periodUs, bool repeat, callback_function_t callback) {
+  detach();
+  _callback = callback;
+  _period = periodUs ? periodUs : 1;
+  _repeat = repeat;
+  _deadline = hal::nowMicros() + _period;
+  _armed = true;
+  armedTickers.push_back(this);
+}
+
+void Ticker::detach() {
+  if (!_armed) return;
+  _armed = false;
+  armedTickers.erase(std::remove(armedTickers.begin(), armedTickers.end(), this), armedTickers.end());
+}
+
+void Ticker::fire() {
+  callback_function_t callback = _callback;
+  if (_repeat) {
+    _deadline += _period;
+  } else {
+    detach();
+  }
+  if (callback) callback();
+}
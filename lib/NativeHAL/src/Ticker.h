@@ -0,0 +1,46 @@
+// Ticker on the virtual clock: callbacks run from hal::advanceMillis()/delay()
+// at their exact deadline, like the SDK timer task on the ESP8266.
+#pragma once
+
+#include <Arduino.h>
+
+class Ticker {
+public:
+  typedef std::function<void(void)> callback_function_t;
+
+  Ticker() {}
+  ~Ticker() { detach(); }
+  Ticker(const Ticker&) = delete;
+  Ticker& operator=(const Ticker&) = delete;
+
+  void once(float seconds, callback_function_t callback) { arm((unsigned long long)(seconds * 1e6f), false, callback); }
+  void once_ms(uint32_t ms, callback_function_t callback) { arm((unsigned long long)ms * 1000ULL, false, callback); }
+  void attach(float seconds, callback_function_t callback) { arm((unsigned long long)(seconds * 1e6f), true, callback); }
+  void attach_ms(uint32_t ms, callback_function_t callback) { arm((unsigned long long)ms * 1000ULL, true, callback); }
+
+  template <typename TArg> void once_ms(uint32_t ms, void (*callback)(TArg), TArg arg) {
+    once_ms(ms, [callback, arg]() { callback(arg); });
+  }
+  template <typename TArg> void once(float seconds, void (*callback)(TArg), TArg arg) {
+    once(seconds, [callback, arg]() { callback(arg); });
+  }
+  template <typename TArg> void attach_ms(uint32_t ms, void (*callback)(TArg), TArg arg) {
+    attach_ms(ms, [callback, arg]() { callback(arg); });
+  }
+
+  void detach();
+  bool active() const { return _armed; }
+
+  // Used by the virtual clock
+  unsigned long long deadline() const { return _deadline; }
+  void fire();
+
+private:
+  void arm(unsigned long long periodUs, bool repeat, callback_function_t callback);
+
+  callback_function_t _callback;
+  unsigned long long _deadline = 0;
+  unsigned long long _period = 0;
+  bool _repeat = false;
+  bool _armed = false;
+};
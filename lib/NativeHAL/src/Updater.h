@@ -0,0 +1,67 @@
+// Firmware updater stand-in: keeps the image in memory, nothing is flashed.
+// Like the core, the first byte has to be an image (0xE9) or gzip (0x1F)
+// magic; a gzipped image is stored as is for the bootloader to inflate.
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#define UPDATE_ERROR_OK 0
+#define UPDATE_ERROR_WRITE 1
+#define UPDATE_ERROR_SPACE 4
+#define UPDATE_ERROR_SIZE 5
+#define UPDATE_ERROR_ABORT 7
+#define UPDATE_ERROR_MAGIC_BYTE 10
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+class UpdaterClass {
+public:
+  bool begin(size_t size) {
+    if (size == 0) { _error = UPDATE_ERROR_SIZE; return false; }
+    _size = size;
+    _progress = 0;
+    _running = true;
+    _error = UPDATE_ERROR_OK;
+    _image.clear();
+    return true;
+  }
+  size_t write(const uint8_t* data, size_t len) {
+    if (!_running || _error != UPDATE_ERROR_OK) return 0;
+    if (_size != UPDATE_SIZE_UNKNOWN && _progress + len > _size) { _error = UPDATE_ERROR_SPACE; return 0; }
+    if (_progress == 0 && len > 0 && data[0] != 0xE9 && data[0] != 0x1F) { _error = UPDATE_ERROR_MAGIC_BYTE; return 0; }
+    _image.insert(_image.end(), data, data + len);
+    _progress += len;
+    return len;
+  }
+  bool end(bool evenIfRemaining = false) {
+    if (!_running) return false;
+    _running = false;
+    if (_error != UPDATE_ERROR_OK) return false;
+    if (!evenIfRemaining && _size != UPDATE_SIZE_UNKNOWN && _progress != _size) { _error = UPDATE_ERROR_SIZE; return false; }
+    if (_progress == 0) { _error = UPDATE_ERROR_ABORT; return false; }
+    _succeeded++;
+    return true;
+  }
+  void printError(Print& out) { out.printf("Update error %u\n", _error); }
+  bool hasError() const { return _error != UPDATE_ERROR_OK; }
+  uint8_t getError() const { return _error; }
+  bool isRunning() const { return _running; }
+  bool isFinished() const { return !_running && _succeeded; }
+  size_t size() const { return _size; }
+  size_t progress() const { return _progress; }
+  size_t remaining() const { return _size - _progress; }
+
+  // Host only
+  unsigned long successCount() const { return _succeeded; }
+  const std::vector<uint8_t>& image() const { return _image; } // Written by the last update
+
+private:
+  size_t _size = 0;
+  size_t _progress = 0;
+  bool _running = false;
+  uint8_t _error = UPDATE_ERROR_OK;
+  unsigned long _succeeded = 0;
+  std::vector<uint8_t> _image;
+};
+
+extern UpdaterClass Update;
@@ -0,0 +1,67 @@
+// WiFiManager stand-in. autoConnect() succeeds when hal::wifiConnected();
+// otherwise it blocks (on the virtual clock) for the config portal timeout.
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+class WiFiManager {
+public:
+  void setAPCallback(std::function<void(WiFiManager*)> fn) { _apCallback = fn; }
+  void setSaveConfigCallback(std::function<void(void)> fn) { (void)fn; }
+  void setConfigPortalTimeout(unsigned long seconds) { _portalTimeout = seconds; }
+  void setConnectTimeout(unsigned long seconds) { _connectTimeout = seconds; }
+  void setMinimumSignalQuality(int quality) { (void)quality; }
+  void setAPStaticIPConfig(IPAddress ip, IPAddress gw, IPAddress sn) { (void)ip; (void)gw; (void)sn; }
+  void setDebugOutput(bool debug) { (void)debug; }
+  void setCaptivePortalEnable(bool enable) { (void)enable; }
+  void setBreakAfterConfig(bool shouldBreak) { (void)shouldBreak; }
+  void setConfigPortalBlocking(bool blocking) { _blocking = blocking; }
+  void setHostname(const char* hostname) { (void)hostname; }
+
+  bool autoConnect(const char* apName, const char* apPassword = nullptr) {
+    (void)apPassword;
+    if (hal::wifiConnected()) return true;
+    delay(_connectTimeout * 1000UL);
+    if (hal::wifiConnected()) return true;
+    return startConfigPortal(apName);
+  }
+
+  bool startConfigPortal(const char* apName, const char* apPassword = nullptr) {
+    (void)apPassword;
+    _portalSSID = apName ? apName : "";
+    _portalActive = true;
+    if (_apCallback) _apCallback(this);
+    if (!_blocking) return false;
+    // Blocks until configured or timed out; on the host nobody configures it
+    delay(_portalTimeout ? _portalTimeout * 1000UL : 1000UL);
+    _portalActive = false;
+    return hal::wifiConnected();
+  }
+
+  // Non-blocking portal: returns true once connected
+  bool process() {
+    if (_portalActive && hal::wifiConnected()) {
+      _portalActive = false;
+      return true;
+    }
+    return false;
+  }
+
+  bool stopConfigPortal() { _portalActive = false; return true; }
+  bool getConfigPortalActive() const { return _portalActive; }
+  void resetSettings() { _resets++; }
+  String getConfigPortalSSID() const { return _portalSSID; }
+  String getWiFiSSID() const { return WiFi.SSID(); }
+
+  static unsigned long resetCount() { return _resets; }
+
+private:
+  std::function<void(WiFiManager*)> _apCallback;
+  unsigned long _portalTimeout = 0;
+  unsigned long _connectTimeout = 10;
+  bool _blocking = true;
+  bool _portalActive = false;
+  String _portalSSID;
+  static unsigned long _resets;
+};
@@ -2,8 +2,7 @@
 #include <ESP8266WiFi.h>
 #include <ESP8266WebServer.h>
 #include <ArduinoJson.h>
-//#include <Ticker.h>
-#include <NTPClient.h>
+#include <Ticker.h>
 #include <PubSubClient.h>
 #include <ArduinoOTA.h>
 #include <WiFiManager.h>
@@ -12,7 +11,9 @@
 #include <ESP8266mDNS.h> // Include mDNS library
 #include <ESP8266HTTPClient.h>
 #include <Updater.h>
+#include <bearssl/bearssl_hash.h>
 #include <EEPROM.h>
+#include "web_assets.h" // Generated from web/ by tools/embed_web_assets.py
 #define SPIFFS LittleFS // Replace SPIFFS with LittleFS for compatibility
 
 // Telnet server globals
@@ -56,55 +57,11 @@ void writeChannels(int channels) {
   EEPROM.commit();
 }
 
-// Global variables that getFormattedTime needs
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, "pool.ntp.org", 19800, 60000);  // 19800 seconds = 5.5 hours for IST
-const unsigned long jan1_2025_epoch = 1735689600; // Epoch time for Jan 1, 2025
-// Time formatting function
-String getFormattedTime() {
-  timeClient.update();
-  time_t epochTime = timeClient.getEpochTime();
-  struct tm *ptm = localtime((time_t *)&epochTime); // Use localtime for timezone
-  static const char* months[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
-  int hour = ptm->tm_hour;
-  int minute = ptm->tm_min;
-  int day = ptm->tm_mday;
-  int month = ptm->tm_mon;
-  int year = ptm->tm_year + 1900;
-  String ampm = (hour < 12) ? "AM" : "PM";
-  int hour12 = hour % 12;
-  if (hour12 == 0) hour12 = 12;
-  char timeString[32];
-  snprintf(timeString, sizeof(timeString), "%02d-%s-%04d %02d:%02d %s", day, months[month], year, hour12, minute, ampm.c_str());
-  return String(timeString);
-}
-
-// Helper function to check if a timestamp is from today
-bool isToday(unsigned long timestamp) {
-  if (timestamp == 0) return false; // Never dosed
-  timeClient.update();
-  time_t now = timeClient.getEpochTime();
-  //telnetPrint("[isToday] now epoch: " + String((long)now) + "\r\n");
-  struct tm nowTmCopy;
-  struct tm *nowTm = gmtime(&now);
-  if (nowTm) nowTmCopy = *nowTm;
-  time_t timestampTime = timestamp;
-  struct tm timestampTmCopy;
-  struct tm *timestampTm = gmtime(&timestampTime);
-  if (timestampTm) timestampTmCopy = *timestampTm;
-  // telnetPrint("[isToday] nowTm: year=" + String(nowTmCopy.tm_year+1900) + ", mon=" + String(nowTmCopy.tm_mon+1) + ", mday=" + String(nowTmCopy.tm_mday) + "\r\n");
-  // telnetPrint("[isToday] timestamp: " + String((long)timestamp) + "\r\n");
-  //telnetPrint("[isToday] timestampTm: year=" + String(timestampTmCopy.tm_year+1900) + ", mon=" + String(timestampTmCopy.tm_mon+1) + ", mday=" + String(timestampTmCopy.tm_mday) + "\r\n");
-  bool sameDay = (nowTmCopy.tm_year == timestampTmCopy.tm_year && 
-          nowTmCopy.tm_mon == timestampTmCopy.tm_mon && 
-          nowTmCopy.tm_mday == timestampTmCopy.tm_mday);
-  //telnetPrint("[isToday] sameDay: " + String(sameDay ? "true" : "false") + "\r\n");
-  return sameDay;
-}
-
 // Pin Definitions
 #define MOTOR1_PIN D1
 #define MOTOR2_PIN D5
+#define MOTOR3_PIN D0 // 4-pump boards only
+#define MOTOR4_PIN D8
 #define LED_PIN D2
 #define CALIBRATE_BUTTON1_PIN D3
 #define CALIBRATE_BUTTON2_PIN D4
@@ -118,6 +75,8 @@ bool isToday(unsigned long timestamp) {
 #define LED_BLUE 0x0000FF
 #define LED_YELLOW 0xFFFF00
 #define LED_PURPLE 0xFF00FF  // Adding purple color (mix of red and blue)
+#define LED_CYAN 0x00FFFF
+#define LED_ORANGE 0xFF8000
 
 // Initialize NeoPixel strip
 Adafruit_NeoPixel strip = Adafruit_NeoPixel(NUM_LEDS, LED_PIN, NEO_GRB + NEO_KHZ800);
@@ -140,9 +99,8 @@ void updateLEDState();
 void setLEDState(LEDState state);
 void updateLED(uint32_t color);
 void handlePrimePump();
-// Function declarations for header and footer generators
-String generateHeader(const String& title);
-String generateFooter();
+const __FlashStringHelper* getWiFiSignalStrength();
+void serveStaticAsset(const char* contentType, const char* etag, const uint8_t* data, size_t length);
 // --- Weekly Schedule Data Structure ---
 struct DaySchedule {
   bool enabled;
@@ -157,16 +115,139 @@ struct WeeklySchedule {
   bool missedDoseCompensation;
 };
 
-// Global WeeklySchedule variables
-WeeklySchedule weeklySchedule1;
-WeeklySchedule weeklySchedule2;
+// A schedule reduced to what days remaining needs, in 0.01 ml: the weekly
+// total and prefix sums over the week (Monday first). Built when the schedule
+// changes, so days remaining is whole weeks plus a partial-week lookup.
+struct DoseForecast {
+  int32_t weekCentiMl;
+  uint8_t weekDoses;
+  int32_t prefixCentiMl[8]; // Volume of days [0, i)
+  uint8_t prefixDoses[8];
+  uint8_t stopAfter[7]; // Days from each weekday to an enabled 0 ml day, 7 if none
+};
+
+// Last days-remaining result and the inputs it was worked out from
+struct DaysRemainingCache {
+  float remainingML;
+  uint32_t scheduleVersion;
+  int8_t weekday;
+  int days;
+};
+
+// --- Channels ---
+// One entry per pump. MAX_CHANNELS fixes the storage at compile time, the
+// number actually fitted (numChannels) comes from EEPROM at boot.
+#define MAX_CHANNELS 4
+
+struct Channel {
+  String name;
+  float calibrationFactor;              // ms per ml
+  bool calibrated;
+  float remainingML;
+  int daysRemaining;
+  float lastDispensedVolume;
+  String lastDispensedTime;
+  unsigned long lastScheduledDoseTime;  // Epoch of the last scheduled dose
+  bool priming;
+  unsigned long primeStartTime;
+  WeeklySchedule schedule;
+  uint32_t scheduleVersion;             // Bumped by scheduleChanged()
+  DoseForecast forecast;
+  DaysRemainingCache daysCache;
+};
+
+Channel channels[MAX_CHANNELS];
+int numChannels = 1; // Active channels, read from EEPROM in setup()
+
+const uint8_t motorPins[MAX_CHANNELS] = {MOTOR1_PIN, MOTOR2_PIN, MOTOR3_PIN, MOTOR4_PIN};
+const uint32_t channelLedColors[MAX_CHANNELS] = {LED_BLUE, LED_YELLOW, LED_CYAN, LED_ORANGE};
+
+// Channels are numbered from 1 everywhere outside this array
+bool isValidChannel(int channel) {
+  return channel >= 1 && channel <= numChannels;
+}
+
+Channel& getChannel(int channel) {
+  return channels[channel - 1];
+}
+
+// Channel being primed, 0 if none
+int primingChannel() {
+  for (int i = 0; i < numChannels; i++) {
+    if (channels[i].priming) return i + 1;
+  }
+  return 0;
+}
+
+void initChannels() {
+  for (int i = 0; i < MAX_CHANNELS; i++) {
+    Channel& c = channels[i];
+    c.name = "Channel " + String(i + 1);
+    c.calibrationFactor = 1;
+    c.calibrated = false;
+    c.remainingML = 0.0;
+    c.daysRemaining = 0;
+    c.lastDispensedVolume = 0.0;
+    c.lastDispensedTime = "N/A";
+    c.lastScheduledDoseTime = 0;
+    c.priming = false;
+    c.primeStartTime = 0;
+    c.schedule.channelName = c.name;
+    c.schedule.missedDoseCompensation = false;
+    for (int d = 0; d < 7; d++) c.schedule.days[d] = {false, 0, 0, 0.0f};
+    c.scheduleVersion = 0;
+    c.forecast = {};
+    c.daysCache = {0.0f, UINT32_MAX, -1, 0};
+  }
+}
+
+// --- Dose event log types ---
+enum DoseSource : uint8_t {
+  DOSE_SOURCE_MANUAL,
+  DOSE_SOURCE_SCHEDULED,
+  DOSE_SOURCE_MISSED,
+  DOSE_SOURCE_CALIBRATION,
+  DOSE_SOURCE_PRIME,
+  DOSE_SOURCE_COUNT
+};
+const char* const doseSourceNames[DOSE_SOURCE_COUNT] = {"manual", "scheduled", "missed", "calibration", "prime"};
+
+struct DoseEvent {
+  uint32_t seq;        // 1-based position in the log
+  uint32_t epoch;      // UTC seconds, 0 if the clock was not synced
+  uint32_t durationMs; // Motor run time
+  float volumeMl;
+  uint8_t channel;
+  uint8_t source;      // DoseSource
+};
+
+// Streams records in seq order without loading the log
+class DoseLogReader {
+public:
+  explicit DoseLogReader(uint32_t fromSeq);
+  bool next(DoseEvent& e);
+
+private:
+  File _file;             // Segment holding _seq
+  uint32_t _segmentStart; // First seq of that segment, 0 if none open
+  uint32_t _seq;
+};
+
+bool doseLogRead(uint32_t seq, DoseEvent& e);
+uint32_t doseLogSeqAtOrAfter(uint32_t epoch);
 // Function prototypes for helpers used before definition
-int calculateDaysRemaining(float remainingML, WeeklySchedule* ws);
+int calculateDaysRemaining(int channel);
+void updateDaysRemaining(int channel);
+void scheduleChanged(int channel);
 void sendNtfyNotification(const String& title, const String& message);
+void serviceNtfyQueue();
+void loadNtfyQueue();
+void saveNtfyQueue();
+void mqttBegin();
+void mqttService();
+int mqttDiscoveryCount();
+bool mqttPublishDiscovery(int index);
 
-// Add a forward declaration for updateDaysRemaining
-template<typename T>
-void updateDaysRemaining(int channel, float remainingML, T* ws);
 
 // Global Variables for LED
 LEDState currentLEDState = LED_OFF;
@@ -189,84 +270,97 @@ void setLEDState(LEDState state) {
 // Global Variables
 ESP8266WebServer server(80);
 
-// Channel names
-String channel1Name = "Channel 1";
-String channel2Name = "Channel 2";
-
 // System Settings Variables
 
 String deviceName; // Default device name with last 2 chars of MAC
 
-// Calibration Variables
-float calibrationFactor1 = 1;
-float calibrationFactor2 = 1;
-
-// Persistent Storage Variables
-float remainingMLChannel1 = 0.0;
-float remainingMLChannel2 = 0.0;
-
 // Add timezone offset to global variables
 int32_t timezoneOffset = 19800;  // Default to IST (UTC+5:30)
 
-// Add last dispensed volume and time string for each channel
-float lastDispensedVolume1 = 0.0;
-float lastDispensedVolume2 = 0.0;
-String lastDispensedTime1 = "N/A";
-String lastDispensedTime2 = "N/A";
-
-// Prime pump state variables
-bool isPrimingChannel1 = false;
-bool isPrimingChannel2 = false;
+// Motors currently running a queued dose, and how many may run at once
+// (limited by the power supply)
+#define MAX_CONCURRENT_MOTORS_DEFAULT 2
+int runningMotors = 0;
+int maxConcurrentMotors = MAX_CONCURRENT_MOTORS_DEFAULT;
 
 // Notification settings
 bool notifyLowFert = true;
 bool notifyStart = false;
 bool notifyDose = false;
 
-// Calibration status variables
-bool calibratedChannel1 = false;
-bool calibratedChannel2 = false;
+// MQTT broker settings, an empty host leaves MQTT off
+#define MQTT_DEFAULT_PORT 1883
+String mqttHost;
+uint16_t mqttPort = MQTT_DEFAULT_PORT;
+String mqttUser;
+String mqttPassword;
+String mqttTopic; // Base topic, doser/<MAC> unless set
+bool mqttConfigChanged = true;
+char mqttMac[13];           // Station MAC in hex, names this device on the broker
+int mqttDiscoveryNext = 0;  // Home Assistant configs sent on this connection
 
 // Add this global variable
 String lastNotifiedIP = "";
 
-// Add last scheduled dose timestamps for each channel (epoch time)
-unsigned long lastScheduledDoseTime1 = 0;
-unsigned long lastScheduledDoseTime2 = 0;
-
-// Add global variable for number of channels
-int numChannels = 1; // Default 1
-
 // Add global flags and timer for pending resets
 bool pendingWiFiReset = false;
 bool pendingFactoryReset = false;
 unsigned long resetRequestTime = 0;
 const unsigned long RESET_DELAY_MS = 3500;
 
-// Add global variables for days remaining
-int daysRemainingChannel1 = 0;
-int daysRemainingChannel2 = 0;
+// Deferred /data.json writes: changes mark the data dirty and loop() writes it
+// once things have been quiet for a moment
+const unsigned long PERSIST_QUIET_MS = 500;
+const unsigned long PERSIST_MAX_DEFER_MS = 5000;
+bool persistentDataDirty = false;
+unsigned long persistentDataDirtySince = 0;
+unsigned long persistentDataLastChange = 0;
+unsigned long persistentDataWrites = 0;
+unsigned long persistentDataWritesSaved = 0; // Saves absorbed by a pending write
 
 // Add global variable for calibration time
 int calibrationTimeMs = 5000; // Default to 5 seconds
 
 // Function Prototypes
-void setupWiFi();
 void setupWebServer();
 void handleCalibration();
 void handleManualDispense();
+bool dispenseManualDose(int channel, float ml);
+bool setPriming(int channel, bool state);
+bool channelDosing(int channel);
+bool motorFree(int channel);
 void updateLED(uint32_t color);
 //void calibrateMotor(int channel, float &calibrationFactor);
 void setupTimeSync();
-void checkDailyDispense();
+void clockService();
+void clockSyncSoon();
+void clockSaveCheckpoint();
+uint32_t clockLoadCheckpoint();
+void rescheduleDoses();
+void serviceDoseScheduler();
 void loadPersistentDataFromSPIFFS();
 void savePersistentDataToSPIFFS();
-void updateRemainingML(int channel, float dispensedML);
+void markPersistentDataDirty();
+void flushPersistentData();
+void servicePersistentData();
+void doseLogBegin();
+void doseLogAppend(int channel, float volumeMl, uint8_t source, unsigned long durationMs);
+void counterBegin();
+void counterDose(int channel, float ml, unsigned long durationMs, bool scheduled);
+void counterSetRemaining(int channel, float ml);
+void counterMotorRun(int channel, unsigned long ms);
+int32_t toCentiMl(float ml);
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len);
+bool snapshotRestore();
+void snapshotSave();
+void snapshotClear();
 
 //void handleSystemReset();
 void setupOTA();
 void blinkLED(uint32_t color, int times);
-void runMotor(int channel, int durationMs);
+bool runMotor(int channel, int durationMs, uint32_t scheduledEpoch = 0);
+void serviceMotor();
+bool isDosing();
 void updateLEDState();
 String getFormattedTime(); 
 void handleRestartOnly();
@@ -274,162 +368,745 @@ void handleWiFiReset();
 void handleFactoryReset();
 void handleSystemSettingsSave();
 void handleFirmwareUpdate();
+void handleFirmwareUploaded();
+void handleFirmwarePull();
+void handleApiFirmware();
+void otaService();
+void handleApiStatus();
+void handleApiChannels();
+void handleApiSchedules();
+void handleApiHistory();
+void handleApiSettings();
+void handleApiState();
+void handleMetrics();
+void handleApiProfile();
+void handleApiBoot();
+void sampleHeap();
 
 // --- Helper: Day names ---
 const char* dayNames[7] = {"Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"};
 
-// --- Save/Load Weekly Schedules ---
-void saveWeeklySchedulesToSPIFFS() {
-  File file = LittleFS.open("/weekly_schedules.json", "w");
-  if (!file) {
-    Serial.println(F("Failed to open weekly_schedules.json for writing"));
-    return;
+// --- Clock ---
+// UTC comes from SNTP and is anchored to a 64-bit millis() count. Between syncs
+// the clock runs on millis() with the measured oscillator drift taken out, so it
+// stays usable while the server is unreachable. Requests go out from loop() and
+// the reply is picked up on a later pass, so nothing waits on the network. The
+// local date, weekday and minute of day are worked out once per minute.
+WiFiUDP ntpUDP;
+const char* NTP_SERVER = "pool.ntp.org";
+const uint16_t NTP_PORT = 123;
+const uint16_t NTP_LOCAL_PORT = 2390;
+const unsigned long NTP_SYNC_INTERVAL_MS = 3600000UL;
+const unsigned long NTP_RETRY_MS = 60000UL;
+const unsigned long NTP_REPLY_TIMEOUT_MS = 1000;
+const uint32_t NTP_UNIX_OFFSET = 2208988800UL; // Seconds from 1900 to 1970
+const long CLOCK_MAX_DRIFT_PPM = 1000;
+const uint64_t CLOCK_MIN_DRIFT_SPAN_MS = 600000ULL; // Shorter spans are too noisy
+const long CLOCK_STEP_MS = 2000; // Larger corrections reschedule doses
+const unsigned long jan1_2025_epoch = 1735689600; // Epoch time for Jan 1, 2025
+
+// Broken-down local time, valid for one minute
+struct LocalTime {
+  uint32_t minute = UINT32_MAX; // Local epoch / 60 this was worked out for, none yet
+  uint32_t day;    // Local days since 1970-01-01
+  uint8_t weekday; // 0=Monday, 6=Sunday
+  uint16_t minuteOfDay;
+  uint16_t year;
+  uint8_t month;   // 1-12
+  uint8_t mday;
+  char formatted[24]; // 16-Jul-2025 08:30 AM
+};
+
+uint32_t monoLastMillis = 0;
+uint64_t monoHighMs = 0;
+uint64_t clockAnchorUtcMs = 0; // UTC at clockAnchorMono
+uint64_t clockAnchorMono = 0;
+long clockDriftPpm = 0;        // How fast UTC runs against millis()
+long clockLastCorrectionMs = 0;
+unsigned long ntpSyncs = 0;
+unsigned long ntpFailures = 0;
+bool ntpRequestPending = false;
+bool clockEstimated = false;   // Running on from the checkpoint, not synced since boot
+uint64_t snapshotClockUtcMs = 0; // From the warm-restart snapshot for setupTimeSync(), 0 if none
+long snapshotDriftPpm = 0;
+uint32_t ntpRequestSentAt = 0;
+uint32_t ntpNextRequestAt = 0;
+LocalTime localTimeCache;
+
+// millis() widened to 64 bits. Must run at least once per 49-day wrap; loop()
+// calls it every pass through clockService().
+uint64_t monoMillis() {
+  uint32_t now = (uint32_t)millis();
+  if (now < monoLastMillis) monoHighMs += 0x100000000ULL;
+  monoLastMillis = now;
+  return monoHighMs + now;
+}
+
+uint64_t clockUtcMs() {
+  int64_t elapsed = (int64_t)(monoMillis() - clockAnchorMono);
+  return clockAnchorUtcMs + elapsed + elapsed * clockDriftPpm / 1000000LL;
+}
+
+uint32_t clockUtc() {
+  return (uint32_t)(clockUtcMs() / 1000ULL);
+}
+
+// Local epoch (UTC plus timezoneOffset), the base for schedules and timestamps
+uint32_t clockNow() {
+  return clockUtc() + timezoneOffset;
+}
+
+// 0=Monday, 6=Sunday (1970-01-01 was a Thursday)
+int weekdayOf(uint32_t epoch) {
+  return (int)((epoch / 86400UL + 3) % 7);
+}
+
+void breakDownLocalTime(uint32_t now, LocalTime& t) {
+  static const char* months[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+  t.minute = now / 60;
+  t.day = now / 86400UL;
+  t.weekday = weekdayOf(now);
+  t.minuteOfDay = (now % 86400UL) / 60;
+  // Civil date from the day count (H. Hinnant's days_from_civil inverse)
+  uint32_t z = t.day + 719468;
+  uint32_t era = z / 146097;
+  uint32_t doe = z - era * 146097;
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  t.mday = doy - (153 * mp + 2) / 5 + 1;
+  t.month = mp < 10 ? mp + 3 : mp - 9;
+  t.year = yoe + era * 400 + (t.month <= 2);
+  int hour12 = (t.minuteOfDay / 60) % 12;
+  if (hour12 == 0) hour12 = 12;
+  snprintf(t.formatted, sizeof(t.formatted), "%02d-%s-%04d %02d:%02d %s", t.mday, months[t.month - 1], t.year,
+           hour12, t.minuteOfDay % 60, t.minuteOfDay < 720 ? "AM" : "PM");
+}
+
+void refreshLocalTime(uint32_t now) {
+  breakDownLocalTime(now, localTimeCache);
+}
+
+const LocalTime& localTime() {
+  uint32_t now = clockNow();
+  if (now / 60 != localTimeCache.minute) refreshLocalTime(now);
+  return localTimeCache;
+}
+
+void setTimezoneOffset(int32_t offset) {
+  timezoneOffset = offset;
+  localTimeCache.minute = UINT32_MAX;
+  rescheduleDoses();
+}
+
+// Time formatting function
+String getFormattedTime() {
+  return String(localTime().formatted);
+}
+
+// Helper function to check if a timestamp (local epoch) is from today
+bool isToday(unsigned long timestamp) {
+  if (timestamp == 0) return false; // Never dosed
+  return timestamp / 86400UL == localTime().day;
+}
+
+// Take a fresh UTC reading: measure drift against the last one and re-anchor
+void clockSync(uint64_t utcMs) {
+  uint64_t mono = monoMillis();
+  int64_t correction = (int64_t)(utcMs - clockUtcMs());
+  if (timeSynced && mono - clockAnchorMono >= CLOCK_MIN_DRIFT_SPAN_MS) {
+    clockDriftPpm += (long)(correction * 1000000LL / (int64_t)(mono - clockAnchorMono));
+    clockDriftPpm = constrain(clockDriftPpm, -CLOCK_MAX_DRIFT_PPM, CLOCK_MAX_DRIFT_PPM);
   }
-  JsonDocument doc;
-  // Channel 1
-  JsonObject ch1 = doc["ch1"].to<JsonObject>();
-  ch1["channelName"] = weeklySchedule1.channelName;
-  ch1["missedDoseCompensation"] = weeklySchedule1.missedDoseCompensation;
-  JsonArray days1 = ch1["days"].to<JsonArray>();
-  for (int i = 0; i < 7; ++i) {
-    JsonObject d = days1.add<JsonObject>();
-    d["enabled"] = weeklySchedule1.days[i].enabled;
-    d["hour"] = weeklySchedule1.days[i].hour;
-    d["minute"] = weeklySchedule1.days[i].minute;
-    d["volume"] = weeklySchedule1.days[i].volume;
-  }
-  // Channel 2
-  JsonObject ch2 = doc.createNestedObject("ch2");
-  ch2["channelName"] = weeklySchedule2.channelName;
-  ch2["missedDoseCompensation"] = weeklySchedule2.missedDoseCompensation;
-  JsonArray days2 = ch2.createNestedArray("days");
-  for (int i = 0; i < 7; ++i) {
-    JsonObject d = days2.createNestedObject();
-    d["enabled"] = weeklySchedule2.days[i].enabled;
-    d["hour"] = weeklySchedule2.days[i].hour;
-    d["minute"] = weeklySchedule2.days[i].minute;
-    d["volume"] = weeklySchedule2.days[i].volume;
+  bool stepped = !timeSynced || correction > CLOCK_STEP_MS || correction < -CLOCK_STEP_MS;
+  clockAnchorUtcMs = utcMs;
+  clockAnchorMono = mono;
+  clockLastCorrectionMs = timeSynced ? (long)correction : 0;
+  localTimeCache.minute = UINT32_MAX;
+  timeSynced = true;
+  clockEstimated = false;
+  ntpSyncs++;
+  if (stepped) rescheduleDoses();
+  clockSaveCheckpoint();
+}
+
+static uint32_t ntpRead32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+void ntpSendRequest(uint32_t nowMs) {
+  uint8_t packet[48] = {0};
+  packet[0] = 0xE3; // Unsynchronised, version 4, client mode
+  // Our transmit field comes back as the originate field and ties the reply to this request
+  packet[40] = nowMs >> 24; packet[41] = nowMs >> 16; packet[42] = nowMs >> 8; packet[43] = nowMs;
+  if (!ntpUDP.beginPacket(NTP_SERVER, NTP_PORT)) {
+    ntpNextRequestAt = nowMs + NTP_RETRY_MS;
+    return;
   }
-  serializeJson(doc, file);
-  file.close();
+  ntpUDP.write(packet, sizeof(packet));
+  ntpUDP.endPacket();
+  ntpRequestPending = true;
+  ntpRequestSentAt = nowMs;
 }
 
-void loadWeeklySchedulesFromSPIFFS() {
-  File file = LittleFS.open("/weekly_schedules.json", "r");
-  if (!file) {
-    // Set defaults
-    weeklySchedule1.channelName = channel1Name;
-    weeklySchedule2.channelName = channel2Name;
-    for (int i = 0; i < 7; ++i) {
-      weeklySchedule1.days[i] = {false, 0, 0, 0.0f};
-      weeklySchedule2.days[i] = {false, 0, 0, 0.0f};
+// Returns true if a valid reply was taken
+bool ntpReadReply(uint32_t nowMs) {
+  if (ntpUDP.parsePacket() < 48) return false;
+  uint8_t packet[48];
+  if (ntpUDP.read(packet, sizeof(packet)) < 48) return false;
+  if ((packet[0] & 0x07) != 4 || packet[1] == 0 || packet[1] > 15) return false; // Not a server reply / kiss-of-death
+  if (ntpRead32(packet + 24) != ntpRequestSentAt) return false; // Stale reply
+  uint32_t seconds = ntpRead32(packet + 40);
+  if (seconds < NTP_UNIX_OFFSET) return false;
+  uint32_t rtt = nowMs - ntpRequestSentAt;
+  uint64_t utcMs = (uint64_t)(seconds - NTP_UNIX_OFFSET) * 1000ULL + (((uint64_t)ntpRead32(packet + 44) * 1000ULL) >> 32) + rtt / 2;
+  clockSync(utcMs);
+  return true;
+}
+
+// Called from loop(): keeps the 64-bit millis() count and runs SNTP exchanges
+void clockService() {
+  monoMillis();
+  uint32_t nowMs = millis();
+  if (ntpRequestPending) {
+    if (ntpReadReply(nowMs)) {
+      ntpRequestPending = false;
+      ntpNextRequestAt = nowMs + NTP_SYNC_INTERVAL_MS;
+      Serial.print(F("[CLOCK] Synced, corrected ")); Serial.print(clockLastCorrectionMs);
+      Serial.print(F(" ms, drift ")); Serial.print(clockDriftPpm); Serial.println(F(" ppm"));
+    } else if (nowMs - ntpRequestSentAt >= NTP_REPLY_TIMEOUT_MS) {
+      ntpRequestPending = false;
+      ntpFailures++;
+      ntpNextRequestAt = nowMs + NTP_RETRY_MS;
+      Serial.println(timeSynced ? F("[CLOCK] NTP timeout, running on the local clock") : F("[CLOCK] NTP timeout, will retry in 1 min"));
     }
-    weeklySchedule1.missedDoseCompensation = false;
-    weeklySchedule2.missedDoseCompensation = false;
     return;
   }
-  DynamicJsonDocument doc(2048);
-  DeserializationError error = deserializeJson(doc, file);
-  if (error) {
-    file.close();
-    // Set defaults
-    weeklySchedule1.channelName = channel1Name;
-    weeklySchedule2.channelName = channel2Name;
-    for (int i = 0; i < 7; ++i) {
-      weeklySchedule1.days[i] = {false, 0, 0, 0.0f};
-      weeklySchedule2.days[i] = {false, 0, 0, 0.0f};
-    }
-    weeklySchedule1.missedDoseCompensation = false;
-    weeklySchedule2.missedDoseCompensation = false;
+  if ((int32_t)(nowMs - ntpNextRequestAt) < 0) return;
+  if (WiFi.status() != WL_CONNECTED) {
+    ntpNextRequestAt = nowMs + NTP_RETRY_MS;
     return;
   }
-  // Channel 1
-  JsonObject ch1 = doc["ch1"];
-  weeklySchedule1.channelName = ch1["channelName"] | channel1Name;
-  weeklySchedule1.missedDoseCompensation = ch1["missedDoseCompensation"] | false;
-  JsonArray days1 = ch1["days"];
-  for (int i = 0; i < 7; ++i) {
-    if (i < days1.size()) {
-      weeklySchedule1.days[i].enabled = days1[i]["enabled"] | false;
-      weeklySchedule1.days[i].hour = days1[i]["hour"] | 0;
-      weeklySchedule1.days[i].minute = days1[i]["minute"] | 0;
-      weeklySchedule1.days[i].volume = days1[i]["volume"] | 0.0f;
-    } else {
-      weeklySchedule1.days[i] = {false, 0, 0, 0.0f};
-    }
-  }
-  // Channel 2
-  JsonObject ch2 = doc["ch2"];
-  weeklySchedule2.channelName = ch2["channelName"] | channel2Name;
-  weeklySchedule2.missedDoseCompensation = ch2["missedDoseCompensation"] | false;
-  JsonArray days2 = ch2["days"];
-  for (int i = 0; i < 7; ++i) {
-    if (i < days2.size()) {
-      weeklySchedule2.days[i].enabled = days2[i]["enabled"] | false;
-      weeklySchedule2.days[i].hour = days2[i]["hour"] | 0;
-      weeklySchedule2.days[i].minute = days2[i]["minute"] | 0;
-      weeklySchedule2.days[i].volume = days2[i]["volume"] | 0.0f;
-    } else {
-      weeklySchedule2.days[i] = {false, 0, 0, 0.0f};
+  ntpSendRequest(nowMs);
+}
+
+// Start from an unset clock and send the first request right away
+void clockBegin() {
+  ntpUDP.begin(NTP_LOCAL_PORT);
+  monoLastMillis = (uint32_t)millis();
+  monoHighMs = 0;
+  clockAnchorUtcMs = 0;
+  clockAnchorMono = monoMillis();
+  clockDriftPpm = 0;
+  clockLastCorrectionMs = 0;
+  timeSynced = false;
+  clockEstimated = false;
+  ntpRequestPending = false;
+  ntpNextRequestAt = monoLastMillis;
+  localTimeCache.minute = UINT32_MAX;
+}
+
+// Ask NTP on the next pass instead of waiting out the retry interval
+void clockSyncSoon() {
+  if (!ntpRequestPending) ntpNextRequestAt = (uint32_t)millis();
+}
+
+// Save an edited schedule and bring the scheduler and forecast up to date
+void commitSchedule(int channel) {
+  markPersistentDataDirty();
+  scheduleChanged(channel);
+  rescheduleDoses();
+  updateDaysRemaining(channel);
+}
+
+// --- Loop profiler ---
+// Times every loop() stage and the loop period with the CPU cycle counter.
+// Samples go into half-octave histograms of microseconds whose counts are
+// halved every PROFILE_WINDOW_MS (and when a bucket fills), so p50/p99 follow
+// recent behaviour; max covers the current and previous window. Reported by
+// /api/v1/profile and the "profile" serial command. Build with
+// -DLOOP_PROFILER=0 to compile it out of loop().
+#ifndef LOOP_PROFILER
+#define LOOP_PROFILER 1
+#endif
+
+#if LOOP_PROFILER
+enum LoopStage {
+  STAGE_WEB,
+  STAGE_OTA,
+  STAGE_PRIME,
+  STAGE_MOTORS,
+  STAGE_BUTTONS,
+  STAGE_SCHEDULER,
+  STAGE_LED,
+  STAGE_WIFI,
+  STAGE_CLOCK,
+  STAGE_RESETS,
+  STAGE_PERSIST,
+  STAGE_NTFY,
+  STAGE_MQTT,
+  STAGE_PERIOD, // Start of one loop() to the start of the next
+  STAGE_COUNT
+};
+
+const char* loopStageNames[STAGE_COUNT] = {"web", "ota", "prime", "motors", "buttons", "scheduler", "led",
+                                           "wifi", "clock", "resets", "persist", "ntfy", "mqtt", "period"};
+
+#define PROFILE_BUCKETS 40 // Up to about 1 s; anything longer lands in the last one
+#define PROFILE_WINDOW_MS 60000UL
+
+struct StageProfile {
+  uint16_t buckets[PROFILE_BUCKETS];
+  uint32_t maxUs;     // This window
+  uint32_t lastMaxUs; // Previous window
+  uint32_t samples;   // Since boot
+};
+
+StageProfile loopProfile[STAGE_COUNT];
+uint32_t loopStageCycles[STAGE_COUNT]; // This pass, stages may be split
+uint32_t loopStartCycles = 0;
+uint32_t loopMarkCycles = 0;
+bool loopProfileRunning = false;
+unsigned long loopProfileWindowStart = 0;
+
+#define LOOP_PROFILE_BEGIN() loopProfileBegin()
+#define LOOP_PROFILE_STAGE(stage) loopProfileStage(stage)
+#define LOOP_PROFILE_END() loopProfileEnd()
+
+// Buckets 0 and 1 hold 0 and 1 us, then two per power of two
+int profileBucket(uint32_t us) {
+  if (us < 2) return us;
+  int msb = 31 - __builtin_clz(us);
+  int bucket = 2 * msb + ((us >> (msb - 1)) & 1);
+  return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1;
+}
+
+// Largest value counted in a bucket
+uint32_t profileBucketLimit(int bucket) {
+  if (bucket < 2) return bucket;
+  int msb = bucket / 2;
+  return (1UL << msb) + (bucket % 2 + 1) * (1UL << (msb - 1)) - 1;
+}
+
+void profileDecay(StageProfile& p) {
+  for (int b = 0; b < PROFILE_BUCKETS; b++) p.buckets[b] >>= 1;
+}
+
+void profileRecord(StageProfile& p, uint32_t us) {
+  uint16_t& bucket = p.buckets[profileBucket(us)];
+  if (bucket == UINT16_MAX) profileDecay(p);
+  bucket++;
+  p.samples++;
+  if (us > p.maxUs) p.maxUs = us;
+}
+
+uint32_t profileMaxUs(const StageProfile& p) {
+  return max(p.maxUs, p.lastMaxUs);
+}
+
+// Upper bound of the bucket holding the given percentile, capped at the max
+uint32_t profilePercentileUs(const StageProfile& p, uint8_t percent) {
+  uint32_t total = 0;
+  for (int b = 0; b < PROFILE_BUCKETS; b++) total += p.buckets[b];
+  if (total == 0) return 0;
+  uint32_t rank = (total * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (int b = 0; b < PROFILE_BUCKETS; b++) {
+    seen += p.buckets[b];
+    if (seen >= rank) return min(profileBucketLimit(b), profileMaxUs(p));
+  }
+  return profileMaxUs(p);
+}
+
+void loopProfileBegin() {
+  uint32_t now = ESP.getCycleCount();
+  if (loopProfileRunning) {
+    profileRecord(loopProfile[STAGE_PERIOD], (now - loopStartCycles) / ESP.getCpuFreqMHz());
+  }
+  loopProfileRunning = true;
+  loopStartCycles = now;
+  loopMarkCycles = now;
+}
+
+// Charge the time since the last mark to a stage
+inline void loopProfileStage(LoopStage stage) {
+  uint32_t now = ESP.getCycleCount();
+  loopStageCycles[stage] += now - loopMarkCycles;
+  loopMarkCycles = now;
+}
+
+void loopProfileEnd() {
+  uint8_t mhz = ESP.getCpuFreqMHz();
+  for (int s = 0; s < STAGE_PERIOD; s++) {
+    profileRecord(loopProfile[s], loopStageCycles[s] / mhz);
+    loopStageCycles[s] = 0;
+  }
+  if (millis() - loopProfileWindowStart >= PROFILE_WINDOW_MS) {
+    loopProfileWindowStart = millis();
+    for (int s = 0; s < STAGE_COUNT; s++) {
+      profileDecay(loopProfile[s]);
+      loopProfile[s].lastMaxUs = loopProfile[s].maxUs;
+      loopProfile[s].maxUs = 0;
     }
   }
-  file.close();
 }
 
-// WiFi/Time retry variables
-unsigned long wifiRetryStart = 0;
-unsigned long lastWifiRetry = 0;
-unsigned long lastTimeSyncRetry = 0;
+void loopProfileReset() {
+  memset(loopProfile, 0, sizeof(loopProfile));
+  memset(loopStageCycles, 0, sizeof(loopStageCycles));
+  loopProfileRunning = false;
+  loopProfileWindowStart = millis();
+}
+
+void printLoopProfile(Print& out) {
+  out.println(F("[PROFILE] stage        samples    p50 us    p99 us    max us"));
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    const StageProfile& p = loopProfile[s];
+    out.printf("[PROFILE] %-10s %10lu %9lu %9lu %9lu\n", loopStageNames[s], (unsigned long)p.samples,
+               (unsigned long)profilePercentileUs(p, 50), (unsigned long)profilePercentileUs(p, 99),
+               (unsigned long)profileMaxUs(p));
+  }
+}
+
+#else
+#define LOOP_PROFILE_BEGIN()
+#define LOOP_PROFILE_STAGE(stage)
+#define LOOP_PROFILE_END()
+#endif
+
+// --- Boot phase timing ---
+// setup() marks the end of each phase with micros(); the times since the
+// previous mark make up the boot record, served by /api/v1/boot, /metrics and
+// the "boot" serial command. Each phase has a budget for a normal boot (the
+// reset button held is not one); a phase over budget is logged.
+enum BootPhase {
+  BOOT_EEPROM,       // Channel count and channel defaults
+  BOOT_RESET_BUTTON, // Factory reset button poll
+  BOOT_LED,          // Serial, LED strip and pins
+  BOOT_FS,           // LittleFS mount
+  BOOT_STATE,        // RTC snapshot or state slots and counter journal
+  BOOT_LOGS,         // Dose log, ntfy queue and MQTT client
+  BOOT_FORECAST,     // Days remaining
+  BOOT_WIFI,         // Start of the station join
+  BOOT_WEB,          // Routes and web server
+  BOOT_CLOCK,        // Clock from snapshot or checkpoint, dose times
+  BOOT_OTA,
+  BOOT_MDNS,
+  BOOT_HW,           // Hardware version
+  BOOT_PHASE_COUNT
+};
+
+const char* bootPhaseNames[BOOT_PHASE_COUNT] = {"eeprom", "resetButton", "led", "fs", "state", "logs", "forecast",
+                                                "wifi", "web", "clock", "ota", "mdns", "hw"};
+const uint16_t bootPhaseBudgetMs[BOOT_PHASE_COUNT] = {10, 20, 20, 250, 100, 100, 20, 20, 20, 20, 20, 50, 10};
+#define BOOT_BUDGET_MS 500 // All of setup()
+
+struct BootRecord {
+  uint32_t startUs;                   // micros() when setup() began
+  uint32_t phaseUs[BOOT_PHASE_COUNT];
+  uint32_t totalUs;
+  uint8_t overBudget;                 // Phases over their budget
+};
+
+BootRecord bootRecord;
+uint32_t bootMarkUs = 0;
+
+void bootPhaseBegin() {
+  memset(&bootRecord, 0, sizeof(bootRecord));
+  bootRecord.startUs = micros();
+  bootMarkUs = bootRecord.startUs;
+}
+
+// Charge the time since the last mark to a phase
+void bootPhaseEnd(BootPhase phase) {
+  uint32_t now = micros();
+  bootRecord.phaseUs[phase] += now - bootMarkUs;
+  bootMarkUs = now;
+}
+
+bool bootPhaseOver(int phase) {
+  return bootRecord.phaseUs[phase] > bootPhaseBudgetMs[phase] * 1000UL;
+}
+
+void bootPhaseFinish() {
+  bootRecord.totalUs = bootMarkUs - bootRecord.startUs;
+  for (int p = 0; p < BOOT_PHASE_COUNT; p++) {
+    if (!bootPhaseOver(p)) continue;
+    bootRecord.overBudget++;
+    Serial.printf("[BOOT] Phase %s took %lu us, budget %u ms\n", bootPhaseNames[p],
+                  (unsigned long)bootRecord.phaseUs[p], bootPhaseBudgetMs[p]);
+  }
+}
+
+void printBootRecord(Print& out) {
+  out.println(F("[BOOT] phase            us   budget ms"));
+  for (int p = 0; p < BOOT_PHASE_COUNT; p++) {
+    out.printf("[BOOT] %-11s %9lu %9u%s\n", bootPhaseNames[p], (unsigned long)bootRecord.phaseUs[p],
+               bootPhaseBudgetMs[p], bootPhaseOver(p) ? " over" : "");
+  }
+  out.printf("[BOOT] %-11s %9lu %9u\n", "total", (unsigned long)bootRecord.totalUs, BOOT_BUDGET_MS);
+}
+
+// Serial console: "profile" prints the loop profile, "profile reset" clears
+// it, "boot" prints the boot record
+void serviceSerialConsole() {
+  static char line[24];
+  static uint8_t len = 0;
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (len < sizeof(line) - 1) line[len++] = c;
+      continue;
+    }
+    line[len] = '\0';
+    len = 0;
+    if (strcmp_P(line, PSTR("boot")) == 0) printBootRecord(Serial);
+#if LOOP_PROFILER
+    if (strcmp_P(line, PSTR("profile")) == 0) {
+      printLoopProfile(Serial);
+    } else if (strcmp_P(line, PSTR("profile reset")) == 0) {
+      loopProfileReset();
+      Serial.println(F("[PROFILE] Cleared"));
+    }
+#endif
+  }
+}
+
+float hwVersion = 0.0f; // Global variable for H/W version
+const char* SOFTWARE_VERSION = "25.07.16";
+
+// --- Network bring-up ---
+// WiFi, the config portal and the first NTP sync advance from loop(), so
+// setup() returns at once and doses run on the checkpointed clock meanwhile.
+// CONNECTING waits for the stored network; if it does not come up the portal
+// opens next to the station, which keeps retrying once a minute. ONLINE waits
+// for NTP, READY is reached once per boot and sends the boot notifications.
+enum NetState : uint8_t { NET_CONNECTING, NET_PORTAL, NET_ONLINE, NET_READY };
+const char* const netStateNames[] = {"connecting", "portal", "online", "ready"};
+
+const unsigned long NET_CONNECT_TIMEOUT_MS = 20000;
+const unsigned long NET_FAST_CONNECT_TIMEOUT_MS = 2000;
+const unsigned long NET_RETRY_MS = 60000;
+const int WIFI_RETRY_LIMIT = 30; // Then only the portal
+
+WiFiManager wifiPortal;
+NetState netState = NET_CONNECTING;
+unsigned long netAttemptAt = 0;
+unsigned long netJoinStartedAt = 0;
+bool netFastConnect = false;    // Joining the cached AP directly
+bool netConnectedFast = false;  // This boot's connect skipped the scan
+unsigned long netConnectMs = 0; // begin() to connected, 0 until then
+unsigned long netFastFallbacks = 0;
 bool apModeActive = false;
 int wifiRetryCount = 0;
-const int WIFI_RETRY_LIMIT = 30; // 30 minutes
+unsigned long bootSetupMs = 0;  // millis() when setup() returned
+unsigned long bootOnlineMs = 0; // ...when WiFi first came up
+unsigned long bootReadyMs = 0;  // ...when WiFi and time were both there, 0 until then
+const char* bootStateSource = "flash"; // Where setup() found the state
+
+// Fast reconnect: the AP's BSSID and channel and the DHCP lease are kept in
+// RTC user memory, which survives ESP.restart() but not a power cycle. A warm
+// boot joins that AP directly with the lease as a static config, skipping the
+// scan and DHCP, and falls back to a normal connect if that has not worked
+// within NET_FAST_CONNECT_TIMEOUT_MS.
+#define RTC_WIFI_OFFSET 0 // RTC user memory word
+const uint32_t RTC_WIFI_MAGIC = 0x49464957; // "WIFI"
+
+struct RtcWifi {
+  uint32_t magic;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t mask;
+  uint32_t dns;
+  uint32_t crc; // CRC-32 of the fields above
+};
+static_assert(sizeof(RtcWifi) == 32, "RtcWifi is 8 RTC words");
+
+bool rtcWifiLoad(RtcWifi& cache) {
+  if (!ESP.rtcUserMemoryRead(RTC_WIFI_OFFSET, (uint32_t*)&cache, sizeof(cache))) return false;
+  return cache.magic == RTC_WIFI_MAGIC && cache.crc == crc32Update(0, (const uint8_t*)&cache, offsetof(RtcWifi, crc));
+}
+
+void rtcWifiSave() {
+  RtcWifi cache = {};
+  cache.magic = RTC_WIFI_MAGIC;
+  memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+  cache.channel = WiFi.channel();
+  cache.ip = WiFi.localIP();
+  cache.gateway = WiFi.gatewayIP();
+  cache.mask = WiFi.subnetMask();
+  cache.dns = WiFi.dnsIP();
+  cache.crc = crc32Update(0, (const uint8_t*)&cache, offsetof(RtcWifi, crc));
+  ESP.rtcUserMemoryWrite(RTC_WIFI_OFFSET, (uint32_t*)&cache, sizeof(cache));
+}
+
+// Forget the AP, e.g. when the WiFi settings are reset
+void rtcWifiClear() {
+  RtcWifi cache = {};
+  ESP.rtcUserMemoryWrite(RTC_WIFI_OFFSET, (uint32_t*)&cache, sizeof(cache));
+}
 
-void setupWiFiWithRetry() {
-  WiFiManager wifiManager;
-  wifiManager.setAPCallback([](WiFiManager *myWiFiManager) {
+void netBegin() {
+  wifiPortal.setAPCallback([](WiFiManager *myWiFiManager) {
     Serial.println(F("Entered config mode"));
     Serial.println(WiFi.softAPIP());
     Serial.println(myWiFiManager->getConfigPortalSSID());
     // Set LED to purple when AP mode is entered via callback
     updateLED(LED_PURPLE);
   });
-  wifiManager.setConfigPortalTimeout(300);
-  wifiManager.setMinimumSignalQuality(10);
-  wifiManager.setAPStaticIPConfig(IPAddress(192,168,4,1), IPAddress(192,168,4,1), IPAddress(255,255,255,0));
-  wifiManager.setDebugOutput(true);
-  wifiManager.setCaptivePortalEnable(true);
-  wifiManager.setBreakAfterConfig(true);
-
-  wifiRetryStart = millis();
+  wifiPortal.setConfigPortalBlocking(false);
+  wifiPortal.setConfigPortalTimeout(0); // Open until connected
+  wifiPortal.setMinimumSignalQuality(10);
+  wifiPortal.setAPStaticIPConfig(IPAddress(192,168,4,1), IPAddress(192,168,4,1), IPAddress(255,255,255,0));
+  wifiPortal.setDebugOutput(true);
+  wifiPortal.setCaptivePortalEnable(true);
+  wifiPortal.setBreakAfterConfig(true);
+
+  WiFi.mode(WIFI_STA);
+  RtcWifi cache;
+  netFastConnect = rtcWifiLoad(cache);
+  netJoinStartedAt = millis();
+  if (netFastConnect) {
+    Serial.println(F("[NET] Warm boot, joining the last AP directly"));
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.mask), IPAddress(cache.dns));
+    WiFi.begin(WiFi.SSID().c_str(), WiFi.psk().c_str(), cache.channel, cache.bssid);
+  } else {
+    WiFi.begin(); // Stored credentials
+  }
+  netState = NET_CONNECTING;
+  netAttemptAt = netJoinStartedAt;
+  netConnectedFast = false;
+  netConnectMs = 0;
   wifiRetryCount = 0;
-  while (wifiRetryCount < WIFI_RETRY_LIMIT) {
-    if (wifiManager.autoConnect(deviceName.c_str())) {
-      Serial.println(F("Connected to WiFi."));
-      Serial.print(F("IP Address: "));
-      Serial.println(WiFi.localIP());
-      apModeActive = false;
-      return;
-    } else {
-      wifiRetryCount++;
-      Serial.print(F("WiFi connect failed, retry "));
-      Serial.println(wifiRetryCount);
-      delay(60000); // 1 minute
-    }
+  apModeActive = false;
+  bootOnlineMs = 0;
+  bootReadyMs = 0;
+}
+
+// Tell the owner when the device turns up on a new address
+void notifyNewIP() {
+  String currentIP = WiFi.localIP().toString();
+  if (WiFi.SSID() == "" || WiFi.getMode() == WIFI_AP || lastNotifiedIP == currentIP) return;
+  String mDnsHost = deviceName;
+  mDnsHost.replace(" ", "-");
+  String welcomeMsg = F("Wifi Connection Successful. IP: ");
+  welcomeMsg += currentIP;
+  welcomeMsg += F("\nIf setting up for first time or resetting it's recommended to unplug the device and plug back again after 5 seconds. Post that you can manage the device at :\nhttp://");
+  welcomeMsg += mDnsHost;
+  welcomeMsg += F(".local/ OR http://");
+  welcomeMsg += currentIP;
+  welcomeMsg += F("/");
+  welcomeMsg += F("\nSW Version: ") + String(SOFTWARE_VERSION);
+  sendNtfyNotification(F("Your Doser got a new IP"), welcomeMsg);
+  lastNotifiedIP = currentIP;
+  markPersistentDataDirty();
+}
+
+void notifySystemStart() {
+  if (!notifyStart) return;
+  String msg = "IP: " + WiFi.localIP().toString();
+  msg += "\n";
+  msg += "Device: " + deviceName + "\n";
+  for (int n = 1; n <= numChannels; n++) {
+    Channel& c = getChannel(n);
+    msg += c.name + ": " + String(c.remainingML) + "ml, Days: " + String(calculateDaysRemaining(n)) + "\n";
+  }
+  msg += resetButtonPressed ? "D7:Y" : "D7:N \n";
+  for (int n = 1; n <= numChannels; n++) {
+    msg += "CH" + String(n) + ":" + String(getChannel(n).lastScheduledDoseTime) + "\n";
   }
-  // If we reach here, go to AP mode and stay
-  Serial.println(F("Failed to connect after retries, entering AP mode."));
-  wifiManager.startConfigPortal(deviceName.c_str());
-  apModeActive = true;
-  updateLED(LED_PURPLE); // Set LED to purple when AP mode is entered after retries
+  msg += "SW Version: " + String(SOFTWARE_VERSION) + "\n";
+  Serial.println(F("Sending System Start notification: ") + msg);
+  sendNtfyNotification(deviceName+" Start", msg);
 }
 
-float hwVersion = 0.0f; // Global variable for H/W version
-const char* SOFTWARE_VERSION = "25.07.16";
+void netConnected() {
+  netConnectMs = millis() - netJoinStartedAt;
+  netConnectedFast = netFastConnect;
+  netFastConnect = false;
+  Serial.println(F("Connected to WiFi."));
+  Serial.print(F("IP Address: "));
+  Serial.println(WiFi.localIP());
+  Serial.print(F("[NET] Joined in ")); Serial.print(netConnectMs);
+  Serial.println(netConnectedFast ? F(" ms (cached AP)") : F(" ms"));
+  rtcWifiSave();
+  if (apModeActive) wifiPortal.stopConfigPortal();
+  apModeActive = false;
+  bootOnlineMs = millis();
+  netAttemptAt = millis();
+  netState = NET_ONLINE;
+  clockSyncSoon();
+  notifyNewIP();
+}
+
+// Called from loop()
+void netService() {
+  unsigned long now = millis();
+  bool connected = WiFi.status() == WL_CONNECTED;
+  switch (netState) {
+    case NET_CONNECTING:
+      if (connected) {
+        netConnected();
+      } else if (netFastConnect && now - netAttemptAt >= NET_FAST_CONNECT_TIMEOUT_MS) {
+        // The AP moved or the lease is gone: scan and ask DHCP as usual
+        Serial.println(F("[NET] Cached AP did not answer, scanning"));
+        netFastConnect = false;
+        netFastFallbacks++;
+        rtcWifiClear();
+        WiFi.config(IPAddress(), IPAddress(), IPAddress());
+        WiFi.begin();
+        netAttemptAt = now;
+      } else if (now - netAttemptAt >= NET_CONNECT_TIMEOUT_MS) {
+        wifiRetryCount++;
+        Serial.println(F("[NET] WiFi connect failed, opening the config portal"));
+        wifiPortal.startConfigPortal(deviceName.c_str());
+        apModeActive = true;
+        updateLED(LED_PURPLE);
+        netAttemptAt = now;
+        netState = NET_PORTAL;
+      }
+      break;
+    case NET_PORTAL:
+      if (wifiPortal.process() || connected) {
+        netConnected();
+      } else if (wifiRetryCount < WIFI_RETRY_LIMIT && now - netAttemptAt >= NET_RETRY_MS) {
+        wifiRetryCount++;
+        netAttemptAt = now;
+        Serial.print(F("WiFi connect failed, retry "));
+        Serial.println(wifiRetryCount);
+        WiFi.begin();
+      }
+      break;
+    case NET_ONLINE:
+    case NET_READY:
+      if (netState == NET_ONLINE && connected && timeSynced) {
+        netState = NET_READY;
+        bootReadyMs = now;
+        Serial.print(F("[BOOT] Ready ")); Serial.print(bootReadyMs);
+        Serial.print(F(" ms after boot, setup() took ")); Serial.print(bootSetupMs); Serial.println(F(" ms"));
+        notifySystemStart();
+      }
+      // Lost after coming up: the SDK reconnects by itself, nudge it once a minute
+      if (!connected && now - netAttemptAt >= NET_RETRY_MS) {
+        netAttemptAt = now;
+        Serial.println(F("WiFi lost, retrying connect..."));
+        WiFi.reconnect();
+      }
+      break;
+  }
+}
 
 void setup() {
+ bootPhaseBegin();
  // writeHWVersion(1.0f);
  //writeChannels(2);
  numChannels = readChannels(); // Read number of channels from EEPROM
+ if (numChannels > MAX_CHANNELS) numChannels = MAX_CHANNELS;
+ initChannels();
+ bootPhaseEnd(BOOT_EEPROM);
   // Check for factory reset button (D7 pulled low for 5 seconds continuously)
   pinMode(SYSTEM_RESET_BUTTON_PIN, INPUT_PULLUP);
   if (digitalRead(SYSTEM_RESET_BUTTON_PIN) == LOW) {
@@ -453,6 +1130,7 @@ void setup() {
       
     }
   }
+  bootPhaseEnd(BOOT_RESET_BUTTON);
  // Initialize Serial
   Serial.begin(9600);
   // Initialize WS2812B LED
@@ -464,48 +1142,70 @@ void setup() {
   // Set LED to Red on Startup
   updateLED(LED_RED);
   // Initialize Pins
-  pinMode(MOTOR1_PIN, OUTPUT);
-  pinMode(MOTOR2_PIN, OUTPUT);
+  for (int i = 0; i < MAX_CHANNELS; i++) {
+    pinMode(motorPins[i], OUTPUT);
+  }
   pinMode(CALIBRATE_BUTTON1_PIN, INPUT_PULLUP);
   pinMode(CALIBRATE_BUTTON2_PIN, INPUT_PULLUP);
   pinMode(WIFI_RESET_BUTTON_PIN, INPUT_PULLUP);
   pinMode(SYSTEM_RESET_BUTTON_PIN, INPUT_PULLUP);
 
   // Ensure pumps are off on boot
-  digitalWrite(MOTOR1_PIN, LOW);
-  digitalWrite(MOTOR2_PIN, LOW);
+  for (int i = 0; i < MAX_CHANNELS; i++) {
+    digitalWrite(motorPins[i], LOW);
+  }
+  bootPhaseEnd(BOOT_LED);
 
   // Initialize SPIFFS
   if (!SPIFFS.begin()) {
     Serial.println(F("Failed to mount file system"));
+    bootPhaseEnd(BOOT_FS);
+    bootPhaseFinish();
     return;
   }
+  bootPhaseEnd(BOOT_FS);
 
-  // Load Persistent Data from SPIFFS
-  loadPersistentDataFromSPIFFS();
-  loadWeeklySchedulesFromSPIFFS();
-  Serial.print(F("[BOOT] lastDispensedVolume1: ")); Serial.println(lastDispensedVolume1);
-  Serial.print(F("[BOOT] lastDispensedTime1: ")); Serial.println(lastDispensedTime1);
-  Serial.print(F("[BOOT] lastDispensedVolume2: ")); Serial.println(lastDispensedVolume2);
-  Serial.print(F("[BOOT] lastDispensedTime2: ")); Serial.println(lastDispensedTime2);
-
-  // Update days remaining at startup for both channels
-  updateDaysRemaining(1, remainingMLChannel1, &weeklySchedule1);
-  updateDaysRemaining(2, remainingMLChannel2, &weeklySchedule2);
+  // State from the RTC snapshot after an intentional restart, else from flash
+  if (snapshotRestore()) {
+    bootStateSource = "snapshot";
+  } else {
+    loadPersistentDataFromSPIFFS();
+    counterBegin();
+    bootStateSource = "flash";
+  }
+  bootPhaseEnd(BOOT_STATE);
+  Serial.printf("[BOOT] State from %s in %lu us\n", bootStateSource, (unsigned long)bootRecord.phaseUs[BOOT_STATE]);
+  doseLogBegin();
+  loadNtfyQueue();
+  mqttBegin();
+  bootPhaseEnd(BOOT_LOGS);
+  for (int n = 1; n <= numChannels; n++) {
+    Channel& c = getChannel(n);
+    Serial.print(F("[BOOT] Channel ")); Serial.print(n);
+    Serial.print(F(" lastDispensedVolume: ")); Serial.print(c.lastDispensedVolume);
+    Serial.print(F(", lastDispensedTime: ")); Serial.println(c.lastDispensedTime);
+    // Update days remaining at startup
+    updateDaysRemaining(n);
+  }
+  bootPhaseEnd(BOOT_FORECAST);
 
-  // Setup WiFi
-  setupWiFiWithRetry();
+  // Start WiFi; loop() brings it up
+  netBegin();
+  bootPhaseEnd(BOOT_WIFI);
 
   // Setup Web Server
   setupWebServer();
+  bootPhaseEnd(BOOT_WEB);
 
   // Setup Time Sync
   setupTimeSync();
 
-  timeClient.setTimeOffset(timezoneOffset); // Ensure NTP client uses IST by default
+  rescheduleDoses();
+  bootPhaseEnd(BOOT_CLOCK);
 
   // Initialize OTA
   setupOTA();
+  bootPhaseEnd(BOOT_OTA);
 
   // Initialize mDNS
   String sanitizedDeviceName = deviceName;
@@ -515,44 +1215,10 @@ void setup() {
   } else {
     Serial.println(F("Error setting up mDNS responder!"));
   }
+  bootPhaseEnd(BOOT_MDNS);
 
   // Set LED to Green at the end of setup
   updateLED(LED_GREEN);
-//print the values in if condition wifi status trime
-  
-
-   // After WiFi connects, send System Start notification if enabled
-   if (WiFi.status() == WL_CONNECTED && timeSynced && notifyStart) {
-    String msg = "IP: " + WiFi.localIP().toString();
-    msg += "\n";
-    msg += "Device: " + deviceName + "\n";
-    msg += channel1Name + ": " + String(remainingMLChannel1) + "ml, Days: " + String(calculateDaysRemaining(remainingMLChannel1, &weeklySchedule1)) + "\n";
-    msg += channel2Name + ": " + String(remainingMLChannel2) + "ml, Days: " + String(calculateDaysRemaining(remainingMLChannel2, &weeklySchedule2)) + "\n";
-    msg += resetButtonPressed ? "D7:Y" : "D7:N \n";
-    msg += "CH1:" + String(lastScheduledDoseTime1) + "\n";
-    msg += "CH2:" + String(lastScheduledDoseTime2) + "\n";
-    msg += "SW Version: " + String(SOFTWARE_VERSION) + "\n";
-    Serial.println(F("Sending System Start notification: ") + msg);
-    sendNtfyNotification(deviceName+" Start", msg);
-  }
-
-  // Send Welcome notification when device comes out of AP mode and connects to WiFi
-  String currentIP = WiFi.localIP().toString();
-  if (WiFi.status() == WL_CONNECTED && WiFi.SSID() != "" && WiFi.getMode() != WIFI_AP && lastNotifiedIP != currentIP) {
-    String mDnsHost = deviceName;
-    mDnsHost.replace(" ", "-");
-    String welcomeMsg = F("Wifi Connection Successful. IP: ");
-    welcomeMsg += currentIP;
-    welcomeMsg += F("\nIf setting up for first time or resetting it's recommended to unplug the device and plug back again after 5 seconds. Post that you can manage the device at :\nhttp://");
-    welcomeMsg += mDnsHost;
-    welcomeMsg += F(".local/ OR http://");
-    welcomeMsg += currentIP;
-    welcomeMsg += F("/");
-    welcomeMsg += F("\nSW Version: ") + String(SOFTWARE_VERSION);
-    sendNtfyNotification(F("Your Doser got a new IP"), welcomeMsg);
-    lastNotifiedIP = currentIP;
-    savePersistentDataToSPIFFS();
-  }
   // serial print time synced notifystart and wifistatus
   Serial.println(F("[BOOT] Time Synced: ") + String(timeSynced));
   Serial.println(F("[BOOT] WiFi Status: ") + String(WiFi.status() == WL_CONNECTED ? F("Connected") : F("Disconnected")));
@@ -572,11 +1238,18 @@ void setup() {
   // Start Telnet server
   //telnetServer.begin();
   //telnetServer.setNoDelay(true);
+  bootPhaseEnd(BOOT_HW);
+  bootPhaseFinish();
+  bootSetupMs = millis();
+  Serial.print(F("[BOOT] Setup done in ")); Serial.print(bootSetupMs); Serial.println(F(" ms"));
 }
 
 void loop() {
+  LOOP_PROFILE_BEGIN();
+
   // Handle Web Server
   server.handleClient();
+  LOOP_PROFILE_STAGE(STAGE_WEB);
 
   // Telnet client connection management
  // if (telnetServer.hasClient()) {
@@ -596,37 +1269,45 @@ void loop() {
 
   // Handle OTA
   ArduinoOTA.handle();
-
-  // Handle prime pump operations
-  if (isPrimingChannel1) {
-    digitalWrite(MOTOR1_PIN, HIGH);
-    updateLED(LED_BLUE);
-  } else if (isPrimingChannel2) {
-    digitalWrite(MOTOR2_PIN, HIGH);
-    updateLED(LED_YELLOW);
-  } else {
-    digitalWrite(MOTOR1_PIN, LOW);
-    digitalWrite(MOTOR2_PIN, LOW);
+  otaService();
+  LOOP_PROFILE_STAGE(STAGE_OTA);
+
+  // Handle prime pump operations; a motor neither priming nor dosing is off
+  int priming = primingChannel();
+  for (int i = 0; i < numChannels; i++) {
+    if (channels[i].priming) {
+      digitalWrite(motorPins[i], HIGH);
+    } else if (!channelDosing(i + 1)) {
+      digitalWrite(motorPins[i], LOW);
+    }
   }
+  if (priming) updateLED(channelLedColors[priming - 1]);
+  LOOP_PROFILE_STAGE(STAGE_PRIME);
+
+  // Start/stop queued doses
+  serviceMotor();
+  LOOP_PROFILE_STAGE(STAGE_MOTORS);
 
   // Check Buttons
   if (digitalRead(WIFI_RESET_BUTTON_PIN) == LOW) {
     // Handle WiFi Reset
+    flushPersistentData();
+    snapshotSave();
+    rtcWifiClear();
     WiFi.disconnect();
     ESP.restart();
   }
+  serviceSerialConsole();
+  LOOP_PROFILE_STAGE(STAGE_BUTTONS);
 
-  // Check Daily Dispense Schedule (only if not priming)
-  static unsigned long lastDailyDispenseCheck = 0;
-  if (!isPrimingChannel1 && !isPrimingChannel2) {
-    if (millis() - lastDailyDispenseCheck > 30000) { // 30 seconds
-      lastDailyDispenseCheck = millis();
-      checkDailyDispense();
-    }
+  // Start scheduled doses when due (only if not priming)
+  if (!priming) {
+    serviceDoseScheduler();
   }
+  LOOP_PROFILE_STAGE(STAGE_SCHEDULER);
 
-  // Only update LED state if not priming
-  if (!isPrimingChannel1 && !isPrimingChannel2) {
+  // Only update LED state if not priming or dosing
+  if (!priming && runningMotors == 0) {
     if (currentLEDState == LED_OFF) {
       if (WiFi.status() == WL_CONNECTED) {
         setLEDState(LED_BLINK_GREEN);
@@ -641,583 +1322,658 @@ void loop() {
     // Update LED state
     updateLEDState();
   }
+  LOOP_PROFILE_STAGE(STAGE_LED);
   
-  // WiFi reconnect logic if lost after boot
-  static unsigned long lastWifiCheck = 0;
-  if (!apModeActive && WiFi.status() != WL_CONNECTED) {
-    if (millis() - lastWifiCheck > 60000) {
-      lastWifiCheck = millis();
-      Serial.println(F("WiFi lost, retrying connect..."));
-      WiFi.reconnect();
-    }
-  }
-  // Time sync retry logic
-  static unsigned long lastTimeSyncCheck = 0;
-  if (!timeSynced && WiFi.status() == WL_CONNECTED) {
-    if (millis() - lastTimeSyncCheck > 60000) {
-      lastTimeSyncCheck = millis();
-      timeClient.update();
-      if (timeClient.getEpochTime() > 100000) {
-        timeSynced = true;
-        Serial.println(F("Time sync successful (retry)"));
-      } else {
-        Serial.println(F("Time sync failed, will retry in 1 min"));
-      }
-    }
-  }
+  // WiFi, config portal and boot notifications
+  netService();
+  LOOP_PROFILE_STAGE(STAGE_WIFI);
+
+  // SNTP in the background; the clock keeps running between syncs
+  clockService();
+  LOOP_PROFILE_STAGE(STAGE_CLOCK);
   
   // Ensure LED stays purple in AP mode
   if (apModeActive) {
     updateLED(LED_PURPLE);
   }
+  LOOP_PROFILE_STAGE(STAGE_LED);
 
   // Handle pending resets after delay
   if (pendingWiFiReset && millis() - resetRequestTime > RESET_DELAY_MS) {
     WiFiManager wifiManager;
     wifiManager.resetSettings();
+    rtcWifiClear();
     lastNotifiedIP = "";
-    savePersistentDataToSPIFFS();
+    markPersistentDataDirty();
+    flushPersistentData();
+    snapshotSave();
     delay(1000);
     pendingWiFiReset = false;
     ESP.restart();
   }
   if (pendingFactoryReset && millis() - resetRequestTime > RESET_DELAY_MS) {
     LittleFS.format();
+    snapshotClear();
     WiFiManager wifiManager;
     wifiManager.resetSettings();
+    rtcWifiClear();
     pendingFactoryReset = false;
     ESP.restart();
   }
+  LOOP_PROFILE_STAGE(STAGE_RESETS);
+
+  // Write /data.json if anything changed
+  servicePersistentData();
+  LOOP_PROFILE_STAGE(STAGE_PERSIST);
+
+  // Send one queued notification if it is due
+  serviceNtfyQueue();
+  LOOP_PROFILE_STAGE(STAGE_NTFY);
+
+  // MQTT connection, commands and state updates
+  mqttService();
+  LOOP_PROFILE_STAGE(STAGE_MQTT);
+
+  // Heap low-water mark for /metrics
+  sampleHeap();
 
   ArduinoOTA.handle();
+  LOOP_PROFILE_STAGE(STAGE_OTA);
+  LOOP_PROFILE_END();
 }
 
-void setupWiFi() {
-  WiFiManager wifiManager;
+// --- Metrics ---
+// Heap low-water marks and per-route request costs for /metrics. Routes are
+// registered through onRoute(), which times each handler and samples the free
+// heap before and after it and at every chunk it sends.
+#define MAX_ROUTE_METRICS 40
+
+struct RouteMetrics {
+  const char* uri;
+  HTTPMethod method;
+  uint32_t requests;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t peakHeapDelta; // Largest drop in free heap during one request
+};
 
-  // Configure WiFiManager for better captive portal experience
-  wifiManager.setAPCallback([](WiFiManager *myWiFiManager) {
-    Serial.println(F("Entered config mode"));
-    Serial.println(WiFi.softAPIP());
-    Serial.println(myWiFiManager->getConfigPortalSSID());
-  });
+RouteMetrics routeMetrics[MAX_ROUTE_METRICS];
+int routeMetricsCount = 0;
+uint32_t heapFreeMin = UINT32_MAX;    // Since boot
+uint32_t requestHeapLow = UINT32_MAX; // During the request being handled
 
-  // Set timeout for config portal (0 = no timeout)
-  wifiManager.setConfigPortalTimeout(300); // 5 minutes timeout
-  
-  // Set minimum signal quality
-  wifiManager.setMinimumSignalQuality(10);
-  
-  // Configure custom parameters for better captive portal
-  wifiManager.setAPStaticIPConfig(IPAddress(192,168,4,1), IPAddress(192,168,4,1), IPAddress(255,255,255,0));
-  
-  // Set debug output
-  wifiManager.setDebugOutput(true);
-  
-  // Configure captive portal
-  wifiManager.setCaptivePortalEnable(true);
-  wifiManager.setBreakAfterConfig(true);
+// Fold the current free heap into the low-water marks
+void sampleHeap() {
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < heapFreeMin) heapFreeMin = freeHeap;
+  if (freeHeap < requestHeapLow) requestHeapLow = freeHeap;
+}
 
-  // Automatically start configuration portal if no WiFi is configured
-  if (!wifiManager.autoConnect(deviceName.c_str())) {
-    Serial.println(F("Failed to connect to WiFi and hit timeout"));
-    ESP.restart();
+// server.on() with the handler's time and heap use recorded for /metrics
+void onRoute(const char* uri, HTTPMethod method, ESP8266WebServer::THandlerFunction handler,
+             ESP8266WebServer::THandlerFunction upload = nullptr) {
+  RouteMetrics* m = nullptr;
+  if (routeMetricsCount < MAX_ROUTE_METRICS) {
+    m = &routeMetrics[routeMetricsCount++];
+    *m = RouteMetrics{uri, method, 0, 0, 0, 0};
+  }
+  ESP8266WebServer::THandlerFunction measured = [m, handler]() {
+    if (!m) {
+      handler();
+      return;
+    }
+    uint32_t before = ESP.getFreeHeap();
+    requestHeapLow = before;
+    unsigned long start = micros();
+    handler();
+    uint32_t us = micros() - start;
+    sampleHeap();
+    m->requests++;
+    m->totalUs += us;
+    if (us > m->maxUs) m->maxUs = us;
+    if (before - requestHeapLow > m->peakHeapDelta) m->peakHeapDelta = before - requestHeapLow;
+    requestHeapLow = UINT32_MAX;
+  };
+  if (upload) {
+    server.on(uri, method, measured, upload);
+  } else {
+    server.on(uri, method, measured);
   }
-
-  Serial.println(F("Connected to WiFi."));
-  Serial.print(F("IP Address: "));
-  Serial.println(WiFi.localIP());
 }
 
-void setupWebServer() {
- 
-
-  server.on("/calibrate", HTTP_GET, []() {
-    int channel = 1;
-    if (server.hasArg("channel")) channel = server.arg("channel").toInt();
-    String channelName = (channel == 1) ? channel1Name : channel2Name;
-        
-    // Start chunked response
+// --- HTML templates ---
+// Pages are PROGMEM templates with {{slot}} placeholders. renderTemplate()
+// copies the text into a ChunkedResponse and asks a fill function to print
+// each slot; repeated parts (cards, table rows, options) are nested templates
+// rendered from a slot. No page is built up in a String, so serving one does
+// not touch the heap.
+
+// Collects output in a small buffer and sends it as chunks of a chunked
+// response, so pages and JSON go to the client without an intermediate String
+class ChunkedResponse : public Print {
+public:
+  explicit ChunkedResponse(const char* contentType = "application/json") {
+    server.sendHeader(F("Cache-Control"), F("no-store"));
     server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-    server.send(200, "text/html", "");
-    
-    // Send HTML header
-    String chunk = F("<html><head><title>Calibrate</title>");
-    chunk += F("<meta name='viewport' content='width=device-width, initial-scale=1.0'>");
-    chunk += F("<style>body{font-family:Arial,sans-serif;background:#f4f4f9;color:#333;} ");
-    
-    // Send CSS in smaller chunks
-    chunk += F(".card{margin:20px auto;padding:20px;max-width:500px;background:#fff;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.1);} ");
-    chunk += F(".card h2{margin-top:0;color:#007BFF;} ");
-    chunk += F(".calib-warning{color:#b30000;background:#fff3cd;border:1px solid #ffeeba;border-radius:6px;padding:10px;margin-bottom:18px;font-size:1.05em;} ");
-    chunk += F(".calib-btn{width:100%;padding:14px 0;font-size:1.1em;background:#dc3545;color:#fff;border:none;border-radius:6px;margin-bottom:10px;cursor:pointer;} ");
-    chunk += F(".calib-btn:disabled{background:#aaa;cursor:not-allowed;} ");
-    chunk += F(".home-btn{width:100%;padding:12px 0;font-size:1.1em;background:#007BFF;color:#fff;border:none;border-radius:6px;} ");
-    chunk += F(".back-btn{width:100%;padding:12px 0;font-size:1.1em;background:#aaa;color:#fff;border:none;border-radius:6px;margin-top:10px;} ");
-    chunk += F("#countdown{font-size:1.2em;color:#007BFF;margin-bottom:10px;text-align:center;} ");
-    chunk += F(".card button, .card-btn, .dispense-btn, .calib-btn, .prime-btn, .home-btn, .back-btn, .rename-btn, button.cancel { transition: background 0.2s; } ");
-    
-    chunk += F(".card button:hover, .card-btn:hover, .dispense-btn:hover, .calib-btn:hover, .prime-btn:hover, .home-btn:hover, .rename-btn:hover { background-color: #0056b3 !important; } ");
-    chunk += F(".prime-btn.stop:hover { background-color: #218838 !important; } ");
-    chunk += F(".rename-btn.cancel:hover, button.cancel:hover, .back-btn:hover { background-color: #888 !important; }");
-    chunk += F("</style>");
-    server.sendContent(chunk);
-    // Send JavaScript
-    chunk = F("<script>\n");
-    chunk += F("var calibrationTime = ") + String(calibrationTimeMs / 1000) + F(";\n");
-    chunk += F("function startCountdown() {\n");
-    chunk += F("  var btn = document.getElementById('calibBtn');\n");
-    chunk += F("  var homeBtn = document.getElementById('homeBtn');\n");
-    chunk += F("  var backBtn = document.getElementById('backBtn');\n");
-    chunk += F("  var countdown = document.getElementById('countdown');\n");
-    chunk += F("  btn.disabled = true;\n");
-    chunk += F("  homeBtn.disabled = true;\n");
-    chunk += F("  backBtn.disabled = true;\n");
-    chunk += F("  var timeLeft = calibrationTime;\n");
-    chunk += F("  countdown.innerText = 'Calibrating... ' + timeLeft + 's remaining';\n");
-    chunk += F("  var interval = setInterval(function() {\n");
-    chunk += F("    timeLeft--;\n");
-    chunk += F("    countdown.innerText = 'Calibrating... ' + timeLeft + 's remaining';\n");
-    chunk += F("    if (timeLeft <= 0) {\n");
-    chunk += F("      clearInterval(interval);\n");
-    chunk += F("      countdown.innerText = '';\n");
-    chunk += F("      btn.disabled = false;\n");
-    chunk += F("      homeBtn.disabled = false;\n");
-    chunk += F("      backBtn.disabled = false;\n");
-    chunk += F("    }\n");
-    chunk += F("  }, 1000);\n");
-    chunk += F("}\n");
-    chunk += F("function onSubmitCalib(e){\n");
-    chunk += F("  startCountdown();\n");
-        chunk += F("}\n");
-    chunk += F("</script>");
-    chunk += F("</head><body>");
-    chunk += generateHeader("Calibrate: " + channelName);
-    chunk += F("<div class='card'>");
-    chunk += F("<div class='calib-warning'>Warning: The motor will run for ") + String(calibrationTimeMs / 1000) + F(" seconds and dispense liquid. Hold the measuring tube near the dispensing tube before proceeding.</div>");
-    chunk += F("<div id='countdown'></div>");
-        chunk += F("<form action='/calibrate?channel=") + String(channel) + F("' method='POST' onsubmit='onSubmitCalib(event)'>");
-    chunk += F("<input type='hidden' name='channel' value='") + String(channel) + F("'>");
-    chunk += F("<button type='submit' class='calib-btn' id='calibBtn'>Start Calibration</button>");
-    chunk += F("</form>");
-    chunk += F("<button class='home-btn' id='homeBtn' onclick=\"window.location.href='/summary'\">Home</button>");
-    chunk += F("<button class='back-btn' id='backBtn' onclick=\"history.back()\">Back</button>");
-    chunk += F("</div>");
-    chunk += generateFooter();
-    chunk += F("</body></html>");
-    server.sendContent(chunk);
-    
-    // End the response
+    server.send(200, contentType, "");
+  }
+  size_t write(uint8_t c) override {
+    if (_len == sizeof(_buf)) sendBuffer();
+    _buf[_len++] = c;
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t size) override {
+    for (size_t i = 0; i < size; i++) write(data[i]);
+    return size;
+  }
+  // Send what is buffered and terminate the response
+  void end() {
+    sendBuffer();
     server.sendContent("");
-  });
+  }
+
+private:
+  void sendBuffer() {
+    sampleHeap();
+    if (_len > 0) {
+      server.sendContent((const char*)_buf, _len);
+      _len = 0;
+    }
+  }
+  uint8_t _buf[256];
+  size_t _len = 0;
+};
+
+// Longest slot name is one less than this
+#define TEMPLATE_SLOT_MAX 24
+
+// Shared by every page. The page's fill function supplies {{title}},
+// {{pageClass}} and {{heading}}. The ?v= tag changes whenever an asset does,
+// so browsers can keep them cached indefinitely.
+static const char PAGE_HEAD_HTML[] PROGMEM =
+  "<html><head><title>{{title}}</title><meta name='viewport' content='width=device-width, initial-scale=1.0'>"
+  "<link rel='stylesheet' href='" WEB_APP_CSS_PATH "?v=" WEB_APP_CSS_ETAG "'>"
+  "<script src='" WEB_APP_JS_PATH "?v=" WEB_APP_JS_ETAG "' defer></script>"
+  "</head><body class='{{pageClass}}'>";
+
+static const char PAGE_HEADER_HTML[] PROGMEM =
+  "<div style='max-width:550px;width:100%;margin:0 auto 10px auto;background:#007BFF;color:#fff;padding:16px 20px;text-align:center;font-size:1.5em;border-radius:10px 10px 0 0;box-shadow:0 2px 4px rgba(0,0,0,0.05);box-sizing:border-box;'>{{heading}}</div>";
+
+static const char PAGE_FOOTER_HTML[] PROGMEM =
+  "<div style='width:100%;background:#f1f1f1;color:#333;padding:10px 0;text-align:center;font-size:1em;border-radius:0 0 10px 10px;box-shadow:0 -2px 4px rgba(0,0,0,0.03);margin-top:20px;'>"
+  "S/W version : {{version}}  mymail.arjun@gmail.com"
+  "<br>H/W version: {{hwVersion}}"
+  "<br>Available RAM: {{freeHeapKb}} KB"
+  "<br>WiFi Signal: {{wifiSignal}}"
+  "</div>";
+
+static const char OPTION_HTML[] PROGMEM = "<option value='{{value}}'{{selected}}>{{label}}</option>";
+
+static const char CALIBRATE_PAGE_HTML[] PROGMEM =
+  "{{head}}{{header}}<div class='card'>"
+  "<div class='calib-warning'>Warning: The motor will run for {{seconds}} seconds and dispense liquid. Hold the measuring tube near the dispensing tube before proceeding.</div>"
+  "<div id='countdown'></div>"
+  "<form action='/calibrate?channel={{channel}}' method='POST' onsubmit='startCountdown({{seconds}})'>"
+  "<input type='hidden' name='channel' value='{{channel}}'>"
+  "<button type='submit' class='calib-btn' id='calibBtn'>Start Calibration</button>"
+  "</form>"
+  "<button class='home-btn' id='homeBtn' onclick=\"window.location.href='/summary'\">Home</button>"
+  "<button class='back-btn' id='backBtn' onclick=\"history.back()\">Back</button>"
+  "</div>{{footer}}</body></html>";
+
+static const char CALIBRATE_RUNNING_HTML[] PROGMEM =
+  "{{head}}{{header}}<div class='card'>"
+  "<p style='margin-bottom:18px;'>Motor is running for {{seconds}} seconds. Once it stops, measure the dispensed liquid and enter the amount below:</p>"
+  "<form action='/calibrate' method='POST'>"
+  "<input type='hidden' name='channel' value='{{channel}}'>"
+  "<label for='dispensedML' class='calib-label'>Amount dispensed (ml):</label>"
+  "<input type='number' name='dispensedML' step='0.1' required class='calib-input'><br>"
+  "<button type='submit' class='calib-submit'>Submit Measurement</button>"
+  "</form>"
+  "<button class='home-btn' onclick=\"window.location.href='/summary'\">Home</button>"
+  "<button class='back-btn' onclick=\"history.back()\">Back</button>"
+  "</div>{{footer}}</body></html>";
+
+// Toast, then back to the channel
+static const char CALIBRATE_DONE_HTML[] PROGMEM =
+  "{{head}}<div class='toast'>Calibration complete!</div>"
+  "<script>setTimeout(function(){window.location.href='/manageChannel?channel={{channel}}';},1800);</script>"
+  "</body></html>";
+
+static const char RESET_PAGE_HTML[] PROGMEM =
+  "<html><head><title>System Reset</title></head><body>"
+  "<h1>System Reset</h1>"
+  "<p>Click the button below to reset the system.</p>"
+  "<form action='/reset' method='POST'>"
+  "<input type='submit' value='Reset System'>"
+  "</form>"
+  "<p><a href='/'>Back to Home</a></p>"
+  "</body></html>";
+
+static const char PRIME_PAGE_HTML[] PROGMEM =
+  "{{head}}{{header}}<div class='card'>"
+  "<div class='prime-warning'>Warning: This action will turn on the pump and liquid will flow. Please ensure tubing is connected and ready.</div>"
+  "<input type='button' id='primeButton' data-state='0' value='Start' class='prime-btn' onclick='togglePrime({{channel}})'>"
+  "<button class='home-btn' onclick=\"window.location.href='/summary'\">Home</button>"
+  "<button class='back-btn' style='width:100%;padding:12px 0;font-size:1.1em;background:#aaa;color:#fff;border:none;border-radius:6px;margin-top:10px;' onclick=\"history.back()\">Back</button>"
+  "</div>{{footer}}</body></html>";
+
+static const char SUMMARY_PAGE_HTML[] PROGMEM =
+  "{{head}}{{header}}{{channels}}"
+  "<div class='card'>"
+  "<button onclick=\"location.href='/systemSettings'\">System Settings</button>"
+  "<div style='display:flex;justify-content:space-between;align-items:center;margin-bottom:10px;'><span style='font-size:0.95em;color:#666;'>System Time:</span><span style='font-size:0.95em;color:#333;'>{{time}}</span></div>"
+  "</div>{{footer}}</body></html>";
+
+// One per channel on the summary page
+static const char SUMMARY_CARD_HTML[] PROGMEM =
+  "<div class='card'>"
+  "<h2 style='display:flex;align-items:center;gap:8px;'>{{name}}{{chips}}</h2>"
+  "<p>Last Dosed Time: {{lastTime}}</p>"
+  "<p>Last Dispensed Volume: {{lastVolume}} ml</p>"
+  "<p>Remaining Volume: {{remaining}} ml</p>"
+  "<p>Days Remaining: {{days}}</p>"
+  "<div id='manualDoseSection{{channel}}' data-factor='{{factor}}'>"
+  "<button class='card-btn' style='width:100%;padding:12px 0;font-size:1.1em;background:#28a745;color:#fff;border:none;border-radius:6px;margin-bottom:10px;' onclick='showManualDose({{channel}})'>Manual Dose</button>"
+  "</div>"
+  "<button onclick=\"location.href='/manageChannel?channel={{channel}}'\">Manage Channel {{channel}}</button>"
+  "</div>";
+
+static const char CHANNEL_PAGE_HTML[] PROGMEM =
+  "{{head}}{{header}}"
+  // Status
+  "<div class='card'><h2>Status</h2>"
+  "<p>Last Dosed: {{lastTime}}</p>"
+  "<p>Last Dispensed Volume: {{lastVolume}} ml</p>"
+  "<p>Remaining Volume: <span id='remaining-volume-label'>{{remaining}} ml ({{days}})</span> "
+  "<span id='update-volume-btn-row'><button style='margin-left:8px;' onclick=\"showUpdateVolumeBox()\">Update Volume</button></span>"
+  "<span id='update-volume-row' class='rename-row' style='display:none;'>"
+  "<input id='update-volume-input' class='rename-input' type='number' min='0' step='0.01' value='{{remaining}}'>"
+  "<button class='rename-btn' onclick='saveUpdateVolume({{channel}})'>Save</button>"
+  "<button class='rename-btn cancel' onclick='cancelUpdateVolume()'>Cancel</button>"
+  "</span></p></div>"
+  // Schedule
+  "<div class='card'><h2>Schedule</h2>{{nextDose}}"
+  "<button onclick=\"location.href='/manageSchedule?channel={{channel}}'\">Manage Schedule</button>"
+  "</div>"
+  // Actions and rename
+  "<div class='card'>"
+  "<button style='background:#dc3545;color:#fff;' onclick=\"location.href='/prime?channel={{channel}}'\">Prime Pump</button>"
+  "<button style='background:#dc3545;color:#fff;' onclick=\"location.href='/calibrate?channel={{channel}}'\">Calibrate</button>"
+  "<div id='rename-btn-row' style='display:block;'><button onclick=\"showRenameBox()\">Rename</button></div>"
+  "<div id='rename-row' class='rename-row' style='display:none;'>"
+  "<input id='rename-input' class='rename-input' type='text' value='{{name}}' maxlength='15'>"
+  "<button class='rename-btn' onclick='saveRename({{channel}})'>Save</button>"
+  "<button class='rename-btn cancel' onclick='cancelRename()'>Cancel</button>"
+  "</div>"
+  "<button style='width:100%;padding:12px 0;font-size:1.1em;background:#007BFF;color:#fff;border:none;border-radius:6px;' onclick=\"window.location.href='/summary'\">Home</button>"
+  "</div>{{footer}}</body></html>";
+
+static const char SCHEDULE_PAGE_HTML[] PROGMEM =
+  "{{head}}{{header}}"
+  "<div class='card' style='margin:20px auto;padding:20px;max-width:500px;background:#fff;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.1);'>"
+  "<form id='scheduleForm' method='POST' action='/manageSchedule?channel={{channel}}'>"
+  "<div class='schedule-table-wrapper'>"
+  "<table class='schedule-table'>"
+  "<tr style='background:#007BFF;color:#fff;'><th>Day</th><th>Enabled</th><th>Time</th><th>Volume (ml)</th></tr>"
+  "{{rows}}"
+  "</table></div>"
+  "<div style='margin:16px 0 0 0;'><input type='checkbox' id='copyMonday' name='copyMonday' onchange='onCopyChange(this)' style='margin-right:8px;vertical-align:middle;'><label for='copyMonday' style='display:inline;margin:0;white-space:nowrap;vertical-align:middle;'>All day as Monday</label></div>"
+  "<div style='max-width:500px;margin:20px auto;'><input type='checkbox' id='missedDose' name='missedDose'{{missedDoseChecked}} style='margin-right:8px;vertical-align:middle;'><label for='missedDose' style='display:inline;margin:0;white-space:nowrap;vertical-align:middle;'>Missed Dose Compensation</label></div>"
+  "<div style='display:flex;flex-direction:column;gap:10px;margin-top:20px;'>"
+  "<button type='submit' style='width:100%;padding:12px 0;font-size:1.1em;background:#007BFF;color:#fff;border:none;border-radius:6px;'>Save</button>"
+  "<button type='button' id='cancelBtn' class='cancel' style='width:100%;padding:12px 0;font-size:1.1em;background:#aaa;color:#fff;border:none;border-radius:6px;' onclick=\"window.location.href='/manageChannel?channel={{channel}}'\">Cancel</button>"
+  "</div>"
+  "</form>"
+  "</div>{{footer}}</body></html>";
+
+// One per weekday on the schedule page
+static const char SCHEDULE_ROW_HTML[] PROGMEM =
+  "<tr style='background:{{shade}};'>"
+  "<td>{{dayName}}</td>"
+  "<td><input type='checkbox' id='enabled{{day}}' name='enabled{{day}}'{{checked}}></td>"
+  "<td><input type='time' id='time{{day}}' name='time{{day}}' value='{{time}}'></td>"
+  "<td><input type='number' id='vol{{day}}' name='vol{{day}}' step='0.01' min='0' value='{{volume}}'></td>"
+  "</tr>";
+
+static const char SETTINGS_PAGE_HTML[] PROGMEM =
+  "{{head}}{{header}}"
+  "<form method='POST' action='/systemSettings'>"
+  "<div class='card'>"
+  "<div class='form-row'><label for='deviceName'>Device Name:</label><input type='text' id='deviceName' name='deviceName' value='{{deviceName}}' maxlength='15'></div>"
+  "<div class='form-row'><label for='timezone'>Time Zone:</label><select name='timezone'>{{timezones}}</select></div>"
+  "<div class='section-title'>Calibration Factor</div>"
+  "{{calibration}}{{maxMotors}}"
+  // Notifications
+  "<div class='section-title'>Notifications</div>"
+  "<div class='form-row'><label for='ntfyChannel'>NTFY Channel:</label><input type='text' id='ntfyChannel' name='ntfyChannel' value='{{ntfyChannel}}' readonly></div>"
+  "<div class='form-row'>Events to Notify:</div>"
+  "<div class='checkbox-row'><input type='checkbox' id='notifyLowFert' name='notifyLowFert'{{notifyLowFert}}><label for='notifyLowFert'>Low Fertilizer Volume</label></div>"
+  "<div class='checkbox-row'><input type='checkbox' id='notifyStart' name='notifyStart'{{notifyStart}}><label for='notifyStart'>System Start</label></div>"
+  "<div class='checkbox-row'><input type='checkbox' id='notifyDose' name='notifyDose'{{notifyDose}}><label for='notifyDose'>Dose</label></div>"
+  // MQTT
+  "<div class='section-title'>MQTT</div>"
+  "<div class='form-row'><label for='mqttHost'>Broker:</label><input type='text' id='mqttHost' name='mqttHost' value='{{mqttHost}}' maxlength='63' placeholder='Off'></div>"
+  "<div class='form-row'><label for='mqttPort'>Port:</label><input type='number' id='mqttPort' name='mqttPort' min='1' max='65535' value='{{mqttPort}}'></div>"
+  "<div class='form-row'><label for='mqttUser'>User:</label><input type='text' id='mqttUser' name='mqttUser' value='{{mqttUser}}' maxlength='31'></div>"
+  "<div class='form-row'><label for='mqttPassword'>Password:</label><input type='password' id='mqttPassword' name='mqttPassword' maxlength='63' placeholder='Unchanged'></div>"
+  "<div class='form-row'><label for='mqttTopic'>Topic:</label><input type='text' id='mqttTopic' name='mqttTopic' value='{{mqttTopic}}' maxlength='47'></div>"
+  // LED
+  "<div class='section-title'>LED Settings</div>"
+  "<div class='form-row'><label for='ledBrightness'>LED Brightness:</label><input type='range' id='ledBrightness' name='ledBrightness' min='0' max='255' value='{{ledBrightness}}' style='width:100%;'><span id='ledBrightnessValue'>{{ledPercent}}%</span></div>"
+  "<div class='form-row checkbox-row' style='display:flex;align-items:center;gap:10px;margin-bottom:8px;flex-wrap:nowrap;'>"
+  "<label for='blinkAllOk' style='margin:0;white-space:nowrap;display:inline-block;vertical-align:middle;'>Power ON LED</label>"
+  "<input type='checkbox' id='blinkAllOk' name='blinkAllOk' value='1' {{blinkAllOk}}> <span>Yes</span>"
+  "</div>"
+  "<div class='btn-row'>"
+  "<button type='submit' class='btn btn-main'>Save</button>"
+  "<button type='button' class='btn btn-cancel' onclick=\"window.location.href='/summary'\">Cancel</button>"
+  "</div></div></form>"
+  // Actions outside the main form
+  "<div class='btn-row card-action-row' style='flex-direction:column;gap:4px;'>"
+  "<form method='POST' action='/restart' style='width:100%;' onsubmit='return handleRestart(event)'><button id='restartBtn' type='submit' class='btn btn-main' style='width:100%;margin-bottom:0;'>Restart</button></form>"
+  "<form method='POST' action='/wifiReset' style='width:100%;'><button type='submit' class='btn btn-danger' style='width:100%;margin-bottom:0;' onclick=\"return confirm('Reset WiFi settings? Device will reboot in AP mode.')\">WiFi Reset</button></form>"
+  "<form method='POST' action='/factoryReset' style='width:100%;'><button type='submit' class='btn btn-danger' style='width:100%;margin-bottom:0;' onclick=\"return confirm('Factory reset will erase ALL data. Are you sure?')\">Factory Reset</button></form>"
+  "<form style='width:100%;'><button type='button' class='btn btn-update' style='width:100%;margin-bottom:0;' onclick=\"showFirmwareUpdate()\">FW Update</button></form>"
+  "</div>"
+  // Firmware update
+  "<div id='firmwareUpdateSection' style='display:none;margin-top:20px;'>"
+  "<div class='card'>"
+  "<h3>FW Update</h3>"
+  "<div class='form-row'><label for='firmwareUrl'>Firmware URL:</label>"
+  "<input type='text' id='firmwareUrl' value='https://arjunus1985.github.io/FWRoot/Doser/firmware.bin' style='width:100%;padding:10px;font-size:1.1em;border-radius:6px;border:1px solid #ccc;'></div>"
+  "<div class='form-row'><label for='firmwareSha256'>SHA-256 (optional):</label>"
+  "<input type='text' id='firmwareSha256' maxlength='64' style='width:100%;padding:10px;font-size:1.1em;border-radius:6px;border:1px solid #ccc;'></div>"
+  "<div class='btn-row'>"
+  "<button type='button' class='btn btn-update' onclick=\"updateFirmware()\">Update</button>"
+  "<button type='button' class='btn btn-cancel' onclick=\"hideFirmwareUpdate()\">Cancel</button>"
+  "</div>"
+  "<div id='updateProgress' style='margin-top:10px;display:none;'>"
+  "<div>Downloading firmware...</div>"
+  "<div id='progressBar' style='width:100%;max-width:100%;background:#ddd;border-radius:6px;margin-top:5px;box-sizing:border-box;'>"
+  "<div id='progressFill' style='width:0%;max-width:100%;height:20px;background:#007BFF;border-radius:6px;transition:width 0.3s;'></div>"
+  "</div><div id='progressText'>0%</div></div></div></div>"
+  "{{footer}}</body></html>";
+
+static const char SETTINGS_CALIBRATION_HTML[] PROGMEM =
+  "<div class='form-row'>Channel {{channel}}: <span style='font-weight:600;'>{{factor}}</span></div>";
+
+// How many pumps may run together, limited by the power supply
+static const char SETTINGS_MAX_MOTORS_HTML[] PROGMEM =
+  "<div class='form-row'><label for='maxMotors'>Pumps Running at Once:</label><select id='maxMotors' name='maxMotors'>{{options}}</select></div>";
+
+// After a WiFi or factory reset, how to find the device again
+static const char RESET_NOTICE_HTML[] PROGMEM =
+  "<html><head><meta name='viewport' content='width=device-width, initial-scale=1.0'><title>{{title}}</title></head>"
+  "<body style='font-family:Arial,sans-serif;background:#f4f4f9;color:#333;'>"
+  "<div style='max-width:500px;margin:40px auto;padding:24px;background:#fff;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.08);'>"
+  "<h2 style='color:{{color}};'>{{title}}</h2>"
+  "<p>Since you have reset {{what}} connect to <b>{{deviceName}}</b> access point from Wifi settings once device led glows purple and proceed with setting up WiFi again. Once WiFi connected click on link below:</p>"
+  "<div style='margin:18px 0;'><a href='{{url}}' style='display:block;padding:14px 0;background:#007BFF;color:#fff;text-align:center;border-radius:6px;font-size:1.1em;text-decoration:none;'>{{url}}</a></div>"
+  "</div></body></html>";
+
+struct TimezoneOption {
+  int32_t offset;
+  char label[16];
+};
+
+static const TimezoneOption TIMEZONE_OPTIONS[] PROGMEM = {
+  {-43200, "UTC-12:00"}, {-39600, "UTC-11:00"}, {-36000, "UTC-10:00"}, {-32400, "UTC-09:00"},
+  {-28800, "UTC-08:00 (PST)"}, {-25200, "UTC-07:00 (MST)"}, {-21600, "UTC-06:00 (CST)"}, {-18000, "UTC-05:00 (EST)"},
+  {-14400, "UTC-04:00"}, {-10800, "UTC-03:00"}, {-7200, "UTC-02:00"}, {-3600, "UTC-01:00"},
+  {0, "UTC+00:00"}, {3600, "UTC+01:00"}, {7200, "UTC+02:00"}, {10800, "UTC+03:00"},
+  {14400, "UTC+04:00"}, {18000, "UTC+05:00"}, {19800, "UTC+05:30 (IST)"}, {21600, "UTC+06:00"},
+  {25200, "UTC+07:00"}, {28800, "UTC+08:00"}, {32400, "UTC+09:00 (JST)"}, {36000, "UTC+10:00"},
+  {39600, "UTC+11:00"}, {43200, "UTC+12:00"},
+};
+
+// True when the slot being filled is named key
+bool slotIs(const char* slot, const __FlashStringHelper* key) {
+  return strcmp_P(slot, (PGM_P)key) == 0;
+}
+
+template <typename Fill>
+void renderTemplate(Print& out, PGM_P tpl, Fill fill);
+
+// Slots any page can use: the shared head, header and footer
+template <typename Fill>
+void fillCommonSlot(Print& out, const char* slot, Fill fill) {
+  if (slotIs(slot, F("head"))) {
+    renderTemplate(out, PAGE_HEAD_HTML, fill);
+  } else if (slotIs(slot, F("header"))) {
+    renderTemplate(out, PAGE_HEADER_HTML, fill);
+  } else if (slotIs(slot, F("footer"))) {
+    renderTemplate(out, PAGE_FOOTER_HTML, fill);
+  } else if (slotIs(slot, F("version"))) {
+    out.print(SOFTWARE_VERSION);
+  } else if (slotIs(slot, F("hwVersion"))) {
+    out.print(hwVersion, 1);
+  } else if (slotIs(slot, F("freeHeapKb"))) {
+    out.print(ESP.getFreeHeap() / 1024.0, 2);
+  } else if (slotIs(slot, F("wifiSignal"))) {
+    out.print(getWiFiSignalStrength());
+  }
+}
+
+// Copy tpl to out, calling fill(out, slot) for each {{slot}}. fill returns
+// false for slots it does not know, which then fall back to fillCommonSlot().
+template <typename Fill>
+void renderTemplate(Print& out, PGM_P tpl, Fill fill) {
+  char slot[TEMPLATE_SLOT_MAX];
+  PGM_P p = tpl;
+  for (char c = pgm_read_byte(p); c; c = pgm_read_byte(p)) {
+    if (c != '{' || pgm_read_byte(p + 1) != '{') {
+      out.write((uint8_t)c);
+      p++;
+      continue;
+    }
+    p += 2;
+    size_t n = 0;
+    for (c = pgm_read_byte(p); c && c != '}'; c = pgm_read_byte(++p)) {
+      if (n < sizeof(slot) - 1) slot[n++] = c;
+    }
+    slot[n] = '\0';
+    if (c) p += 2; // Closing braces
+    if (!fill(out, slot)) fillCommonSlot(out, slot, fill);
+  }
+}
+
+// Send a whole page rendered from tpl
+template <typename Fill>
+void sendPage(PGM_P tpl, Fill fill) {
+  ChunkedResponse out("text/html");
+  renderTemplate(out, tpl, fill);
+  out.end();
+}
+
+// Fill function for templates whose slots are all common ones
+bool noPageSlots(Print&, const char*) {
+  return false;
+}
+
+// "More than a year", or the count in red once a week or less is left
+void printDaysRemaining(Print& out, int days, const __FlashStringHelper* unit) {
+  if (days >= 365) {
+    out.print(F("More than a year"));
+    return;
+  }
+  out.print(F("<span style='"));
+  if (days <= 7) out.print(F("color:#dc3545;font-weight:bold;"));
+  out.print(F("'>"));
+  out.print(days);
+  out.print(unit);
+  out.print(F("</span>"));
+}
+
+// Hex digits [from, to) of the MAC address, as WiFi.macAddress() without colons
+void printMacDigits(Print& out, int from, int to) {
+  static const char hexDigits[] PROGMEM = "0123456789ABCDEF";
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  for (int i = from; i < to; i++) {
+    uint8_t nibble = (i % 2 == 0) ? mac[i / 2] >> 4 : mac[i / 2] & 0x0F;
+    out.print((char)pgm_read_byte(hexDigits + nibble));
+  }
+}
+
+// The page shown after a WiFi or factory reset
+void sendResetNotice(const __FlashStringHelper* title, const __FlashStringHelper* color, const __FlashStringHelper* what, bool factory) {
+  sendPage(RESET_NOTICE_HTML, [&](Print& out, const char* slot) {
+    if (slotIs(slot, F("title"))) {
+      out.print(title);
+    } else if (slotIs(slot, F("color"))) {
+      out.print(color);
+    } else if (slotIs(slot, F("what"))) {
+      out.print(what);
+    } else if (slotIs(slot, F("deviceName"))) {
+      out.print(deviceName);
+    } else if (slotIs(slot, F("url"))) {
+      // mDNS name the device comes back under
+      if (factory) {
+        out.print(F("http://doser_"));
+        printMacDigits(out, 9, 11);
+      } else {
+        out.print(F("http://"));
+        for (unsigned int i = 0; i < deviceName.length(); i++) out.print(deviceName[i] == ' ' ? '-' : deviceName[i]);
+      }
+      out.print(F(".local/"));
+    } else {
+      return false;
+    }
+    return true;
+  });
+}
+
+// ?channel=N for pages, channel 1 if missing or out of range
+int channelArg() {
+  int channel = server.hasArg("channel") ? server.arg("channel").toInt() : 1;
+  return isValidChannel(channel) ? channel : 1;
+}
+
+void setupWebServer() {
+  routeMetricsCount = 0; // Routes are registered once per boot
+ 
+
+  onRoute("/calibrate", HTTP_GET, []() {
+    int channel = channelArg();
+    const Channel& c = getChannel(channel);
+    sendPage(CALIBRATE_PAGE_HTML, [&](Print& out, const char* slot) {
+      if (slotIs(slot, F("title"))) {
+        out.print(F("Calibrate"));
+      } else if (slotIs(slot, F("pageClass"))) {
+        out.print(F("pg-calibrate"));
+      } else if (slotIs(slot, F("heading"))) {
+        out.print(F("Calibrate: "));
+        out.print(c.name);
+      } else if (slotIs(slot, F("seconds"))) {
+        out.print(calibrationTimeMs / 1000);
+      } else if (slotIs(slot, F("channel"))) {
+        out.print(channel);
+      } else {
+        return false;
+      }
+      return true;
+    });
+  });
 
   
 
-  server.on("/reset", HTTP_GET, []() {
-    String html = F("<html><head><title>System Reset</title></head><body>");
-    html += F("<h1>System Reset</h1>");
-    html += F("<p>Click the button below to reset the system.</p>");
-    html += F("<form action='/reset' method='POST'>");
-    html += F("<input type='submit' value='Reset System'>");
-    html += F("</form>");
-    html += F("<p><a href='/'>Back to Home</a></p>");
-    html += F("</body></html>");
-    server.send(200, "text/html", html);
+  onRoute("/reset", HTTP_GET, []() {
+    sendPage(RESET_PAGE_HTML, noPageSlots);
   });
 
  
 
-  server.on("/timezone", HTTP_POST, []() {
+  onRoute("/timezone", HTTP_POST, []() {
     if (server.hasArg("offset")) {
-      timezoneOffset = server.arg("offset").toInt();
-      timeClient.setTimeOffset(timezoneOffset);
-      savePersistentDataToSPIFFS();
+      setTimezoneOffset(server.arg("offset").toInt());
+      markPersistentDataDirty();
       server.send(200, "application/json", F("{\"status\":\"timezone updated\"}"));
     } else {
       server.send(400, "application/json", F("{\"error\":\"missing parameters\"}"));
     }
   });
 
-  server.on("/calibrate", HTTP_POST, handleCalibration);
-  server.on("/manual", HTTP_POST, handleManualDispense);
-  //server.on("/daily", HTTP_POST, handleDailyDispense);
-  //server.on("/bottle", HTTP_POST, handleBottleTracking);
-  //server.on("/reset", HTTP_POST, handleSystemReset);
-  server.on("/prime", HTTP_POST, handlePrimePump);
-
-  server.on("/prime", HTTP_GET, []() {
-    int channel = 1;
-    if (server.hasArg("channel")) channel = server.arg("channel").toInt();
-    String channelName = (channel == 1) ? channel1Name : channel2Name;
-    
-    // Start chunked response
-    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-    server.send(200, "text/html", "");
-    
-    // Send HTML header
-    String chunk = F("<html><head>");
-    chunk += F("<title>Prime Pump</title>");
-    chunk += F("<meta name='viewport' content='width=device-width, initial-scale=1.0'>");
-    chunk += F("<style>body { font-family: Arial, sans-serif; background-color: #f4f4f9; color: #333; } ");
-    
-    // CSS in chunks
-    chunk += F(".card { margin: 20px auto; padding: 20px; max-width: 500px; background: #fff; border-radius: 10px; box-shadow: 0 4px 6px rgba(0,0,0,0.1); } ");
-    chunk += F(".card h2 { margin-top: 0; color: #007BFF; } .prime-warning { color: #b30000; background: #fff3cd; border: 1px solid #ffeeba; border-radius: 6px; padding: 10px; margin-bottom: 18px; font-size: 1.05em; } ");
-    chunk += F(".prime-btn { width: 100%; padding: 14px 0; font-size: 1.1em; background: #dc3545; color: #fff; border: none; border-radius: 6px; margin-bottom: 10px; cursor: pointer; transition: background 0.2s; } ");
-    chunk += F(".prime-btn.stop { background: #28a745; } ");
-    chunk += F(".prime-btn:active { opacity: 0.9; } ");
-    chunk += F(".home-btn { width: 100%; padding: 12px 0; font-size: 1.1em; background: #007BFF; color: #fff; border: none; border-radius: 6px; } ");
-    
-    chunk += F(".back-btn { width: 100%; padding: 12px 0; font-size: 1.1em; background: #aaa; color: #fff; border: none; border-radius: 6px; margin-top: 10px; } ");
-    chunk += F(".card button, .card-btn, .dispense-btn, .calib-btn, .prime-btn, .home-btn, .back-btn, .rename-btn, button.cancel { transition: background 0.2s; } ");
-    chunk += F(".card button:hover, .card-btn:hover, .dispense-btn:hover, .calib-btn:hover, .prime-btn:hover, .home-btn:hover, .rename-btn:hover { background-color: #0056b3 !important; } ");
-    
-    chunk += F(".prime-btn.stop:hover { background-color: #218838 !important; } ");
-    chunk += F(".rename-btn.cancel:hover, button.cancel:hover, .back-btn:hover { background-color: #888 !important; }</style>");
-    server.sendContent(chunk);
-    // JavaScript
-    chunk = F("<script>\n");
-    chunk += F("function togglePrime() {\n");
-    chunk += F("  var btn = document.getElementById('primeButton');\n");
-    chunk += F("  var state = btn.getAttribute('data-state') === '1' ? '0' : '1';\n");
-    chunk += F("  var xhr = new XMLHttpRequest();\n");
-    chunk += F("  xhr.open('POST', '/prime', true);\n");
-    chunk += F("  xhr.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');\n");
-    chunk += F("  xhr.send('channel=") + String(channel) + F("&state=' + state);\n");
-    chunk += F("  btn.setAttribute('data-state', state);\n");
-    chunk += F("  btn.value = state === '1' ? 'Done' : 'Start';\n");
-    chunk += F("  btn.className = state === '1' ? 'prime-btn stop' : 'prime-btn';\n");
-    chunk += F("}\n");
-    
-    chunk += F("window.onload = function() {\n");
-    chunk += F("  var btn = document.getElementById('primeButton');\n");
-    chunk += F("  btn.value = 'Start';\n");
-    chunk += F("  btn.className = 'prime-btn';\n");
-    chunk += F("}\n");
-    chunk += F("</script>");
-    chunk += F("</head><body>");
-    
-    // Body content
-    chunk += generateHeader("Prime Pump: " + channelName);
-    chunk += F("<div class='card'>");
-    chunk += F("<div class='prime-warning'>Warning: This action will turn on the pump and liquid will flow. Please ensure tubing is connected and ready.</div>");
-    chunk += F("<input type='button' id='primeButton' data-state='0' value='Start' class='prime-btn' onclick='togglePrime()'>");
-    chunk += F("<button class='home-btn' onclick=\"window.location.href='/summary'\">Home</button>");
-    chunk += F("<button class='back-btn' style='width:100%;padding:12px 0;font-size:1.1em;background:#aaa;color:#fff;border:none;border-radius:6px;margin-top:10px;' onclick=\"history.back()\">Back</button>");
-    chunk += F("</div>");
-    chunk += generateFooter();
-    chunk += F("</body></html>");
-    server.sendContent(chunk);
-    
-    // End chunked response
-    server.sendContent("");
+  onRoute("/calibrate", HTTP_POST, handleCalibration);
+  onRoute("/manual", HTTP_POST, handleManualDispense);
+  //onRoute("/daily", HTTP_POST, handleDailyDispense);
+  //onRoute("/bottle", HTTP_POST, handleBottleTracking);
+  //onRoute("/reset", HTTP_POST, handleSystemReset);
+  onRoute("/prime", HTTP_POST, handlePrimePump);
+
+  onRoute("/prime", HTTP_GET, []() {
+    int channel = channelArg();
+    const Channel& c = getChannel(channel);
+    sendPage(PRIME_PAGE_HTML, [&](Print& out, const char* slot) {
+      if (slotIs(slot, F("title"))) {
+        out.print(F("Prime Pump"));
+      } else if (slotIs(slot, F("pageClass"))) {
+        out.print(F("pg-prime"));
+      } else if (slotIs(slot, F("heading"))) {
+        out.print(F("Prime Pump: "));
+        out.print(c.name);
+      } else if (slotIs(slot, F("channel"))) {
+        out.print(channel);
+      } else {
+        return false;
+      }
+      return true;
+    });
   });
 
-  server.on("/summary", HTTP_GET, []() {
-    Serial.print(F("[SUMMARY] lastDispensedVolume1: ")); Serial.println(lastDispensedVolume1);
-    Serial.print(F("[SUMMARY] lastDispensedTime1: ")); Serial.println(lastDispensedTime1);
-    Serial.print(F("[SUMMARY] lastDispensedVolume2: ")); Serial.println(lastDispensedVolume2);
-    Serial.print(F("[SUMMARY] lastDispensedTime2: ")); Serial.println(lastDispensedTime2);
-    
-    // Start chunked response
-    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-    server.send(200, "text/html", "");
-    
-    // Send HTML header
-    String chunk = F("<html><head><title>Doser Summary</title>");
-    chunk += F("<meta name='viewport' content='width=device-width, initial-scale=1.0'>");
-    chunk += F("<style>body { font-family: Arial, sans-serif; margin: 0; padding: 0; background-color: #f4f4f9; color: #333; } ");
-    
-    // Send CSS in chunks
-    chunk += F(".card { margin: 20px auto; padding: 20px; max-width: 500px; background: #fff; border-radius: 10px; box-shadow: 0 4px 6px rgba(0, 0, 0, 0.1); } ");
-    chunk += F(".card h2 { margin-top: 0; color: #007BFF; } .card p { margin: 10px 0; } ");
-    chunk += F(".status-chip { display: inline-block; padding: 4px 8px; border-radius: 12px; font-size: 0.5em; font-weight: bold; margin-left: 8px; } ");
-    chunk += F(".chip-running-low { background: #dc3545; color: #fff; } ");
-    
-    chunk += F(".card button { display: block; width: 100%; margin: 10px 0; padding: 10px; font-size: 16px; color: #fff; background-color: #007BFF; ");
-    chunk += F("border: none; border-radius: 5px; cursor: pointer; } .card button:hover { background-color: #0056b3; } ");
-    
-    chunk += F(".card button, .card-btn, .dispense-btn, .calib-btn, .prime-btn, .home-btn, .back-btn, .rename-btn, button.cancel { transition: background 0.2s; } ");
-    chunk += F(".card button:hover, .card-btn:hover, .dispense-btn:hover, .calib-btn:hover, .prime-btn:hover, .home-btn:hover, .rename-btn:hover { background-color: #0056b3 !important; } ");
-    chunk += F(".rename-btn.cancel:hover, button.cancel:hover, .back-btn:hover { background-color: #888 !important; }</style></head><body>");
-    
-    // Generate header
-    chunk += generateHeader("Doser Summary");
-
-    // Warning banner
-   
-    
-    // Channel 1 Summary
-    int daysRemaining1 = daysRemainingChannel1;
-    bool moreThanYear1 = (daysRemaining1 >= 365);
-    
-    chunk += F("<div class='card'>");
-    chunk += F("<h2 style='display:flex;align-items:center;gap:8px;'>") + channel1Name;
-    if (!calibratedChannel1) {
-      chunk += F("<span class='status-chip chip-running-low'>Not Calibrated</span>");
-    }
-    if (!moreThanYear1 && daysRemaining1 <= 7) {
-      chunk += F("<span class='status-chip chip-running-low'>Running Low</span>");
-    }
-    chunk += F("</h2>");
-    chunk += F("<p>Last Dosed Time: ") + lastDispensedTime1 + F("</p>");
-    chunk += F("<p>Last Dispensed Volume: ") + String(lastDispensedVolume1) + F(" ml</p>");
-    chunk += F("<p>Remaining Volume: ") + String(remainingMLChannel1) + F(" ml</p>");
-    chunk += F("<p>Days Remaining: ");
-    if (moreThanYear1) {
-      chunk += F("More than a year");
-    } else {
-      String daysColor = (daysRemaining1 <= 7) ? F("color:#dc3545;font-weight:bold;") : F("");
-      chunk += F("<span style='") + daysColor + F("'>") + String(daysRemaining1) + F("</span>");
-    }
-    chunk += F("</p>");
-    
-    chunk += F("<div id='manualDoseSection1'>");
-    chunk += F("<button class='card-btn' style='width:100%;padding:12px 0;font-size:1.1em;background:#28a745;color:#fff;border:none;border-radius:6px;margin-bottom:10px;' onclick='showManualDose1()'>Manual Dose</button>");
-    chunk += F("</div>");
-    chunk += F("<button onclick=\"location.href='/manageChannel?channel=1'\">Manage Channel 1</button>");
-    chunk += F("</div>");
-    
-    // Channel 2 Summary
-    if (numChannels == 2) {
-      int daysRemaining2 = daysRemainingChannel2;
-      bool moreThanYear2 = (daysRemaining2 >= 365);
-      
-      chunk += F("<div class='card'>");
-      chunk += F("<h2 style='display:flex;align-items:center;gap:8px;'>") + channel2Name;
-      if (!calibratedChannel2) {
-        chunk += F("<span class='status-chip chip-running-low'>Not Calibrated</span>");
-      }
-      if (!moreThanYear2 && daysRemaining2 <= 7) {
-        chunk += F("<span class='status-chip chip-running-low'>Running Low</span>");
-      }
-      chunk += F("</h2>");
-      chunk += F("<p>Last Dosed Time: ") + lastDispensedTime2 + F("</p>");
-      chunk += F("<p>Last Dispensed Volume: ") + String(lastDispensedVolume2) + F(" ml</p>");
-      chunk += F("<p>Remaining Volume: ") + String(remainingMLChannel2) + F(" ml</p>");
-      chunk += F("<p>Days Remaining: ");
-      if (moreThanYear2) {
-        chunk += F("More than a year");
+  onRoute("/summary", HTTP_GET, []() {
+    sendPage(SUMMARY_PAGE_HTML, [](Print& out, const char* slot) {
+      if (slotIs(slot, F("title")) || slotIs(slot, F("heading"))) {
+        out.print(F("Doser Summary"));
+      } else if (slotIs(slot, F("pageClass"))) {
+        out.print(F("pg-summary"));
+      } else if (slotIs(slot, F("time"))) {
+        out.print(localTime().formatted);
+      } else if (slotIs(slot, F("channels"))) {
+        // One card per channel
+        for (int n = 1; n <= numChannels; n++) {
+          const Channel& c = getChannel(n);
+          renderTemplate(out, SUMMARY_CARD_HTML, [&](Print& out, const char* slot) {
+            if (slotIs(slot, F("name"))) {
+              out.print(c.name);
+            } else if (slotIs(slot, F("chips"))) {
+              if (!c.calibrated) out.print(F("<span class='status-chip chip-running-low'>Not Calibrated</span>"));
+              if (c.daysRemaining <= 7) out.print(F("<span class='status-chip chip-running-low'>Running Low</span>"));
+            } else if (slotIs(slot, F("lastTime"))) {
+              out.print(c.lastDispensedTime);
+            } else if (slotIs(slot, F("lastVolume"))) {
+              out.print(c.lastDispensedVolume);
+            } else if (slotIs(slot, F("remaining"))) {
+              out.print(c.remainingML);
+            } else if (slotIs(slot, F("days"))) {
+              printDaysRemaining(out, c.daysRemaining, F(""));
+            } else if (slotIs(slot, F("channel"))) {
+              out.print(n);
+            } else if (slotIs(slot, F("factor"))) {
+              out.print(c.calibrationFactor);
+            } else {
+              return false;
+            }
+            return true;
+          });
+        }
       } else {
-        String daysColor = (daysRemaining2 <= 7) ? F("color:#dc3545;font-weight:bold;") : F("");
-        chunk += F("<span style='") + daysColor + F("'>") + String(daysRemaining2) + F("</span>");
+        return false;
       }
-      chunk += F("</p>");
-      
-      chunk += F("<div id='manualDoseSection2'>");
-      chunk += F("<button class='card-btn' style='width:100%;padding:12px 0;font-size:1.1em;background:#28a745;color:#fff;border:none;border-radius:6px;margin-bottom:10px;' onclick='showManualDose2()'>Manual Dose</button>");
-      chunk += F("</div>");
-      chunk += F("<button onclick=\"location.href='/manageChannel?channel=2'\">Manage Channel 2</button>");
-      chunk += F("</div>");
-    }
-    
-    // System Time and Actions
-    chunk += F("<div class='card'>");
-    chunk += F("<button onclick=\"location.href='/systemSettings'\">System Settings</button>");
-    chunk += F("<div style='display:flex;justify-content:space-between;align-items:center;margin-bottom:10px;'><span style='font-size:0.95em;color:#666;'>System Time:</span><span style='font-size:0.95em;color:#333;'>") + getFormattedTime() + F("</span></div>");
-    chunk += F("</div>");
-    
-    // Generate footer
-    chunk += generateFooter();
-    server.sendContent(chunk);
-    // JavaScript
-    chunk = F("<script>\n");
-    chunk += F("function showManualDose1() {\n");
-    chunk += F("  var s = document.getElementById('manualDoseSection1');\n");
-    chunk += F("  s.innerHTML = `<div style='display:flex;gap:8px;align-items:center;justify-content:center;'><input id='doseVol1' type='number' min='0.1' step='0.1' placeholder='Volume (ml)' style='width:40%;padding:8px;font-size:1em;border-radius:6px;border:1px solid #ccc;'><button id='doseBtn1' style=\"width:25%;padding:10px 0;font-size:1em;background:#007BFF;color:#fff;border:none;border-radius:6px;\" onclick='doseNow1()'>Dose</button><button id='cancelBtn1' style=\"width:25%;padding:10px 0;font-size:1em;background:#aaa;color:#fff;border:none;border-radius:6px;\" onclick='cancelManualDose1()'>Cancel</button></div><div id='doseCountdown1' style='margin-top:8px;font-size:1.1em;color:#007BFF;'></div>`;\n");
-    chunk += F("}\n");
-    
-    chunk += F("function showManualDose2() {\n");
-    chunk += F("  var s = document.getElementById('manualDoseSection2');\n");
-    chunk += F("  s.innerHTML = `<div style='display:flex;gap:8px;align-items:center;justify-content:center;'><input id='doseVol2' type='number' min='0.1' step='0.1' placeholder='Volume (ml)' style='width:40%;padding:8px;font-size:1em;border-radius:6px;border:1px solid #ccc;'><button id='doseBtn2' style=\"width:25%;padding:10px 0;font-size:1em;background:#007BFF;color:#fff;border:none;border-radius:6px;\" onclick='doseNow2()'>Dose</button><button id='cancelBtn2' style=\"width:25%;padding:10px 0;font-size:1em;background:#aaa;color:#fff;border:none;border-radius:6px;\" onclick='cancelManualDose2()'>Cancel</button></div><div id='doseCountdown2' style='margin-top:8px;font-size:1.1em;color:#007BFF;'></div>`;\n");
-    chunk += F("}\n");
-    
-    chunk += F("function cancelManualDose1() {\n");
-    chunk += F("  var s = document.getElementById('manualDoseSection1');\n");
-    chunk += F("  s.innerHTML = `<button class='card-btn' style='width:100%;padding:12px 0;font-size:1.1em;background:#28a745;color:#fff;border:none;border-radius:6px;margin-bottom:10px;' onclick='showManualDose1()'>Manual Dose</button>`;\n");
-    chunk += F("}\n");
-    chunk += F("function cancelManualDose2() {\n");
-    chunk += F("  var s = document.getElementById('manualDoseSection2');\n");
-    chunk += F("  s.innerHTML = `<button class='card-btn' style='width:100%;padding:12px 0;font-size:1.1em;background:#28a745;color:#fff;border:none;border-radius:6px;margin-bottom:10px;' onclick='showManualDose2()'>Manual Dose</button>`;\n");
-    chunk += F("}\n");
-    
-    chunk += F("function doseNow1() {\n");
-    chunk += F("  var vol = parseFloat(document.getElementById('doseVol1').value);\n");
-    chunk += F("  if (!vol || vol <= 0) { alert('Enter a valid volume'); return; }\n");
-    chunk += F("  var btn = document.getElementById('doseBtn1');\n");
-    chunk += F("  var cancel = document.getElementById('cancelBtn1');\n");
-    chunk += F("  btn.disabled = true; cancel.disabled = true;\n");
-    chunk += F("  var countdown = document.getElementById('doseCountdown1');\n");
-    chunk += F("  var duration = Math.ceil(vol * ") + String(calibrationFactor1) + F(" / 1000);\n");
-    chunk += F("  countdown.innerText = 'Dosing... ' + duration + 's remaining';\n");
-    
-    chunk += F("  var interval = setInterval(function() {\n");
-    chunk += F("    duration--;\n");
-    chunk += F("    countdown.innerText = 'Dosing... ' + duration + 's remaining';\n");
-    chunk += F("    if (duration <= 0) { clearInterval(interval); countdown.innerText = ''; window.location.reload(); }\n");
-    chunk += F("  }, 1000);\n");
-    chunk += F("  var xhr = new XMLHttpRequest();\n");
-    chunk += F("  xhr.open('POST', '/manual', true);\n");
-    chunk += F("  xhr.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');\n");
-    chunk += F("  xhr.send('channel=1&ml=' + encodeURIComponent(vol));\n");
-    chunk += F("}\n");
-    server.sendContent(chunk);
-    chunk = F("function doseNow2() {\n");
-    chunk += F("  var vol = parseFloat(document.getElementById('doseVol2').value);\n");
-    chunk += F("  if (!vol || vol <= 0) { alert('Enter a valid volume'); return; }\n");
-    chunk += F("  var btn = document.getElementById('doseBtn2');\n");
-    chunk += F("  var cancel = document.getElementById('cancelBtn2');\n");
-    chunk += F("  btn.disabled = true; cancel.disabled = true;\n");
-    chunk += F("  var countdown = document.getElementById('doseCountdown2');\n");
-    chunk += F("  var duration = Math.ceil(vol * ") + String(calibrationFactor2) + F(" / 1000);\n");
-    chunk += F("  countdown.innerText = 'Dosing... ' + duration + 's remaining';\n");
-    
-    chunk += F("  var interval = setInterval(function() {\n");
-    chunk += F("    duration--;\n");
-    chunk += F("    countdown.innerText = 'Dosing... ' + duration + 's remaining';\n");
-    chunk += F("    if (duration <= 0) { clearInterval(interval); countdown.innerText = ''; window.location.reload(); }\n");
-    chunk += F("  }, 1000);\n");
-    chunk += F("  var xhr = new XMLHttpRequest();\n");
-    chunk += F("  xhr.open('POST', '/manual', true);\n");
-    chunk += F("  xhr.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');\n");
-    chunk += F("  xhr.send('channel=2&ml=' + encodeURIComponent(vol));\n");
-    chunk += F("}\n");
-    chunk += F("</script>\n");
-    chunk += F("</body></html>");
-    server.sendContent(chunk);
-    
-    // End the chunked response
-    server.sendContent("");
+      return true;
+    });
   });
 
-  server.on("/manageChannel", HTTP_GET, []() {
-    int channel = 1;
-    if (server.hasArg("channel")) {
-      channel = server.arg("channel").toInt();
-    }
-    // Select channel-specific variables
-    String channelName = (channel == 1) ? channel1Name : channel2Name;
-    float lastDispensedVolume = (channel == 1) ? lastDispensedVolume1 : lastDispensedVolume2;
-    String lastDispensedTime = (channel == 1) ? lastDispensedTime1 : lastDispensedTime2;
-    float remainingML = (channel == 1) ? remainingMLChannel1 : remainingMLChannel2;
-    int daysRemaining = (channel == 1) ? daysRemainingChannel1 : daysRemainingChannel2;
-    
-    // Start chunked response
-    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-    server.send(200, "text/html", "");
-    
-    // Send HTML header
-    String chunk = F("<html><head><title>Channel Management: ") + channelName + F("</title>");
-    chunk += F("<meta name='viewport' content='width=device-width, initial-scale=1.0'>");
-    chunk += F("<style>body { font-family: Arial, sans-serif; margin: 0; padding: 0; background-color: #f4f4f9; color: #333; } ");
-    
-    // CSS in chunks
-    chunk += F(".card { margin: 20px auto; padding: 20px; max-width: 500px; background: #fff; border-radius: 10px; box-shadow: 0 4px 6px rgba(0, 0, 0, 0.1); } ");
-    chunk += F(".card h2 { margin-top: 0; color: #007BFF; } .card p { margin: 10px 0; } ");
-    
-    chunk += F(".card button { display: block; width: 100%; margin: 10px 0; padding: 10px; font-size: 16px; color: #fff; background-color: #007BFF; ");
-    chunk += F("border: none; border-radius: 5px; cursor: pointer; } .card button:hover { background-color: #0056b3; } ");
+  onRoute("/manageChannel", HTTP_GET, []() {
+    int channel = channelArg();
+    const Channel& c = getChannel(channel);
     
-    chunk += F(".header-action { float:right; margin-top:-8px; } .rename-row { display:flex; gap:8px; } ");
-    chunk += F(".rename-input { flex:1; padding:8px 12px; font-size:1em; border-radius:4px; border:1px solid #ccc; height: 2.2em; box-sizing: border-box; } ");
-    
-    chunk += F(".rename-btn { padding:8px 16px; font-size:1em; border-radius:4px; border:none; background:#007BFF; color:#fff; cursor:pointer; } ");
-    chunk += F(".rename-btn.cancel { background:#aaa; } .rename-row { display:flex; gap:8px; align-items:center; justify-content:center; } ");
-    
-    chunk += F(".rename-input { flex:1; padding:8px; font-size:1em; border-radius:6px; border:1px solid #ccc; height: 2.2em; box-sizing: border-box; margin:0; } ");
-    chunk += F(".rename-btn { width:25%; padding:10px 0; font-size:1em; border-radius:6px; border:none; background:#007BFF; color:#fff; cursor:pointer; margin:0; transition: background 0.2s; } ");
-    chunk += F(".rename-btn.cancel { background:#aaa; transition: background 0.2s; } .rename-btn.cancel:hover { background:#888; } ");
-    chunk += F("button.cancel { background:#aaa; transition: background 0.2s; } button.cancel:hover { background:#888; } ");
-    
-    chunk += F(".card button, .card-btn, .dispense-btn, .calib-btn, .prime-btn, .home-btn, .back-btn, .rename-btn, button.cancel { transition: background 0.2s; } ");
-    chunk += F(".card button:hover, .card-btn:hover, .dispense-btn:hover, .calib-btn:hover, .prime-btn:hover, .home-btn:hover, .rename-btn:hover { background-color: #0056b3 !important; } ");
-    chunk += F(".rename-btn.cancel:hover, button.cancel:hover, .back-btn:hover { background-color: #888 !important; }</style>");
-    
-    // JavaScript
-    chunk += F("<script>\n");
-    chunk += F("function showRenameBox() {\n");
-    chunk += F("  document.getElementById('rename-row').style.display = 'flex';\n");
-    chunk += F("  document.getElementById('rename-btn-row').style.display = 'none';\n");
-    chunk += F("}\n");
-    
-    chunk += F("function cancelRename() {\n");
-    chunk += F("  document.getElementById('rename-row').style.display = 'none';\n");
-    chunk += F("  document.getElementById('rename-btn-row').style.display = 'block';\n");
-    chunk += F("}\n");
-    
-chunk += F("function saveRename(channel) {\n");
-    chunk += F("  var newName = document.getElementById('rename-input').value;\n");
-    chunk += F("  if (!newName) { alert('Name cannot be empty'); return; }\n");
-    chunk += F("  var xhr = new XMLHttpRequest();\n");
-    chunk += F("  xhr.open('POST', '/renameChannel', true);\n");
-    chunk += F("  xhr.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');\n");
-    chunk += F("  xhr.onreadystatechange = function() {\n");
-    chunk += F("    if (xhr.readyState == 4 && xhr.status == 200) { location.reload(); }\n");
-    chunk += F("  };\n");
-    chunk += F("  xhr.send('channel=' + channel + '&name=' + encodeURIComponent(newName));\n");
-    chunk += F("}\n");
-    
-    chunk += F("function showUpdateVolumeBox() {\n");
-    chunk += F("  document.getElementById('update-volume-row').style.display = 'flex';\n");
-    chunk += F("  document.getElementById('update-volume-btn-row').style.display = 'none';\n");
-    chunk += F("}\n");
-    
-    chunk += F("function cancelUpdateVolume() {\n");
-    chunk += F("  document.getElementById('update-volume-row').style.display = 'none';\n");
-    chunk += F("  document.getElementById('update-volume-btn-row').style.display = 'inline';\n");
-    chunk += F("}\n");
-    
-    chunk += F("function saveUpdateVolume(channel) {\n");
-    chunk += F("  var newVol = document.getElementById('update-volume-input').value;\n");
-    chunk += F("  if (!newVol || isNaN(newVol) || Number(newVol) < 0) { alert('Enter a valid volume'); return; }\n");
-    chunk += F("  var xhr = new XMLHttpRequest();\n");
-    chunk += F("  xhr.open('POST', '/updateVolume', true);\n");
-    chunk += F("  xhr.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');\n");
-    chunk += F("  xhr.onreadystatechange = function() {\n");
-    chunk += F("    if (xhr.readyState == 4 && xhr.status == 200) { location.reload(); }\n");
-    chunk += F("  };\n");
-    chunk += F("  xhr.send('channel=' + channel + '&volume=' + encodeURIComponent(newVol));\n");
-    chunk += F("}\n");
-    chunk += F("</script>\n");
-    chunk += F("</head><body>");
-    
-    // Header and card open
-    chunk += generateHeader("Channel Management: " + channelName);
-    server.sendContent(chunk);
-    // Calculate days remaining for this channel
-    bool moreThanYear = (daysRemaining >= 365);
-    
-    // Status Card
-    chunk = F("<div class='card'>");
-    chunk += F("<h2>Status</h2>");
-    chunk += F("<p>Last Dosed: ") + lastDispensedTime + F("</p>");
-    chunk += F("<p>Last Dispensed Volume: ") + String(lastDispensedVolume) + F(" ml</p>");
-    chunk += F("<p>Remaining Volume: <span id='remaining-volume-label'>") + String(remainingML) + F(" ml (");
-    if (moreThanYear) {
-      chunk += F("More than a year");
-    } else {
-      String daysColor = (daysRemaining <= 7) ? F("color:#dc3545;font-weight:bold;") : F("");
-      chunk += F("<span style='") + daysColor + F("'>") + String(daysRemaining) + F(" days</span>");
-    }
-    chunk += F(")</span> ");
-    
-    chunk += F("<span id='update-volume-btn-row'><button style='margin-left:8px;' onclick=\"showUpdateVolumeBox()\">Update Volume</button></span>");
-    chunk += F("<span id='update-volume-row' class='rename-row' style='display:none;'>");
-    chunk += F("<input id='update-volume-input' class='rename-input' type='number' min='0' step='0.01' value='") + String(remainingML) + F("'>");
-    chunk += F("<button class='rename-btn' onclick='saveUpdateVolume(") + String(channel) + F(")'>Save</button>");
-    chunk += F("<button class='rename-btn cancel' onclick='cancelUpdateVolume()'>Cancel</button>");
-    chunk += F("</span></p>");
-    chunk += F("</div>");
-    
-    // Schedule Card
-    chunk += F("<div class='card'>");
-    chunk += F("<h2>Schedule</h2>");
-    
-    // Show next dose from weekly schedule
-    int today = (timeClient.getDay() + 6) % 7; // 0=Monday, 6=Sunday
-    WeeklySchedule* ws = (channel == 1) ? &weeklySchedule1 : &weeklySchedule2;
-    int nowHour = timeClient.getHours();
-    int nowMinute = timeClient.getMinutes();
+    // Next dose from the weekly schedule
+    const LocalTime& lt = localTime();
+    int today = lt.weekday; // 0=Monday, 6=Sunday
+    const WeeklySchedule* ws = &c.schedule;
+    int nowHour = lt.minuteOfDay / 60;
+    int nowMinute = lt.minuteOfDay % 60;
     int nextDay = -1, nextHour = -1, nextMinute = -1;
     float nextVol = 0.0f;
     for (int offset = 0; offset < 7; ++offset) {
@@ -1239,59 +1995,58 @@ chunk += F("function saveRename(channel) {\n");
       }
     }
     
-    if (nextDay >= 0) {
-      String ampm = (nextHour < 12) ? F("AM") : F("PM");
-      int hour12 = nextHour % 12 == 0 ? 12 : nextHour % 12;
-      chunk += F("<p>Next Dose: ") + String(dayNames[nextDay]) + F(", ") + String(hour12) + F(":") + (nextMinute < 10 ? F("0") : F("")) + String(nextMinute) + F(" ") + ampm + F("</p>");
-      chunk += F("<p>Next Dose Volume: ") + String(nextVol) + F(" ml</p>");
-    } else {
-      chunk += F("<p>Next Dose: N/A</p>");
-      chunk += F("<p>Next Dose Volume: N/A</p>");
-    }
-    chunk += F("<button onclick=\"location.href='/manageSchedule?channel=") + String(channel) + F("'\">Manage Schedule</button>");
-    chunk += F("</div>");
-    
-    // Actions Card
-    chunk += F("<div class='card'>");
-    chunk += F("<button style='background:#dc3545;color:#fff;' onclick=\"location.href='/prime?channel=") + String(channel) + F("'\">Prime Pump</button>");
-    chunk += F("<button style='background:#dc3545;color:#fff;' onclick=\"location.href='/calibrate?channel=") + String(channel) + F("'\">Calibrate</button>");
-    
-    // Rename UI
-    chunk += F("<div id='rename-btn-row' style='display:block;'><button onclick=\"showRenameBox()\">Rename</button></div>");
-    chunk += F("<div id='rename-row' class='rename-row' style='display:none;'>");
-    chunk += F("<input id='rename-input' class='rename-input' type='text' value='") + channelName + F("' maxlength='15'>");
-    chunk += F("<button class='rename-btn' onclick='saveRename(") + String(channel) + F(")'>Save</button>");
-    chunk += F("<button class='rename-btn cancel' onclick='cancelRename()'>Cancel</button>");
-   
-    chunk += F("</div>");
-    chunk += F("<button style='width:100%;padding:12px 0;font-size:1.1em;background:#007BFF;color:#fff;border:none;border-radius:6px;' onclick=\"window.location.href='/summary'\">Home</button>");
-   
-    chunk += F("</div>");
-    
-    // Back and Home buttons row
-   // chunk += F("<div style='display:flex;gap:10px;max-width:500px;margin:20px auto 0 auto;'>");
-    //chunk += F("</div>");
-    
-    // Footer
-    chunk += generateFooter();
-    chunk += F("</body></html>");
-    server.sendContent(chunk);
-    
-    // End chunked response
-    server.sendContent("");
+    sendPage(CHANNEL_PAGE_HTML, [&](Print& out, const char* slot) {
+      if (slotIs(slot, F("title")) || slotIs(slot, F("heading"))) {
+        out.print(F("Channel Management: "));
+        out.print(c.name);
+      } else if (slotIs(slot, F("pageClass"))) {
+        out.print(F("pg-channel"));
+      } else if (slotIs(slot, F("name"))) {
+        out.print(c.name);
+      } else if (slotIs(slot, F("lastTime"))) {
+        out.print(c.lastDispensedTime);
+      } else if (slotIs(slot, F("lastVolume"))) {
+        out.print(c.lastDispensedVolume);
+      } else if (slotIs(slot, F("remaining"))) {
+        out.print(c.remainingML);
+      } else if (slotIs(slot, F("days"))) {
+        printDaysRemaining(out, c.daysRemaining, F(" days"));
+      } else if (slotIs(slot, F("channel"))) {
+        out.print(channel);
+      } else if (slotIs(slot, F("nextDose"))) {
+        if (nextDay >= 0) {
+          int hour12 = nextHour % 12 == 0 ? 12 : nextHour % 12;
+          out.print(F("<p>Next Dose: "));
+          out.print(dayNames[nextDay]);
+          out.print(F(", "));
+          out.print(hour12);
+          out.print(nextMinute < 10 ? F(":0") : F(":"));
+          out.print(nextMinute);
+          out.print(nextHour < 12 ? F(" AM</p>") : F(" PM</p>"));
+          out.print(F("<p>Next Dose Volume: "));
+          out.print(nextVol);
+          out.print(F(" ml</p>"));
+        } else {
+          out.print(F("<p>Next Dose: N/A</p><p>Next Dose Volume: N/A</p>"));
+        }
+      } else {
+        return false;
+      }
+      return true;
+    });
   });
 
   // Add endpoint to handle rename POST
-  server.on("/renameChannel", HTTP_POST, []() {
+  onRoute("/renameChannel", HTTP_POST, []() {
     if (server.hasArg("channel") && server.hasArg("name")) {
       int channel = server.arg("channel").toInt();
-      String newName = server.arg("name");
-      if (channel == 1) {
-        channel1Name = newName;
-      } else if (channel == 2) {
-        channel2Name = newName;
+      if (!isValidChannel(channel)) {
+        server.send(400, "application/json", F("{\"error\":\"invalid channel\"}"));
+        return;
       }
-      savePersistentDataToSPIFFS();
+      getChannel(channel).name = server.arg("name");
+      markPersistentDataDirty();
+      mqttDiscoveryNext = 0; // Names are part of the discovery configs
       server.send(200, "application/json", F("{\"status\":\"renamed\"}"));
     } else {
       server.send(400, "application/json", F("{\"error\":\"missing parameters\"}"));
@@ -1299,18 +2054,15 @@ chunk += F("function saveRename(channel) {\n");
   });
 
   // Add endpoint to handle update volume POST
-  server.on("/updateVolume", HTTP_POST, []() {
+  onRoute("/updateVolume", HTTP_POST, []() {
     if (server.hasArg("channel") && server.hasArg("volume")) {
       int channel = server.arg("channel").toInt();
-      float newVol = server.arg("volume").toFloat();
-      if (channel == 1) {
-        remainingMLChannel1 = newVol;
-        updateDaysRemaining(1, remainingMLChannel1, &weeklySchedule1);
-      } else if (channel == 2) {
-        remainingMLChannel2 = newVol;
-        updateDaysRemaining(2, remainingMLChannel2, &weeklySchedule2);
+      if (!isValidChannel(channel)) {
+        server.send(400, "application/json", F("{\"error\":\"invalid channel\"}"));
+        return;
       }
-      savePersistentDataToSPIFFS();
+      counterSetRemaining(channel, server.arg("volume").toFloat());
+      updateDaysRemaining(channel);
       server.send(200, "application/json", F("{\"status\":\"updated\"}"));
     } else {
       server.send(400, "application/json", F("{\"error\":\"missing parameters\"}"));
@@ -1318,110 +2070,61 @@ chunk += F("function saveRename(channel) {\n");
   });
 
   // --- Manage Schedule UI ---
-  server.on("/manageSchedule", HTTP_GET, []() {
-    int channel = 1;
-    if (server.hasArg("channel")) channel = server.arg("channel").toInt();
-    WeeklySchedule* ws = (channel == 2) ? &weeklySchedule2 : &weeklySchedule1;
-    // Start chunked response
-    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-    server.send(200, "text/html", "");
-    // HTML head and style
-    String chunk = F("<html><head><title>Manage Schedule: ") + ws->channelName + F("</title>");
-    chunk += F("<meta name='viewport' content='width=device-width, initial-scale=1.0'>");
-    chunk += F("<style>body{font-family:Arial,sans-serif;background:#f4f4f9;color:#333;}\n");
-    chunk += F(".card{margin:20px auto;padding:20px;max-width:500px;background:#fff;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.1);}\n");
-    chunk += F(".card h2{margin-top:0;color:#007BFF;}\n");
-    chunk += F(".form-row{margin-bottom:16px;}\n");
-    chunk += F("label{display:block;margin-bottom:6px;font-weight:500;}\n");
-    chunk += F(".schedule-table-wrapper{width:100%;overflow-x:auto;margin:0 auto;box-sizing:border-box;}\n");
-    chunk += F("table.schedule-table{width:100%;max-width:100%;margin:0 auto;box-sizing:border-box;border-collapse:collapse;}\n");
-    chunk += F("th,td{padding:8px;text-align:center;box-sizing:border-box;}\n");
-    chunk += F("th{background:#007BFF;color:#fff;}\n");
-    chunk += F("tr:nth-child(even){background:#f9f9f9;}\n");
-    chunk += F("input[type=number]{width:70px;}input[type=time]{width:120px;}label{margin-left:8px;}button{margin:8px 4px;padding:10px 20px;font-size:1em;border-radius:5px;border:none;background:#007BFF;color:#fff;cursor:pointer;}button.cancel{background:#aaa;}button:disabled,input:disabled{background:#eee;color:#888;}\n");
-    chunk += F(".card button, .card-btn, .dispense-btn, .calib-btn, .prime-btn, .home-btn, .back-btn, .rename-btn, button.cancel { transition: background 0.2s; }\n");
-    chunk += F(".card button:hover, .card-btn:hover, .dispense-btn:hover, .calib-btn:hover, .prime-btn:hover, .home-btn:hover, .rename-btn:hover { background-color: #0056b3 !important; }\n");
-    chunk += F(".rename-btn.cancel:hover, button.cancel:hover, .back-btn:hover { background-color: #888 !important; }\n");
-    chunk += F("@media (max-width:600px){.card{padding:10px;}th,td{font-size:0.95em;padding:6px;}input[type=number],input[type=time]{width:90%;min-width:60px;}}\n");
-    chunk += F("</style>");
-    // JS chunk
-    chunk += F("<script>\n");
-    chunk += F("function copyMondayToOthers() {\n");
-    chunk += F("  var enabled=document.getElementById('enabled0').checked;\n");
-    chunk += F("  var time=document.getElementById('time0').value;\n");
-    chunk += F("  var vol=document.getElementById('vol0').value;\n");
-    chunk += F("  for(var i=1;i<7;i++){\n");
-    chunk += F("    document.getElementById('enabled'+i).checked=enabled;\n");
-    chunk += F("    document.getElementById('time'+i).value=time;\n");
-    chunk += F("    document.getElementById('vol'+i).value=vol;\n");
-    chunk += F("  }\n");
-    chunk += F("}\n");
-    chunk += F("function uncopyMonday() {\n");
-    chunk += F("  // No disabling, just allow editing\n");
-    chunk += F("}\n");
-    chunk += F("function onCopyChange(cb){if(cb.checked){copyMondayToOthers();}else{uncopyMonday();}}\n");
-    chunk += F("window.addEventListener('DOMContentLoaded',function(){\n");
-    chunk += F("  document.getElementById('enabled0').addEventListener('change',function(){if(document.getElementById('copyMonday').checked){copyMondayToOthers();}});\n");
-    chunk += F("  document.getElementById('time0').addEventListener('change',function(){if(document.getElementById('copyMonday').checked){copyMondayToOthers();}});\n");
-    chunk += F("  document.getElementById('vol0').addEventListener('input',function(){if(document.getElementById('copyMonday').checked){copyMondayToOthers();}});\n");
-    chunk += F("});\n");
-    chunk += F("</script>\n");
-    chunk += F("</head><body>");
-    server.sendContent(chunk);
-    // Header and card open
-    chunk += generateHeader("Manage Schedule : " + ws->channelName);
-    chunk += F("<div class='card' style='margin:20px auto;padding:20px;max-width:500px;background:#fff;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.1);'>");
-    chunk += F("<form id='scheduleForm' method='POST' action='/manageSchedule?channel=") + String(channel) + F("'>");
-    chunk += F("<div class='schedule-table-wrapper'>");
-    chunk += F("<table class='schedule-table'>");
-    chunk += F("<tr style='background:#007BFF;color:#fff;'><th>Day</th><th>Enabled</th><th>Time</th><th>Volume (ml)</th></tr>");
-    
-    // Table rows chunked
-    for (int i = 0; i < 7; ++i) {
-      String rowShade = (i % 2 == 0) ? F("background:#f9f9f9;") : F("background:#fff;");
-      chunk += F("<tr style='") + rowShade + F("'>");
-      chunk += F("<td>") + String(dayNames[i]) + F("</td>");
-      chunk += F("<td><input type='checkbox' id='enabled") + String(i) + F("' name='enabled") + String(i) + F("'") + (ws->days[i].enabled ? F(" checked") : F("")) + F("></td>");
-      char timebuf[6];
-      snprintf(timebuf, sizeof(timebuf), "%02d:%02d", ws->days[i].hour, ws->days[i].minute);
-      chunk += F("<td><input type='time' id='time") + String(i) + F("' name='time") + String(i) + F("' value='") + String(timebuf) + F("'></td>");
-      chunk += F("<td><input type='number' id='vol") + String(i) + F("' name='vol") + String(i) + F("' step='0.01' min='0' value='") + String(ws->days[i].volume, 2) + F("'></td>");
-      chunk += F("</tr>");
-    }
-    
-    // After table
-    chunk += F("</table></div>");
-    chunk += F("<div style='margin:16px 0 0 0;'><input type='checkbox' id='copyMonday' name='copyMonday' onchange='onCopyChange(this)' style='margin-right:8px;vertical-align:middle;'><label for='copyMonday' style='display:inline;margin:0;white-space:nowrap;vertical-align:middle;'>All day as Monday</label></div>");
-    chunk += String(F("<div style='max-width:500px;margin:20px auto;'><input type='checkbox' id='missedDose' name='missedDose'")) + (ws->missedDoseCompensation ? F(" checked") : F("")) + F(" style='margin-right:8px;vertical-align:middle;'><label for='missedDose' style='display:inline;margin:0;white-space:nowrap;vertical-align:middle;'>Missed Dose Compensation</label></div>");
-    chunk += F("<div style='display:flex;flex-direction:column;gap:10px;margin-top:20px;'>");
-    chunk += F("<button type='submit' style='width:100%;padding:12px 0;font-size:1.1em;background:#007BFF;color:#fff;border:none;border-radius:6px;'>Save</button>");
-    chunk += F("<button type='button' id='cancelBtn' class='cancel' style='width:100%;padding:12px 0;font-size:1.1em;background:#aaa;color:#fff;border:none;border-radius:6px;' onclick=\"window.location.href='/manageChannel?channel=") + String(channel) + F("'\">Cancel</button>");
-    chunk += F("</div>");
-    chunk += F("</form>");
-    chunk += F("</div>");
-    
-    // Footer and scripts
-    chunk += generateFooter();
-    chunk += F("<script>\n");
-    chunk += F("document.getElementById('scheduleForm').addEventListener('submit',function(e){\n");
-    chunk += F("  if(document.getElementById('copyMonday').checked){\n");
-    chunk += F("    var enabled=document.getElementById('enabled0').checked;\n");
-    chunk += F("    var time=document.getElementById('time0').value;\n");
-    chunk += F("    var vol=document.getElementById('vol0').value;\n");
-    chunk += F("    for(var i=1;i<7;i'){document.getElementById('enabled'+i).disabled=false;document.getElementById('time'+i).disabled=false;document.getElementById('vol'+i).disabled=false;document.getElementById('enabled'+i).checked=enabled;document.getElementById('time'+i).value=time;document.getElementById('vol'+i).value=vol;}\n");
-    chunk += F("  }\n");
-    chunk += F("});\n");
-    chunk += F("</script>\n");
-    chunk += F("</form></body></html>");
-    server.sendContent(chunk);
-    // End chunked response
-    server.sendContent("");
+  onRoute("/manageSchedule", HTTP_GET, []() {
+    int channel = channelArg();
+    const WeeklySchedule* ws = &getChannel(channel).schedule;
+    sendPage(SCHEDULE_PAGE_HTML, [&](Print& out, const char* slot) {
+      if (slotIs(slot, F("title"))) {
+        out.print(F("Manage Schedule: "));
+        out.print(ws->channelName);
+      } else if (slotIs(slot, F("heading"))) {
+        out.print(F("Manage Schedule : "));
+        out.print(ws->channelName);
+      } else if (slotIs(slot, F("pageClass"))) {
+        out.print(F("pg-schedule"));
+      } else if (slotIs(slot, F("channel"))) {
+        out.print(channel);
+      } else if (slotIs(slot, F("missedDoseChecked"))) {
+        if (ws->missedDoseCompensation) out.print(F(" checked"));
+      } else if (slotIs(slot, F("rows"))) {
+        for (int i = 0; i < 7; ++i) {
+          const DaySchedule& day = ws->days[i];
+          renderTemplate(out, SCHEDULE_ROW_HTML, [&](Print& out, const char* slot) {
+            if (slotIs(slot, F("shade"))) {
+              out.print(i % 2 == 0 ? F("#f9f9f9") : F("#fff"));
+            } else if (slotIs(slot, F("dayName"))) {
+              out.print(dayNames[i]);
+            } else if (slotIs(slot, F("day"))) {
+              out.print(i);
+            } else if (slotIs(slot, F("checked"))) {
+              if (day.enabled) out.print(F(" checked"));
+            } else if (slotIs(slot, F("time"))) {
+              char timebuf[6];
+              snprintf(timebuf, sizeof(timebuf), "%02d:%02d", day.hour, day.minute);
+              out.print(timebuf);
+            } else if (slotIs(slot, F("volume"))) {
+              out.print(day.volume, 2);
+            } else {
+              return false;
+            }
+            return true;
+          });
+        }
+      } else {
+        return false;
+      }
+      return true;
+    });
   });
 
-  server.on("/manageSchedule", HTTP_POST, []() {
+  onRoute("/manageSchedule", HTTP_POST, []() {
     int channel = 1;
     if (server.hasArg("channel")) channel = server.arg("channel").toInt();
-    WeeklySchedule* ws = (channel == 2) ? &weeklySchedule2 : &weeklySchedule1;
+    if (!isValidChannel(channel)) {
+      server.send(400, "application/json", F("{\"error\":\"invalid channel\"}"));
+      return;
+    }
+    WeeklySchedule* ws = &getChannel(channel).schedule;
     for (int i = 0; i < 7; ++i) {
       ws->days[i].enabled = server.hasArg("enabled" + String(i));
       String t = server.arg("time" + String(i));
@@ -1441,306 +2144,194 @@ chunk += F("function saveRename(channel) {\n");
     server.send(302, "text/plain", "");
     
     // File I/O operations after response
-    saveWeeklySchedulesToSPIFFS();
-    updateDaysRemaining(channel, (channel == 1) ? remainingMLChannel1 : remainingMLChannel2, ws);
+    commitSchedule(channel);
   });
 
-  server.on("/systemSettings", HTTP_GET, []() {
-    // Get MAC address for default device name
-    String mac = WiFi.macAddress();
-    mac.replace(":", "");
-    String defaultDeviceName = "Doser";
-    if (deviceName == "") deviceName = defaultDeviceName;
-    // Use global ntfyChannel
-    // Use global notification variables directly instead of local ones
-    // Calibration factors
-    float calib1 = calibrationFactor1;
-    float calib2 = calibrationFactor2;
-    
-    // Start chunked response
-    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-    server.send(200, "text/html", "");
-    
-    // HTML head
-    String chunk = F("<html><head><title>System Settings</title>");
-    chunk += F("<meta name='viewport' content='width=device-width, initial-scale=1.0'>");
-    chunk += F("<style>body{font-family:Arial,sans-serif;background:#f4f4f9;color:#333;} ");
-    
-    // CSS in smaller chunks
-    chunk += F(".card{margin:20px auto;padding:20px;max-width:500px;background:#fff;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.1);} ");
-    chunk += F(".card h2{margin-top:0;color:#007BFF;} .form-row{margin-bottom:16px;} ");
-    chunk += F("label{display:block;margin-bottom:6px;font-weight:500;} ");
-    chunk += F("input[type=text],input[type=number],input[type=password],select{width:100%;padding:10px;font-size:1.1em;border-radius:6px;border:1px solid #ccc;box-sizing:border-box;} ");
-    chunk += F(".section-title{font-size:1.1em;font-weight:600;margin:18px 0 8px 0;color:#007BFF;} ");
-    chunk += F(".checkbox-row{display:flex;align-items:center;gap:10px;margin-bottom:8px;flex-wrap:nowrap;}\n");
-    chunk += F(".checkbox-row input[type=checkbox]{margin:0 6px 0 0;flex-shrink:0;}\n");
-    chunk += F(".checkbox-row label{margin:0;white-space:nowrap;display:inline-block;vertical-align:middle;}\n");
-    chunk += F(".btn-row{display:flex;gap:10px;margin-top:18px;} ");
-    chunk += F(".btn{flex:1;padding:12px 0;font-size:1.1em;background:#007BFF;color:#fff;border:none;border-radius:6px;cursor:pointer;transition:background 0.2s;} ");
-    chunk += F(".btn.cancel{background:#aaa;} .btn.danger{background:#dc3545;} .btn.update{background:#28a745;} ");
-    chunk += F(".btn:hover{background:#0056b3;} .btn.cancel:hover{background:#888;} .btn.danger:hover{background:#b30000;} .btn.update:hover{background:#218838;} ");
-    chunk += F("</style></head><body>");
-    
-    // Header
-    chunk += generateHeader("System Settings");
-    
-    // Form start and device settings
-    chunk += F("<form method='POST' action='/systemSettings'>");
-    chunk += F("<div class='card'>");
-    chunk += F("<div class='form-row'><label for='deviceName'>Device Name:</label><input type='text' id='deviceName' name='deviceName' value='") + deviceName + F("' maxlength='15'></div>");
-
-    // Timezone dropdown
-    chunk += F("<div class='form-row'><label for='timezone'>Time Zone:</label><select name='timezone'>");
-    int tzOffsets[] = {-43200,-39600,-36000,-32400,-28800,-25200,-21600,-18000,-14400,-10800,-7200,-3600,0,3600,7200,10800,14400,18000,19800,21600,25200,28800,32400,36000,39600,43200};
-    String tzLabels[] = {"UTC-12:00","UTC-11:00","UTC-10:00","UTC-09:00","UTC-08:00 (PST)","UTC-07:00 (MST)","UTC-06:00 (CST)","UTC-05:00 (EST)","UTC-04:00","UTC-03:00","UTC-02:00","UTC-01:00","UTC+00:00","UTC+01:00","UTC+02:00","UTC+03:00","UTC+04:00","UTC+05:00","UTC+05:30 (IST)","UTC+06:00","UTC+07:00","UTC+08:00","UTC+09:00 (JST)","UTC+10:00","UTC+11:00","UTC+12:00"};
-    
-    // Send timezone options in smaller chunks
-    for (int i = 0; i < 26; i += 5) {
-      chunk += F("");
-      for (int j = i; j < i + 5 && j < 26; j++) {
-        chunk += F("<option value='") + String(tzOffsets[j]) + F("'") + (timezoneOffset == tzOffsets[j] ? F(" selected") : F("")) + F(">") + tzLabels[j] + F("</option>");
+  onRoute("/systemSettings", HTTP_GET, []() {
+    if (deviceName == "") deviceName = F("Doser");
+    sendPage(SETTINGS_PAGE_HTML, [](Print& out, const char* slot) {
+      if (slotIs(slot, F("title")) || slotIs(slot, F("heading"))) {
+        out.print(F("System Settings"));
+      } else if (slotIs(slot, F("pageClass"))) {
+        out.print(F("pg-settings"));
+      } else if (slotIs(slot, F("deviceName"))) {
+        out.print(deviceName);
+      } else if (slotIs(slot, F("timezones"))) {
+        for (size_t i = 0; i < sizeof(TIMEZONE_OPTIONS) / sizeof(TIMEZONE_OPTIONS[0]); i++) {
+          TimezoneOption tz;
+          memcpy_P(&tz, &TIMEZONE_OPTIONS[i], sizeof(tz));
+          renderTemplate(out, OPTION_HTML, [&](Print& out, const char* slot) {
+            if (slotIs(slot, F("value"))) {
+              out.print((long)tz.offset);
+            } else if (slotIs(slot, F("selected"))) {
+              if (timezoneOffset == tz.offset) out.print(F(" selected"));
+            } else if (slotIs(slot, F("label"))) {
+              out.print(tz.label);
+            } else {
+              return false;
+            }
+            return true;
+          });
+        }
+      } else if (slotIs(slot, F("calibration"))) {
+        for (int n = 1; n <= numChannels; n++) {
+          renderTemplate(out, SETTINGS_CALIBRATION_HTML, [&](Print& out, const char* slot) {
+            if (slotIs(slot, F("channel"))) {
+              out.print(n);
+            } else if (slotIs(slot, F("factor"))) {
+              out.print(getChannel(n).calibrationFactor, 2);
+            } else {
+              return false;
+            }
+            return true;
+          });
+        }
+      } else if (slotIs(slot, F("maxMotors"))) {
+        if (numChannels < 2) return true;
+        renderTemplate(out, SETTINGS_MAX_MOTORS_HTML, [](Print& out, const char* slot) {
+          if (!slotIs(slot, F("options"))) return false;
+          for (int n = 1; n <= numChannels; n++) {
+            renderTemplate(out, OPTION_HTML, [&](Print& out, const char* slot) {
+              if (slotIs(slot, F("value")) || slotIs(slot, F("label"))) {
+                out.print(n);
+              } else if (slotIs(slot, F("selected"))) {
+                if (maxConcurrentMotors == n) out.print(F(" selected"));
+              } else {
+                return false;
+              }
+              return true;
+            });
+          }
+          return true;
+        });
+      } else if (slotIs(slot, F("ntfyChannel"))) {
+        printMacDigits(out, 0, 12);
+      } else if (slotIs(slot, F("notifyLowFert"))) {
+        if (notifyLowFert) out.print(F(" checked"));
+      } else if (slotIs(slot, F("notifyStart"))) {
+        if (notifyStart) out.print(F(" checked"));
+      } else if (slotIs(slot, F("notifyDose"))) {
+        if (notifyDose) out.print(F(" checked"));
+      } else if (slotIs(slot, F("mqttHost"))) {
+        out.print(mqttHost);
+      } else if (slotIs(slot, F("mqttPort"))) {
+        out.print(mqttPort);
+      } else if (slotIs(slot, F("mqttUser"))) {
+        out.print(mqttUser);
+      } else if (slotIs(slot, F("mqttTopic"))) {
+        out.print(mqttTopic);
+      } else if (slotIs(slot, F("ledBrightness"))) {
+        out.print(ledBrightness);
+      } else if (slotIs(slot, F("ledPercent"))) {
+        out.print(ledBrightness * 100 / 255);
+      } else if (slotIs(slot, F("blinkAllOk"))) {
+        if (blinkAllOk) out.print(F("checked"));
+      } else {
+        return false;
       }
-    }
-    chunk += F("</select></div>");
-    server.sendContent(chunk);
-    
-    //chunk += F("<div class='form-row'><label for='numChannels'>Number of Channels:</label><select id='numChannels' name='numChannels' onchange='onNumChannelsChange()'>");
-    //chunk += F("<option value='1'") + String(numChannels == 1 ? F(" selected") : F("")) + F(">1</option>");
-    //chunk += F("<option value='2'") + String(numChannels == 2 ? F(" selected") : F("")) + F(">2</option>");
-    //chunk += F("</select></div>");
-    //// ...existing code...
-    //// Add password prompt JS for numChannels
-    //chunk += F("<script>\n");
-    //chunk += F("var prevNumChannels = ") + String(numChannels) + F(";\n");
-    //chunk += F("function onNumChannelsChange() {\n");
-    //chunk += F("  var sel = document.getElementById('numChannels');\n");
-    //chunk += F("  var newVal = sel.value;\n");
-    //chunk += F("  var pwd = prompt('Enter admin password to change number of channels:');\n");
-    //chunk += F("  if (pwd === 'admin1985') {\n");
-    //chunk += F("    prevNumChannels = newVal;\n");
-    //chunk += F("  } else {\n");
-    //chunk += F("    alert('Incorrect password. Change reverted.');\n");
-    //chunk += F("    sel.value = prevNumChannels;\n");
-    //chunk += F("  }\n");
-    //chunk += F("}\n");
-    //chunk += F("</script>\n");
-    //// ...existing code...
-    chunk = F("<div class='section-title'>Calibration Factor</div>");
-    chunk += F("<div class='form-row'>Channel 1: <span style='font-weight:600;'>") + String(calib1, 2) + F("</span></div>");
-    if (numChannels == 2) {
-      chunk += F("<div class='form-row'>Channel 2: <span style='font-weight:600;'>") + String(calib2, 2) + F("</span></div>");
-    }
-    
-    // Notifications section
-    chunk += F("<div class='section-title'>Notifications</div>");
-    // NTFY Channel as read-only, default to MAC if empty
-    String ntfyDefault = mac;
-    chunk += F("<div class='form-row'><label for='ntfyChannel'>NTFY Channel:</label><input type='text' id='ntfyChannel' name='ntfyChannel' value='") + ntfyDefault + F("' readonly></div>");
-    chunk += F("<div class='form-row'>Events to Notify:</div>");
-    
-    chunk += F("<div class='checkbox-row'><input type='checkbox' id='notifyLowFert' name='notifyLowFert'") + String(notifyLowFert ? F(" checked") : F("")) + F("><label for='notifyLowFert'>Low Fertilizer Volume</label></div>");
-    chunk += F("<div class='checkbox-row'><input type='checkbox' id='notifyStart' name='notifyStart'") + String(notifyStart ? F(" checked") : F("")) + F("><label for='notifyStart'>System Start</label></div>");
-    chunk += F("<div class='checkbox-row'><input type='checkbox' id='notifyDose' name='notifyDose'") + String(notifyDose ? F(" checked") : F("")) + F("><label for='notifyDose'>Dose</label></div>");
-    
-    // LED Settings section
-    chunk += F("<div class='section-title'>LED Settings</div>");
-    chunk += F("<div class='form-row'><label for='ledBrightness'>LED Brightness:</label><input type='range' id='ledBrightness' name='ledBrightness' min='0' max='255' value='") + String(ledBrightness) + F("' style='width:100%;'><span id='ledBrightnessValue'>") + String(ledBrightness * 100 / 255) + F("%</span></div>");
-    chunk += F("<div class='form-row checkbox-row' style='display:flex;align-items:center;gap:10px;margin-bottom:8px;flex-wrap:nowrap;'>");
-    chunk += F("<label for='blinkAllOk' style='margin:0;white-space:nowrap;display:inline-block;vertical-align:middle;'>Power ON LED</label>");
-    chunk += F("<input type='checkbox' id='blinkAllOk' name='blinkAllOk' value='1' ") + String((blinkAllOk ? F("checked") : F(""))) + F("> <span>Yes</span>");
-    chunk += F("</div>");
-    chunk += F("<script>document.getElementById('ledBrightness').addEventListener('input',function(){document.getElementById('ledBrightnessValue').innerText=Math.round(this.value*100/255)+'%';});</script>");
-
-    // Buttons
-    chunk += F("<div class='btn-row'>");
-    chunk += F("<button type='submit' class='btn btn-main'>Save</button>");
-    chunk += F("<button type='button' class='btn btn-cancel' onclick=\"window.location.href='/summary'\">Cancel</button>");
-    chunk += F("</div></div></form>"); // Close main form and card
-
-    // Action buttons outside the main form
-    chunk += F("<div class='btn-row card-action-row' style='flex-direction:column;gap:4px;'>");
-    chunk += F("<form method='POST' action='/restart' style='width:100%;' onsubmit='return handleRestart(event)'><button id='restartBtn' type='submit' class='btn btn-main' style='width:100%;margin-bottom:0;'>Restart</button></form>");
-    chunk += F("<form method='POST' action='/wifiReset' style='width:100%;'><button type='submit' class='btn btn-danger' style='width:100%;margin-bottom:0;' onclick=\"return confirm('Reset WiFi settings? Device will reboot in AP mode.')\">WiFi Reset</button></form>");
-    chunk += F("<form method='POST' action='/factoryReset' style='width:100%;'><button type='submit' class='btn btn-danger' style='width:100%;margin-bottom:0;' onclick=\"return confirm('Factory reset will erase ALL data. Are you sure?')\">Factory Reset</button></form>");
-    chunk += F("<form style='width:100%;'><button type='button' class='btn btn-update' style='width:100%;margin-bottom:0;' onclick=\"showFirmwareUpdate()\">FW Update</button></form>");
-    chunk += F("</div>");
-    server.sendContent(chunk);
-    // Add JS for restart button
-    chunk = F("<script>\nfunction handleRestart(e) {\n  var btn = document.getElementById('restartBtn');\n  btn.disabled = true;\n  btn.innerText = 'Restarting..';\n  setTimeout(function() { window.location.href = '/summary'; }, 10000);\n  return true;\n}\n<\/script>");
-
-    // Update CSS for button consistency and centering
-    chunk += F("<style> ");
-    chunk += F(".btn-row.card-action-row { display: flex; justify-content: center; align-items: center; gap: 10px; max-width: 500px; margin: 0 auto 16px auto; } ");
-    chunk += F(".btn-row.card-action-row .btn { flex: unset; min-width: 120px; } ");
-    chunk += F(".btn { padding:12px 0; font-size:1.1em; border:none; border-radius:6px; cursor:pointer; transition:background 0.2s; min-width:120px; margin:0 4px 8px 0; } ");
-    chunk += F(".btn-main { background:#007BFF; color:#fff; } ");
-    chunk += F(".btn-cancel { background:#aaa; color:#fff; } ");
-    chunk += F(".btn-danger { background:#dc3545; color:#fff; } ");
-    chunk += F(".btn-update { background:#28a745; color:#fff; } ");
-    chunk += F(".btn-main:hover { background:#0056b3; } ");
-    chunk += F(".btn-cancel:hover { background:#888; } ");
-    chunk += F(".btn-danger:hover { background:#b30000; } ");
-    chunk += F(".btn-update:hover { background:#218838; } ");
-    chunk += F("</style>");
-
-    // Firmware update section
-    chunk += F("<div id='firmwareUpdateSection' style='display:none;margin-top:20px;'>");
-    chunk += F("<div class='card'>");
-    chunk += F("<h3>FW Update</h3>");
-    chunk += F("<div class='form-row'><label for='firmwareUrl'>Firmware URL:</label>");
-    chunk += F("<input type='text' id='firmwareUrl' value='https://arjunus1985.github.io/FWRoot/Doser/firmware.bin' style='width:100%;padding:10px;font-size:1.1em;border-radius:6px;border:1px solid #ccc;'></div>");
-    
-    chunk += F("<div class='btn-row'>");
-    chunk += F("<button type='button' class='btn btn-update' onclick=\"updateFirmware()\">Update</button>");
-    chunk += F("<button type='button' class='btn btn-cancel' onclick=\"hideFirmwareUpdate()\">Cancel</button>");
-    chunk += F("</div>");
-    
-    chunk += F("<div id='updateProgress' style='margin-top:10px;display:none;'>");
-    chunk += F("<div>Downloading firmware...</div>");
-    chunk += F("<div id='progressBar' style='width:100%;max-width:100%;background:#ddd;border-radius:6px;margin-top:5px;box-sizing:border-box;'>");
-    chunk += F("<div id='progressFill' style='width:0%;max-width:100%;height:20px;background:#007BFF;border-radius:6px;transition:width 0.3s;'></div>");
-    chunk += F("</div><div id='progressText'>0%</div></div></div></div>");
-    // Responsive style for progress bar
-    chunk += F("<style>@media (max-width:600px){#progressBar{width:100% !important;max-width:100% !important;}#progressFill{max-width:100% !important;}}</style>");
-
-    // JavaScript in smaller chunks
-    chunk += F("<script>");
-    chunk += F("function showFirmwareUpdate() {");
-    chunk += F("  document.getElementById('firmwareUpdateSection').style.display = 'block';");
-    chunk += F("}");
-    chunk += F("function hideFirmwareUpdate() {");
-    chunk += F("  document.getElementById('firmwareUpdateSection').style.display = 'none';");
-    chunk += F("  document.getElementById('updateProgress').style.display = 'none';");
-    chunk += F("}");
-    chunk += F("async function updateFirmware() {");
-    chunk += F("  const url = document.getElementById('firmwareUrl').value;");
-    chunk += F("  if (!url) { alert('Please enter firmware URL'); return; }");
-    chunk += F("  document.getElementById('updateProgress').style.display = 'block';");
-    chunk += F("  const progressFill = document.getElementById('progressFill');");
-    chunk += F("  const progressText = document.getElementById('progressText');");
-    chunk += F("  try {");
-    chunk += F("    const response = await fetch(url);");
-    chunk += F("    if (!response.ok) throw new Error('Failed to download firmware');");
-    chunk += F("    const total = parseInt(response.headers.get('content-length') || '0');");
-    chunk += F("    const reader = response.body.getReader();");
-    chunk += F("    const chunks = []; let loaded = 0;");
-    
-    chunk += F("    while (true) {");
-    chunk += F("      const { done, value } = await reader.read();");
-    chunk += F("      if (done) break;");
-    chunk += F("      chunks.push(value); loaded += value.length;");
-    chunk += F("      if (total) {");
-    chunk += F("        const progress = (loaded / total) * 100;");
-    chunk += F("        progressFill.style.width = progress + '%';");
-    chunk += F("        progressText.textContent = Math.round(progress) + '%';");
-    chunk += F("      }}");
-    
-    chunk += F("    const firmwareData = new Uint8Array(loaded);");
-    chunk += F("    let offset = 0;");
-    chunk += F("    for (const chunk of chunks) {");
-    chunk += F("      firmwareData.set(chunk, offset); offset += chunk.length;");
-    chunk += F("    }");
-    chunk += F("    progressText.textContent = 'Flashing firmware...';");
-    chunk += F("    const formData = new FormData();");
-    chunk += F("    formData.append('firmware', new Blob([firmwareData]), 'firmware.bin');");
-    
-    chunk += F("    const uploadResponse = await fetch('/update', {");
-    chunk += F("      method: 'POST', body: formData");
-    chunk += F("    });");
-    chunk += F("    if (uploadResponse.ok) {");
-    chunk += F("      progressText.textContent = 'Firmware updated successfully! Device will restart...';");
-    chunk += F("      setTimeout(() => { window.location.href = '/summary'; }, 3000);");
-    chunk += F("    } else { throw new Error('Failed to flash firmware'); }");
-    
-    chunk += F("  } catch (error) {");
-    chunk += F("    alert('Firmware update failed: ' + error.message);");
-    chunk += F("    hideFirmwareUpdate();");
-    chunk += F("  }");
-    chunk += F("}");
-    chunk += F("</script>");
-
-    // Footer
-    chunk += generateFooter();
-    chunk += F("</body></html>");
-    server.sendContent(chunk);
-    
-    // End chunked response
-    server.sendContent("");
+      return true;
+    });
   });
 
-  server.on("/restart", HTTP_POST, handleRestartOnly);
-  server.on("/wifiReset", HTTP_POST, handleWiFiReset);
-  server.on("/factoryReset", HTTP_POST, handleFactoryReset);
-  server.on("/systemSettings", HTTP_POST, handleSystemSettingsSave);
+  onRoute("/restart", HTTP_POST, handleRestartOnly);
+  onRoute("/wifiReset", HTTP_POST, handleWiFiReset);
+  onRoute("/factoryReset", HTTP_POST, handleFactoryReset);
+  onRoute("/systemSettings", HTTP_POST, handleSystemSettingsSave);
+
+  // Versioned JSON API for monitoring
+  onRoute("/api/v1/status", HTTP_GET, handleApiStatus);
+  onRoute("/api/v1/channels", HTTP_GET, handleApiChannels);
+  onRoute("/api/v1/schedules", HTTP_GET, handleApiSchedules);
+  onRoute("/api/v1/history", HTTP_GET, handleApiHistory);
+  onRoute("/api/v1/settings", HTTP_GET, handleApiSettings);
+  onRoute("/api/v1/state", HTTP_GET, handleApiState);
+  onRoute("/api/v1/dose", HTTP_POST, handleManualDispense);
+  onRoute("/api/v1/boot", HTTP_GET, handleApiBoot);
+#if LOOP_PROFILER
+  onRoute("/api/v1/profile", HTTP_GET, handleApiProfile);
+#endif
+  // Prometheus scrape target
+  onRoute("/metrics", HTTP_GET, handleMetrics);
+
+  // Shared CSS/JS for all pages
+  static const char* staticAssetHeaders[] = {"If-None-Match"};
+  server.collectHeaders(staticAssetHeaders, 1);
+  onRoute(WEB_APP_CSS_PATH, HTTP_GET, []() {
+    serveStaticAsset(WEB_APP_CSS_TYPE, WEB_APP_CSS_ETAG, WEB_APP_CSS_GZ, WEB_APP_CSS_GZ_LEN);
+  });
+  onRoute(WEB_APP_JS_PATH, HTTP_GET, []() {
+    serveStaticAsset(WEB_APP_JS_TYPE, WEB_APP_JS_ETAG, WEB_APP_JS_GZ, WEB_APP_JS_GZ_LEN);
+  });
 
   // Root access should redirect to summary
-  server.on("/", HTTP_GET, []() {
+  onRoute("/", HTTP_GET, []() {
     server.sendHeader("Location", "/summary");
     server.send(302, "text/plain", "");
   });
 
-  server.on("/update", HTTP_POST, []() {
-    server.send(200, "text/plain", F("OK"));
-    delay(100);
-    ESP.restart();
-  }, handleFirmwareUpdate);
+  onRoute("/update", HTTP_POST, handleFirmwareUploaded, handleFirmwareUpdate);
+  onRoute("/api/v1/firmware", HTTP_GET, handleApiFirmware);
+  onRoute("/api/v1/firmware/pull", HTTP_POST, handleFirmwarePull);
 
   server.begin();
 }
 
 void handleCalibration() {
-  if (server.hasArg("channel")) {
+  if (server.hasArg("channel") && isValidChannel(server.arg("channel").toInt())) {
     int channel = server.arg("channel").toInt();
+    Channel& c = getChannel(channel);
     
     // If we have the dispensed amount, complete calibration
     if (server.hasArg("dispensedML")) {
       float dispensedML = server.arg("dispensedML").toFloat();
-      float &calibrationFactor = (channel == 1) ? calibrationFactor1 : calibrationFactor2;
-      calibrationFactor = calibrationTimeMs / dispensedML;
-if (channel == 1) calibratedChannel1 = true;
-      if (channel == 2) calibratedChannel2 = true;
-      savePersistentDataToSPIFFS();
+      if (dispensedML <= 0.0f) {
+        server.send(400, "application/json", F("{\"error\":\"invalid volume\"}"));
+        return;
+      }
+      c.calibrationFactor = calibrationTimeMs / dispensedML;
+      doseLogAppend(channel, dispensedML, DOSE_SOURCE_CALIBRATION, calibrationTimeMs);
+      c.calibrated = true;
+      markPersistentDataDirty();
       // Show toast and redirect to channel management
-      String html = F("<html><head><meta http-equiv='refresh' content='2;url=/manageChannel?channel=") + String(channel) + F("'>");
-      html += F("<meta name='viewport' content='width=device-width, initial-scale=1.0'>");
-      html += F("<style>.toast{position:fixed;top:30px;left:50%;transform:translateX(-50%);background:#28a745;color:#fff;padding:18px 32px;border-radius:8px;font-size:1.2em;box-shadow:0 2px 8px rgba(0,0,0,0.15);z-index:9999;}</style>");
-      html += F("</head><body>");
-      html += F("<div class='toast'>Calibration complete!</div>");
-      html += F("<script>setTimeout(function(){window.location.href='/manageChannel?channel=") + String(channel) + F("';},1800);</script>");
-      html += F("</body></html>");
-      server.send(200, "text/html", html);
+      sendPage(CALIBRATE_DONE_HTML, [&](Print& out, const char* slot) {
+        if (slotIs(slot, F("title"))) {
+          out.print(F("Calibration Complete"));
+        } else if (slotIs(slot, F("pageClass"))) {
+          out.print(F("pg-calibrate"));
+        } else if (slotIs(slot, F("channel"))) {
+          out.print(channel);
+        } else {
+          return false;
+        }
+        return true;
+      });
       return;
     }
     
     // First phase - run the motor and show input form
-    if (channel == 1 || channel == 2) {
-      // Run motor for calibrationTimeMs
-      runMotor(channel, calibrationTimeMs);
-      
-      // Show form to input dispensed amount
-      String html = F("");
-      
-      html += F("<meta name='viewport' content='width=device-width, initial-scale=1.0'>");
-      html += F("<style>body{font-family:Arial,sans-serif;background:#f4f4f9;color:#333;} .card{margin:20px auto;padding:20px;max-width:500px;background:#fff;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.1);} .card h2{margin-top:0;color:#007BFF;} .calib-label{font-size:1.1em;margin-bottom:8px;display:block;} .calib-input{width:100%;padding:10px;font-size:1.1em;border-radius:6px;border:1px solid #ccc;margin-bottom:16px;} .calib-submit{width:100%;padding:14px 0;font-size:1.1em;background:#007BFF;color:#fff;border:none;border-radius:6px;cursor:pointer;} .home-btn{width:100%;padding:12px 0;font-size:1.1em;background:#007BFF;color:#fff;border:none;border-radius:6px;} .back-btn{width:100%;padding:12px 0;font-size:1.1em;background:#aaa;color:#fff;border:none;border-radius:6px;margin-top:10px;} .card button, .card-btn, .dispense-btn, .calib-btn, .prime-btn, .home-btn, .back-btn, .rename-btn, button.cancel { transition: background 0.2s; } .card button:hover, .card-btn:hover, .dispense-btn:hover, .calib-btn:hover, .prime-btn:hover, .home-btn:hover, .rename-btn:hover { background-color: #0056b3 !important; } .prime-btn.stop:hover { background-color: #218838 !important; } .rename-btn.cancel:hover, button.cancel:hover, .back-btn:hover { background-color: #888 !important; }</style>");
-      html += F("</head><body>");
-      html += generateHeader("Calibration Measurement");
-      html += F("<div class='card'>");
-     // html += "<h2>Calibration Measurement</h2>";
-      html += F("<p style='margin-bottom:18px;'>Motor has run for 15 seconds. Please measure the dispensed liquid and enter the amount below:</p>");
-      html += F("<form action='/calibrate' method='POST'>");
-      html += F("<input type='hidden' name='channel' value='") + String(channel) + F("'>");
-      html += F("<label for='dispensedML' class='calib-label'>Amount dispensed (ml):</label>");
-      html += F("<input type='number' name='dispensedML' step='0.1' required class='calib-input'><br>");
-      html += F("<button type='submit' class='calib-submit'>Submit Measurement</button>");
-      html += F("</form>");
-      html += F("<button class='home-btn' onclick=\"window.location.href='/summary'\">Home</button>");
-      html += F("<button class='back-btn' onclick=\"history.back()\">Back</button>");
-      html += F("</div>");
-      html += generateFooter();
-      html += F("</body></html>");
-      server.send(200, "text/html", html);
+    // Start motor for calibrationTimeMs, the page is served while it runs.
+    // The page times the run, so it has to start now rather than wait its turn.
+    if (!motorFree(channel) || !runMotor(channel, calibrationTimeMs)) {
+      server.send(503, "application/json", F("{\"error\":\"pump busy\"}"));
       return;
     }
+    
+    // Show form to input dispensed amount
+    sendPage(CALIBRATE_RUNNING_HTML, [&](Print& out, const char* slot) {
+      if (slotIs(slot, F("title")) || slotIs(slot, F("heading"))) {
+        out.print(F("Calibration Measurement"));
+      } else if (slotIs(slot, F("pageClass"))) {
+        out.print(F("pg-calibrate"));
+      } else if (slotIs(slot, F("seconds"))) {
+        out.print(calibrationTimeMs / 1000);
+      } else if (slotIs(slot, F("channel"))) {
+        out.print(channel);
+      } else {
+        return false;
+      }
+      return true;
+    });
+    return;
   }
   
   server.send(400, "application/json", F("{\"error\":\"missing or invalid parameters\"}"));
@@ -1748,51 +2339,52 @@ if (channel == 1) calibratedChannel1 = true;
 
 
 
+// Queue a manual dose and account for it. Returns false if the pump queue is full.
+bool dispenseManualDose(int channel, float ml) {
+  Channel& c = getChannel(channel);
+
+  // Calculate dispense time (calibrationFactor is already in ms/mL)
+  int dispenseTime = ml * c.calibrationFactor;
+
+  // Queue motor run through central function, it returns immediately
+  if (!runMotor(channel, dispenseTime)) return false;
+
+  // Update ML and publish
+  doseLogAppend(channel, ml, DOSE_SOURCE_MANUAL, dispenseTime);
+  counterDose(channel, ml, dispenseTime, false); // Remaining, last dispensed volume and time
+  Serial.print(F("[MANUAL DOSE] Channel ")); Serial.print(channel);
+  Serial.print(F(" lastDispensedVolume set: ")); Serial.print(c.lastDispensedVolume);
+  Serial.print(F(", lastDispensedTime set: ")); Serial.println(c.lastDispensedTime);
+  updateDaysRemaining(channel);
+
+  // After dosing, send notifications if enabled
+  // Use global notification variables instead of reading from form arguments
+  int daysLeft = calculateDaysRemaining(channel);
+
+  if (notifyLowFert && daysLeft <= 7) {
+    String msg = "Running low on " + c.name + " Refill!!";
+    sendNtfyNotification("Low Fertilizer Alert", msg);
+  }
+  return true;
+}
+
 void handleManualDispense() {
   if (server.hasArg("channel") && server.hasArg("ml")) {
     int channel = server.arg("channel").toInt();
     float ml = server.arg("ml").toFloat();
-    float calibrationFactor = (channel == 1) ? calibrationFactor1 : calibrationFactor2;
-
-    // Calculate dispense time (calibrationFactor is already in ms/mL)
-    int dispenseTime = ml * calibrationFactor;
-    
-    // Run motor through central function
-    runMotor(channel, dispenseTime);
-    
-    // Update ML and publish
-    updateRemainingML(channel, ml);
-   
-
-    // Update last dispensed volume and time for the channel
-    if (channel == 1) {
-      lastDispensedVolume1 = ml;
-      lastDispensedTime1 = getFormattedTime();
-      Serial.print(F("[MANUAL DOSE] lastDispensedVolume1 set: ")); Serial.println(lastDispensedVolume1);
-      Serial.print(F("[MANUAL DOSE] lastDispensedTime1 set: ")); Serial.println(lastDispensedTime1);
-    } else if (channel == 2) {
-      lastDispensedVolume2 = ml;
-      lastDispensedTime2 = getFormattedTime();
-      Serial.print(F("[MANUAL DOSE] lastDispensedVolume2 set: ")); Serial.println(lastDispensedVolume2);
-      Serial.print(F("[MANUAL DOSE] lastDispensedTime2 set: ")); Serial.println(lastDispensedTime2);
-    }
-    updateDaysRemaining(channel, (channel == 1) ? remainingMLChannel1 : remainingMLChannel2, (channel == 1) ? &weeklySchedule1 : &weeklySchedule2);
-    savePersistentDataToSPIFFS();
-    Serial.println(F("[MANUAL DOSE] savePersistentDataToSPIFFS called"));
-
-    // After dosing, send notifications if enabled
-    // Use global notification variables instead of reading from form arguments
-    String chName = (channel == 1) ? channel1Name : channel2Name;
-    float remML = (channel == 1) ? remainingMLChannel1 : remainingMLChannel2;
-    WeeklySchedule* ws = (channel == 1) ? &weeklySchedule1 : &weeklySchedule2;
-    int daysLeft = calculateDaysRemaining(remML, ws);
-    
-    if (notifyLowFert && daysLeft <= 7) {
-      String msg = "Running low on " + chName + " Refill!!";
-      sendNtfyNotification("Low Fertilizer Alert", msg);
+    if (!isValidChannel(channel)) {
+      server.send(400, "application/json", F("{\"error\":\"invalid channel\"}"));
+      return;
     }
-
-    server.send(200, "application/json", F("{\"status\":\"dispensed\"}"));
+    if (ml <= 0.0f) {
+      server.send(400, "application/json", F("{\"error\":\"invalid volume\"}"));
+      return;
+    }
+    if (!dispenseManualDose(channel, ml)) {
+      server.send(503, "application/json", F("{\"error\":\"pump busy\"}"));
+      return;
+    }
+    server.send(200, "application/json", F("{\"status\":\"dispensing\"}"));
   } else {
     server.send(400, "application/json", F("{\"error\":\"missing parameters\"}"));
   }
@@ -1800,296 +2392,1062 @@ void handleManualDispense() {
 
 
 
-void checkDailyDispense() {
-  timeClient.update();
-  int today = (timeClient.getDay() + 6) % 7; // 0=Monday, 6=Sunday
-  int nowHour = timeClient.getHours();
-  int nowMinute = timeClient.getMinutes();
-  time_t epochTime = timeClient.getEpochTime();
-  struct tm *ptm = gmtime((time_t *)&epochTime);
-  int todayYear = ptm->tm_year + 1900;
-  int todayMonth = ptm->tm_mon + 1;
-  int todayDay = ptm->tm_mday;
-  String todayStr = String(todayDay) + "-" + String(todayMonth) + "-" + String(todayYear);
-
-  // Reset scheduledDoseCompleted flags at midnight - REMOVED: No longer needed with timestamp approach
-
-  // Channel 1
-  bool missed1 = false;
-  if (weeklySchedule1.days[today].enabled) {
-    int schedHour = weeklySchedule1.days[today].hour;
-    int schedMinute = weeklySchedule1.days[today].minute;
-    float dose = weeklySchedule1.days[today].volume;
-    bool timePast = (nowHour > schedHour) || (nowHour == schedHour && nowMinute > schedMinute);
-   // bool notDosedToday = (lastDispensedTime1.indexOf(String(todayYear)) == -1 || lastDispensedTime1.indexOf(String(todayMonth)) == -1 || lastDispensedTime1.indexOf(String(todayDay)) == -1);
-    if (weeklySchedule1.missedDoseCompensation && timePast && !isToday(lastScheduledDoseTime1) && dose > 0.0f && lastScheduledDoseTime1 != jan1_2025_epoch) {
-      missed1 = true;
-      int dispenseTime = (int)(dose * calibrationFactor1);
-      runMotor(1, dispenseTime);
-      updateRemainingML(1, dose);
-      lastDispensedVolume1 = dose;
-      lastDispensedTime1 = getFormattedTime();
-      lastScheduledDoseTime1 = timeClient.getEpochTime();
-      savePersistentDataToSPIFFS();
-      Serial.print(F("[MISSED DOSE COMPENSATION] Channel 1: Dispensed ")); Serial.print(dose); Serial.println(F(" ml"));
-      if (notifyDose) {
-        String msg = String(F("Missed scheduled dose given on ")) + channel1Name + F(". Remaining: ") + String(remainingMLChannel1) + F("ml, Days left: ") + String(calculateDaysRemaining(remainingMLChannel1, &weeklySchedule1));
-        sendNtfyNotification(F("Dose Notification"), msg);
-      }
-      if (notifyLowFert && calculateDaysRemaining(remainingMLChannel1, &weeklySchedule1) <= 7) {
-        String msg = String(F("Low fertilizer on ")) + channel1Name + F(" Refill!!");
-        sendNtfyNotification(F("Low Fertilizer Alert"), msg);
-      }
-    }
+// Queue one scheduled (or compensating) dose. Returns false if the pump queue is full.
+bool dispenseScheduledDose(int channel, float dose, bool missed, uint32_t scheduledEpoch) {
+  Channel& c = getChannel(channel);
+  int dispenseTime = (int)(dose * c.calibrationFactor); // ms
+  if (!runMotor(channel, dispenseTime, scheduledEpoch)) return false;
+  doseLogAppend(channel, dose, missed ? DOSE_SOURCE_MISSED : DOSE_SOURCE_SCHEDULED, dispenseTime);
+  counterDose(channel, dose, dispenseTime, true);
+  updateDaysRemaining(channel);
+  Serial.print(missed ? F("[MISSED DOSE COMPENSATION] Channel ") : F("[SCHEDULED DOSE] Channel "));
+  Serial.print(channel); Serial.print(F(": Dispensed ")); Serial.print(dose); Serial.println(F(" ml"));
+  if (notifyDose) {
+    String msg = String(missed ? F("Missed scheduled dose given on ") : F("Scheduled dose given on ")) + c.name + F(". Remaining: ") + String(c.remainingML) + F("ml, Days left: ") + String(c.daysRemaining);
+    sendNtfyNotification(F("Dose Notification"), msg);
   }
+  if (notifyLowFert && c.daysRemaining <= 7) {
+    String msg = String(F("Low fertilizer on ")) + c.name + F(" Refill!!");
+    sendNtfyNotification(F("Low Fertilizer Alert"), msg);
+  }
+  return true;
+}
 
-  // Channel 2
-  bool missed2 = false;
-  if (weeklySchedule2.days[today].enabled) {
-    int schedHour = weeklySchedule2.days[today].hour;
-    int schedMinute = weeklySchedule2.days[today].minute;
-    float dose = weeklySchedule2.days[today].volume;
-    bool timePast = (nowHour > schedHour) || (nowHour == schedHour && nowMinute > schedMinute);
-    //bool notDosedToday = (lastDispensedTime2.indexOf(String(todayYear)) == -1 || lastDispensedTime2.indexOf(String(todayMonth)) == -1 || lastDispensedTime2.indexOf(String(todayDay)) == -1);
-    if (weeklySchedule2.missedDoseCompensation && timePast && !isToday(lastScheduledDoseTime2) && dose > 0.0f && lastScheduledDoseTime2 != jan1_2025_epoch) {
-      missed2 = true;
-      int dispenseTime = (int)(dose * calibrationFactor2);
-      runMotor(2, dispenseTime);
-      updateRemainingML(2, dose);
-      lastDispensedVolume2 = dose;
-      lastDispensedTime2 = getFormattedTime();
-      lastScheduledDoseTime2 = timeClient.getEpochTime();
-      savePersistentDataToSPIFFS();
-      Serial.print(F("[MISSED DOSE COMPENSATION] Channel 2: Dispensed ")); Serial.print(dose); Serial.println(F(" ml"));
-      if (notifyDose) {
-        String msg = String(F("Missed scheduled dose given on ")) + channel2Name + F(". Remaining: ") + String(remainingMLChannel2) + F("ml, Days left: ") + String(calculateDaysRemaining(remainingMLChannel2, &weeklySchedule2));
-        sendNtfyNotification(F("Dose Notification"), msg);
-      }
-      if (notifyLowFert && calculateDaysRemaining(remainingMLChannel2, &weeklySchedule2) <= 7) {
-        String msg = String(F("Low fertilizer on ")) + channel2Name + F(" Refill!!");
-        sendNtfyNotification(F("Low Fertilizer Alert"), msg);
-      }
-    }
+// --- Dose scheduler ---
+// Each channel's next due time (local epoch) sits in a small min-heap. loop()
+// only compares the clock with the head; the heap is rebuilt when a schedule,
+// the timezone or the clock changes.
+struct ScheduledDose {
+  uint32_t due;
+  int channel;
+};
+
+ScheduledDose doseHeap[MAX_CHANNELS];
+int doseHeapSize = 0;
+bool doseScheduleDirty = true;
+unsigned long schedulerRetryAt = 0;
+unsigned long schedulerRebuilds = 0;
+
+// Call after changing a schedule, the timezone or the clock
+void rescheduleDoses() {
+  doseScheduleDirty = true;
+}
+
+void doseHeapPush(const ScheduledDose& d) {
+  int i = doseHeapSize++;
+  while (i > 0 && doseHeap[(i - 1) / 2].due > d.due) {
+    doseHeap[i] = doseHeap[(i - 1) / 2];
+    i = (i - 1) / 2;
   }
+  doseHeap[i] = d;
+}
 
-  // ...existing scheduled dosing logic (do not double dose if missed dose already handled)...
-  if (!missed1 && weeklySchedule1.days[today].enabled && weeklySchedule1.days[today].hour == nowHour && weeklySchedule1.days[today].minute == nowMinute && !isToday(lastScheduledDoseTime1)) {
-    float dose = weeklySchedule1.days[today].volume;
-    if (dose > 0.0f ) {
-      int dispenseTime = (int)(dose * calibrationFactor1); // ms
-      runMotor(1, dispenseTime);
-      updateRemainingML(1, dose);
-      lastDispensedVolume1 = dose;
-      lastDispensedTime1 = getFormattedTime();
-      lastScheduledDoseTime1 = timeClient.getEpochTime();
-      savePersistentDataToSPIFFS();
-      Serial.print(F("[SCHEDULED DOSE] Channel 1: Dispensed ")); Serial.print(dose); Serial.println(F(" ml"));
-      if (notifyDose) {
-        String msg = String(F("Scheduled dose given on ")) + channel1Name + F(". Remaining: ") + String(remainingMLChannel1) + F("ml, Days left: ") + String(calculateDaysRemaining(remainingMLChannel1, &weeklySchedule1));
-        sendNtfyNotification(F("Dose Notification"), msg);
-      }
-      if (notifyLowFert && calculateDaysRemaining(remainingMLChannel1, &weeklySchedule1) <= 7) {
-        String msg = String(F("Low fertilizer on ")) + channel1Name + F(" Refill!!");
-        sendNtfyNotification(F("Low Fertilizer Alert"), msg);
-      }
+void doseHeapPop() {
+  ScheduledDose last = doseHeap[--doseHeapSize];
+  int i = 0;
+  while (true) {
+    int child = 2 * i + 1;
+    if (child >= doseHeapSize) break;
+    if (child + 1 < doseHeapSize && doseHeap[child + 1].due < doseHeap[child].due) child++;
+    if (doseHeap[child].due >= last.due) break;
+    doseHeap[i] = doseHeap[child];
+    i = child;
+  }
+  if (doseHeapSize > 0) doseHeap[i] = last;
+}
+
+// jan1_2025_epoch marks a channel never dosed on schedule, nothing to make up
+bool compensatesMissedDose(const Channel& c) {
+  return c.schedule.missedDoseCompensation && c.lastScheduledDoseTime != jan1_2025_epoch;
+}
+
+// Next time this channel needs a scheduled dose, 0 if it has none. Today's dose
+// counts until its minute is over, or until it is given when missed-dose
+// compensation is on.
+uint32_t nextDoseDue(int channel, uint32_t now) {
+  const Channel& c = getChannel(channel);
+  uint32_t midnight = now - now % 86400UL;
+  int today = weekdayOf(now);
+  bool compensate = compensatesMissedDose(c);
+  for (int offset = 0; offset <= 7; ++offset) {
+    const DaySchedule& day = c.schedule.days[(today + offset) % 7];
+    if (!day.enabled || day.volume <= 0.0f) continue;
+    uint32_t due = midnight + offset * 86400UL + day.hour * 3600UL + day.minute * 60UL;
+    if (offset == 0) {
+      if (isToday(c.lastScheduledDoseTime)) continue;
+      if (now >= due + 60 && !compensate) continue;
     }
+    return due;
   }
-  if (!missed2 && weeklySchedule2.days[today].enabled && weeklySchedule2.days[today].hour == nowHour && weeklySchedule2.days[today].minute == nowMinute && !isToday(lastScheduledDoseTime2)) {
-    float dose = weeklySchedule2.days[today].volume;
-    if (dose > 0.0f ) {
-      int dispenseTime = (int)(dose * calibrationFactor2); // ms
-      runMotor(2, dispenseTime);
-      updateRemainingML(2, dose);
-      lastDispensedVolume2 = dose;
-      lastDispensedTime2 = getFormattedTime();
-      lastScheduledDoseTime2 = timeClient.getEpochTime();
-      savePersistentDataToSPIFFS();
-      Serial.print(F("[SCHEDULED DOSE] Channel 2: Dispensed ")); Serial.print(dose); Serial.println(F(" ml"));
-      if (notifyDose) {
-        String msg = String(F("Scheduled dose given on ")) + channel2Name + F(". Remaining: ") + String(remainingMLChannel2) + F("ml, Days left: ") + String(calculateDaysRemaining(remainingMLChannel2, &weeklySchedule2));
-        sendNtfyNotification(F("Dose Notification"), msg);
-      }
-      if (notifyLowFert && calculateDaysRemaining(remainingMLChannel2, &weeklySchedule2) <= 7) {
-        String msg = String(F("Low fertilizer on ")) + channel2Name + F(" Refill!!");
-        sendNtfyNotification(F("Low Fertilizer Alert"), msg);
+  return 0;
+}
+
+void rebuildDoseSchedule(uint32_t now) {
+  doseHeapSize = 0;
+  for (int channel = 1; channel <= numChannels; channel++) {
+    uint32_t due = nextDoseDue(channel, now);
+    if (due != 0) doseHeapPush({due, channel});
+  }
+  doseScheduleDirty = false;
+  schedulerRebuilds++;
+}
+
+// Called from loop(): start the head dose once it is due
+void serviceDoseScheduler() {
+  if (!timeSynced && !clockEstimated) return; // No schedule against a clock that was never set
+  unsigned long nowMs = millis();
+  uint32_t now = clockNow();
+  if (doseScheduleDirty) rebuildDoseSchedule(now);
+
+  // Channels due at the same time are queued together and run side by side
+  while (doseHeapSize > 0 && doseHeap[0].due <= now) {
+    if (schedulerRetryAt != 0 && (long)(nowMs - schedulerRetryAt) < 0) return;
+    schedulerRetryAt = 0;
+    ScheduledDose head = doseHeap[0];
+    const Channel& c = getChannel(head.channel);
+    float volume = c.schedule.days[weekdayOf(head.due)].volume;
+    bool missed = now >= head.due + 60;
+    if (!missed || compensatesMissedDose(c)) {
+      // A missed dose is late by design, so no start latency is recorded
+      if (!dispenseScheduledDose(head.channel, volume, missed, missed ? 0 : head.due)) {
+        schedulerRetryAt = nowMs + 1000; // Pump queue full
+        return;
       }
     }
+    doseHeapPop();
+    uint32_t due = nextDoseDue(head.channel, now);
+    if (due != 0) doseHeapPush({due, head.channel});
   }
 }
 
+// Clock restarts from the checkpoint; loop() syncs it once the network is up
 void setupTimeSync() {
-  timeClient.begin();
-  timeClient.setTimeOffset(timezoneOffset);
-  Serial.println(F("Syncing time..."));
-  
-  int retries = 0;
-  while (!timeClient.update() && retries < 10) {
-    timeClient.forceUpdate();
-    retries++;
-    delay(500);
-  }
-  
-  if (retries >= 10) {
-    Serial.println(F("Time sync failed!"));
+  clockBegin();
+  uint32_t saved = clockLoadCheckpoint();
+  if (snapshotClockUtcMs != 0) {
+    // Restarted on purpose a moment ago: carry on, drift estimate and all
+    clockAnchorUtcMs = snapshotClockUtcMs + clockAnchorMono;
+    clockDriftPpm = snapshotDriftPpm;
+    clockEstimated = true;
+    snapshotClockUtcMs = 0;
+    Serial.println(F("[CLOCK] Running on from before the restart: ") + getFormattedTime());
+  } else if (saved != 0) {
+    clockAnchorUtcMs = (uint64_t)saved * 1000ULL;
+    clockEstimated = true;
+    Serial.println(F("[CLOCK] Running from the last saved time: ") + getFormattedTime());
   } else {
-    //set global flag
-    timeSynced = true;
-    Serial.println(F("Time synced successfully"));
-    Serial.println(F("Current time: ") + getFormattedTime());
+    Serial.println(F("[CLOCK] No saved time, waiting for NTP"));
   }
 }
 
+// --- Persistent state ---
+// Settings, channel state and schedules are one packed binary record, written
+// alternately to two slot files:
+//   magic u32, format u16, seq u32, fields..., CRC-32 u32
+// with the CRC over everything before it. Boot takes the valid slot with the
+// higher seq, so a write cut short by a power loss leaves the previous record
+// to fall back on. Numbers are little endian, strings a u8 length and the
+// bytes. New fields go at the end; in an older record they read as unchanged.
+// STATE_FORMAT only changes if existing fields change meaning.
+#define STATE_MAGIC 0x52534F44UL // "DOSR"
+#define STATE_FORMAT 1
+const char* const STATE_SLOT_PATHS[2] = {"/state0.bin", "/state1.bin"};
+const size_t STATE_HEADER_SIZE = 10;
+const size_t STATE_MAX_SIZE = 4096;
+// Written by firmware before the binary record, migrated on first boot
+#define LEGACY_DATA_PATH "/data.json"
+#define LEGACY_SCHEDULES_PATH "/weekly_schedules.json"
 #define JSON_BUFFER_SIZE 1024
 
-// JSON handling functions updated to use JsonDocument
-void loadPersistentDataFromSPIFFS() {
-  File file = LittleFS.open("/data.json", "r");
-  if (!file) {
-    Serial.println(F("Failed to open file for reading"));
-    return;
-  }
-
-  DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-  DeserializationError error = deserializeJson(doc, file);
-  if (error) {
-    Serial.println(F("Failed to parse JSON"));
-    return;
-  }
-
-  // Load channel names
-  channel1Name = doc["name1"] | "Channel 1";
-  channel2Name = doc["name2"] | "Channel 2";
+int stateSlot = -1;    // Slot holding the current record, -1 if none yet
+uint32_t stateSeq = 0;
+size_t stateBytes = 0; // Size of the current record
+unsigned long stateLoadUs = 0;
+unsigned long stateWriteFailures = 0;
 
-  // Load remaining ML values
-  remainingMLChannel1 = doc["channel1"].as<float>();
-  remainingMLChannel2 = doc["channel2"].as<float>();
-  timezoneOffset = doc["timezone"] | 19800;  // Default to UTC if not set
+static void putU32(uint8_t* p, uint32_t v) {
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
 
-  // Load calibration factors
-  calibrationFactor1 = doc["calibration1"] | 1.0f;  // Default to 1 if not set
-  calibrationFactor2 = doc["calibration2"] | 1.0f;  // Default to 1 if not set
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
 
-  // Load last dispensed volume and time
-  lastDispensedVolume1 = doc["lastDispensedVolume1"] | 0.0f;
-  lastDispensedTime1 = doc["lastDispensedTime1"] | "N/A";
-  lastDispensedVolume2 = doc["lastDispensedVolume2"] | 0.0f;
-  lastDispensedTime2 = doc["lastDispensedTime2"] | "N/A";
+// CRC-8 (polynomial 0x07) for small fixed records
+uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
 
-  // Load device name
-  deviceName = doc["deviceName"] | "";
+// CRC-32 (IEEE), continued from a previous call's result; start with 0
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
 
-  // Load notification settings
-  notifyLowFert = doc["notifyLowFert"] | true;
+// Streams a record into a slot file through a small buffer, keeping its CRC
+class StateWriter {
+public:
+  explicit StateWriter(File& file) : _file(file) {}
+  void u8(uint8_t v) { bytes(&v, 1); }
+  void u16(uint16_t v) {
+    uint8_t b[2] = {(uint8_t)v, (uint8_t)(v >> 8)};
+    bytes(b, 2);
+  }
+  void u32(uint32_t v) {
+    uint8_t b[4];
+    putU32(b, v);
+    bytes(b, 4);
+  }
+  void f32(float v) {
+    uint32_t u;
+    memcpy(&u, &v, 4);
+    u32(u);
+  }
+  void str(const String& s) {
+    size_t n = s.length() > 255 ? 255 : s.length();
+    u8(n);
+    bytes(s.c_str(), n);
+  }
+  // Append the CRC; false if any of the record failed to write
+  bool finish() {
+    uint8_t b[4];
+    putU32(b, _crc);
+    flush();
+    if (_file.write(b, 4) != 4) _ok = false;
+    _size += 4;
+    return _ok;
+  }
+  size_t size() const { return _size; }
+
+private:
+  void bytes(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    _crc = crc32Update(_crc, p, len);
+    _size += len;
+    while (len > 0) {
+      size_t n = sizeof(_buf) - _used;
+      if (n > len) n = len;
+      memcpy(_buf + _used, p, n);
+      _used += n;
+      p += n;
+      len -= n;
+      if (_used == sizeof(_buf)) flush();
+    }
+  }
+  void flush() {
+    if (_used > 0 && _file.write(_buf, _used) != _used) _ok = false;
+    _used = 0;
+  }
+
+  File& _file;
+  uint8_t _buf[128];
+  size_t _used = 0;
+  size_t _size = 0;
+  uint32_t _crc = 0;
+  bool _ok = true;
+};
+
+// Reads fields back from a checked record. Past its end a field keeps the
+// value passed in.
+class StateReader {
+public:
+  StateReader(File& file, size_t left) : _file(file), _left(left) {}
+  uint8_t u8(uint8_t v) {
+    uint8_t b;
+    return bytes(&b, 1) ? b : v;
+  }
+  uint16_t u16(uint16_t v) {
+    uint8_t b[2];
+    return bytes(b, 2) ? (uint16_t)(b[0] | (b[1] << 8)) : v;
+  }
+  uint32_t u32(uint32_t v) {
+    uint8_t b[4];
+    return bytes(b, 4) ? getU32(b) : v;
+  }
+  float f32(float v) {
+    uint8_t b[4];
+    if (!bytes(b, 4)) return v;
+    uint32_t u = getU32(b);
+    memcpy(&v, &u, 4);
+    return v;
+  }
+  void str(String& s) {
+    char text[256];
+    uint8_t n = 0;
+    if (!bytes(&n, 1) || !bytes(text, n)) return;
+    text[n] = '\0';
+    s = text;
+  }
+
+private:
+  bool bytes(void* data, size_t len) {
+    if (_past || len > _left) {
+      _past = true;
+      return false;
+    }
+    _left -= len;
+    uint8_t* p = (uint8_t*)data;
+    while (len > 0) {
+      if (_pos == _end) {
+        _end = _file.read(_buf, sizeof(_buf));
+        _pos = 0;
+        if (_end == 0) {
+          _past = true;
+          return false;
+        }
+      }
+      size_t n = _end - _pos;
+      if (n > len) n = len;
+      memcpy(p, _buf + _pos, n);
+      _pos += n;
+      p += n;
+      len -= n;
+    }
+    return true;
+  }
+
+  File& _file;
+  size_t _left;
+  uint8_t _buf[128];
+  size_t _pos = 0;
+  size_t _end = 0;
+  bool _past = false;
+};
+
+// A slot is valid if its magic, format and CRC check out
+bool stateSlotCheck(int slot, uint32_t& seq, size_t& size) {
+  File file = LittleFS.open(STATE_SLOT_PATHS[slot], "r");
+  if (!file) return false;
+  size = file.size();
+  uint8_t buf[128];
+  if (size < STATE_HEADER_SIZE + 4 || size > STATE_MAX_SIZE || file.read(buf, STATE_HEADER_SIZE) != STATE_HEADER_SIZE ||
+      getU32(buf) != STATE_MAGIC || (buf[4] | (buf[5] << 8)) != STATE_FORMAT) {
+    file.close();
+    return false;
+  }
+  seq = getU32(buf + 6);
+  uint32_t crc = crc32Update(0, buf, STATE_HEADER_SIZE);
+  size_t left = size - STATE_HEADER_SIZE - 4;
+  while (left > 0) {
+    size_t n = left < sizeof(buf) ? left : sizeof(buf);
+    if (file.read(buf, n) != n) break;
+    crc = crc32Update(crc, buf, n);
+    left -= n;
+  }
+  bool ok = left == 0 && file.read(buf, 4) == 4 && getU32(buf) == crc;
+  file.close();
+  return ok;
+}
+
+// Fields in the order savePersistentDataToSPIFFS() writes them
+bool stateReadSlot(int slot, size_t size) {
+  File file = LittleFS.open(STATE_SLOT_PATHS[slot], "r");
+  if (!file || !file.seek(STATE_HEADER_SIZE, SeekSet)) return false;
+  StateReader in(file, size - STATE_HEADER_SIZE - 4);
+  timezoneOffset = (int32_t)in.u32(timezoneOffset);
+  maxConcurrentMotors = in.u8(maxConcurrentMotors);
+  if (maxConcurrentMotors < 1 || maxConcurrentMotors > MAX_CHANNELS) maxConcurrentMotors = MAX_CONCURRENT_MOTORS_DEFAULT;
+  in.str(deviceName);
+  notifyLowFert = in.u8(notifyLowFert);
+  notifyStart = in.u8(notifyStart);
+  notifyDose = in.u8(notifyDose);
+  ledBrightness = in.u8(ledBrightness);
+  blinkAllOk = in.u8(blinkAllOk);
+  in.str(lastNotifiedIP);
+  in.str(mqttHost);
+  mqttPort = in.u16(mqttPort);
+  in.str(mqttUser);
+  in.str(mqttPassword);
+  in.str(mqttTopic);
+  int count = in.u8(0);
+  for (int n = 1; n <= count && n <= MAX_CHANNELS; n++) {
+    Channel& c = getChannel(n);
+    in.str(c.name);
+    c.calibrationFactor = in.f32(c.calibrationFactor);
+    c.calibrated = in.u8(c.calibrated);
+    c.remainingML = in.f32(c.remainingML);
+    c.daysRemaining = (int32_t)in.u32(c.daysRemaining);
+    c.lastDispensedVolume = in.f32(c.lastDispensedVolume);
+    in.str(c.lastDispensedTime);
+    c.lastScheduledDoseTime = in.u32(c.lastScheduledDoseTime);
+    WeeklySchedule& ws = c.schedule;
+    in.str(ws.channelName);
+    ws.missedDoseCompensation = in.u8(ws.missedDoseCompensation);
+    for (int i = 0; i < 7; i++) {
+      ws.days[i].enabled = in.u8(ws.days[i].enabled);
+      ws.days[i].hour = in.u8(ws.days[i].hour);
+      ws.days[i].minute = in.u8(ws.days[i].minute);
+      ws.days[i].volume = in.f32(ws.days[i].volume);
+    }
+  }
+  file.close();
+  return true;
+}
+
+// /data.json from earlier firmware
+bool loadLegacyData() {
+  File file = LittleFS.open(LEGACY_DATA_PATH, "r");
+  if (!file) return false;
+
+  DynamicJsonDocument doc(JSON_BUFFER_SIZE);
+  DeserializationError error = deserializeJson(doc, file);
+  file.close();
+  if (error) {
+    Serial.println(F("Failed to parse JSON"));
+    return false;
+  }
+
+  // Per-channel values use the channel number as key suffix (name1, channel1, ...)
+  for (int n = 1; n <= MAX_CHANNELS; n++) {
+    Channel& c = getChannel(n);
+    String k = String(n);
+    c.name = doc["name" + k] | c.name;
+    c.remainingML = doc["channel" + k].as<float>();
+    c.calibrationFactor = doc["calibration" + k] | 1.0f;  // Default to 1 if not set
+    c.lastDispensedVolume = doc["lastDispensedVolume" + k] | 0.0f;
+    c.lastDispensedTime = doc["lastDispensedTime" + k] | "N/A";
+    c.calibrated = doc["calibratedChannel" + k] | false;
+    c.lastScheduledDoseTime = doc["lastScheduledDoseTime" + k] | jan1_2025_epoch;
+    c.daysRemaining = doc["daysRemainingChannel" + k] | 0;
+  }
+  timezoneOffset = doc["timezone"] | 19800;  // Default to UTC if not set
+  maxConcurrentMotors = doc["maxConcurrentMotors"] | MAX_CONCURRENT_MOTORS_DEFAULT;
+  if (maxConcurrentMotors < 1 || maxConcurrentMotors > MAX_CHANNELS) maxConcurrentMotors = MAX_CONCURRENT_MOTORS_DEFAULT;
+
+  // Load device name
+  deviceName = doc["deviceName"] | "";
+
+  // Load notification settings
+  notifyLowFert = doc["notifyLowFert"] | true;
   notifyStart = doc["notifyStart"] | false;
   notifyDose = doc["notifyDose"] | false;
 
-  // Load calibration status
-  calibratedChannel1 = doc["calibratedChannel1"] | false;
-  calibratedChannel2 = doc["calibratedChannel2"] | false;
+  // Load MQTT settings
+  mqttHost = doc["mqttHost"] | "";
+  mqttPort = doc["mqttPort"] | MQTT_DEFAULT_PORT;
+  mqttUser = doc["mqttUser"] | "";
+  mqttPassword = doc["mqttPassword"] | "";
+  mqttTopic = doc["mqttTopic"] | "";
 
   // Load last notified IP (default to empty string)
   lastNotifiedIP = doc["lastNotifiedIP"] | "";
 
-  // Load last scheduled dose timestamps
-  //create a variable to hold the epoch of Jan1 2025
-  
-
-  lastScheduledDoseTime1 = doc["lastScheduledDoseTime1"] | jan1_2025_epoch; // Default to 0 if not set
-  lastScheduledDoseTime2 = doc["lastScheduledDoseTime2"] | jan1_2025_epoch;
-  
     // Load LED settings
   ledBrightness = doc["ledBrightness"] | 128;
   blinkAllOk = doc["blinkAllOk"] | true;
+  return true;
+}
 
-  // Load number of channels
-  //numChannels = doc["numChannels"] | 1;
+// /weekly_schedules.json from earlier firmware
+bool loadLegacySchedules() {
+  DynamicJsonDocument doc(4096);
+  File file = LittleFS.open(LEGACY_SCHEDULES_PATH, "r");
+  if (!file) return false;
+  if (deserializeJson(doc, file)) doc.clear(); // Fall back to empty schedules
+  file.close();
+  for (int n = 1; n <= MAX_CHANNELS; ++n) {
+    Channel& c = getChannel(n);
+    JsonObject ch = doc["ch" + String(n)];
+    c.schedule.channelName = ch["channelName"] | c.name;
+    c.schedule.missedDoseCompensation = ch["missedDoseCompensation"] | false;
+    JsonArray days = ch["days"];
+    for (size_t i = 0; i < 7; ++i) {
+      if (i < days.size()) {
+        c.schedule.days[i].enabled = days[i]["enabled"] | false;
+        c.schedule.days[i].hour = days[i]["hour"] | 0;
+        c.schedule.days[i].minute = days[i]["minute"] | 0;
+        c.schedule.days[i].volume = days[i]["volume"] | 0.0f;
+      } else {
+        c.schedule.days[i] = {false, 0, 0, 0.0f};
+      }
+    }
+  }
+  return true;
+}
 
-  // Load days remaining
-  daysRemainingChannel1 = doc["daysRemainingChannel1"] | 0;
-  daysRemainingChannel2 = doc["daysRemainingChannel2"] | 0;
+// Newest valid slot, else the JSON files of earlier firmware (converted to a
+// record and removed), else the defaults
+void loadPersistentDataFromSPIFFS() {
+  unsigned long start = micros();
+  uint32_t seq[2] = {0, 0};
+  size_t size[2] = {0, 0};
+  bool valid[2];
+  for (int i = 0; i < 2; i++) valid[i] = stateSlotCheck(i, seq[i], size[i]);
+  int slot = -1;
+  if (valid[0] && valid[1]) {
+    slot = (int32_t)(seq[1] - seq[0]) > 0 ? 1 : 0;
+  } else if (valid[0] || valid[1]) {
+    slot = valid[0] ? 0 : 1;
+    if (LittleFS.exists(STATE_SLOT_PATHS[1 - slot])) Serial.println(F("[STATE] Ignoring damaged slot"));
+  }
 
-  file.close();
-  Serial.println(F("Loaded configuration from filesystem"));
+  if (slot >= 0 && stateReadSlot(slot, size[slot])) {
+    stateSlot = slot;
+    stateSeq = seq[slot];
+    stateBytes = size[slot];
+    stateLoadUs = micros() - start;
+    Serial.printf("[STATE] Loaded record %u from slot %d (%u bytes, %lu us)\n", (unsigned)stateSeq, slot, (unsigned)stateBytes, stateLoadUs);
+  } else {
+    stateSlot = -1;
+    stateSeq = 0;
+    stateBytes = 0;
+    bool data = loadLegacyData();
+    bool schedules = loadLegacySchedules();
+    stateLoadUs = micros() - start;
+    if (data || schedules) {
+      savePersistentDataToSPIFFS();
+      if (stateSlot >= 0) {
+        LittleFS.remove(LEGACY_DATA_PATH);
+        LittleFS.remove(LEGACY_SCHEDULES_PATH);
+        Serial.println(F("[STATE] Migrated JSON files to the binary record"));
+      }
+    } else {
+      Serial.println(F("[STATE] No saved state, using defaults"));
+    }
+  }
+  for (int n = 1; n <= MAX_CHANNELS; n++) scheduleChanged(n);
 }
 
-// JSON handling functions updated to use JsonDocument
+// Write a new record to the slot not holding the current one
 void savePersistentDataToSPIFFS() {
-  File file = LittleFS.open("/data.json", "w");
+  int slot = stateSlot == 0 ? 1 : 0;
+  persistentDataDirty = false;
+  persistentDataWrites++;
+  File file = LittleFS.open(STATE_SLOT_PATHS[slot], "w");
   if (!file) {
-    Serial.println(F("Failed to open file for writing"));
+    stateWriteFailures++;
+    Serial.println(F("[STATE] Failed to open slot for writing"));
     return;
   }
 
-  DynamicJsonDocument doc(JSON_BUFFER_SIZE);
-  
-  // Save channel names
-  doc["name1"] = channel1Name;
-  doc["name2"] = channel2Name;
-  
-  // Save remaining ML values
-  doc["channel1"] = remainingMLChannel1;
-  doc["channel2"] = remainingMLChannel2;
-  doc["timezone"] = timezoneOffset;
-  
-  // Save calibration factors
-  doc["calibration1"] = calibrationFactor1;
-  doc["calibration2"] = calibrationFactor2;
+  StateWriter out(file);
+  out.u32(STATE_MAGIC);
+  out.u16(STATE_FORMAT);
+  out.u32(stateSeq + 1);
+  out.u32((uint32_t)timezoneOffset);
+  out.u8(maxConcurrentMotors);
+  out.str(deviceName);
+  out.u8(notifyLowFert);
+  out.u8(notifyStart);
+  out.u8(notifyDose);
+  out.u8(ledBrightness);
+  out.u8(blinkAllOk);
+  out.str(lastNotifiedIP);
+  out.str(mqttHost);
+  out.u16(mqttPort);
+  out.str(mqttUser);
+  out.str(mqttPassword);
+  out.str(mqttTopic);
+  out.u8(MAX_CHANNELS);
+  for (int n = 1; n <= MAX_CHANNELS; n++) {
+    const Channel& c = getChannel(n);
+    out.str(c.name);
+    out.f32(c.calibrationFactor);
+    out.u8(c.calibrated);
+    out.f32(c.remainingML);
+    out.u32((uint32_t)c.daysRemaining);
+    out.f32(c.lastDispensedVolume);
+    out.str(c.lastDispensedTime);
+    out.u32(c.lastScheduledDoseTime);
+    const WeeklySchedule& ws = c.schedule;
+    out.str(ws.channelName);
+    out.u8(ws.missedDoseCompensation);
+    for (int i = 0; i < 7; i++) {
+      out.u8(ws.days[i].enabled);
+      out.u8(ws.days[i].hour);
+      out.u8(ws.days[i].minute);
+      out.f32(ws.days[i].volume);
+    }
+  }
+  bool ok = out.finish();
+  file.close();
+  if (!ok) {
+    // The other slot still holds the last good record
+    stateWriteFailures++;
+    Serial.println(F("[STATE] Write failed"));
+    return;
+  }
+  stateSlot = slot;
+  stateSeq++;
+  stateBytes = out.size();
+  Serial.println(F("Saved configuration to filesystem"));
+}
 
-  // Save last dispensed volume and time
-  doc["lastDispensedVolume1"] = lastDispensedVolume1;
-  doc["lastDispensedTime1"] = lastDispensedTime1;
-  doc["lastDispensedVolume2"] = lastDispensedVolume2;
-  doc["lastDispensedTime2"] = lastDispensedTime2;
+// --- Deferred persistence ---
+void markPersistentDataDirty() {
+  unsigned long now = millis();
+  if (persistentDataDirty) {
+    persistentDataWritesSaved++;
+  } else {
+    persistentDataDirty = true;
+    persistentDataDirtySince = now;
+  }
+  persistentDataLastChange = now;
+}
 
-  // Save device name
-  doc["deviceName"] = deviceName;
+// Write now if anything is pending (before restart/OTA)
+void flushPersistentData() {
+  if (persistentDataDirty) {
+    savePersistentDataToSPIFFS();
+  }
+  saveNtfyQueue();
+  clockSaveCheckpoint();
+}
+
+// --- Clock checkpoint ---
+// UTC seconds and their CRC-32, saved on every NTP sync and before restarts.
+// Until NTP answers after a boot the clock runs on from here, so schedules
+// keep going through a network outage.
+#define CLOCK_PATH "/clock.bin"
+
+void clockSaveCheckpoint() {
+  if (!timeSynced) return; // Never save a guess
+  uint8_t rec[8];
+  putU32(rec, clockUtc());
+  putU32(rec + 4, crc32Update(0, rec, 4));
+  File file = LittleFS.open(CLOCK_PATH, "w");
+  if (!file) return;
+  file.write(rec, sizeof(rec));
+  file.close();
+}
 
-  // Save notification settings
-  doc["notifyLowFert"] = notifyLowFert;
-  doc["notifyStart"] = notifyStart;
-  doc["notifyDose"] = notifyDose;
+// Newest time we know of: the checkpoint or a later scheduled dose. 0 if none.
+uint32_t clockLoadCheckpoint() {
+  uint32_t utc = 0;
+  File file = LittleFS.open(CLOCK_PATH, "r");
+  if (file) {
+    uint8_t rec[8];
+    if (file.read(rec, sizeof(rec)) == sizeof(rec) && getU32(rec + 4) == crc32Update(0, rec, 4)) utc = getU32(rec);
+    file.close();
+  }
+  for (int n = 1; n <= numChannels; n++) {
+    uint32_t dose = getChannel(n).lastScheduledDoseTime;
+    if (dose != 0 && dose - timezoneOffset > utc) utc = dose - timezoneOffset;
+  }
+  return utc;
+}
 
-  // Save calibration status
-  doc["calibratedChannel1"] = calibratedChannel1;
-  doc["calibratedChannel2"] = calibratedChannel2;
+// Called from loop(): write once changes settle, but never hold them too long
+void servicePersistentData() {
+  if (!persistentDataDirty) return;
+  unsigned long now = millis();
+  if (now - persistentDataLastChange >= PERSIST_QUIET_MS || now - persistentDataDirtySince >= PERSIST_MAX_DEFER_MS) {
+    savePersistentDataToSPIFFS();
+    Serial.print(F("[PERSIST] Writes: ")); Serial.print(persistentDataWrites);
+    Serial.print(F(", saved by coalescing: ")); Serial.println(persistentDataWritesSaved);
+  }
+}
 
-  // Save last notified IP
-  doc["lastNotifiedIP"] = lastNotifiedIP;
+// --- Dose event log ---
+// Fixed 16 byte records in a ring of segment files. Record seq N lives at
+// index (N - 1) % DOSE_LOG_SEGMENT_RECORDS of segment (N - 1) / DOSE_LOG_SEGMENT_RECORDS,
+// stored in file DOSE_LOG_PATH_FORMAT with that segment number modulo
+// DOSE_LOG_SEGMENTS. Appends go to the end of the newest segment, so LittleFS
+// only copies that segment's unfinished block, never the rest of the log. The
+// first record of a segment truncates the file, dropping the oldest lap.
+#define DOSE_LOG_PATH_FORMAT "/dose_log_%u.bin"
+const uint32_t DOSE_LOG_SEGMENTS = 8;
+const uint32_t DOSE_LOG_SEGMENT_RECORDS = 256; // 4 KB per file
+const uint32_t DOSE_LOG_CAPACITY = DOSE_LOG_SEGMENTS * DOSE_LOG_SEGMENT_RECORDS; // Over two years of two daily doses
+const size_t DOSE_LOG_RECORD_SIZE = 16;
+
+uint32_t doseLogFirst = 0; // Oldest seq still kept (0 = empty)
+uint32_t doseLogLast = 0;  // Newest seq
+
+// Record: seq u32, epoch u32, durationMs u32, volume u16 (1/100 ml),
+// channel << 4 | source u8, CRC-8 of the first 15 bytes
+
+static File doseLogOpenSegment(uint32_t seq, const char* mode) {
+  char path[24];
+  snprintf(path, sizeof(path), DOSE_LOG_PATH_FORMAT, (unsigned)((seq - 1) / DOSE_LOG_SEGMENT_RECORDS % DOSE_LOG_SEGMENTS));
+  return LittleFS.open(path, mode);
+}
 
-  // Save last scheduled dose timestamps
-  doc["lastScheduledDoseTime1"] = lastScheduledDoseTime1;
-  doc["lastScheduledDoseTime2"] = lastScheduledDoseTime2;
+// First seq stored in the same segment as seq
+static uint32_t doseLogSegmentStart(uint32_t seq) {
+  return seq - (seq - 1) % DOSE_LOG_SEGMENT_RECORDS;
+}
 
-  // Save LED settings
-  doc["ledBrightness"] = ledBrightness;
-  doc["blinkAllOk"] = blinkAllOk;
+static bool doseLogReadAt(File& file, uint32_t index, DoseEvent& e) {
+  uint8_t rec[DOSE_LOG_RECORD_SIZE];
+  if (!file.seek(index * DOSE_LOG_RECORD_SIZE, SeekSet)) return false;
+  if (file.read(rec, sizeof(rec)) != sizeof(rec)) return false;
+  e.seq = getU32(rec);
+  if (e.seq == 0 || crc8(rec, 15) != rec[15]) return false;
+  e.epoch = getU32(rec + 4);
+  e.durationMs = getU32(rec + 8);
+  e.volumeMl = (rec[12] | (rec[13] << 8)) / 100.0f;
+  e.channel = rec[14] >> 4;
+  e.source = rec[14] & 0x0F;
+  return e.source < DOSE_SOURCE_COUNT;
+}
 
-  // Save number of channels
-  //doc["numChannels"] = numChannels;
+// Find the newest segment by the seq of its first record, then the last
+// record in it that reads back. Older segments of the same lap follow it.
+void doseLogBegin() {
+  doseLogFirst = doseLogLast = 0;
+  uint32_t starts[DOSE_LOG_SEGMENTS] = {0};
+  uint32_t newest = 0;
+  for (uint32_t i = 0; i < DOSE_LOG_SEGMENTS; i++) {
+    File file = doseLogOpenSegment(i * DOSE_LOG_SEGMENT_RECORDS + 1, "r");
+    DoseEvent e;
+    if (file && doseLogReadAt(file, 0, e) && doseLogSegmentStart(e.seq) == e.seq &&
+        (e.seq - 1) / DOSE_LOG_SEGMENT_RECORDS % DOSE_LOG_SEGMENTS == i) {
+      starts[i] = e.seq;
+      if (e.seq > newest) newest = e.seq;
+    }
+    if (file) file.close();
+  }
+  if (newest == 0) {
+    Serial.println(F("[DOSELOG] Empty log"));
+    return;
+  }
 
-  // Save days remaining
-  doc["daysRemainingChannel1"] = daysRemainingChannel1;
-  doc["daysRemainingChannel2"] = daysRemainingChannel2;
+  File file = doseLogOpenSegment(newest, "r");
+  uint32_t count = min((uint32_t)(file.size() / DOSE_LOG_RECORD_SIZE), DOSE_LOG_SEGMENT_RECORDS);
+  DoseEvent e;
+  while (count > 1 && !(doseLogReadAt(file, count - 1, e) && e.seq == newest + count - 1)) count--;
+  file.close();
+  doseLogLast = newest + count - 1;
+  doseLogFirst = newest;
+  for (uint32_t i = 0; i < DOSE_LOG_SEGMENTS; i++) {
+    if (starts[i] && newest - starts[i] < DOSE_LOG_CAPACITY && starts[i] < doseLogFirst) doseLogFirst = starts[i];
+  }
+  Serial.print(F("[DOSELOG] Records ")); Serial.print(doseLogFirst);
+  Serial.print(F("..")); Serial.println(doseLogLast);
+}
 
-  if (serializeJson(doc, file) == 0) {
-    Serial.println(F("Failed to write JSON to file"));
+void doseLogAppend(int channel, float volumeMl, uint8_t source, unsigned long durationMs) {
+  uint32_t seq = doseLogLast + 1;
+  uint32_t index = (seq - 1) % DOSE_LOG_SEGMENT_RECORDS;
+  File file = doseLogOpenSegment(seq, index == 0 ? "w" : "a");
+  if (!file) {
+    Serial.println(F("[DOSELOG] Failed to open log"));
+    return;
+  }
+  // A torn record from a power cut is cut off so this one lands at its index
+  if (file.size() != index * DOSE_LOG_RECORD_SIZE) file.truncate(index * DOSE_LOG_RECORD_SIZE);
+
+  uint32_t epoch = timeSynced ? clockUtc() : 0;
+  long centiMl = lroundf(volumeMl * 100.0f);
+  if (centiMl < 0) centiMl = 0;
+  if (centiMl > 0xFFFF) centiMl = 0xFFFF;
+
+  uint8_t rec[DOSE_LOG_RECORD_SIZE];
+  putU32(rec, seq);
+  putU32(rec + 4, epoch);
+  putU32(rec + 8, durationMs);
+  rec[12] = centiMl & 0xFF;
+  rec[13] = centiMl >> 8;
+  rec[14] = (channel << 4) | (source & 0x0F);
+  rec[15] = crc8(rec, 15);
+
+  if (file.write(rec, sizeof(rec)) != sizeof(rec)) {
+    Serial.println(F("[DOSELOG] Write failed"));
+    file.close();
+    return;
   }
+  file.close();
+  doseLogLast = seq;
+  if (doseLogFirst == 0) doseLogFirst = seq;
+  // Starting a segment overwrote the oldest one
+  uint32_t kept = (DOSE_LOG_SEGMENTS - 1) * DOSE_LOG_SEGMENT_RECORDS;
+  uint32_t start = seq - index;
+  if (start > kept && doseLogFirst < start - kept) doseLogFirst = start - kept;
+}
 
+// Read one record by sequence number
+bool doseLogRead(uint32_t seq, DoseEvent& e) {
+  if (seq < doseLogFirst || seq > doseLogLast || seq == 0) return false;
+  File file = doseLogOpenSegment(seq, "r");
+  if (!file) return false;
+  bool ok = doseLogReadAt(file, (seq - 1) % DOSE_LOG_SEGMENT_RECORDS, e) && e.seq == seq;
   file.close();
-  Serial.println(F("Saved configuration to filesystem"));
+  return ok;
 }
 
+// First seq logged at or after a UTC epoch (doseLogLast + 1 if none).
+// Binary search, so it relies on timestamps rising with seq.
+uint32_t doseLogSeqAtOrAfter(uint32_t epoch) {
+  if (doseLogLast == 0) return 1;
+  uint32_t lo = doseLogFirst, hi = doseLogLast + 1;
+  DoseEvent e;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (doseLogRead(mid, e) && e.epoch < epoch) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
 
+DoseLogReader::DoseLogReader(uint32_t fromSeq) : _segmentStart(0) {
+  _seq = (fromSeq < doseLogFirst) ? doseLogFirst : fromSeq;
+  if (_seq == 0) _seq = 1;
+}
 
-void updateRemainingML(int channel, float dispensedML) {
-  if (channel == 1) {
-    remainingMLChannel1 -= dispensedML;
-  } else if (channel == 2) {
-    remainingMLChannel2 -= dispensedML;
+// Next readable record in seq order; damaged records are skipped
+bool DoseLogReader::next(DoseEvent& e) {
+  while (_seq <= doseLogLast) {
+    uint32_t seq = _seq++;
+    uint32_t start = doseLogSegmentStart(seq);
+    if (start != _segmentStart) {
+      if (_file) _file.close();
+      _file = doseLogOpenSegment(seq, "r");
+      _segmentStart = start;
+    }
+    if (_file && doseLogReadAt(_file, seq - start, e) && e.seq == seq) return true;
   }
-  savePersistentDataToSPIFFS();
+  return false;
+}
 
- 
+// --- Counter journal ---
+// Remaining volume, total dispensed, pump run time and the last dose change
+// with every dose, so they are kept out of the state record. /counters.bin is
+// a base snapshot followed by 16 byte delta records appended at the end of the
+// file. LittleFS is copy-on-write, so an append still copies the file's
+// unfinished block to a freshly erased one: an update costs a block erase like
+// any small file write. Keeping the journal at most COUNTER_FILE_SIZE bounds
+// the copy below a state record rewrite, and a dose no longer serializes the
+// whole state. When the records fill up, the current values are written as a
+// new base (generation + 1) to COUNTER_COMPACT_PATH, which is then renamed
+// over the journal; until the rename the old journal stays whole. Boot
+// replays the records after the base that carry its generation. The state
+// record still carries these fields as of its last write; they only seed a
+// new journal.
+#define COUNTER_PATH "/counters.bin"
+#define COUNTER_COMPACT_PATH "/counters.new"
+#define COUNTER_MAGIC 0x544E4344UL // "DCNT"
+const size_t COUNTER_FILE_SIZE = 512; // Largest the journal grows to
+const size_t COUNTER_BASE_SIZE = 128;
+const size_t COUNTER_RECORD_SIZE = 16;
+const uint32_t COUNTER_CAPACITY = (COUNTER_FILE_SIZE - COUNTER_BASE_SIZE) / COUNTER_RECORD_SIZE;
+
+// Record: channel << 4 | kind u8, generation u16, a u32, b u32, c u32,
+// CRC-8 of the first 15 bytes
+enum CounterKind : uint8_t {
+  COUNTER_SET_REMAINING = 1, // a = remaining 0.01 ml
+  COUNTER_DOSE,              // a = 0.01 ml, b = local epoch, c = pump ms
+  COUNTER_SCHEDULED_DOSE,    // As COUNTER_DOSE, b is also the last scheduled dose
+  COUNTER_MOTOR,             // c = pump ms without a dose (priming)
+  COUNTER_KIND_END
+};
+
+// Kept in whole units so a replay gives exactly what was recorded
+struct ChannelCounters {
+  int32_t remainingCentiMl;
+  uint32_t dispensedCentiMl; // Since the counters were started
+  uint32_t motorOnMs;
+  int32_t lastDoseCentiMl;
+  uint32_t lastDoseAt;       // Local epoch, 0 if none recorded
+  uint32_t lastScheduledAt;  // Local epoch
+};
+
+ChannelCounters channelCounters[MAX_CHANNELS];
+uint32_t counterGeneration = 0; // Compactions over the journal's lifetime
+uint32_t counterNext = 0;       // Next record index
+unsigned long counterAppends = 0;
+unsigned long counterCompactions = 0;
+unsigned long counterWriteFailures = 0;
+uint32_t counterReplayed = 0;   // Records replayed at boot
+
+void counterApply(int channel, uint8_t kind, uint32_t a, uint32_t b, uint32_t c) {
+  ChannelCounters& k = channelCounters[channel - 1];
+  if (kind == COUNTER_SET_REMAINING) {
+    k.remainingCentiMl = (int32_t)a;
+  } else if (kind == COUNTER_DOSE || kind == COUNTER_SCHEDULED_DOSE) {
+    k.remainingCentiMl -= (int32_t)a;
+    k.dispensedCentiMl += a;
+    k.lastDoseCentiMl = (int32_t)a;
+    k.lastDoseAt = b;
+    if (kind == COUNTER_SCHEDULED_DOSE) k.lastScheduledAt = b;
+  }
+  k.motorOnMs += c;
+}
+
+// Copy a channel's counters to the fields the rest of the firmware reads
+void counterSync(int channel) {
+  const ChannelCounters& k = channelCounters[channel - 1];
+  Channel& c = getChannel(channel);
+  c.remainingML = k.remainingCentiMl / 100.0f;
+  c.lastDispensedVolume = k.lastDoseCentiMl / 100.0f;
+  c.lastScheduledDoseTime = k.lastScheduledAt;
+  if (k.lastDoseAt != 0) {
+    LocalTime t;
+    breakDownLocalTime(k.lastDoseAt, t);
+    c.lastDispensedTime = t.formatted;
+  }
+}
+
+bool counterWriteBase(File& file, uint32_t generation) {
+  uint8_t base[COUNTER_BASE_SIZE] = {0};
+  putU32(base, COUNTER_MAGIC);
+  putU32(base + 4, generation);
+  uint8_t* p = base + 8;
+  for (int i = 0; i < MAX_CHANNELS; i++, p += 24) {
+    const ChannelCounters& k = channelCounters[i];
+    putU32(p, k.remainingCentiMl);
+    putU32(p + 4, k.dispensedCentiMl);
+    putU32(p + 8, k.motorOnMs);
+    putU32(p + 12, k.lastDoseCentiMl);
+    putU32(p + 16, k.lastDoseAt);
+    putU32(p + 20, k.lastScheduledAt);
+  }
+  putU32(p, crc32Update(0, base, p - base));
+  return file.write(base, sizeof(base)) == sizeof(base);
+}
+
+bool counterReadBase(File& file, uint32_t& generation, ChannelCounters* values) {
+  uint8_t base[COUNTER_BASE_SIZE];
+  if (!file.seek(0, SeekSet) || file.read(base, sizeof(base)) != sizeof(base)) return false;
+  const uint8_t* p = base + 8;
+  size_t len = 8 + MAX_CHANNELS * 24;
+  if (getU32(base) != COUNTER_MAGIC || getU32(base + len) != crc32Update(0, base, len)) return false;
+  generation = getU32(base + 4);
+  for (int i = 0; i < MAX_CHANNELS; i++, p += 24) {
+    ChannelCounters& k = values[i];
+    k.remainingCentiMl = (int32_t)getU32(p);
+    k.dispensedCentiMl = getU32(p + 4);
+    k.motorOnMs = getU32(p + 8);
+    k.lastDoseCentiMl = (int32_t)getU32(p + 12);
+    k.lastDoseAt = getU32(p + 16);
+    k.lastScheduledAt = getU32(p + 20);
+  }
+  return true;
+}
+
+// Start a fresh journal from the channel values already loaded
+void counterCreate() {
+  for (int n = 1; n <= MAX_CHANNELS; n++) {
+    const Channel& c = getChannel(n);
+    ChannelCounters& k = channelCounters[n - 1];
+    k = {};
+    k.remainingCentiMl = toCentiMl(c.remainingML);
+    k.lastDoseCentiMl = toCentiMl(c.lastDispensedVolume);
+    k.lastScheduledAt = c.lastScheduledDoseTime;
+  }
+  counterGeneration = 1;
+  counterNext = 0;
+  File file = LittleFS.open(COUNTER_PATH, "w");
+  if (!file) {
+    Serial.println(F("[COUNTER] Failed to create journal"));
+    return;
+  }
+  if (!counterWriteBase(file, counterGeneration)) counterWriteFailures++;
+  file.close();
+  Serial.println(F("[COUNTER] Created journal"));
+}
+
+// Load the newest base and replay the records written since
+void counterBegin() {
+  LittleFS.remove(COUNTER_COMPACT_PATH); // A compaction cut before its rename
+  File file = LittleFS.open(COUNTER_PATH, "r");
+  if (!file || !counterReadBase(file, counterGeneration, channelCounters)) {
+    if (file) file.close();
+    counterCreate();
+  } else {
+    counterNext = 0;
+    file.seek(COUNTER_BASE_SIZE, SeekSet);
+    uint8_t buf[COUNTER_RECORD_SIZE * 16];
+    bool end = false;
+    while (!end && counterNext < COUNTER_CAPACITY) {
+      size_t got = file.read(buf, sizeof(buf)) / COUNTER_RECORD_SIZE;
+      if (got == 0) break;
+      for (size_t i = 0; i < got && counterNext < COUNTER_CAPACITY; i++) {
+        const uint8_t* rec = buf + i * COUNTER_RECORD_SIZE;
+        int channel = rec[0] >> 4;
+        uint8_t kind = rec[0] & 0x0F;
+        if (crc8(rec, 15) != rec[15] || (uint16_t)(rec[1] | (rec[2] << 8)) != (uint16_t)counterGeneration || channel < 1 ||
+            channel > MAX_CHANNELS || kind < COUNTER_SET_REMAINING || kind >= COUNTER_KIND_END) {
+          end = true; // Stale, torn or never written: the journal ends here
+          break;
+        }
+        counterApply(channel, kind, getU32(rec + 3), getU32(rec + 7), getU32(rec + 11));
+        counterNext++;
+      }
+    }
+    file.close();
+    Serial.printf("[COUNTER] Generation %u, replayed %u records\n", (unsigned)counterGeneration, (unsigned)counterNext);
+  }
+  counterReplayed = counterNext;
+  for (int n = 1; n <= MAX_CHANNELS; n++) counterSync(n);
+}
+
+// Fold the records into a new base in a new journal, then rename it over the
+// old one. Until the rename the old base and its records stay valid.
+bool counterCompact() {
+  File file = LittleFS.open(COUNTER_COMPACT_PATH, "w");
+  if (!file) return false;
+  bool ok = counterWriteBase(file, counterGeneration + 1);
+  file.close();
+  if (!ok || !LittleFS.rename(COUNTER_COMPACT_PATH, COUNTER_PATH)) {
+    LittleFS.remove(COUNTER_COMPACT_PATH);
+    return false;
+  }
+  counterGeneration++;
+  counterNext = 0;
+  counterCompactions++;
+  return true;
+}
+
+// Apply a change and append it to the journal. A full journal first becomes
+// the new base, without this change, so the change is only ever in a record.
+void counterRecord(int channel, uint8_t kind, uint32_t a, uint32_t b, uint32_t c) {
+  if (!isValidChannel(channel)) return;
+  bool ok = counterNext < COUNTER_CAPACITY || counterCompact();
+  File file;
+  if (ok) file = LittleFS.open(COUNTER_PATH, "a");
+  counterApply(channel, kind, a, b, c);
+  counterSync(channel);
+  if (file) {
+    // A record cut short by a power cut is dropped so this one follows the last whole one
+    size_t end = COUNTER_BASE_SIZE + counterNext * COUNTER_RECORD_SIZE;
+    if (file.size() != end) file.truncate(end);
+    uint8_t rec[COUNTER_RECORD_SIZE];
+    rec[0] = (channel << 4) | kind;
+    rec[1] = counterGeneration & 0xFF;
+    rec[2] = (counterGeneration >> 8) & 0xFF;
+    putU32(rec + 3, a);
+    putU32(rec + 7, b);
+    putU32(rec + 11, c);
+    rec[15] = crc8(rec, 15);
+    ok = file.write(rec, sizeof(rec)) == sizeof(rec);
+    file.close();
+  } else {
+    ok = false;
+  }
+  if (!ok) {
+    counterWriteFailures++;
+    Serial.println(F("[COUNTER] Write failed"));
+    return;
+  }
+  counterNext++;
+  counterAppends++;
+}
+
+void counterDose(int channel, float ml, unsigned long durationMs, bool scheduled) {
+  int32_t centiMl = toCentiMl(ml);
+  if (centiMl < 0) centiMl = 0;
+  counterRecord(channel, scheduled ? COUNTER_SCHEDULED_DOSE : COUNTER_DOSE, centiMl, clockNow(), durationMs);
+}
+
+void counterSetRemaining(int channel, float ml) {
+  counterRecord(channel, COUNTER_SET_REMAINING, (uint32_t)toCentiMl(ml), 0, 0);
+}
+
+void counterMotorRun(int channel, unsigned long ms) {
+  counterRecord(channel, COUNTER_MOTOR, 0, 0, ms);
 }
 
 
@@ -2105,6 +3463,7 @@ void setupOTA() {
   ArduinoOTA.onStart([]() {
     // Start with red
     updateLED(LED_RED);
+    flushPersistentData();
     Serial.println(F("[OTA] Start updating"));
   });
   ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
@@ -2218,125 +3577,517 @@ void updateLEDState() {
   }
 }
 
-// Add this new central motor control function
-void runMotor(int channel, int durationMs) {
-  // Save current LED state
-  LEDState previousState = currentLEDState;
-  
-  // Set LED color based on channel
-  if (channel == 1) {
-    updateLED(LED_BLUE);
-  } else if (channel == 2) {
-    updateLED(LED_YELLOW);
+// --- Warm-restart snapshot ---
+// Just before an intentional restart the runtime state (settings, channels,
+// schedules, counters, journal and slot positions, clock) is copied into RTC
+// user memory after the WiFi cache. The next boot takes it from there instead
+// of checking and reading the state slots and replaying the counter journal.
+// It is used once: boot clears it, so a later crash or power cycle reads
+// flash. The build stamp keeps a new firmware from reading an old layout.
+// Fields derived from the counters (remaining, last dose) are not repeated,
+// and unset schedule days and counters are left out to fit in 480 bytes.
+#define RTC_SNAPSHOT_OFFSET 8 // RTC user memory word, after the WiFi cache
+const size_t SNAPSHOT_MAX_SIZE = (128 - RTC_SNAPSHOT_OFFSET) * 4;
+const uint32_t SNAPSHOT_MAGIC = 0x50414E53; // "SNAP"
+const size_t SNAPSHOT_HEADER_SIZE = 10;     // magic u32, build u32, size u16
+
+size_t snapshotBytes = 0; // Size of the last snapshot written or restored
+unsigned long snapshotSaves = 0;
+unsigned long snapshotTooBig = 0;
+
+// Same encoding as StateWriter, into a buffer; size() counts past the end
+class SnapshotWriter {
+public:
+  SnapshotWriter(uint8_t* buf, size_t capacity) : _buf(buf), _capacity(capacity) {}
+  void u8(uint8_t v) { bytes(&v, 1); }
+  void u16(uint16_t v) {
+    uint8_t b[2] = {(uint8_t)v, (uint8_t)(v >> 8)};
+    bytes(b, 2);
   }
-  
-  // Run motor
-  int motorPin = (channel == 1) ? MOTOR1_PIN : MOTOR2_PIN;
-  digitalWrite(motorPin, HIGH);
-  delay(durationMs);
-  digitalWrite(motorPin, LOW);
-  
-  // Restore previous LED state
-  setLEDState(previousState);
-}
+  void u32(uint32_t v) {
+    uint8_t b[4];
+    putU32(b, v);
+    bytes(b, 4);
+  }
+  void f32(float v) {
+    uint32_t u;
+    memcpy(&u, &v, 4);
+    u32(u);
+  }
+  void str(const String& s) {
+    if (s.length() > 255) _size = _capacity; // No room for the length; counts as too big
+    u8(s.length());
+    bytes(s.c_str(), s.length());
+  }
+  size_t size() const { return _size; }
 
-void handlePrimePump() {
-  if (server.hasArg("channel") && server.hasArg("state")) {
-    int channel = server.arg("channel").toInt();
-    bool state = server.arg("state") == "1";
-    
-    if (channel == 1) {
-      isPrimingChannel1 = state;
-    } else if (channel == 2) {
-      isPrimingChannel2 = state;
-    }
-    
-    String msg = String(F("{\"status\":\"prime pump ")) + (state ? F("started") : F("stopped")) + F("\"}");
-    server.send(200, "application/json", msg);
-  } else {
-    server.send(400, "application/json", F("{\"error\":\"missing parameters\"}"));
+private:
+  void bytes(const void* data, size_t len) {
+    if (_size + len <= _capacity) memcpy(_buf + _size, data, len);
+    _size += len;
   }
+
+  uint8_t* _buf;
+  size_t _capacity;
+  size_t _size = 0;
+};
+
+// Reads a checked snapshot; the size was checked against the CRC already
+class SnapshotReader {
+public:
+  explicit SnapshotReader(const uint8_t* buf) : _p(buf) {}
+  uint8_t u8() { return *_p++; }
+  uint16_t u16() {
+    uint16_t v = _p[0] | (_p[1] << 8);
+    _p += 2;
+    return v;
+  }
+  uint32_t u32() {
+    uint32_t v = getU32(_p);
+    _p += 4;
+    return v;
+  }
+  float f32() {
+    uint32_t u = u32();
+    float v;
+    memcpy(&v, &u, 4);
+    return v;
+  }
+  void str(String& s) {
+    char text[256];
+    uint8_t n = u8();
+    memcpy(text, _p, n);
+    text[n] = '\0';
+    _p += n;
+    s = text;
+  }
+
+private:
+  const uint8_t* _p;
+};
+
+uint32_t snapshotBuild() {
+  static const char stamp[] = __DATE__ " " __TIME__;
+  return crc32Update(0, (const uint8_t*)stamp, sizeof(stamp) - 1);
 }
 
-// Common header and footer generators
-String generateHeader(const String& title) {
-  String html = F("<div style='max-width:550px;width:100%;margin:0 auto 10px auto;background:#007BFF;color:#fff;padding:16px 20px;text-align:center;font-size:1.5em;border-radius:10px 10px 0 0;box-shadow:0 2px 4px rgba(0,0,0,0.05);box-sizing:border-box;'>");
-  html += title;
-  html += F("</div>");
-  return html;
+void snapshotClear() {
+  uint32_t magic = 0;
+  ESP.rtcUserMemoryWrite(RTC_SNAPSHOT_OFFSET, &magic, sizeof(magic));
 }
 
-// Helper function to get WiFi signal strength description
-String getWiFiSignalStrength() {
-  if (WiFi.status() != WL_CONNECTED) {
-    return F("Disconnected");
+// Call after flushPersistentData(), right before ESP.restart()
+void snapshotSave() {
+  uint32_t words[SNAPSHOT_MAX_SIZE / 4];
+  uint8_t* buf = (uint8_t*)words;
+  SnapshotWriter out(buf, SNAPSHOT_MAX_SIZE);
+  out.u32(SNAPSHOT_MAGIC);
+  out.u32(snapshotBuild());
+  out.u16(0); // Size, filled in below
+  out.u8(stateSlot + 1);
+  out.u32(stateSeq);
+  out.u16(stateBytes);
+  out.u32(counterGeneration);
+  out.u16(counterNext);
+  uint64_t utcMs = timeSynced || clockEstimated ? clockUtcMs() : 0;
+  out.u32((uint32_t)utcMs);
+  out.u32((uint32_t)(utcMs >> 32));
+  out.u32((uint32_t)clockDriftPpm);
+
+  out.u32((uint32_t)timezoneOffset);
+  out.u8(maxConcurrentMotors);
+  out.str(deviceName);
+  out.u8(notifyLowFert | notifyStart << 1 | notifyDose << 2 | blinkAllOk << 3);
+  out.u8(ledBrightness);
+  out.str(lastNotifiedIP);
+  out.str(mqttHost);
+  out.u16(mqttPort);
+  out.str(mqttUser);
+  out.str(mqttPassword);
+  out.str(mqttTopic);
+  static const ChannelCounters noCounters = {};
+  for (int n = 1; n <= MAX_CHANNELS; n++) {
+    const Channel& c = getChannel(n);
+    const ChannelCounters& k = channelCounters[n - 1];
+    bool ownName = c.schedule.channelName != c.name;
+    bool counters = memcmp(&k, &noCounters, sizeof(k)) != 0;
+    uint8_t days = 0; // Days that are not {false, 00:00, 0 ml}
+    for (int i = 0; i < 7; i++) {
+      const DaySchedule& d = c.schedule.days[i];
+      if (d.enabled || d.hour || d.minute || d.volume != 0.0f) days |= 1 << i;
+    }
+    out.str(c.name);
+    out.f32(c.calibrationFactor);
+    out.u8(c.calibrated | c.schedule.missedDoseCompensation << 1 | ownName << 2 | counters << 3);
+    out.u32((uint32_t)c.daysRemaining);
+    if (ownName) out.str(c.schedule.channelName);
+    out.u8(days);
+    for (int i = 0; i < 7; i++) {
+      const DaySchedule& d = c.schedule.days[i];
+      if (!(days & (1 << i))) continue;
+      out.u16((d.enabled ? 0x8000 : 0) | (d.hour * 60 + d.minute));
+      out.f32(d.volume);
+    }
+    if (counters) {
+      out.u32(k.remainingCentiMl);
+      out.u32(k.dispensedCentiMl);
+      out.u32(k.motorOnMs);
+      out.u32(k.lastDoseCentiMl);
+      out.u32(k.lastDoseAt);
+      out.u32(k.lastScheduledAt);
+    }
+    if (k.lastDoseAt == 0) out.str(c.lastDispensedTime); // Else rebuilt from lastDoseAt
   }
-  
-  int32_t rssi = WiFi.RSSI();
-  
-  if (rssi >= -50) {
-    return F("Excellent");
-  } else if (rssi >= -60) {
-    return F("Strong");
-  } else if (rssi >= -70) {
-    return F("Medium");
-  } else if (rssi >= -80) {
-    return F("Low");
-  } else {
-    return F("Poor");
+
+  size_t size = out.size() + 4;
+  if (size > SNAPSHOT_MAX_SIZE) {
+    snapshotTooBig++;
+    snapshotClear();
+    Serial.printf("[SNAPSHOT] %u bytes, more than RTC memory holds; next boot reads flash\n", (unsigned)size);
+    return;
   }
+  buf[8] = size;
+  buf[9] = size >> 8;
+  putU32(buf + size - 4, crc32Update(0, buf, size - 4));
+  ESP.rtcUserMemoryWrite(RTC_SNAPSHOT_OFFSET, words, (size + 3) & ~3);
+  snapshotBytes = size;
+  snapshotSaves++;
+  Serial.printf("[SNAPSHOT] Saved %u bytes\n", (unsigned)size);
 }
 
-String generateFooter() {
-  String html = F("<div style='width:100%;background:#f1f1f1;color:#333;padding:10px 0;text-align:center;font-size:1em;border-radius:0 0 10px 10px;box-shadow:0 -2px 4px rgba(0,0,0,0.03);margin-top:20px;'>");
-  html += F("S/W version : ") + String(SOFTWARE_VERSION) + F("  mymail.arjun@gmail.com");
-  html += F("<br>H/W version: ") + String(hwVersion, 1);
-  html += F("<br>Available RAM: ") + String(ESP.getFreeHeap() / 1024.0, 2) + F(" KB");
-  html += F("<br>WiFi Signal: ") + getWiFiSignalStrength();
-  html += F("</div>");
-  return html;
+// In place of loadPersistentDataFromSPIFFS() and counterBegin(); false if
+// there is no usable snapshot
+bool snapshotRestore() {
+  uint32_t words[SNAPSHOT_MAX_SIZE / 4];
+  uint8_t* buf = (uint8_t*)words;
+  if (!ESP.rtcUserMemoryRead(RTC_SNAPSHOT_OFFSET, words, sizeof(words))) return false;
+  if (getU32(buf) != SNAPSHOT_MAGIC) return false; // Cold boot or crash
+  snapshotClear();
+  size_t size = buf[8] | (buf[9] << 8);
+  if (getU32(buf + 4) != snapshotBuild() || size < SNAPSHOT_HEADER_SIZE + 4 || size > SNAPSHOT_MAX_SIZE ||
+      getU32(buf + size - 4) != crc32Update(0, buf, size - 4)) {
+    Serial.println(F("[SNAPSHOT] Stale or damaged, reading flash"));
+    return false;
+  }
+
+  SnapshotReader in(buf + SNAPSHOT_HEADER_SIZE);
+  stateSlot = (int)in.u8() - 1;
+  stateSeq = in.u32();
+  stateBytes = in.u16();
+  counterGeneration = in.u32();
+  counterNext = in.u16();
+  uint32_t utcLow = in.u32();
+  snapshotClockUtcMs = (uint64_t)in.u32() << 32 | utcLow;
+  snapshotDriftPpm = (int32_t)in.u32();
+
+  timezoneOffset = (int32_t)in.u32();
+  maxConcurrentMotors = in.u8();
+  in.str(deviceName);
+  uint8_t flags = in.u8();
+  notifyLowFert = flags & 1;
+  notifyStart = flags & 2;
+  notifyDose = flags & 4;
+  blinkAllOk = flags & 8;
+  ledBrightness = in.u8();
+  in.str(lastNotifiedIP);
+  in.str(mqttHost);
+  mqttPort = in.u16();
+  in.str(mqttUser);
+  in.str(mqttPassword);
+  in.str(mqttTopic);
+  for (int n = 1; n <= MAX_CHANNELS; n++) {
+    Channel& c = getChannel(n);
+    ChannelCounters& k = channelCounters[n - 1];
+    in.str(c.name);
+    c.calibrationFactor = in.f32();
+    uint8_t channelFlags = in.u8();
+    c.calibrated = channelFlags & 1;
+    c.schedule.missedDoseCompensation = channelFlags & 2;
+    c.daysRemaining = (int32_t)in.u32();
+    if (channelFlags & 4) {
+      in.str(c.schedule.channelName);
+    } else {
+      c.schedule.channelName = c.name;
+    }
+    uint8_t days = in.u8();
+    for (int i = 0; i < 7; i++) {
+      DaySchedule& d = c.schedule.days[i];
+      if (!(days & (1 << i))) {
+        d = {false, 0, 0, 0.0f};
+        continue;
+      }
+      uint16_t time = in.u16();
+      d.enabled = time & 0x8000;
+      d.hour = (time & 0x7FFF) / 60;
+      d.minute = (time & 0x7FFF) % 60;
+      d.volume = in.f32();
+    }
+    k = {};
+    if (channelFlags & 8) {
+      k.remainingCentiMl = (int32_t)in.u32();
+      k.dispensedCentiMl = in.u32();
+      k.motorOnMs = in.u32();
+      k.lastDoseCentiMl = (int32_t)in.u32();
+      k.lastDoseAt = in.u32();
+      k.lastScheduledAt = in.u32();
+    }
+    if (k.lastDoseAt == 0) in.str(c.lastDispensedTime);
+  }
+  snapshotBytes = size;
+  counterReplayed = 0;
+  for (int n = 1; n <= MAX_CHANNELS; n++) {
+    counterSync(n);
+    scheduleChanged(n);
+  }
+  return true;
 }
 
-void handleRestartOnly() {
-  
- Serial.println(F("Restarting system..."));
+// --- Non-blocking motor control ---
+// runMotor() only queues a dose and returns. serviceMotor() is called from loop()
+// and starts queued doses in order, running different channels at the same time
+// up to maxConcurrentMotors. A one-shot Ticker per channel switches its motor off
+// on time even if loop() is busy; loop() then frees the slot for the next dose.
+#define DOSE_QUEUE_SIZE 8
+
+struct DoseRequest {
+  int channel;
+  unsigned long durationMs;
+  uint32_t scheduledEpoch; // Local epoch the dose was due, 0 if unscheduled
+  unsigned long queuedAt;  // millis() when queued
+  bool heldByLimit;        // Was ready but every motor slot was taken
+};
 
-  // Give browser time to receive response, then restart
-  delay(500);
-  ESP.restart();
+struct ActiveDose {
+  bool running;
+  volatile bool stopped;
+  unsigned long start;
+  unsigned long durationMs;
+  Ticker stopTicker;
+};
+
+DoseRequest doseQueue[DOSE_QUEUE_SIZE]; // Oldest first
+int doseQueueCount = 0;
+ActiveDose activeDoses[MAX_CHANNELS];
+LEDState ledStateBeforeDose = LED_OFF;
+
+// Start latency of scheduled doses: motor on time minus the scheduled time
+long lastStartLatencyMs[MAX_CHANNELS];
+long maxStartLatencyMs = 0;
+unsigned long dosesStartedLate = 0; // Waited for a free motor slot
+
+int motorPinForChannel(int channel) {
+  return motorPins[channel - 1];
 }
 
-void handleWiFiReset() {
- 
-  String redirectUrl = "http://" + deviceName;
-  redirectUrl.replace(" ", "-");
-  redirectUrl += ".local/";
-  String html = F("<html><head><meta name='viewport' content='width=device-width, initial-scale=1.0'><title>WiFi Reset</title></head><body style='font-family:Arial,sans-serif;background:#f4f4f9;color:#333;'><div style='max-width:500px;margin:40px auto;padding:24px;background:#fff;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.08);'><h2 style='color:#007BFF;'>WiFi Reset</h2><p>Since you have reset Wifi/System connect to <b>")+ deviceName + F("</b> access point from Wifi settings once device led glows purple and proceed with setting up WiFi again. Once WiFi connected click on link below:</p><div style='margin:18px 0;'><a href='");
-  html += redirectUrl;
-  html += F("' style='display:block;padding:14px 0;background:#007BFF;color:#fff;text-align:center;border-radius:6px;font-size:1.1em;text-decoration:none;'>");
-  html += redirectUrl;
-  html += F("</a></div></div></body></html>");
-  server.send(200, "text/html", html);
-  // Set flag and timer for reset in loop
-  pendingWiFiReset = true;
-  resetRequestTime = millis();
+// Runs from the Ticker callback, keep it short
+void stopMotorCallback(int channel) {
+  digitalWrite(motorPinForChannel(channel), LOW);
+  activeDoses[channel - 1].stopped = true;
 }
 
-void handleFactoryReset() {
+// Queue a motor run. Returns false if the channel is invalid or the queue is full.
+bool runMotor(int channel, int durationMs, uint32_t scheduledEpoch) {
+  if (!isValidChannel(channel)) return false;
+  if (durationMs <= 0) return true; // Nothing to dispense
+  if (doseQueueCount >= DOSE_QUEUE_SIZE) {
+    Serial.println(F("[DOSE] Queue full, dose rejected"));
+    return false;
+  }
+  DoseRequest& req = doseQueue[doseQueueCount++];
+  req.channel = channel;
+  req.durationMs = (unsigned long)durationMs;
+  req.scheduledEpoch = scheduledEpoch;
+  req.queuedAt = millis();
+  req.heldByLimit = false;
+  serviceMotor(); // Start right away if a motor slot is free
+  return true;
+}
 
-  String mac = WiFi.macAddress();
-  mac.replace(":", "");
-  String suffix = mac.substring(9,11);
-  String redirectUrl = "http://doser_" + suffix + ".local/";
-  String html = F("<html><head><meta name='viewport' content='width=device-width, initial-scale=1.0'><title>Factory Reset</title></head><body style='font-family:Arial,sans-serif;background:#f4f4f9;color:#333;'><div style='max-width:500px;margin:40px auto;padding:24px;background:#fff;border-radius:10px;box-shadow:0 4px 6px rgba(0,0,0,0.08);'><h2 style='color:#dc3545;'>Factory Reset</h2><p>Since you have reset System connect to <b>")+deviceName+F("</b> access point from Wifi settings once device led glows purple and proceed with setting up WiFi again. Once WiFi connected click on link below:</p><div style='margin:18px 0;'><a href='");
-  html += redirectUrl;
-  html += F("' style='display:block;padding:14px 0;background:#007BFF;color:#fff;text-align:center;border-radius:6px;font-size:1.1em;text-decoration:none;'>");
-  html += redirectUrl;
-  html += F("</a></div></div></body></html>");
-  server.send(200, "text/html", html);
-  // Set flag and timer for reset in loop
-  pendingFactoryReset = true;
-  resetRequestTime = millis();
+bool isDosing() {
+  return runningMotors > 0 || doseQueueCount > 0;
+}
+
+bool channelDosing(int channel) {
+  return activeDoses[channel - 1].running;
+}
+
+// A run queued for this channel now would start right away
+bool motorFree(int channel) {
+  return !channelDosing(channel) && !primingChannel() && runningMotors < maxConcurrentMotors;
+}
+
+// First channel with a motor running a dose, 0 if none
+int activeDoseChannel() {
+  for (int i = 0; i < MAX_CHANNELS; i++) {
+    if (activeDoses[i].running) return i + 1;
+  }
+  return 0;
+}
+
+void startDose(const DoseRequest& req) {
+  ActiveDose& d = activeDoses[req.channel - 1];
+  if (runningMotors == 0) ledStateBeforeDose = currentLEDState;
+  updateLED(channelLedColors[req.channel - 1]);
+
+  d.running = true;
+  d.stopped = false;
+  d.durationMs = req.durationMs;
+  d.start = millis();
+  runningMotors++;
+  digitalWrite(motorPinForChannel(req.channel), HIGH);
+  d.stopTicker.once_ms(req.durationMs, stopMotorCallback, req.channel);
+
+  unsigned long waitedMs = d.start - req.queuedAt;
+  if (req.heldByLimit) dosesStartedLate++;
+  if (req.scheduledEpoch != 0) {
+    // Time spent before queueing (scheduler poll interval) plus time in the queue
+    long latency = (long)(clockNow() - req.scheduledEpoch) * 1000L;
+    if (latency < (long)waitedMs) latency = waitedMs;
+    lastStartLatencyMs[req.channel - 1] = latency;
+    if (latency > maxStartLatencyMs) maxStartLatencyMs = latency;
+    Serial.print(F("[DOSE] Channel ")); Serial.print(req.channel);
+    Serial.print(F(" started ")); Serial.print(latency); Serial.println(F(" ms after its scheduled time"));
+  }
+}
+
+void serviceMotor() {
+  for (int i = 0; i < MAX_CHANNELS; i++) {
+    ActiveDose& d = activeDoses[i];
+    if (!d.running) continue;
+    // Fallback in case the ticker did not fire
+    if (!d.stopped && millis() - d.start >= d.durationMs) {
+      stopMotorCallback(i + 1);
+    }
+    if (!d.stopped) continue;
+    d.stopTicker.detach();
+    Serial.print(F("[DOSE] Channel ")); Serial.print(i + 1);
+    Serial.print(F(" done after ")); Serial.print(millis() - d.start); Serial.println(F(" ms"));
+    d.running = false;
+    runningMotors--;
+    // Restore previous LED state once every motor is off
+    if (runningMotors == 0) setLEDState(ledStateBeforeDose);
+  }
+
+  // Priming drives the motor pins directly, hold queued doses until it is done
+  if (doseQueueCount == 0 || primingChannel()) return;
+
+  // Start the oldest dose for each idle channel while slots are free.
+  // A busy channel keeps its later doses queued without blocking others.
+  int i = 0;
+  while (i < doseQueueCount && runningMotors < maxConcurrentMotors) {
+    DoseRequest req = doseQueue[i];
+    if (activeDoses[req.channel - 1].running) {
+      i++;
+      continue;
+    }
+    for (int j = i + 1; j < doseQueueCount; j++) doseQueue[j - 1] = doseQueue[j];
+    doseQueueCount--;
+    startDose(req);
+  }
+  // Whatever could have started now is waiting on the motor limit
+  for (; i < doseQueueCount; i++) {
+    if (!activeDoses[doseQueue[i].channel - 1].running) doseQueue[i].heldByLimit = true;
+  }
+}
+
+// loop() drives the motor while a channel is priming. One channel primes at a
+// time; returns false if another one already is.
+bool setPriming(int channel, bool state) {
+  Channel& c = getChannel(channel);
+  int priming = primingChannel();
+  if (state && priming && priming != channel) return false;
+  if (state && !c.priming) {
+    c.primeStartTime = millis();
+  } else if (!state && c.priming) {
+    // Log the run with the volume the calibration says it pumped
+    unsigned long ranMs = millis() - c.primeStartTime;
+    float factor = c.calibrationFactor;
+    doseLogAppend(channel, factor > 0.0f ? ranMs / factor : 0.0f, DOSE_SOURCE_PRIME, ranMs);
+    counterMotorRun(channel, ranMs);
+    // Stop the motor now; loop() leaves the pins alone while other motors run
+    if (!channelDosing(channel)) digitalWrite(motorPinForChannel(channel), LOW);
+  }
+  c.priming = state;
+  return true;
+}
+
+void handlePrimePump() {
+  if (server.hasArg("channel") && server.hasArg("state")) {
+    int channel = server.arg("channel").toInt();
+    bool state = server.arg("state") == "1";
+    if (!isValidChannel(channel)) {
+      server.send(400, "application/json", F("{\"error\":\"invalid channel\"}"));
+      return;
+    }
+    if (!setPriming(channel, state)) {
+      server.send(409, "application/json", F("{\"error\":\"another channel is priming\"}"));
+      return;
+    }
+
+    String msg = String(F("{\"status\":\"prime pump ")) + (state ? F("started") : F("stopped")) + F("\"}");
+    server.send(200, "application/json", msg);
+  } else {
+    server.send(400, "application/json", F("{\"error\":\"missing parameters\"}"));
+  }
+}
+
+// Serve a gzipped asset from flash, or 304 when the browser already has it
+void serveStaticAsset(const char* contentType, const char* etag, const uint8_t* data, size_t length) {
+  String quotedEtag = String('"') + etag + '"';
+  server.sendHeader(F("ETag"), quotedEtag);
+  server.sendHeader(F("Cache-Control"), F("public, max-age=31536000, immutable"));
+  if (server.header(F("If-None-Match")) == quotedEtag) {
+    server.send(304);
+    return;
+  }
+  server.sendHeader(F("Content-Encoding"), F("gzip"));
+  server.send_P(200, contentType, (PGM_P)data, length);
+}
+
+// Helper function to get WiFi signal strength description
+const __FlashStringHelper* getWiFiSignalStrength() {
+  if (WiFi.status() != WL_CONNECTED) {
+    return F("Disconnected");
+  }
+  
+  int32_t rssi = WiFi.RSSI();
+  
+  if (rssi >= -50) {
+    return F("Excellent");
+  } else if (rssi >= -60) {
+    return F("Strong");
+  } else if (rssi >= -70) {
+    return F("Medium");
+  } else if (rssi >= -80) {
+    return F("Low");
+  } else {
+    return F("Poor");
+  }
+}
+
+void handleRestartOnly() {
+  
+ Serial.println(F("Restarting system..."));
+
+  // Give browser time to receive response, then restart
+  flushPersistentData();
+  snapshotSave();
+  delay(500);
+  ESP.restart();
+}
+
+void handleWiFiReset() {
+  sendResetNotice(F("WiFi Reset"), F("#007BFF"), F("Wifi/System"), false);
+  // Set flag and timer for reset in loop
+  pendingWiFiReset = true;
+  resetRequestTime = millis();
+}
+
+void handleFactoryReset() {
+  sendResetNotice(F("Factory Reset"), F("#dc3545"), F("System"), true);
+  // Set flag and timer for reset in loop
+  pendingFactoryReset = true;
+  resetRequestTime = millis();
 }
 
 void handleSystemSettingsSave() {
@@ -2346,8 +4097,7 @@ void handleSystemSettingsSave() {
   if (server.hasArg("timezone")) {
     int newTimezone = server.arg("timezone").toInt();
     if (newTimezone != timezoneOffset) {
-      timezoneOffset = newTimezone;
-      timeClient.setTimeOffset(timezoneOffset); // Ensure NTP client uses new offset immediately
+      setTimezoneOffset(newTimezone);
       updated = true;
     }
   }
@@ -2357,6 +4107,7 @@ void handleSystemSettingsSave() {
     String newDeviceName = server.arg("deviceName");
     if (newDeviceName != deviceName) {
       deviceName = newDeviceName;
+      mqttDiscoveryNext = 0;
       updated = true;
     }
   }
@@ -2374,6 +4125,30 @@ void handleSystemSettingsSave() {
   if (oldNotifyLowFert != notifyLowFert || oldNotifyStart != notifyStart || oldNotifyDose != notifyDose) {
     updated = true;
   }
+  // MQTT broker, reconnects on change; a blank password keeps the stored one
+  if (server.hasArg("mqttHost")) {
+    String host = server.arg("mqttHost");
+    host.trim();
+    long port = server.hasArg("mqttPort") ? server.arg("mqttPort").toInt() : mqttPort;
+    if (port < 1 || port > 65535) port = MQTT_DEFAULT_PORT;
+    String user = server.arg("mqttUser");
+    String password = server.arg("mqttPassword");
+    String topic = server.arg("mqttTopic");
+    topic.trim();
+    while (topic.endsWith("/")) topic.remove(topic.length() - 1);
+    if (topic.length() == 0) topic = mqttTopic;
+    if (password.length() == 0) password = mqttPassword;
+    if (host != mqttHost || port != mqttPort || user != mqttUser || password != mqttPassword || topic != mqttTopic) {
+      mqttHost = host;
+      mqttPort = port;
+      mqttUser = user;
+      mqttPassword = password;
+      mqttTopic = topic;
+      mqttConfigChanged = true;
+      updated = true;
+    }
+  }
+
   if (server.hasArg("ledBrightness")) {
     int newBrightness = server.arg("ledBrightness").toInt();
     if (newBrightness < 0) newBrightness = 0;
@@ -2385,6 +4160,14 @@ void handleSystemSettingsSave() {
   // Save blinkAllOk if provided
   blinkAllOk = server.hasArg("blinkAllOk");
 
+  if (server.hasArg("maxMotors")) {
+    int newMax = server.arg("maxMotors").toInt();
+    if (newMax >= 1 && newMax <= MAX_CHANNELS) {
+      maxConcurrentMotors = newMax;
+      updated = true;
+    }
+  }
+
   // Save number of channels if provided
   //if (server.hasArg("numChannels")) {
   //  int newNumChannels = server.arg("numChannels").toInt();
@@ -2397,91 +4180,1413 @@ void handleSystemSettingsSave() {
   // Save other settings here as needed (device name, NTFY settings, etc.)
   
   // Always save to persist notification settings
-  savePersistentDataToSPIFFS();
+  markPersistentDataDirty();
   server.sendHeader("Location", "/summary");
   server.send(302, "text/plain", "");
 }
 
 // Helper: Send NTFY notification
+// --- Notification queue ---
+// sendNtfyNotification() only queues. loop() sends at most one message per
+// pass, spaced out, with a short timeout and exponential backoff on failure.
+#define NTFY_QUEUE_PATH "/ntfy_queue.json"
+const int NTFY_QUEUE_SIZE = 8;
+const uint16_t NTFY_TIMEOUT_MS = 3000;
+const unsigned long NTFY_MIN_INTERVAL_MS = 5000;   // ntfy.sh allows a send every 5 s
+const unsigned long NTFY_RETRY_BASE_MS = 10000;
+const unsigned long NTFY_RETRY_MAX_MS = 600000;
+const uint8_t NTFY_MAX_ATTEMPTS = 6;
+
+struct NtfyMessage {
+  String title;
+  String message;
+  uint8_t attempts;
+  unsigned long queuedAt;
+  unsigned long notBefore; // millis() of the next attempt
+};
+
+NtfyMessage ntfyQueue[NTFY_QUEUE_SIZE];
+int ntfyQueueHead = 0;
+int ntfyQueueCount = 0;
+bool ntfyQueueDirty = false;
+unsigned long ntfyQueueChangedAt = 0;
+unsigned long ntfyLastSendAt = 0;
+
+// Counters for /api/v1/status
+unsigned long ntfySent = 0;
+unsigned long ntfyFailed = 0;     // Attempts that failed (each retry counts)
+unsigned long ntfyDropped = 0;    // Messages given up on or pushed out of a full queue
+unsigned long ntfyCoalesced = 0;  // Duplicate alerts merged into a queued one
+unsigned long ntfyLastLatencyMs = 0;
+unsigned long ntfyMaxLatencyMs = 0;
+unsigned long ntfyMaxQueueDelayMs = 0;
+
+NtfyMessage& ntfyQueueAt(int i) {
+  return ntfyQueue[(ntfyQueueHead + i) % NTFY_QUEUE_SIZE];
+}
+
+void ntfyQueuePop() {
+  ntfyQueue[ntfyQueueHead].title = String();
+  ntfyQueue[ntfyQueueHead].message = String();
+  ntfyQueueHead = (ntfyQueueHead + 1) % NTFY_QUEUE_SIZE;
+  ntfyQueueCount--;
+  ntfyQueueDirty = true;
+  ntfyQueueChangedAt = millis();
+}
+
 void sendNtfyNotification(const String& title, const String& message) {
+  // The same low fertilizer alert is only kept once while it waits
+  if (title == F("Low Fertilizer Alert")) {
+    for (int i = 0; i < ntfyQueueCount; i++) {
+      if (ntfyQueueAt(i).title == title && ntfyQueueAt(i).message == message) {
+        ntfyCoalesced++;
+        return;
+      }
+    }
+  }
+  if (ntfyQueueCount == NTFY_QUEUE_SIZE) {
+    Serial.println(F("[NTFY] Queue full, dropping oldest: ") + ntfyQueueAt(0).title);
+    ntfyQueuePop();
+    ntfyDropped++;
+  }
+  NtfyMessage& m = ntfyQueueAt(ntfyQueueCount);
+  m.title = title;
+  m.message = message;
+  m.attempts = 0;
+  m.queuedAt = millis();
+  m.notBefore = 0;
+  ntfyQueueCount++;
+  ntfyQueueDirty = true;
+  ntfyQueueChangedAt = millis();
+  Serial.println(F("[NTFY] Queued: ") + title);
+}
+
+// Returns the HTTP status, or a negative HTTPClient error
+int postNtfyMessage(const NtfyMessage& m) {
   String mac = WiFi.macAddress();
   mac.replace(":", "");
   String ntfyUrl = F("http://ntfy.sh/") + mac;
   Serial.println(F("Sending NTFY notification to: ") + ntfyUrl);
   WiFiClient wifiClient;
   HTTPClient http;
+  http.setTimeout(NTFY_TIMEOUT_MS);
   http.begin(wifiClient, ntfyUrl);
-  http.addHeader(F("Title"), title);
-  http.POST(message);
+  http.addHeader(F("Title"), m.title);
+  int code = http.POST(m.message);
   http.end();
+  return code;
 }
 
-// Helper: Calculate days remaining for a channel
-int calculateDaysRemaining(float remainingML, WeeklySchedule* ws) {
-  int days = 0;
-  int dayIdx = (timeClient.getDay() + 6) % 7;
-  float rem = remainingML;
-  for (int i = 0; i < 365; ++i) {
-    int d = (dayIdx + i) % 7;
-    if (ws->days[d].enabled) {
-      float dose = ws->days[d].volume;
-      if (rem < dose || dose <= 0.0f) break;
-      rem -= dose;
-      days++;
+void serviceNtfyQueue() {
+  unsigned long now = millis();
+  // Keep the backlog on flash so it survives a reboot
+  if (ntfyQueueDirty && now - ntfyQueueChangedAt >= PERSIST_QUIET_MS) {
+    saveNtfyQueue();
+  }
+  if (ntfyQueueCount == 0 || WiFi.status() != WL_CONNECTED) return;
+  if (ntfyLastSendAt != 0 && now - ntfyLastSendAt < NTFY_MIN_INTERVAL_MS) return;
+  NtfyMessage& m = ntfyQueueAt(0);
+  if (m.notBefore != 0 && (long)(now - m.notBefore) < 0) return;
+
+  unsigned long start = millis();
+  int code = postNtfyMessage(m);
+  unsigned long latency = millis() - start;
+  ntfyLastSendAt = millis();
+  ntfyLastLatencyMs = latency;
+  if (latency > ntfyMaxLatencyMs) ntfyMaxLatencyMs = latency;
+
+  if (code >= 200 && code < 300) {
+    ntfySent++;
+    unsigned long queueDelay = millis() - m.queuedAt;
+    if (queueDelay > ntfyMaxQueueDelayMs) ntfyMaxQueueDelayMs = queueDelay;
+    Serial.printf("[NTFY] Sent in %lu ms\n", latency);
+    ntfyQueuePop();
+    return;
+  }
+
+  ntfyFailed++;
+  m.attempts++;
+  // Other 4xx answers will not get better by retrying
+  bool permanent = code >= 400 && code < 500 && code != 429;
+  if (permanent || m.attempts >= NTFY_MAX_ATTEMPTS) {
+    Serial.printf("[NTFY] Giving up after %d attempts (code %d)\n", m.attempts, code);
+    ntfyDropped++;
+    ntfyQueuePop();
+    return;
+  }
+  unsigned long backoff = NTFY_RETRY_BASE_MS << (m.attempts - 1);
+  if (backoff > NTFY_RETRY_MAX_MS) backoff = NTFY_RETRY_MAX_MS;
+  m.notBefore = millis() + backoff;
+  if (m.notBefore == 0) m.notBefore = 1;
+  Serial.printf("[NTFY] Send failed (code %d), retry in %lu s\n", code, backoff / 1000);
+}
+
+void saveNtfyQueue() {
+  if (!ntfyQueueDirty) return;
+  ntfyQueueDirty = false;
+  if (ntfyQueueCount == 0) {
+    LittleFS.remove(NTFY_QUEUE_PATH);
+    return;
+  }
+  File file = LittleFS.open(NTFY_QUEUE_PATH, "w");
+  if (!file) {
+    Serial.println(F("[NTFY] Failed to save queue"));
+    return;
+  }
+  JsonDocument doc;
+  JsonArray arr = doc.to<JsonArray>();
+  for (int i = 0; i < ntfyQueueCount; i++) {
+    JsonObject o = arr.add<JsonObject>();
+    o["title"] = ntfyQueueAt(i).title;
+    o["message"] = ntfyQueueAt(i).message;
+    o["attempts"] = ntfyQueueAt(i).attempts;
+  }
+  serializeJson(doc, file);
+  file.close();
+}
+
+void loadNtfyQueue() {
+  ntfyQueueHead = 0;
+  ntfyQueueCount = 0;
+  ntfyQueueDirty = false;
+  ntfyLastSendAt = 0;
+  File file = LittleFS.open(NTFY_QUEUE_PATH, "r");
+  if (!file) return;
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, file);
+  file.close();
+  if (error) {
+    Serial.println(F("[NTFY] Failed to parse saved queue"));
+    return;
+  }
+  for (JsonObject o : doc.as<JsonArray>()) {
+    if (ntfyQueueCount == NTFY_QUEUE_SIZE) break;
+    NtfyMessage& m = ntfyQueueAt(ntfyQueueCount);
+    m.title = o["title"] | "";
+    m.message = o["message"] | "";
+    m.attempts = o["attempts"] | 0;
+    m.queuedAt = millis();
+    m.notBefore = 0;
+    ntfyQueueCount++;
+  }
+  Serial.printf("[NTFY] Restored %d queued notifications\n", ntfyQueueCount);
+}
+
+// --- Days remaining ---
+// Number of upcoming scheduled doses the remaining fertilizer covers, looking
+// at most a year ahead. A day that is enabled with 0 ml ends the count.
+const int DAYS_REMAINING_HORIZON = 365;
+unsigned long daysRemainingComputed = 0; // Cache misses
+
+int32_t toCentiMl(float ml) {
+  return (int32_t)lroundf(ml * 100.0f);
+}
+
+void buildDoseForecast(const WeeklySchedule& ws, DoseForecast& f) {
+  f.prefixCentiMl[0] = 0;
+  f.prefixDoses[0] = 0;
+  for (int d = 0; d < 7; ++d) {
+    const DaySchedule& day = ws.days[d];
+    bool doses = day.enabled && day.volume > 0.0f;
+    // Tiny doses still cost something, or a week would be free
+    int32_t centi = doses ? max((int32_t)1, toCentiMl(day.volume)) : 0;
+    f.prefixCentiMl[d + 1] = f.prefixCentiMl[d] + centi;
+    f.prefixDoses[d + 1] = f.prefixDoses[d] + (doses ? 1 : 0);
+  }
+  f.weekCentiMl = f.prefixCentiMl[7];
+  f.weekDoses = f.prefixDoses[7];
+  for (int d = 0; d < 7; ++d) {
+    f.stopAfter[d] = 7;
+    for (int j = 0; j < 7; ++j) {
+      const DaySchedule& day = ws.days[(d + j) % 7];
+      if (day.enabled && day.volume <= 0.0f) {
+        f.stopAfter[d] = j;
+        break;
+      }
+    }
+  }
+}
+
+// Call after changing a channel's schedule
+void scheduleChanged(int channel) {
+  Channel& c = getChannel(channel);
+  c.scheduleVersion++;
+  buildDoseForecast(c.schedule, c.forecast);
+}
+
+// Volume of the k days (k <= 7) starting at weekday w, wrapping past Sunday
+int32_t forecastSpanCentiMl(const DoseForecast& f, int w, int k) {
+  if (w + k <= 7) return f.prefixCentiMl[w + k] - f.prefixCentiMl[w];
+  return f.weekCentiMl - f.prefixCentiMl[w] + f.prefixCentiMl[w + k - 7];
+}
+
+int forecastSpanDoses(const DoseForecast& f, int w, int k) {
+  if (w + k <= 7) return f.prefixDoses[w + k] - f.prefixDoses[w];
+  return f.weekDoses - f.prefixDoses[w] + f.prefixDoses[w + k - 7];
+}
+
+// Days remaining from weekday (0=Monday) on, bypassing the cache
+int daysRemainingAt(int channel, float remainingML, int weekday) {
+  const DoseForecast& f = getChannel(channel).forecast;
+  int32_t left = toCentiMl(remainingML);
+  if (left < 0) left = 0;
+  int limit = f.stopAfter[weekday];
+  int32_t weeks = 0;
+  if (limit == 7 && f.weekCentiMl > 0) {
+    weeks = min(left / f.weekCentiMl, (int32_t)(DAYS_REMAINING_HORIZON / 7));
+    left -= weeks * f.weekCentiMl;
+    limit = min(limit, DAYS_REMAINING_HORIZON - (int)weeks * 7);
+  }
+  // Partial week: the longest run of days the rest still pays for
+  int k = 0;
+  while (k < limit && forecastSpanCentiMl(f, weekday, k + 1) <= left) k++;
+  return weeks * f.weekDoses + forecastSpanDoses(f, weekday, k);
+}
+
+int calculateDaysRemaining(int channel) {
+  Channel& c = getChannel(channel);
+  int weekday = localTime().weekday;
+  DaysRemainingCache& m = c.daysCache;
+  if (m.remainingML != c.remainingML || m.scheduleVersion != c.scheduleVersion || m.weekday != weekday) {
+    m.remainingML = c.remainingML;
+    m.scheduleVersion = c.scheduleVersion;
+    m.weekday = weekday;
+    m.days = daysRemainingAt(channel, c.remainingML, weekday);
+    daysRemainingComputed++;
+  }
+  return m.days;
+}
+
+// Refresh the value shown in the UI. It is worked out again at boot, so a
+// change on its own does not rewrite the state record.
+void updateDaysRemaining(int channel) {
+  if (!isValidChannel(channel)) return;
+  getChannel(channel).daysRemaining = calculateDaysRemaining(channel);
+}
+
+// --- MQTT ---
+// Each channel's state is published retained under <topic>/channel/<n>/...
+// when it changes, and all of it again after every connect, so while the
+// broker is away only the latest value of each topic waits. Commands arrive
+// on <topic>/channel/<n>/{dose,prime,schedule}/set. Connect attempts back off,
+// so an unreachable broker costs a short timeout now and then, not every pass.
+#define MQTT_BUFFER_SIZE 512 // Room for a full week in a schedule command
+#define MQTT_TOPIC_MAX 96
+const uint16_t MQTT_CONNECT_TIMEOUT_MS = 1000;
+const uint16_t MQTT_SOCKET_TIMEOUT_S = 2;
+const unsigned long MQTT_RETRY_BASE_MS = 5000;
+const unsigned long MQTT_RETRY_MAX_MS = 300000;
+const int MQTT_PUBLISHES_PER_PASS = 4;
+
+enum MqttField : uint8_t {
+  MQTT_REMAINING,
+  MQTT_DAYS,
+  MQTT_LAST_DOSE_ML,
+  MQTT_LAST_DOSE_TIME,
+  MQTT_CALIBRATED,
+  MQTT_PRIMING,
+  MQTT_FIELD_COUNT
+};
+const char* const mqttFieldTopics[MQTT_FIELD_COUNT] = {"remaining_ml", "days_remaining", "last_dose_ml",
+                                                       "last_dose_time", "calibrated", "priming"};
+
+// What the broker last got for a channel
+struct MqttChannelState {
+  uint8_t pending; // Fields to send whatever their value, one bit per MqttField
+  int32_t remainingCentiMl;
+  int daysRemaining;
+  int32_t lastDoseCentiMl;
+  String lastDoseTime;
+  bool calibrated;
+  bool priming;
+};
+
+WiFiClient mqttWifiClient;
+PubSubClient mqttClient(mqttWifiClient);
+MqttChannelState mqttState[MAX_CHANNELS];
+unsigned long mqttRetryAt = 0;
+unsigned long mqttRetryDelayMs = 0; // 0 = connect as soon as possible
+
+// Counters for /api/v1/status
+unsigned long mqttConnects = 0;
+unsigned long mqttConnectFailures = 0;
+unsigned long mqttPublishes = 0;
+unsigned long mqttCommands = 0;
+
+// <topic>/channel/<n>/<leaf>, or <topic>/<leaf> for channel 0
+void mqttBuildTopic(char* buf, int channel, const char* leaf) {
+  if (channel) {
+    snprintf(buf, MQTT_TOPIC_MAX, "%s/channel/%d/%s", mqttTopic.c_str(), channel, leaf);
+  } else {
+    snprintf(buf, MQTT_TOPIC_MAX, "%s/%s", mqttTopic.c_str(), leaf);
+  }
+}
+
+// Publish the fields that changed or are pending, using up to budget publishes
+void mqttPublishChannel(int channel, int& budget) {
+  const Channel& c = getChannel(channel);
+  MqttChannelState& st = mqttState[channel - 1];
+  int32_t remaining = toCentiMl(c.remainingML);
+  int32_t lastDose = toCentiMl(c.lastDispensedVolume);
+  bool changed[MQTT_FIELD_COUNT] = {remaining != st.remainingCentiMl, c.daysRemaining != st.daysRemaining,
+                                    lastDose != st.lastDoseCentiMl, c.lastDispensedTime != st.lastDoseTime,
+                                    c.calibrated != st.calibrated, c.priming != st.priming};
+  for (int f = 0; f < MQTT_FIELD_COUNT; f++) {
+    if (!changed[f] && !(st.pending & bit(f))) continue;
+    if (budget == 0) return;
+    budget--;
+    char buf[16];
+    const char* payload = buf;
+    switch (f) {
+      case MQTT_REMAINING: snprintf(buf, sizeof(buf), "%.2f", c.remainingML); break;
+      case MQTT_DAYS: snprintf(buf, sizeof(buf), "%d", c.daysRemaining); break;
+      case MQTT_LAST_DOSE_ML: snprintf(buf, sizeof(buf), "%.2f", c.lastDispensedVolume); break;
+      case MQTT_LAST_DOSE_TIME: payload = c.lastDispensedTime.c_str(); break;
+      case MQTT_CALIBRATED: payload = c.calibrated ? "true" : "false"; break;
+      case MQTT_PRIMING: payload = c.priming ? "ON" : "OFF"; break;
+    }
+    char topic[MQTT_TOPIC_MAX];
+    mqttBuildTopic(topic, channel, mqttFieldTopics[f]);
+    if (!mqttClient.publish(topic, payload, true)) return; // Sent again after the reconnect
+    mqttPublishes++;
+    st.pending &= ~bit(f);
+    switch (f) {
+      case MQTT_REMAINING: st.remainingCentiMl = remaining; break;
+      case MQTT_DAYS: st.daysRemaining = c.daysRemaining; break;
+      case MQTT_LAST_DOSE_ML: st.lastDoseCentiMl = lastDose; break;
+      case MQTT_LAST_DOSE_TIME: st.lastDoseTime = c.lastDispensedTime; break;
+      case MQTT_CALIBRATED: st.calibrated = c.calibrated; break;
+      case MQTT_PRIMING: st.priming = c.priming; break;
+    }
+  }
+}
+
+// Same shape as a /api/v1/schedules entry. Days not listed keep their settings.
+void mqttScheduleCommand(int channel, const char* json) {
+  JsonDocument doc;
+  if (deserializeJson(doc, json)) {
+    Serial.println(F("[MQTT] Schedule command is not valid JSON"));
+    return;
+  }
+  WeeklySchedule& ws = getChannel(channel).schedule;
+  if (doc["missedDoseCompensation"].is<bool>()) ws.missedDoseCompensation = doc["missedDoseCompensation"];
+  for (JsonObject d : doc["days"].as<JsonArray>()) {
+    const char* name = d["day"] | "";
+    int i = 0;
+    while (i < 7 && strcasecmp(name, dayNames[i]) != 0) i++;
+    if (i == 7) continue;
+    DaySchedule& day = ws.days[i];
+    if (d["enabled"].is<bool>()) day.enabled = d["enabled"];
+    int h, m;
+    if (sscanf(d["time"] | "", "%d:%d", &h, &m) == 2 && h >= 0 && h < 24 && m >= 0 && m < 60) {
+      day.hour = h;
+      day.minute = m;
     }
+    if (d["volumeMl"].is<float>() && d["volumeMl"].as<float>() >= 0.0f) day.volume = d["volumeMl"];
   }
-  return days;
+  commitSchedule(channel);
 }
 
+// <topic>/channel/<n>/<command>/set
+void mqttCallback(char* topic, uint8_t* payload, unsigned int length) {
+  static char text[MQTT_BUFFER_SIZE];
+  if (length >= sizeof(text)) return;
+  memcpy(text, payload, length);
+  text[length] = '\0';
+  size_t base = mqttTopic.length();
+  if (strncmp(topic, mqttTopic.c_str(), base) != 0 || strncmp_P(topic + base, PSTR("/channel/"), 9) != 0) return;
+  char* command;
+  int channel = strtol(topic + base + 9, &command, 10);
+  if (!isValidChannel(channel) || *command++ != '/') return;
+  mqttCommands++;
+  Serial.printf("[MQTT] Command %s: %s\n", topic, text);
+  if (strcmp_P(command, PSTR("dose/set")) == 0) {
+    float ml = atof(text);
+    if (ml <= 0.0f || !dispenseManualDose(channel, ml)) Serial.println(F("[MQTT] Dose rejected"));
+  } else if (strcmp_P(command, PSTR("prime/set")) == 0) {
+    if (strcasecmp(text, "ON") == 0 || strcmp(text, "1") == 0) {
+      if (!setPriming(channel, true)) Serial.println(F("[MQTT] Prime rejected, another channel is priming"));
+    } else if (strcasecmp(text, "OFF") == 0 || strcmp(text, "0") == 0) {
+      setPriming(channel, false);
+    }
+  } else if (strcmp_P(command, PSTR("schedule/set")) == 0) {
+    mqttScheduleCommand(channel, text);
+  }
+}
+
+bool mqttConnect() {
+  char clientId[24];
+  snprintf(clientId, sizeof(clientId), "doser-%s", mqttMac);
+  char status[MQTT_TOPIC_MAX];
+  mqttBuildTopic(status, 0, "status");
+  const char* user = mqttUser.length() ? mqttUser.c_str() : nullptr;
+  const char* password = mqttPassword.length() ? mqttPassword.c_str() : nullptr;
+  if (!mqttClient.connect(clientId, user, password, status, 0, true, "offline")) return false;
+  mqttClient.publish(status, "online", true);
+  char commands[MQTT_TOPIC_MAX];
+  mqttBuildTopic(commands, 0, "channel/+/+/set");
+  mqttClient.subscribe(commands);
+  // The broker may hold values from before the outage, send everything again
+  for (int i = 0; i < MAX_CHANNELS; i++) mqttState[i].pending = bit(MQTT_FIELD_COUNT) - 1;
+  mqttDiscoveryNext = 0;
+  return true;
+}
+
+void mqttBegin() {
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  snprintf(mqttMac, sizeof(mqttMac), "%02X%02X%02X%02X%02X%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  if (mqttTopic.length() == 0) mqttTopic = String(F("doser/")) + mqttMac;
+  mqttWifiClient.setTimeout(MQTT_CONNECT_TIMEOUT_MS);
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+  mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+  mqttClient.setCallback(mqttCallback);
+  mqttConfigChanged = true;
+}
+
+// Called from loop(): connect when due, take one command, publish changes
+void mqttService() {
+  if (mqttConfigChanged) {
+    mqttConfigChanged = false;
+    mqttClient.disconnect();
+    mqttClient.setServer(mqttHost.c_str(), mqttPort);
+    mqttRetryDelayMs = 0;
+  }
+  if (mqttHost.length() == 0 || WiFi.status() != WL_CONNECTED) return;
+  if (!mqttClient.connected()) {
+    if (mqttRetryDelayMs != 0 && (long)(millis() - mqttRetryAt) < 0) return;
+    if (!mqttConnect()) {
+      mqttConnectFailures++;
+      mqttRetryDelayMs = mqttRetryDelayMs == 0 ? MQTT_RETRY_BASE_MS : min(mqttRetryDelayMs * 2, MQTT_RETRY_MAX_MS);
+      mqttRetryAt = millis() + mqttRetryDelayMs;
+      Serial.printf("[MQTT] Connect to %s:%u failed (state %d), retry in %lu s\n", mqttHost.c_str(), mqttPort,
+                    mqttClient.state(), mqttRetryDelayMs / 1000);
+      return;
+    }
+    mqttConnects++;
+    mqttRetryDelayMs = 0;
+    Serial.printf("[MQTT] Connected to %s:%u, topic %s\n", mqttHost.c_str(), mqttPort, mqttTopic.c_str());
+  }
+  mqttClient.loop();
+  int budget = MQTT_PUBLISHES_PER_PASS;
+  while (mqttDiscoveryNext < mqttDiscoveryCount() && budget > 0) {
+    budget--;
+    if (!mqttPublishDiscovery(mqttDiscoveryNext)) return;
+    mqttDiscoveryNext++;
+  }
+  for (int n = 1; n <= numChannels && budget > 0; n++) {
+    mqttPublishChannel(n, budget);
+  }
+}
+
+// --- Home Assistant discovery ---
+// One retained config per channel entity under
+// homeassistant/<component>/doser_<MAC>/ch<n>_<object>/config, sent once per
+// connection (and after a rename) ahead of the state topics. "~" in a config
+// stands for the base topic. Payloads are rendered from PROGMEM into a fixed
+// buffer, so discovery does not touch the heap.
+#define HA_DISCOVERY_PREFIX "homeassistant"
+
+static const char HA_DEVICE_JSON[] PROGMEM =
+  "\"avty_t\":\"~/status\","
+  "\"dev\":{\"ids\":[\"{{id}}\"],\"name\":\"{{deviceName}}\",\"mdl\":\"Doser\",\"sw\":\"{{version}}\",\"cu\":\"http://{{ip}}/\"}";
+
+static const char HA_REMAINING_JSON[] PROGMEM =
+  "{\"~\":\"{{base}}\",\"name\":\"{{name}} remaining\",\"uniq_id\":\"{{id}}_ch{{n}}_remaining\","
+  "\"stat_t\":\"~/channel/{{n}}/remaining_ml\",\"unit_of_meas\":\"mL\",\"dev_cla\":\"volume_storage\","
+  "\"stat_cla\":\"measurement\",{{device}}}";
+
+static const char HA_DAYS_JSON[] PROGMEM =
+  "{\"~\":\"{{base}}\",\"name\":\"{{name}} days remaining\",\"uniq_id\":\"{{id}}_ch{{n}}_days\","
+  "\"stat_t\":\"~/channel/{{n}}/days_remaining\",\"unit_of_meas\":\"d\",\"ic\":\"mdi:calendar-clock\",{{device}}}";
+
+// Setting a value doses that much; the state shows the last dose
+static const char HA_DOSE_JSON[] PROGMEM =
+  "{\"~\":\"{{base}}\",\"name\":\"{{name}} dose\",\"uniq_id\":\"{{id}}_ch{{n}}_dose\","
+  "\"cmd_t\":\"~/channel/{{n}}/dose/set\",\"stat_t\":\"~/channel/{{n}}/last_dose_ml\","
+  "\"min\":0.1,\"max\":100,\"step\":0.1,\"mode\":\"box\",\"unit_of_meas\":\"mL\",\"ic\":\"mdi:water-plus\",{{device}}}";
+
+static const char HA_PRIME_JSON[] PROGMEM =
+  "{\"~\":\"{{base}}\",\"name\":\"{{name}} prime\",\"uniq_id\":\"{{id}}_ch{{n}}_prime\","
+  "\"cmd_t\":\"~/channel/{{n}}/prime/set\",\"stat_t\":\"~/channel/{{n}}/priming\",\"ic\":\"mdi:pump\",{{device}}}";
+
+static const char HA_CALIBRATED_JSON[] PROGMEM =
+  "{\"~\":\"{{base}}\",\"name\":\"{{name}} calibrated\",\"uniq_id\":\"{{id}}_ch{{n}}_calibrated\","
+  "\"stat_t\":\"~/channel/{{n}}/calibrated\",\"pl_on\":\"true\",\"pl_off\":\"false\",\"ent_cat\":\"diagnostic\",{{device}}}";
+
+struct HaEntity {
+  const char* component;
+  const char* object;
+  PGM_P config;
+};
+
+const HaEntity haEntities[] = {
+  {"sensor", "remaining", HA_REMAINING_JSON},
+  {"sensor", "days", HA_DAYS_JSON},
+  {"number", "dose", HA_DOSE_JSON},
+  {"switch", "prime", HA_PRIME_JSON},
+  {"binary_sensor", "calibrated", HA_CALIBRATED_JSON},
+};
+const int HA_ENTITY_COUNT = sizeof(haEntities) / sizeof(haEntities[0]);
+
+// Leaves room in the client's buffer for the packet header and topic
+#define HA_PAYLOAD_MAX (MQTT_BUFFER_SIZE - MQTT_TOPIC_MAX - 7)
+char haPayload[HA_PAYLOAD_MAX];
+
+// Print into a fixed buffer, NUL terminated; overflowed() if it did not fit
+class BufferPrint : public Print {
+public:
+  BufferPrint(char* buf, size_t size) : _buf(buf), _size(size) { _buf[0] = '\0'; }
+  size_t write(uint8_t c) override {
+    if (_len + 1 >= _size) {
+      _overflowed = true;
+      return 0;
+    }
+    _buf[_len++] = c;
+    _buf[_len] = '\0';
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t size) override {
+    size_t n = 0;
+    while (n < size && write(data[n])) n++;
+    return n;
+  }
+  size_t length() const { return _len; }
+  bool overflowed() const { return _overflowed; }
+
+private:
+  char* _buf;
+  size_t _size;
+  size_t _len = 0;
+  bool _overflowed = false;
+};
+
+// Text as the inside of a JSON string
+void printJsonEscaped(Print& out, const char* text) {
+  for (const char* p = text; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      out.write('\\');
+      out.write(*p);
+    } else if ((uint8_t)*p < 0x20) {
+      out.printf("\\u%04x", *p);
+    } else {
+      out.write(*p);
+    }
+  }
+}
+
+int mqttDiscoveryCount() {
+  return numChannels * HA_ENTITY_COUNT;
+}
+
+// Config number index, channel by channel. False if the broker went away.
+bool mqttPublishDiscovery(int index) {
+  int channel = index / HA_ENTITY_COUNT + 1;
+  const HaEntity& e = haEntities[index % HA_ENTITY_COUNT];
+  const Channel& c = getChannel(channel);
+  auto deviceFill = [](Print& out, const char* slot) {
+    if (slotIs(slot, F("id"))) {
+      out.print(F("doser_"));
+      out.print(mqttMac);
+    } else if (slotIs(slot, F("deviceName"))) {
+      printJsonEscaped(out, deviceName.c_str());
+    } else if (slotIs(slot, F("ip"))) {
+      out.print(WiFi.localIP());
+    } else {
+      return false;
+    }
+    return true;
+  };
+  BufferPrint out(haPayload, sizeof(haPayload));
+  renderTemplate(out, e.config, [&](Print& out, const char* slot) {
+    if (slotIs(slot, F("base"))) {
+      printJsonEscaped(out, mqttTopic.c_str());
+    } else if (slotIs(slot, F("name"))) {
+      printJsonEscaped(out, c.name.c_str());
+    } else if (slotIs(slot, F("n"))) {
+      out.print(channel);
+    } else if (slotIs(slot, F("device"))) {
+      renderTemplate(out, HA_DEVICE_JSON, deviceFill);
+    } else {
+      return deviceFill(out, slot);
+    }
+    return true;
+  });
+  if (out.overflowed()) {
+    Serial.printf("[MQTT] Discovery config for channel %d %s does not fit, skipped\n", channel, e.object);
+    return true;
+  }
+  char topic[MQTT_TOPIC_MAX];
+  snprintf(topic, sizeof(topic), HA_DISCOVERY_PREFIX "/%s/doser_%s/ch%d_%s/config", e.component, mqttMac, channel,
+           e.object);
+  if (!mqttClient.publish(topic, haPayload, true)) return false;
+  mqttPublishes++;
+  return true;
+}
+
+// --- Firmware update ---
+// An image comes either as an upload to /update or as a pull from a local
+// HTTP server, started with /api/v1/firmware/pull. Either may be gzipped. The
+// Updater stores a gzipped image as it is and the bootloader inflates it while
+// copying, so the 32 KB inflate window never has to fit in the heap. If a
+// SHA-256 digest comes with the image, the received bytes are checked against
+// it before Update.end(true). A pull fetches OTA_PULL_CHUNK bytes per Range
+// request from loop(). A dropped connection resumes at the last byte written.
+// A server that ignores Range sends the whole image in one response; that is
+// kept open and read one chunk per loop() as well, but cannot resume.
+#define OTA_PULL_CHUNK 8192
+#define OTA_PULL_TIMEOUT_MS 5000
+#define OTA_PULL_RETRY_MS 1000 // Doubling after each failure in a row...
+#define OTA_PULL_RETRY_MAX_MS 16000 // ...up to this
+#define OTA_PULL_MAX_RETRIES 10 // Failed requests in a row before giving up
+#define OTA_RESTART_DELAY_MS 2000 // Lets the page see "done" after a pull
+#define OTA_LOG_EVERY_BYTES (64 * 1024UL)
+
+enum OtaState : uint8_t { OTA_IDLE, OTA_RECEIVING, OTA_PULLING, OTA_DONE, OTA_FAILED };
+const char* otaStateNames[] = {"idle", "receiving", "pulling", "done", "failed"};
+
+OtaState otaState = OTA_IDLE;
+bool otaGzip = false;
+bool otaVerify = false;    // A digest came with the image
+uint8_t otaDigest[32];     // ...and this is it
+br_sha256_context otaSha;
+uint32_t otaBytes = 0;     // Received and written
+uint32_t otaTotal = 0;     // Image size, 0 until known
+uint32_t otaLoggedBytes = 0;
+unsigned long otaStartedAt = 0;
+unsigned long otaFinishedAt = 0;
+String otaUrl;             // Pull source, empty for an upload
+String otaError;
+uint8_t otaRetries = 0;    // Failed pull requests in a row
+unsigned long otaResumes = 0;
+unsigned long otaRetryAt = 0;
+unsigned long otaRestartAt = 0;
+WiFiClient otaPullClient;
+HTTPClient otaPullHttp;
+uint32_t otaPullLeft = 0;  // Unread bytes of the open pull response, 0 if none
+
+void otaPullClose() {
+  if (otaPullLeft) otaPullHttp.end();
+  otaPullLeft = 0;
+}
+
+// 64 hex digits, either case
+bool parseSha256(const String& hex, uint8_t* out) {
+  if (hex.length() != 64) return false;
+  for (int i = 0; i < 64; i++) {
+    char c = tolower(hex[i]);
+    int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+    if (v < 0) return false;
+    if (i % 2 == 0) out[i / 2] = v << 4;
+    else out[i / 2] |= v;
+  }
+  return true;
+}
+
+float otaKBps() {
+  unsigned long ms = (otaFinishedAt ? otaFinishedAt : millis()) - otaStartedAt;
+  return ms ? otaBytes / 1.024f / ms : 0;
+}
+
+void otaFail(const String& error) {
+  otaPullClose();
+  if (Update.isRunning()) Update.end(); // Not all written: nothing is marked for boot
+  otaState = OTA_FAILED;
+  otaError = error;
+  otaFinishedAt = millis();
+  Serial.println(F("[OTA] Failed: ") + error);
+}
+
+bool otaBusy() {
+  return otaState == OTA_RECEIVING || otaState == OTA_PULLING;
+}
+
+// sha256 is empty or 64 hex digits
+bool otaBegin(OtaState state, const String& sha256) {
+  otaUrl = "";
+  otaError = "";
+  otaGzip = false;
+  otaBytes = otaTotal = otaLoggedBytes = 0;
+  otaStartedAt = millis();
+  otaFinishedAt = 0;
+  otaRetries = 0;
+  otaResumes = 0;
+  otaRestartAt = 0;
+  otaState = state;
+  otaVerify = sha256.length() > 0;
+  if (otaVerify && !parseSha256(sha256, otaDigest)) {
+    otaFail(F("sha256 must be 64 hex digits"));
+    return false;
+  }
+  br_sha256_init(&otaSha);
+  updateLED(LED_BLUE);
+  flushPersistentData();
+  if (Update.isRunning()) Update.end();
+  if (!Update.begin((ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000)) {
+    Update.printError(Serial);
+    otaFail(F("no room for the image"));
+    return false;
+  }
+  return true;
+}
+
+bool otaWrite(const uint8_t* data, size_t len) {
+  if (!otaBusy()) return false;
+  if (otaBytes == 0 && len >= 2) {
+    otaGzip = data[0] == 0x1F && data[1] == 0x8B;
+    if (!otaGzip && data[0] != 0xE9) {
+      otaFail(F("not a firmware image"));
+      return false;
+    }
+  }
+  if (Update.write((uint8_t*)data, len) != len) {
+    Update.printError(Serial);
+    otaFail(String(F("flash write failed, error ")) + String(Update.getError()));
+    return false;
+  }
+  br_sha256_update(&otaSha, data, len);
+  otaBytes += len;
+  if (otaBytes - otaLoggedBytes >= OTA_LOG_EVERY_BYTES) {
+    otaLoggedBytes = otaBytes;
+    if (otaTotal) {
+      Serial.printf("[OTA] %u of %u KB (%u%%), %.1f KB/s\n", otaBytes / 1024, otaTotal / 1024,
+                    (unsigned)(100ULL * otaBytes / otaTotal), otaKBps());
+    } else {
+      Serial.printf("[OTA] %u KB, %.1f KB/s\n", otaBytes / 1024, otaKBps());
+    }
+  }
+  return true;
+}
+
+bool otaFinish() {
+  if (!otaBusy()) return false;
+  if (otaVerify) {
+    uint8_t digest[32];
+    br_sha256_out(&otaSha, digest);
+    if (memcmp(digest, otaDigest, sizeof(digest)) != 0) {
+      otaFail(F("SHA-256 mismatch"));
+      return false;
+    }
+  }
+  if (!Update.end(true)) {
+    Update.printError(Serial);
+    otaFail(String(F("image rejected, error ")) + String(Update.getError()));
+    return false;
+  }
+  otaState = OTA_DONE;
+  otaFinishedAt = millis();
+  Serial.printf("[OTA] Done: %u bytes%s in %lu ms, %.1f KB/s, %s\n", otaBytes, otaGzip ? " gzipped" : "",
+                otaFinishedAt - otaStartedAt, otaKBps(), otaVerify ? "SHA-256 verified" : "not verified");
+  return true;
+}
+
+// Upload part of POST /update; the digest comes as ?sha256= or a form field
+// ahead of the file
 void handleFirmwareUpdate() {
-    HTTPUpload& upload = server.upload();
+  HTTPUpload& upload = server.upload();
   if (upload.status == UPLOAD_FILE_START) {
-    updateLED(LED_BLUE); // Set LED to purple at start
-    Serial.setDebugOutput(true);
     Serial.printf("[OTA] Update: %s\n", upload.filename.c_str());
-    if (!Update.begin((ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000)) {
-      Update.printError(Serial);
-    }
+    // One request at a time, so an upload still open here has been cut off
+    if (otaState == OTA_PULLING) return; // The response handler reports it
+    otaBegin(OTA_RECEIVING, server.arg("sha256"));
   } else if (upload.status == UPLOAD_FILE_WRITE) {
-    if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
-      Update.printError(Serial);
-    }
+    if (otaState == OTA_RECEIVING) otaWrite(upload.buf, upload.currentSize);
   } else if (upload.status == UPLOAD_FILE_END) {
-    if (Update.end(true)) {
-      Serial.printf("[OTA] Update Success: %u bytes\nRebooting...\n", upload.totalSize);
-   //   updateLED(LED_GREEN); // Set LED to green when done
-   //   delay(1000); // Show green for 1 second
-    } else {
-      Update.printError(Serial);
-    }
-    Serial.setDebugOutput(false);
+    if (otaState == OTA_RECEIVING) otaFinish();
   } else if (upload.status == UPLOAD_FILE_ABORTED) {
-    Update.end();
-    Serial.println(F("[OTA] Update was aborted"));
+    if (otaState == OTA_RECEIVING) otaFail(F("upload aborted"));
   }
   yield();
 }
 
-// New function to update days remaining and persist
-template<typename T>
-void updateDaysRemaining(int channel, float remainingML, T* ws) {
-  int days = 0;
-  int dayIdx = (timeClient.getDay() + 6) % 7;
-  float rem = remainingML;
-  for (int i = 0; i < 365; ++i) {
-    int d = (dayIdx + i) % 7;
-    if (ws->days[d].enabled) {
-      float dose = ws->days[d].volume;
-      if (rem < dose || dose <= 0.0f) break;
-      rem -= dose;
-      days++;
+void sendOtaError(int code) {
+  JsonDocument doc;
+  doc["error"] = otaError;
+  String body;
+  serializeJson(doc, body);
+  server.send(code, "application/json", body);
+}
+
+// Response part of POST /update
+void handleFirmwareUploaded() {
+  if (otaState == OTA_PULLING) {
+    server.send(409, "application/json", F("{\"error\":\"a pull is in progress\"}"));
+    return;
+  }
+  if (otaState != OTA_DONE) {
+    sendOtaError(400);
+    return;
+  }
+  server.send(200, "text/plain", F("OK"));
+  flushPersistentData();
+  delay(100);
+  ESP.restart();
+}
+
+// POST /api/v1/firmware/pull?url=http://host/firmware.bin[.gz]&sha256=...
+void handleFirmwarePull() {
+  String url = server.arg("url");
+  if (!url.startsWith(F("http://"))) {
+    server.send(400, "application/json", F("{\"error\":\"url must start with http://\"}"));
+    return;
+  }
+  if (otaBusy()) {
+    server.send(409, "application/json", F("{\"error\":\"an update is in progress\"}"));
+    return;
+  }
+  if (!otaBegin(OTA_PULLING, server.arg("sha256"))) {
+    sendOtaError(400);
+    return;
+  }
+  otaUrl = url;
+  otaRetryAt = millis();
+  Serial.println(F("[OTA] Pulling ") + url);
+  handleApiFirmware();
+}
+
+// A failed or cut request; the next one starts at otaBytes
+void otaPullRetry(const String& why) {
+  if (++otaRetries > OTA_PULL_MAX_RETRIES) {
+    otaFail(why);
+    return;
+  }
+  unsigned long wait = min((unsigned long)OTA_PULL_RETRY_MS << (otaRetries - 1), (unsigned long)OTA_PULL_RETRY_MAX_MS);
+  Serial.printf("[OTA] %s at %u bytes, retry %u in %lu ms\n", why.c_str(), otaBytes, otaRetries, wait);
+  otaRetryAt = millis() + wait;
+}
+
+// Sends the request for the next chunk and leaves its response open in
+// otaPullHttp. Returns false if there is nothing to read.
+bool otaPullRequest() {
+  uint32_t last = otaBytes + OTA_PULL_CHUNK - 1;
+  if (otaTotal && last >= otaTotal) last = otaTotal - 1;
+  otaPullHttp.setTimeout(OTA_PULL_TIMEOUT_MS);
+  otaPullHttp.begin(otaPullClient, otaUrl);
+  static const char* headers[] = {"Content-Range"};
+  otaPullHttp.collectHeaders(headers, 1);
+  char range[32];
+  snprintf(range, sizeof(range), "bytes=%u-%u", otaBytes, last);
+  otaPullHttp.addHeader(F("Range"), range);
+  int code = otaPullHttp.GET();
+
+  if (code == HTTP_CODE_PARTIAL_CONTENT) {
+    // "bytes first-last/total"
+    unsigned long first = 0, end = 0, total = 0;
+    String range = otaPullHttp.header("Content-Range");
+    if (sscanf(range.c_str(), "bytes %lu-%lu/%lu", &first, &end, &total) != 3 || first != otaBytes || end < first) {
+      otaPullHttp.end();
+      otaFail(F("bad Content-Range from server"));
+      return false;
+    }
+    otaTotal = total;
+    otaPullLeft = end - first + 1;
+    return true;
+  }
+  if (code == HTTP_CODE_OK && otaBytes == 0 && otaPullHttp.getSize() > 0) {
+    // No Range support: the whole image in this one response
+    otaTotal = otaPullHttp.getSize();
+    otaPullLeft = otaTotal;
+    return true;
+  }
+  otaPullHttp.end();
+  if (code == HTTP_CODE_OK) {
+    otaFail(F("server does not support Range, cannot resume"));
+  } else if (code > 0 && code != 429 && code < 500) {
+    otaFail(String(F("HTTP ")) + String(code));
+  } else {
+    otaPullRetry(code > 0 ? String(F("HTTP ")) + String(code) : HTTPClient::errorToString(code));
+  }
+  return false;
+}
+
+// At most OTA_PULL_CHUNK bytes per call while pulling, then the restart
+void otaService() {
+  if (otaState == OTA_DONE && otaRestartAt && (long)(millis() - otaRestartAt) >= 0) {
+    flushPersistentData();
+    ESP.restart();
+    return;
+  }
+  if (otaState != OTA_PULLING || (long)(millis() - otaRetryAt) < 0) return;
+  if (WiFi.status() != WL_CONNECTED) return;
+  if (!otaPullLeft && !otaPullRequest()) return;
+
+  WiFiClient* stream = otaPullHttp.getStreamPtr();
+  uint8_t buf[512];
+  uint32_t want = min(otaPullLeft, (uint32_t)OTA_PULL_CHUNK);
+  uint32_t got = 0;
+  while (got < want) {
+    size_t n = stream->readBytes(buf, min((uint32_t)sizeof(buf), want - got));
+    if (n == 0) break;
+    if (!otaWrite(buf, n)) break;
+    got += n;
+  }
+  if (otaState != OTA_PULLING) return; // otaWrite() failed and closed it
+  otaPullLeft -= got;
+  if (got < want) {
+    otaPullClose();
+    otaResumes++;
+    otaPullRetry(F("connection lost"));
+    return;
+  }
+  otaRetries = 0;
+  if (!otaPullLeft) otaPullHttp.end();
+  if (otaBytes >= otaTotal && otaFinish()) otaRestartAt = millis() + OTA_RESTART_DELAY_MS;
+}
+
+// Progress of the current or last update
+void handleApiFirmware() {
+  JsonDocument doc;
+  doc["state"] = otaStateNames[otaState];
+  doc["source"] = otaUrl.length() ? "pull" : "upload";
+  if (otaUrl.length()) doc["url"] = otaUrl;
+  doc["gzip"] = otaGzip;
+  doc["verified"] = otaVerify;
+  doc["bytes"] = otaBytes;
+  doc["total"] = otaTotal;
+  doc["percent"] = otaTotal ? (int)(100ULL * otaBytes / otaTotal) : 0;
+  doc["elapsedMs"] = otaStartedAt ? (otaFinishedAt ? otaFinishedAt : millis()) - otaStartedAt : 0;
+  doc["kbps"] = roundf(otaKBps() * 10) / 10;
+  doc["retries"] = otaRetries;
+  doc["resumes"] = otaResumes;
+  if (otaError.length()) doc["error"] = otaError;
+
+  ChunkedResponse out;
+  serializeJson(doc, out);
+  out.end();
+}
+
+// --- Prometheus metrics (/metrics) ---
+static const char METRICS_TEXT[] PROGMEM =
+  "# HELP doser_heap_free_bytes Free heap.\n"
+  "# TYPE doser_heap_free_bytes gauge\n"
+  "doser_heap_free_bytes {{heapFree}}\n"
+  "# HELP doser_heap_free_min_bytes Lowest free heap seen since boot.\n"
+  "# TYPE doser_heap_free_min_bytes gauge\n"
+  "doser_heap_free_min_bytes {{heapFreeMin}}\n"
+  "# HELP doser_heap_max_free_block_bytes Largest block that can be allocated.\n"
+  "# TYPE doser_heap_max_free_block_bytes gauge\n"
+  "doser_heap_max_free_block_bytes {{heapMaxBlock}}\n"
+  "# HELP doser_heap_fragmentation_percent Heap fragmentation.\n"
+  "# TYPE doser_heap_fragmentation_percent gauge\n"
+  "doser_heap_fragmentation_percent {{heapFragmentation}}\n"
+  "# HELP doser_stack_free_min_bytes Least free loop stack since boot.\n"
+  "# TYPE doser_stack_free_min_bytes gauge\n"
+  "doser_stack_free_min_bytes {{stackFreeMin}}\n"
+  "# HELP doser_uptime_seconds Time since boot.\n"
+  "# TYPE doser_uptime_seconds counter\n"
+  "doser_uptime_seconds {{uptime}}\n"
+  "# HELP doser_boot_phase_seconds Time spent in each phase of setup() this boot.\n"
+  "# TYPE doser_boot_phase_seconds gauge\n"
+  "{{bootPhases}}"
+  "# HELP doser_http_request_duration_seconds Handler time per route.\n"
+  "# TYPE doser_http_request_duration_seconds summary\n"
+  "{{durationSum}}{{durationCount}}"
+  "# HELP doser_http_request_duration_max_seconds Longest handler time per route.\n"
+  "# TYPE doser_http_request_duration_max_seconds gauge\n"
+  "{{durationMax}}"
+  "# HELP doser_http_request_heap_peak_bytes Largest drop in free heap during one request, per route.\n"
+  "# TYPE doser_http_request_heap_peak_bytes gauge\n"
+  "{{heapPeak}}";
+
+const __FlashStringHelper* httpMethodName(HTTPMethod method) {
+  switch (method) {
+    case HTTP_GET: return F("GET");
+    case HTTP_HEAD: return F("HEAD");
+    case HTTP_POST: return F("POST");
+    case HTTP_PUT: return F("PUT");
+    case HTTP_PATCH: return F("PATCH");
+    case HTTP_DELETE: return F("DELETE");
+    case HTTP_OPTIONS: return F("OPTIONS");
+    default: return F("ANY");
+  }
+}
+
+// name{route="/x",method="GET"} value, for each route that has been requested
+template <typename Value>
+void printRouteSamples(Print& out, const __FlashStringHelper* name, Value value) {
+  for (int i = 0; i < routeMetricsCount; i++) {
+    const RouteMetrics& r = routeMetrics[i];
+    if (r.requests == 0) continue;
+    out.print(name);
+    out.print(F("{route=\""));
+    out.print(r.uri);
+    out.print(F("\",method=\""));
+    out.print(httpMethodName(r.method));
+    out.print(F("\"} "));
+    value(out, r);
+    out.print('\n');
+  }
+}
+
+void handleMetrics() {
+  sampleHeap();
+  ChunkedResponse out("text/plain; version=0.0.4");
+  renderTemplate(out, METRICS_TEXT, [](Print& out, const char* slot) {
+    if (slotIs(slot, F("heapFree"))) {
+      out.print(ESP.getFreeHeap());
+    } else if (slotIs(slot, F("heapFreeMin"))) {
+      out.print(heapFreeMin);
+    } else if (slotIs(slot, F("heapMaxBlock"))) {
+      out.print(ESP.getMaxFreeBlockSize());
+    } else if (slotIs(slot, F("heapFragmentation"))) {
+      out.print(ESP.getHeapFragmentation());
+    } else if (slotIs(slot, F("stackFreeMin"))) {
+      out.print(ESP.getFreeContStack());
+    } else if (slotIs(slot, F("uptime"))) {
+      out.print((unsigned long)(monoMillis() / 1000));
+    } else if (slotIs(slot, F("bootPhases"))) {
+      for (int p = 0; p < BOOT_PHASE_COUNT; p++) {
+        out.printf("doser_boot_phase_seconds{phase=\"%s\"} ", bootPhaseNames[p]);
+        out.print(bootRecord.phaseUs[p] / 1e6, 6);
+        out.print('\n');
+      }
+    } else if (slotIs(slot, F("durationSum"))) {
+      printRouteSamples(out, F("doser_http_request_duration_seconds_sum"), [](Print& out, const RouteMetrics& r) {
+        out.print(r.totalUs / 1e6, 6);
+      });
+    } else if (slotIs(slot, F("durationCount"))) {
+      printRouteSamples(out, F("doser_http_request_duration_seconds_count"), [](Print& out, const RouteMetrics& r) {
+        out.print(r.requests);
+      });
+    } else if (slotIs(slot, F("durationMax"))) {
+      printRouteSamples(out, F("doser_http_request_duration_max_seconds"), [](Print& out, const RouteMetrics& r) {
+        out.print(r.maxUs / 1e6, 6);
+      });
+    } else if (slotIs(slot, F("heapPeak"))) {
+      printRouteSamples(out, F("doser_http_request_heap_peak_bytes"), [](Print& out, const RouteMetrics& r) {
+        out.print(r.peakHeapDelta);
+      });
+    } else {
+      return false;
+    }
+    return true;
+  });
+  out.end();
+}
+
+// --- JSON API (/api/v1) ---
+// Responses are serialized straight into a ChunkedResponse
+
+// Channels exposed by the API (those fitted on this board)
+int apiChannelCount() {
+  return numChannels;
+}
+
+// ?channel=N limits list endpoints to one channel
+bool apiChannelSelected(int channel) {
+  return !server.hasArg("channel") || server.arg("channel").toInt() == channel;
+}
+
+void handleApiStatus() {
+  JsonDocument doc;
+  doc["version"] = SOFTWARE_VERSION;
+  doc["hwVersion"] = hwVersion;
+  doc["deviceName"] = deviceName;
+  doc["uptimeMs"] = millis();
+  doc["timeSynced"] = timeSynced;
+  doc["epoch"] = clockNow();
+  JsonObject boot = doc["boot"].to<JsonObject>();
+  boot["setupMs"] = bootSetupMs;
+  boot["onlineMs"] = bootOnlineMs;
+  boot["readyMs"] = bootReadyMs;
+  boot["network"] = netStateNames[netState];
+  boot["wifiAttempts"] = wifiRetryCount;
+  boot["wifiConnectMs"] = netConnectMs;
+  boot["fastReconnect"] = netConnectedFast;
+  boot["fastFallbacks"] = netFastFallbacks;
+  boot["stateSource"] = bootStateSource;
+  boot["stateUs"] = bootRecord.phaseUs[BOOT_STATE];
+  boot["snapshotBytes"] = snapshotBytes;
+  boot["portal"] = apModeActive;
+  doc["time"] = getFormattedTime();
+  doc["freeHeap"] = ESP.getFreeHeap();
+  JsonObject wifi = doc["wifi"].to<JsonObject>();
+  wifi["connected"] = (WiFi.status() == WL_CONNECTED);
+  wifi["rssi"] = WiFi.RSSI();
+  wifi["ip"] = WiFi.localIP().toString();
+  JsonObject pump = doc["pump"].to<JsonObject>();
+  pump["activeChannel"] = activeDoseChannel();
+  pump["running"] = runningMotors;
+  pump["maxConcurrent"] = maxConcurrentMotors;
+  pump["queued"] = doseQueueCount;
+  pump["startedLate"] = dosesStartedLate;
+  pump["maxStartLatencyMs"] = maxStartLatencyMs;
+  pump["priming"] = primingChannel();
+  JsonObject sched = doc["scheduler"].to<JsonObject>();
+  sched["nextDueEpoch"] = doseHeapSize > 0 ? doseHeap[0].due : 0;
+  sched["nextChannel"] = doseHeapSize > 0 ? doseHeap[0].channel : 0;
+  sched["rebuilds"] = schedulerRebuilds;
+  JsonObject clock = doc["clock"].to<JsonObject>();
+  clock["estimated"] = clockEstimated;
+  clock["syncs"] = ntpSyncs;
+  clock["failures"] = ntpFailures;
+  clock["driftPpm"] = clockDriftPpm;
+  clock["lastCorrectionMs"] = clockLastCorrectionMs;
+  JsonObject ntfy = doc["notifications"].to<JsonObject>();
+  ntfy["queued"] = ntfyQueueCount;
+  ntfy["sent"] = ntfySent;
+  ntfy["failed"] = ntfyFailed;
+  ntfy["dropped"] = ntfyDropped;
+  ntfy["coalesced"] = ntfyCoalesced;
+  ntfy["lastLatencyMs"] = ntfyLastLatencyMs;
+  ntfy["maxLatencyMs"] = ntfyMaxLatencyMs;
+  ntfy["maxQueueDelayMs"] = ntfyMaxQueueDelayMs;
+  JsonObject mqtt = doc["mqtt"].to<JsonObject>();
+  mqtt["connected"] = mqttClient.connected();
+  mqtt["state"] = mqttClient.state();
+  mqtt["connects"] = mqttConnects;
+  mqtt["connectFailures"] = mqttConnectFailures;
+  mqtt["published"] = mqttPublishes;
+  mqtt["commands"] = mqttCommands;
+  JsonObject counters = doc["counters"].to<JsonObject>();
+  counters["records"] = counterNext;
+  counters["capacity"] = COUNTER_CAPACITY;
+  counters["generation"] = counterGeneration;
+  counters["replayed"] = counterReplayed;
+  counters["appends"] = counterAppends;
+  counters["compactions"] = counterCompactions;
+  counters["writeFailures"] = counterWriteFailures;
+  counters["stateWrites"] = persistentDataWrites;
+
+  ChunkedResponse out;
+  serializeJson(doc, out);
+  out.end();
+}
+
+void handleApiChannels() {
+  ChunkedResponse out;
+  out.print(F("{\"channels\":["));
+  bool first = true;
+  for (int channel = 1; channel <= apiChannelCount(); channel++) {
+    if (!apiChannelSelected(channel)) continue;
+    const Channel& c = getChannel(channel);
+    JsonDocument doc;
+    doc["channel"] = channel;
+    doc["name"] = c.name;
+    doc["calibrated"] = c.calibrated;
+    doc["calibrationMsPerMl"] = c.calibrationFactor;
+    doc["remainingMl"] = c.remainingML;
+    doc["daysRemaining"] = c.daysRemaining;
+    doc["lastDispensedMl"] = c.lastDispensedVolume;
+    doc["lastDispensedTime"] = c.lastDispensedTime;
+    doc["lastScheduledDoseEpoch"] = c.lastScheduledDoseTime;
+    doc["dispensedTotalMl"] = channelCounters[channel - 1].dispensedCentiMl / 100.0f;
+    doc["motorOnMs"] = channelCounters[channel - 1].motorOnMs;
+    doc["lastStartLatencyMs"] = lastStartLatencyMs[channel - 1];
+    if (!first) out.print(',');
+    first = false;
+    serializeJson(doc, out);
+  }
+  out.print(F("]}"));
+  out.end();
+}
+
+void handleApiSchedules() {
+  ChunkedResponse out;
+  out.print(F("{\"schedules\":["));
+  bool first = true;
+  for (int channel = 1; channel <= apiChannelCount(); channel++) {
+    if (!apiChannelSelected(channel)) continue;
+    const WeeklySchedule* ws = &getChannel(channel).schedule;
+    JsonDocument doc;
+    doc["channel"] = channel;
+    doc["missedDoseCompensation"] = ws->missedDoseCompensation;
+    JsonArray days = doc["days"].to<JsonArray>();
+    for (int i = 0; i < 7; ++i) {
+      JsonObject d = days.add<JsonObject>();
+      char timebuf[6];
+      snprintf(timebuf, sizeof(timebuf), "%02d:%02d", ws->days[i].hour, ws->days[i].minute);
+      d["day"] = dayNames[i];
+      d["enabled"] = ws->days[i].enabled;
+      d["time"] = timebuf;
+      d["volumeMl"] = ws->days[i].volume;
+    }
+    if (!first) out.print(',');
+    first = false;
+    serializeJson(doc, out);
+  }
+  out.print(F("]}"));
+  out.end();
+}
+
+// Dose events from the log. Query: after=<seq>, from/to=<UTC epoch>,
+// channel=N, source=<name>, limit=N (default 100). Continue with after=next.
+void handleApiHistory() {
+  uint32_t after = server.hasArg("after") ? strtoul(server.arg("after").c_str(), nullptr, 10) : 0;
+  uint32_t from = server.hasArg("from") ? strtoul(server.arg("from").c_str(), nullptr, 10) : 0;
+  uint32_t to = server.hasArg("to") ? strtoul(server.arg("to").c_str(), nullptr, 10) : 0xFFFFFFFFUL;
+  int channel = server.hasArg("channel") ? server.arg("channel").toInt() : 0;
+  int source = -1;
+  if (server.hasArg("source")) {
+    String name = server.arg("source");
+    for (int i = 0; i < DOSE_SOURCE_COUNT; i++) {
+      if (name == doseSourceNames[i]) source = i;
+    }
+    if (source < 0) {
+      server.send(400, "application/json", F("{\"error\":\"unknown source\"}"));
+      return;
+    }
+  }
+  long limit = server.hasArg("limit") ? server.arg("limit").toInt() : 100;
+  if (limit <= 0 || limit > 1000) limit = 1000;
+
+  uint32_t start = after + 1;
+  if (from > 0) {
+    uint32_t fromSeq = doseLogSeqAtOrAfter(from);
+    if (fromSeq > start) start = fromSeq;
+  }
+
+  ChunkedResponse out;
+  out.print(F("{\"first\":")); out.print(doseLogFirst);
+  out.print(F(",\"last\":")); out.print(doseLogLast);
+  out.print(F(",\"capacity\":")); out.print(DOSE_LOG_CAPACITY);
+  out.print(F(",\"events\":["));
+  DoseLogReader reader(start);
+  DoseEvent e;
+  long count = 0;
+  uint32_t next = 0;
+  while (reader.next(e)) {
+    next = e.seq;
+    if (e.epoch > to && e.epoch != 0) break;
+    if (e.epoch < from || (channel && e.channel != channel) || (source >= 0 && e.source != source)) continue;
+    if (count > 0) out.print(',');
+    out.print(F("{\"seq\":")); out.print(e.seq);
+    out.print(F(",\"epoch\":")); out.print(e.epoch);
+    out.print(F(",\"channel\":")); out.print(e.channel);
+    out.print(F(",\"source\":\"")); out.print(doseSourceNames[e.source]);
+    out.print(F("\",\"volumeMl\":")); out.print(e.volumeMl, 2);
+    out.print(F(",\"durationMs\":")); out.print(e.durationMs);
+    out.print('}');
+    if (++count >= limit) break;
+  }
+  out.print(F("],\"next\":"));
+  if (count >= limit && next < doseLogLast) {
+    out.print(next);
+  } else {
+    out.print(F("null"));
+  }
+  out.print('}');
+  out.end();
+}
+
+void handleApiSettings() {
+  JsonDocument doc;
+  doc["deviceName"] = deviceName;
+  doc["timezoneOffset"] = timezoneOffset;
+  doc["numChannels"] = numChannels;
+  doc["maxConcurrentMotors"] = maxConcurrentMotors;
+  doc["calibrationTimeMs"] = calibrationTimeMs;
+  doc["ledBrightness"] = ledBrightness;
+  doc["blinkAllOk"] = blinkAllOk;
+  JsonObject notify = doc["notify"].to<JsonObject>();
+  notify["lowFertilizer"] = notifyLowFert;
+  notify["start"] = notifyStart;
+  notify["dose"] = notifyDose;
+  JsonObject mqtt = doc["mqtt"].to<JsonObject>();
+  mqtt["host"] = mqttHost;
+  mqtt["port"] = mqttPort;
+  mqtt["user"] = mqttUser;
+  mqtt["topic"] = mqttTopic;
+
+  ChunkedResponse out;
+  serializeJson(doc, out);
+  out.end();
+}
+
+// The persistent record as JSON, for debugging. Fields come from RAM, which
+// matches the stored record unless "dirty" (a write is pending).
+void handleApiState() {
+  JsonDocument doc;
+  doc["format"] = STATE_FORMAT;
+  doc["slot"] = stateSlot;
+  doc["seq"] = stateSeq;
+  doc["bytes"] = stateBytes;
+  doc["loadUs"] = stateLoadUs;
+  doc["writes"] = persistentDataWrites;
+  doc["writeFailures"] = stateWriteFailures;
+  doc["dirty"] = persistentDataDirty;
+  JsonObject settings = doc["settings"].to<JsonObject>();
+  settings["timezoneOffset"] = timezoneOffset;
+  settings["maxConcurrentMotors"] = maxConcurrentMotors;
+  settings["deviceName"] = deviceName;
+  settings["notifyLowFert"] = notifyLowFert;
+  settings["notifyStart"] = notifyStart;
+  settings["notifyDose"] = notifyDose;
+  settings["ledBrightness"] = ledBrightness;
+  settings["blinkAllOk"] = blinkAllOk;
+  settings["lastNotifiedIP"] = lastNotifiedIP;
+  settings["mqttHost"] = mqttHost;
+  settings["mqttPort"] = mqttPort;
+  settings["mqttUser"] = mqttUser;
+  settings["mqttTopic"] = mqttTopic; // The password stays out, as in /api/v1/settings
+  JsonArray list = doc["channels"].to<JsonArray>();
+  for (int n = 1; n <= MAX_CHANNELS; n++) {
+    const Channel& c = getChannel(n);
+    JsonObject ch = list.add<JsonObject>();
+    ch["name"] = c.name;
+    ch["calibrationFactor"] = c.calibrationFactor;
+    ch["calibrated"] = c.calibrated;
+    ch["remainingMl"] = c.remainingML;
+    ch["daysRemaining"] = c.daysRemaining;
+    ch["lastDispensedMl"] = c.lastDispensedVolume;
+    ch["lastDispensedTime"] = c.lastDispensedTime;
+    ch["lastScheduledDoseEpoch"] = c.lastScheduledDoseTime;
+    JsonObject schedule = ch["schedule"].to<JsonObject>();
+    schedule["channelName"] = c.schedule.channelName;
+    schedule["missedDoseCompensation"] = c.schedule.missedDoseCompensation;
+    JsonArray days = schedule["days"].to<JsonArray>();
+    for (int i = 0; i < 7; i++) {
+      JsonObject d = days.add<JsonObject>();
+      d["enabled"] = c.schedule.days[i].enabled;
+      d["hour"] = c.schedule.days[i].hour;
+      d["minute"] = c.schedule.days[i].minute;
+      d["volume"] = c.schedule.days[i].volume;
     }
   }
-  if (channel == 1) {
-    daysRemainingChannel1 = days;
-  } else if (channel == 2) {
-    daysRemainingChannel2 = days;
+
+  ChunkedResponse out;
+  serializeJson(doc, out);
+  out.end();
+}
+
+// Time spent in each phase of this boot's setup(), against its budget
+void handleApiBoot() {
+  JsonDocument doc;
+  doc["startUs"] = bootRecord.startUs;
+  doc["totalUs"] = bootRecord.totalUs;
+  doc["budgetMs"] = BOOT_BUDGET_MS;
+  doc["overBudget"] = bootRecord.overBudget;
+  doc["stateSource"] = bootStateSource;
+  JsonObject phases = doc["phases"].to<JsonObject>();
+  for (int p = 0; p < BOOT_PHASE_COUNT; p++) {
+    JsonObject phase = phases[bootPhaseNames[p]].to<JsonObject>();
+    phase["us"] = bootRecord.phaseUs[p];
+    phase["budgetMs"] = bootPhaseBudgetMs[p];
+    phase["over"] = bootPhaseOver(p);
   }
-  savePersistentDataToSPIFFS();
+
+  ChunkedResponse out;
+  serializeJson(doc, out);
+  out.end();
 }
 
+#if LOOP_PROFILER
+// Rolling per-stage loop() timings in microseconds
+void handleApiProfile() {
+  JsonDocument doc;
+  doc["windowMs"] = PROFILE_WINDOW_MS;
+  JsonObject stages = doc["stages"].to<JsonObject>();
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    const StageProfile& p = loopProfile[s];
+    JsonObject stage = stages[loopStageNames[s]].to<JsonObject>();
+    stage["samples"] = p.samples;
+    stage["p50Us"] = profilePercentileUs(p, 50);
+    stage["p99Us"] = profilePercentileUs(p, 99);
+    stage["maxUs"] = profileMaxUs(p);
+  }
+
+  ChunkedResponse out;
+  serializeJson(doc, out);
+  out.end();
+}
+#endif
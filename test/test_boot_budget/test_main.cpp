@@ -0,0 +1,149 @@
+// Boot budget: setup() is run under the simulated HAL in the situations a
+// device boots into, and every phase of the boot record has to stay within
+// its budget. Slow network, a full journal or a backlog of notifications
+// must not reach setup(); only a held reset button may.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <chrono>
+
+void writeChannels(int channels);
+void counterDose(int channel, float ml, unsigned long durationMs, bool scheduled);
+
+extern bool resetButtonPressed;
+extern bool notifyStart;
+extern bool notifyLowFert;
+
+static const unsigned long SLOW_MS = 5000;        // Any network wait that could reach setup()
+static const unsigned long TARGET_SLOWDOWN = 20; // An 80 MHz ESP8266 against a desktop host
+static const char* PHASES[] = {"eeprom", "resetButton", "led", "fs", "state", "logs", "forecast",
+                               "wifi", "web", "clock", "ota", "mdns", "hw"};
+
+static JsonDocument record; // /api/v1/boot after the last boot
+
+// Runs setup() with host time charged to the clock, as on the target, and
+// checks the boot record against the budgets it reports
+static void bootWithin(const char* name) {
+  auto start = std::chrono::steady_clock::now();
+  hal::setHostClockScale(TARGET_SLOWDOWN);
+  setup();
+  hal::setHostClockScale(0);
+  auto hostNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  record = api("/api/v1/boot");
+
+  String phases;
+  unsigned long sumUs = 0;
+  for (const char* phase : PHASES) {
+    JsonObject p = record["phases"][phase];
+    unsigned long us = p["us"].as<unsigned long>();
+    unsigned long budgetMs = p["budgetMs"].as<unsigned long>();
+    char line[160];
+    snprintf(line, sizeof(line), "%s boot: %s took %lu us, budget %lu ms", name, phase, us, budgetMs);
+    TEST_ASSERT_TRUE_MESSAGE(budgetMs > 0, line);
+    TEST_ASSERT_TRUE_MESSAGE(us <= budgetMs * 1000, line);
+    TEST_ASSERT_FALSE(p["over"].as<bool>());
+    if (us > 0) phases += String(" ") + phase + "=" + String(us);
+    sumUs += us;
+  }
+  unsigned long totalUs = record["totalUs"].as<unsigned long>();
+  TEST_ASSERT_EQUAL(sumUs, totalUs);
+  TEST_ASSERT_TRUE(totalUs <= record["budgetMs"].as<unsigned long>() * 1000);
+  TEST_ASSERT_EQUAL(0, record["overBudget"].as<int>());
+  printf("[BENCH] boot %-8s %7lu us at %lux host time (%s ), setup() %.1f us host\n", name, totalUs,
+         TARGET_SLOWDOWN, phases.c_str(), hostNs / 1000.0);
+}
+
+void setUp() {
+  hal::reset();
+}
+void tearDown() {
+  hal::setPinLevel(D7, HIGH);
+  resetButtonPressed = false;
+}
+
+void test_first_boot() {
+  hal::clearRtcMemory();
+  hal::formatFs();
+  bootWithin("first");
+}
+
+void test_cold_boot() {
+  server.inject(HTTP_POST, "/calibrate", {{"channel", "1"}, {"dispensedML", "5"}});
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "500"}});
+  for (int i = 0; i < 100; i++) counterDose(1, 0.5f, 500, false);
+  runLoopFor(5000);
+  hal::reset();
+  hal::clearRtcMemory();
+  bootWithin("cold");
+  TEST_ASSERT_EQUAL_STRING("flash", record["stateSource"] | "");
+}
+
+void test_warm_boot() {
+  server.inject(HTTP_POST, "/restart");
+  TEST_ASSERT_TRUE(hal::restartRequested());
+  hal::reset();
+  bootWithin("warm");
+  TEST_ASSERT_EQUAL_STRING("snapshot", record["stateSource"] | "");
+}
+
+// Router, broker and ntfy all down, with notifications waiting to go out
+void test_boot_with_network_down() {
+  notifyStart = true;
+  notifyLowFert = true;
+  server.inject(HTTP_POST, "/systemSettings", {{"mqttHost", "broker.local"}});
+  hal::setWiFiConnected(false);
+  for (int i = 0; i < 5; i++) server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "100"}});
+  runLoopFor(5000);
+  hal::reset();
+  hal::clearRtcMemory();
+  hal::setWiFiConnected(false);
+  hal::setWiFiJoinTiming(SLOW_MS, SLOW_MS, SLOW_MS);
+  hal::setMqttBrokerReachable(false);
+  hal::setHttpClientLatencyMs(SLOW_MS);
+  hal::setNtpReachable(false);
+  bootWithin("offline");
+  TEST_ASSERT_EQUAL(0, hal::httpCalls().size());
+  hal::setMqttBrokerReachable(true);
+  hal::setHttpClientLatencyMs(0);
+  hal::setNtpReachable(true);
+}
+
+// The gate itself: a blocking phase shows up in the record, the log and /metrics
+void test_held_reset_button_is_over_budget() {
+  hal::setPinLevel(D7, LOW);
+  hal::captureSerial(true);
+  hal::clearSerialOutput();
+  setup();
+  hal::captureSerial(false);
+  TEST_ASSERT_TRUE(resetButtonPressed);
+  record = api("/api/v1/boot");
+  JsonObject button = record["phases"]["resetButton"];
+  TEST_ASSERT_TRUE(button["over"].as<bool>());
+  TEST_ASSERT_TRUE(button["us"].as<unsigned long>() >= 5000000UL);
+  TEST_ASSERT_EQUAL(1, record["overBudget"].as<int>());
+  TEST_ASSERT_TRUE(hal::serialOutput().indexOf("[BOOT] Phase resetButton took") >= 0);
+
+  HttpResponse metrics = server.inject(HTTP_GET, "/metrics");
+  TEST_ASSERT_TRUE(metrics.body.indexOf("doser_boot_phase_seconds{phase=\"resetButton\"} 5.0") >= 0);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_boot_budget");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_first_boot);
+  RUN_TEST(test_cold_boot);
+  RUN_TEST(test_warm_boot);
+  RUN_TEST(test_boot_with_network_down);
+  RUN_TEST(test_held_reset_button_is_over_budget);
+  return UNITY_END();
+}
@@ -0,0 +1,133 @@
+// Clock service: SNTP never holds up loop(), local time is cached per minute,
+// and the clock keeps good time through NTP outages, oscillator drift and the
+// millis() wrap.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+void writeChannels(int channels);
+void setupTimeSync();
+uint32_t clockUtc();
+String getFormattedTime();
+
+extern bool timeSynced;
+extern long clockDriftPpm;
+
+// The clock service works in whole seconds
+static const unsigned long STEP_MS = 1000;
+
+static long clockError() {
+  return (long)(int32_t)(clockUtc() - hal::utcEpoch());
+}
+
+// Set the real time and let the firmware pick it up as after a reboot
+static void syncTo(uint32_t utc) {
+  hal::setUtcEpoch(utc);
+  setupTimeSync();
+  for (int i = 0; i < 10 && !timeSynced; i++) {
+    loop();
+    hal::advanceMillis(10);
+  }
+  TEST_ASSERT_TRUE(timeSynced);
+}
+
+void setUp() {
+  hal::setNtpReachable(true);
+  hal::setUtcDriftPpm(0);
+  server.inject(HTTP_POST, "/timezone", {{"offset", "19800"}});
+}
+void tearDown() {}
+
+void test_loop_never_waits_on_ntp() {
+  hal::setNtpReachable(false);
+  setupTimeSync();
+  TEST_ASSERT_FALSE(timeSynced);
+  unsigned long requests = hal::ntpRequestCount();
+  for (int i = 0; i < 3 * 60 * 100; i++) {
+    unsigned long before = millis();
+    loop();
+    TEST_ASSERT_EQUAL(before, millis());
+    hal::advanceMillis(10);
+  }
+  TEST_ASSERT_TRUE(hal::ntpRequestCount() >= requests + 2); // Retried each minute
+  hal::setNtpReachable(true);
+  runLoopFor(61000, STEP_MS);
+  TEST_ASSERT_TRUE(timeSynced);
+}
+
+void test_local_time_follows_the_minute() {
+  syncTo(1752634800); // Wed 16-Jul-2025 03:00:00 UTC, 08:30 IST
+  TEST_ASSERT_EQUAL_STRING("16-Jul-2025 08:30 AM", getFormattedTime().c_str());
+  runLoopFor(59000, STEP_MS);
+  TEST_ASSERT_EQUAL_STRING("16-Jul-2025 08:30 AM", getFormattedTime().c_str());
+  runLoopFor(1000, STEP_MS);
+  TEST_ASSERT_EQUAL_STRING("16-Jul-2025 08:31 AM", getFormattedTime().c_str());
+}
+
+void test_date_rolls_over_at_local_midnight() {
+  syncTo(1709231399); // 29-Feb-2024 18:29:59 UTC, one second before midnight IST
+  TEST_ASSERT_EQUAL_STRING("29-Feb-2024 11:59 PM", getFormattedTime().c_str());
+  runLoopFor(1000, STEP_MS);
+  TEST_ASSERT_EQUAL_STRING("01-Mar-2024 12:00 AM", getFormattedTime().c_str());
+}
+
+void test_timezone_change_applies_immediately() {
+  syncTo(1752634800);
+  server.inject(HTTP_POST, "/timezone", {{"offset", "3600"}});
+  TEST_ASSERT_EQUAL_STRING("16-Jul-2025 04:00 AM", getFormattedTime().c_str());
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/status");
+  TEST_ASSERT_TRUE(r.body.indexOf("\"time\":\"16-Jul-2025 04:00 AM\"") > 0);
+}
+
+void test_keeps_time_while_ntp_is_unreachable() {
+  syncTo(1752634800);
+  hal::setNtpReachable(false);
+  runLoopFor(3ULL * 86400ULL * 1000ULL, STEP_MS);
+  TEST_ASSERT_TRUE(timeSynced);
+  TEST_ASSERT_TRUE(labs(clockError()) <= 1);
+}
+
+void test_drift_is_measured_and_taken_out() {
+  hal::setUtcDriftPpm(300);
+  syncTo(1752634800);
+  runLoopFor(4ULL * 3600ULL * 1000ULL, STEP_MS); // Hourly syncs
+  TEST_ASSERT_TRUE(clockDriftPpm >= 280 && clockDriftPpm <= 320);
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/status");
+  TEST_ASSERT_TRUE(r.body.indexOf("\"driftPpm\":") > 0);
+
+  // Two days without NTP: uncorrected, 300 ppm would be 52 s off
+  hal::setNtpReachable(false);
+  runLoopFor(2ULL * 86400ULL * 1000ULL, STEP_MS);
+  TEST_ASSERT_TRUE(labs(clockError()) <= 2);
+}
+
+void test_survives_millis_wrap() {
+  syncTo(1752634800);
+  hal::setNtpReachable(false);
+  unsigned long long wraps = hal::nowMicros() / 1000ULL >> 32;
+  runLoopFor(60ULL * 86400ULL * 1000ULL, 10000);
+  TEST_ASSERT_TRUE((hal::nowMicros() / 1000ULL >> 32) > wraps);
+  TEST_ASSERT_TRUE(labs(clockError()) <= 1);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_clock");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_loop_never_waits_on_ntp);
+  RUN_TEST(test_local_time_follows_the_minute);
+  RUN_TEST(test_date_rolls_over_at_local_midnight);
+  RUN_TEST(test_timezone_change_applies_immediately);
+  RUN_TEST(test_keeps_time_while_ntp_is_unreachable);
+  RUN_TEST(test_drift_is_measured_and_taken_out);
+  RUN_TEST(test_survives_millis_wrap);
+  return UNITY_END();
+}
@@ -0,0 +1,172 @@
+// Counter journal: doses append one 16 byte record instead of rewriting the
+// state record, replay at boot gives the exact values, a full journal is
+// compacted into a new file and a cut write loses at most that one update.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+
+void writeChannels(int channels);
+void counterDose(int channel, float ml, unsigned long durationMs, bool scheduled);
+void savePersistentDataToSPIFFS();
+
+extern unsigned long persistentDataWrites;
+extern uint32_t counterNext;
+extern uint32_t counterGeneration;
+extern unsigned long counterCompactions;
+extern unsigned long counterWriteFailures;
+
+static const uint32_t COUNTER_CAPACITY = 24;  // Records after the base
+static const size_t COUNTER_FILE_SIZE = 512;  // Largest the journal grows to
+
+static JsonObject channel(JsonDocument& doc, int n) {
+  return doc["channels"][n - 1];
+}
+
+static float remainingMl(int n) {
+  JsonDocument doc = api("/api/v1/channels");
+  return channel(doc, n)["remainingMl"].as<float>();
+}
+
+void setUp() {}
+void tearDown() {
+  hal::cutFsWritesAfter(-1);
+}
+
+void test_dose_appends_one_record() {
+  server.inject(HTTP_POST, "/calibrate", {{"channel", "1"}, {"dispensedML", "5"}});
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "100"}});
+  runLoopFor(5000);
+  unsigned long writes = persistentDataWrites;
+  uint32_t records = counterNext;
+  unsigned long long bytes = LittleFS.bytesWritten();
+  server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "2.5"}});
+  unsigned long long doseBytes = LittleFS.bytesWritten() - bytes;
+  runLoopFor(5000);
+  TEST_ASSERT_EQUAL(writes, persistentDataWrites);
+  TEST_ASSERT_EQUAL(records + 1, counterNext);
+  TEST_ASSERT_EQUAL(32, doseBytes); // Counter record + dose log record
+}
+
+void test_values_replay_after_reboot() {
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "2"}, {"volume", "50"}});
+  for (int i = 0; i < 3; i++) counterDose(2, 0.25f, 250, false);
+  counterDose(2, 1.0f, 1000, true);
+  JsonDocument before = api("/api/v1/channels");
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 48.25, channel(before, 2)["remainingMl"].as<float>());
+
+  reboot();
+  JsonDocument after = api("/api/v1/channels");
+  JsonObject ch = channel(after, 2);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 48.25, ch["remainingMl"].as<float>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 1.75, ch["dispensedTotalMl"].as<float>());
+  TEST_ASSERT_EQUAL(1750, ch["motorOnMs"].as<int>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0, ch["lastDispensedMl"].as<float>());
+  TEST_ASSERT_EQUAL_STRING(channel(before, 2)["lastDispensedTime"] | "", ch["lastDispensedTime"] | "");
+  TEST_ASSERT_EQUAL(channel(before, 2)["lastScheduledDoseEpoch"].as<uint32_t>(), ch["lastScheduledDoseEpoch"].as<uint32_t>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 97.5, remainingMl(1)); // Other channel untouched
+}
+
+void test_priming_counts_run_time() {
+  JsonDocument doc = api("/api/v1/channels");
+  unsigned long before = channel(doc, 1)["motorOnMs"].as<unsigned long>();
+  server.inject(HTTP_POST, "/prime", {{"channel", "1"}, {"state", "1"}});
+  runLoopFor(3000);
+  server.inject(HTTP_POST, "/prime", {{"channel", "1"}, {"state", "0"}});
+  reboot();
+  doc = api("/api/v1/channels");
+  TEST_ASSERT_EQUAL(before + 3000, channel(doc, 1)["motorOnMs"].as<unsigned long>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 97.5, remainingMl(1));
+}
+
+void test_full_journal_is_compacted() {
+  uint32_t generation = counterGeneration;
+  unsigned long compactions = counterCompactions;
+  float start = remainingMl(2);
+  int doses = 2 * COUNTER_CAPACITY + 10;
+  // What LittleFS programs per update, compactions included: the journal's
+  // unfinished block, never more than the journal
+  unsigned long long worst = 0, total = 0;
+  for (int i = 0; i < doses; i++) {
+    unsigned long long flash = LittleFS.flashBytes();
+    counterDose(2, 0.01f, 10, false);
+    unsigned long long cost = LittleFS.flashBytes() - flash;
+    if (cost > worst) worst = cost;
+    total += cost;
+  }
+  TEST_ASSERT_TRUE(worst <= COUNTER_FILE_SIZE);
+  unsigned long long flash = LittleFS.flashBytes();
+  savePersistentDataToSPIFFS();
+  unsigned long long stateCost = LittleFS.flashBytes() - flash;
+  printf("[BENCH] counter update: %llu bytes programmed on average, %llu at most; state record rewrite: %llu\n",
+         total / doses, worst, stateCost);
+  TEST_ASSERT_TRUE(total / doses < stateCost);
+  TEST_ASSERT_EQUAL(compactions + 2, counterCompactions);
+  TEST_ASSERT_EQUAL(generation + 2, counterGeneration);
+
+  uint32_t records = counterNext;
+  reboot();
+  TEST_ASSERT_EQUAL(records, counterNext);
+  TEST_ASSERT_EQUAL(generation + 2, counterGeneration);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, start - doses / 100.0f, remainingMl(2));
+
+  JsonObject counters = api("/api/v1/status")["counters"];
+  TEST_ASSERT_EQUAL(records, counters["records"].as<uint32_t>());
+  TEST_ASSERT_EQUAL(COUNTER_CAPACITY, counters["capacity"].as<uint32_t>());
+  TEST_ASSERT_EQUAL(generation + 2, counters["generation"].as<uint32_t>());
+}
+
+// A record cut short is dropped on replay and its slot is written again
+void test_cut_record_loses_only_that_update() {
+  counterDose(1, 1.0f, 1000, false);
+  float kept = remainingMl(1);
+  unsigned long failures = counterWriteFailures;
+  hal::cutFsWritesAfter(7);
+  counterDose(1, 1.0f, 1000, false);
+  TEST_ASSERT_EQUAL(failures + 1, counterWriteFailures);
+  reboot();
+  TEST_ASSERT_FLOAT_WITHIN(0.001, kept, remainingMl(1));
+  counterDose(1, 1.0f, 1000, false);
+  reboot();
+  TEST_ASSERT_FLOAT_WITHIN(0.001, kept - 1, remainingMl(1));
+}
+
+// Power lost while writing the new base: the old base and its full set of
+// records still replay to the values before the update
+void test_cut_compaction_keeps_old_generation() {
+  while (counterNext < COUNTER_CAPACITY) counterDose(1, 0.01f, 10, false);
+  uint32_t generation = counterGeneration;
+  float kept = remainingMl(1);
+  hal::cutFsWritesAfter(50);
+  counterDose(1, 1.0f, 1000, false);
+  reboot();
+  TEST_ASSERT_EQUAL(generation, counterGeneration);
+  TEST_ASSERT_EQUAL(COUNTER_CAPACITY, counterNext);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, kept, remainingMl(1));
+
+  counterDose(1, 1.0f, 1000, false);
+  TEST_ASSERT_EQUAL(generation + 1, counterGeneration);
+  reboot();
+  TEST_ASSERT_FLOAT_WITHIN(0.001, kept - 1, remainingMl(1));
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_counters");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_dose_appends_one_record);
+  RUN_TEST(test_values_replay_after_reboot);
+  RUN_TEST(test_priming_counts_run_time);
+  RUN_TEST(test_full_journal_is_compacted);
+  RUN_TEST(test_cut_record_loses_only_that_update);
+  RUN_TEST(test_cut_compaction_keeps_old_generation);
+  return UNITY_END();
+}
@@ -0,0 +1,154 @@
+// Days remaining: the closed form built from weekly prefix sums agrees with the
+// old day-by-day walk, results are cached, and a microbenchmark compares the two.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <unity.h>
+#include <chrono>
+
+void setup();
+void writeChannels(int channels);
+int daysRemainingAt(int channel, float remainingML, int weekday);
+int calculateDaysRemaining(int channel);
+
+extern ESP8266WebServer server;
+extern unsigned long daysRemainingComputed;
+
+struct Day {
+  bool enabled;
+  float volume;
+};
+
+static Day schedule[7];
+
+// The loop calculateDaysRemaining() and updateDaysRemaining() used to run
+static int legacyDaysRemaining(float remainingML, int dayIdx) {
+  int days = 0;
+  float rem = remainingML;
+  for (int i = 0; i < 365; ++i) {
+    int d = (dayIdx + i) % 7;
+    if (schedule[d].enabled) {
+      float dose = schedule[d].volume;
+      if (rem < dose || dose <= 0.0f) break;
+      rem -= dose;
+      days++;
+    }
+  }
+  return days;
+}
+
+static void applySchedule() {
+  ESP8266WebServer::Args args;
+  args.push_back({"channel", "1"});
+  for (int i = 0; i < 7; ++i) {
+    if (schedule[i].enabled) args.push_back({"enabled" + String(i), "on"});
+    args.push_back({"time" + String(i), "08:00"});
+    args.push_back({"vol" + String(i), String(schedule[i].volume, 2)});
+  }
+  HttpResponse r = server.inject(HTTP_POST, "/manageSchedule", args);
+  TEST_ASSERT_EQUAL(302, r.code);
+}
+
+static uint32_t rng = 12345;
+static uint32_t nextRandom() {
+  rng = rng * 1103515245u + 12345u;
+  return rng >> 8;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_matches_day_by_day_walk() {
+  // Quarter-ml steps keep the old float arithmetic exact
+  for (int n = 0; n < 300; ++n) {
+    for (int d = 0; d < 7; ++d) {
+      schedule[d].enabled = nextRandom() % 10 < 6;
+      schedule[d].volume = (nextRandom() % (n % 10 == 0 ? 21 : 20) + (n % 10 == 0 ? 0 : 1)) * 0.25f;
+    }
+    applySchedule();
+    for (int w = 0; w < 7; ++w) {
+      for (int v = 0; v < 40; ++v) {
+        float ml = (nextRandom() % 8000) * 0.25f;
+        int expected = legacyDaysRemaining(ml, w);
+        int actual = daysRemainingAt(1, ml, w);
+        if (expected != actual) printf("  schedule %d weekday %d %.2f ml: %d != %d\n", n, w, ml, actual, expected);
+        TEST_ASSERT_EQUAL(expected, actual);
+      }
+    }
+  }
+}
+
+void test_year_horizon_and_zero_volume_day() {
+  for (int d = 0; d < 7; ++d) schedule[d] = Day{true, 1.0f};
+  applySchedule();
+  TEST_ASSERT_EQUAL(365, daysRemainingAt(1, 100000.0f, 2));
+  TEST_ASSERT_EQUAL(0, daysRemainingAt(1, 0.5f, 2));
+  schedule[4] = Day{true, 0.0f}; // Enabled Friday with nothing to give
+  applySchedule();
+  TEST_ASSERT_EQUAL(2, daysRemainingAt(1, 100000.0f, 2));
+  TEST_ASSERT_EQUAL(0, daysRemainingAt(1, 100000.0f, 4));
+}
+
+void test_tenth_ml_doses_count_exactly() {
+  for (int d = 0; d < 7; ++d) schedule[d] = Day{true, 0.1f};
+  applySchedule();
+  TEST_ASSERT_EQUAL(100, daysRemainingAt(1, 10.0f, 0));
+}
+
+void test_result_is_cached() {
+  for (int d = 0; d < 7; ++d) schedule[d] = Day{d % 2 == 0, 2.0f};
+  applySchedule();
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "100"}});
+  unsigned long before = daysRemainingComputed;
+  int days = calculateDaysRemaining(1);
+  for (int i = 0; i < 10; ++i) TEST_ASSERT_EQUAL(days, calculateDaysRemaining(1));
+  TEST_ASSERT_EQUAL(before, daysRemainingComputed); // /updateVolume already filled it
+
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "50"}});
+  TEST_ASSERT_EQUAL(before + 1, daysRemainingComputed);
+  applySchedule();
+  TEST_ASSERT_EQUAL(before + 2, daysRemainingComputed);
+  hal::advanceMillis(86400UL * 1000UL); // Next weekday
+  calculateDaysRemaining(1);
+  TEST_ASSERT_EQUAL(before + 3, daysRemainingComputed);
+}
+
+void test_benchmark_against_loop() {
+  // Mon/Wed/Fri 2.5 ml with a year's supply: the worst case for the walk
+  for (int d = 0; d < 7; ++d) schedule[d] = Day{d == 0 || d == 2 || d == 4, 2.5f};
+  applySchedule();
+  const int N = 200000;
+  volatile long sink = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; ++i) sink += legacyDaysRemaining(400.0f + (i & 63), i % 7);
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; ++i) sink += daysRemainingAt(1, 400.0f + (i & 63), i % 7);
+  auto t2 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; ++i) sink += calculateDaysRemaining(1);
+  auto t3 = std::chrono::steady_clock::now();
+
+  double loopNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+  double closedNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / N;
+  double cachedNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / N;
+  printf("[BENCH] days remaining: loop %.1f ns, closed form %.1f ns, cached %.1f ns per call\n", loopNs, closedNs, cachedNs);
+  TEST_ASSERT_TRUE(closedNs < loopNs);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_days_remaining");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_day_by_day_walk);
+  RUN_TEST(test_year_horizon_and_zero_volume_day);
+  RUN_TEST(test_tenth_ml_doses_count_exactly);
+  RUN_TEST(test_result_is_cached);
+  RUN_TEST(test_benchmark_against_loop);
+  return UNITY_END();
+}
@@ -0,0 +1,209 @@
+// Dose dispatcher: channels run side by side up to the motor limit, the rest
+// wait in order, and scheduled doses report their start latency.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+void writeChannels(int channels);
+
+uint32_t clockNow();
+extern int maxConcurrentMotors;
+
+static const uint8_t MOTOR_PINS[3] = {D1, D5, D0};
+// Fine enough to resolve start order between channels
+static const unsigned long STEP_MS = 10;
+
+// Time of the first HIGH edge on a motor pin, 0 if it never started
+static unsigned long long startUs(int channel) {
+  for (const auto& e : hal::gpioEdges()) {
+    if (e.pin == MOTOR_PINS[channel - 1] && e.level == HIGH) return e.us;
+  }
+  return 0;
+}
+
+static void assertOneSecondAfter(unsigned long long t0, unsigned long long us) {
+  TEST_ASSERT_TRUE(us >= t0 + 1000000ULL && us <= t0 + 1020000ULL);
+}
+
+static long startedLate() {
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/status");
+  int at = r.body.indexOf("\"startedLate\":");
+  if (at < 0) return -1;
+  return r.body.substring(at + 14).toInt();
+}
+
+static void dose(int channel, const char* ml) {
+  HttpResponse r = server.inject(HTTP_POST, "/manual", {{"channel", String(channel)}, {"ml", ml}});
+  TEST_ASSERT_EQUAL(200, r.code);
+}
+
+void setUp() {
+  maxConcurrentMotors = 2;
+  runLoopFor(10000, STEP_MS); // Let anything still running finish
+  hal::clearGpioEdges();
+}
+void tearDown() {}
+
+void test_two_channels_run_together() {
+  dose(1, "2");
+  dose(2, "1");
+  TEST_ASSERT_TRUE(startUs(1) != 0);
+  TEST_ASSERT_EQUAL(startUs(1), startUs(2));
+}
+
+void test_limit_queues_extra_channel() {
+  unsigned long long t0 = hal::nowMicros();
+  dose(1, "2");
+  dose(2, "1");
+  dose(3, "1");
+  TEST_ASSERT_EQUAL(0, startUs(3));
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/status");
+  TEST_ASSERT_TRUE(r.body.indexOf("\"running\":2,\"maxConcurrent\":2,\"queued\":1") > 0);
+  runLoopFor(3000, STEP_MS);
+  // Channel 3 takes the slot channel 2 frees after 1 s
+  assertOneSecondAfter(t0, startUs(3));
+}
+
+void test_limit_of_one_runs_in_sequence() {
+  HttpResponse r = server.inject(HTTP_POST, "/systemSettings", {{"maxMotors", "1"}, {"notifyLowFert", "on"}});
+  TEST_ASSERT_EQUAL(302, r.code);
+  TEST_ASSERT_EQUAL(1, maxConcurrentMotors);
+  unsigned long long t0 = hal::nowMicros();
+  dose(1, "1");
+  dose(2, "1");
+  runLoopFor(3000, STEP_MS);
+  assertOneSecondAfter(t0, startUs(2));
+}
+
+void test_same_channel_waits_without_blocking_others() {
+  unsigned long long t0 = hal::nowMicros();
+  dose(1, "1");
+  dose(1, "1");
+  dose(2, "1");
+  TEST_ASSERT_EQUAL(t0, startUs(2));
+  runLoopFor(3000, STEP_MS);
+  int starts = 0;
+  unsigned long long second = 0;
+  for (const auto& e : hal::gpioEdges()) {
+    if (e.pin == MOTOR_PINS[0] && e.level == HIGH && ++starts == 2) second = e.us;
+  }
+  assertOneSecondAfter(t0, second);
+}
+
+void test_scheduled_doses_start_together_and_report_latency() {
+  int minute = (clockNow() / 60 + 2) % 1440;
+  char t[6];
+  snprintf(t, sizeof(t), "%02d:%02d", minute / 60, minute % 60);
+  for (int ch = 1; ch <= 2; ch++) {
+    ESP8266WebServer::Args args;
+    args.push_back({"channel", String(ch)});
+    for (int i = 0; i < 7; ++i) {
+      args.push_back({"enabled" + String(i), "on"});
+      args.push_back({"time" + String(i), t});
+      args.push_back({"vol" + String(i), "1"});
+    }
+    server.inject(HTTP_POST, "/manageSchedule", args);
+  }
+  runLoopFor(200000, STEP_MS);
+  TEST_ASSERT_TRUE(startUs(1) != 0);
+  TEST_ASSERT_EQUAL(startUs(1), startUs(2));
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/channels", {{"channel", "2"}});
+  int at = r.body.indexOf("\"lastStartLatencyMs\":");
+  TEST_ASSERT_TRUE(at > 0);
+  long latency = r.body.substring(at + 21).toInt();
+  // Started by the next-dose timer, not a poll
+  TEST_ASSERT_TRUE(latency >= 0 && latency <= 1000);
+}
+
+// Stopping a prime stops its motor even while another channel is dosing
+void test_prime_stops_during_another_dose() {
+  dose(1, "5");
+  HttpResponse r = server.inject(HTTP_POST, "/prime", {{"channel", "2"}, {"state", "1"}});
+  TEST_ASSERT_EQUAL(200, r.code);
+  runLoopFor(2000, STEP_MS);
+  TEST_ASSERT_EQUAL(HIGH, hal::pinLevel(MOTOR_PINS[1]));
+  server.inject(HTTP_POST, "/prime", {{"channel", "2"}, {"state", "0"}});
+  TEST_ASSERT_EQUAL(LOW, hal::pinLevel(MOTOR_PINS[1]));
+  runLoopFor(100, STEP_MS);
+  TEST_ASSERT_EQUAL(LOW, hal::pinLevel(MOTOR_PINS[1]));
+  TEST_ASSERT_EQUAL(HIGH, hal::pinLevel(MOTOR_PINS[0]));
+  runLoopFor(4000, STEP_MS);
+  TEST_ASSERT_EQUAL(LOW, hal::pinLevel(MOTOR_PINS[0]));
+}
+
+void test_prime_rejects_invalid_channel() {
+  HttpResponse r = server.inject(HTTP_POST, "/prime", {{"channel", "9"}, {"state", "1"}});
+  TEST_ASSERT_EQUAL(400, r.code);
+}
+
+void test_second_prime_is_rejected() {
+  TEST_ASSERT_EQUAL(200, server.inject(HTTP_POST, "/prime", {{"channel", "1"}, {"state", "1"}}).code);
+  TEST_ASSERT_EQUAL(409, server.inject(HTTP_POST, "/prime", {{"channel", "2"}, {"state", "1"}}).code);
+  runLoopFor(100, STEP_MS);
+  TEST_ASSERT_EQUAL(HIGH, hal::pinLevel(MOTOR_PINS[0]));
+  TEST_ASSERT_EQUAL(LOW, hal::pinLevel(MOTOR_PINS[1]));
+  server.inject(HTTP_POST, "/prime", {{"channel", "1"}, {"state", "0"}});
+  TEST_ASSERT_EQUAL(LOW, hal::pinLevel(MOTOR_PINS[0]));
+}
+
+// Only a dose held back by the motor limit counts as started late
+void test_started_late_counts_limit_waits() {
+  long before = startedLate();
+  TEST_ASSERT_TRUE(before >= 0);
+  dose(1, "1");
+  dose(1, "1");
+  runLoopFor(3000, STEP_MS);
+  TEST_ASSERT_EQUAL(before, startedLate());
+  dose(1, "1");
+  dose(2, "1");
+  dose(3, "1");
+  runLoopFor(3000, STEP_MS);
+  TEST_ASSERT_EQUAL(before + 1, startedLate());
+}
+
+// The calibration page times the run, so it only starts one that runs now
+void test_calibration_needs_a_free_motor() {
+  maxConcurrentMotors = 1;
+  dose(1, "2");
+  HttpResponse r = server.inject(HTTP_POST, "/calibrate", {{"channel", "2"}});
+  TEST_ASSERT_EQUAL(503, r.code);
+  runLoopFor(3000, STEP_MS);
+  TEST_ASSERT_EQUAL(0, startUs(2));
+  r = server.inject(HTTP_POST, "/calibrate", {{"channel", "2"}});
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_EQUAL(HIGH, hal::pinLevel(MOTOR_PINS[1]));
+  runLoopFor(6000, STEP_MS);
+  TEST_ASSERT_EQUAL(400, server.inject(HTTP_POST, "/calibrate", {{"channel", "2"}, {"dispensedML", "0"}}).code);
+  TEST_ASSERT_EQUAL(400, server.inject(HTTP_POST, "/manual", {{"channel", "2"}, {"ml", "-1"}}).code);
+  TEST_ASSERT_EQUAL(400, server.inject(HTTP_POST, "/manual", {{"channel", "2"}, {"ml", "0"}}).code);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_dispatcher");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(3);
+  setup();
+  // 5 s calibration run measured as 5 ml: 1 s per ml
+  for (int ch = 1; ch <= 3; ch++) {
+    server.inject(HTTP_POST, "/calibrate", {{"channel", String(ch)}, {"dispensedML", "5"}});
+    server.inject(HTTP_POST, "/updateVolume", {{"channel", String(ch)}, {"volume", "1000"}});
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_two_channels_run_together);
+  RUN_TEST(test_limit_queues_extra_channel);
+  RUN_TEST(test_limit_of_one_runs_in_sequence);
+  RUN_TEST(test_same_channel_waits_without_blocking_others);
+  RUN_TEST(test_scheduled_doses_start_together_and_report_latency);
+  RUN_TEST(test_prime_stops_during_another_dose);
+  RUN_TEST(test_prime_rejects_invalid_channel);
+  RUN_TEST(test_second_prime_is_rejected);
+  RUN_TEST(test_started_late_counts_limit_waits);
+  RUN_TEST(test_calibration_needs_a_free_motor);
+  return UNITY_END();
+}
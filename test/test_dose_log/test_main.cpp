@@ -0,0 +1,186 @@
+// Dose event log: segment file layout, flash cost of an append, recovery after
+// reboot and /api/v1/history.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+void setup();
+
+extern ESP8266WebServer server;
+extern bool timeSynced;
+extern uint32_t doseLogFirst;
+extern uint32_t doseLogLast;
+// Same as the firmware
+static const uint32_t DOSE_LOG_SEGMENTS = 8;
+static const uint32_t DOSE_LOG_SEGMENT_RECORDS = 256;
+static const uint32_t DOSE_LOG_CAPACITY = DOSE_LOG_SEGMENTS * DOSE_LOG_SEGMENT_RECORDS;
+
+struct DoseEvent {
+  uint32_t seq;
+  uint32_t epoch;
+  uint32_t durationMs;
+  float volumeMl;
+  uint8_t channel;
+  uint8_t source;
+};
+void doseLogBegin();
+void doseLogAppend(int channel, float volumeMl, uint8_t source, unsigned long durationMs);
+bool doseLogRead(uint32_t seq, DoseEvent& e);
+
+static String segmentPath(uint32_t segment) {
+  return "/dose_log_" + String(segment) + ".bin";
+}
+
+void setUp() {
+  for (uint32_t i = 0; i < DOSE_LOG_SEGMENTS; i++) LittleFS.remove(segmentPath(i));
+  doseLogBegin();
+}
+void tearDown() {}
+
+void test_empty_log() {
+  TEST_ASSERT_FALSE(LittleFS.exists(segmentPath(0)));
+  TEST_ASSERT_EQUAL(0, doseLogFirst);
+  TEST_ASSERT_EQUAL(0, doseLogLast);
+}
+
+void test_append_and_read_back() {
+  doseLogAppend(2, 3.25f, 1, 3250);
+  TEST_ASSERT_EQUAL(1, doseLogFirst);
+  TEST_ASSERT_EQUAL(1, doseLogLast);
+  DoseEvent e;
+  TEST_ASSERT_TRUE(doseLogRead(1, e));
+  TEST_ASSERT_EQUAL(2, e.channel);
+  TEST_ASSERT_EQUAL(1, e.source);
+  TEST_ASSERT_EQUAL(3250, e.durationMs);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 3.25f, e.volumeMl);
+  TEST_ASSERT_FALSE(doseLogRead(2, e));
+}
+
+// Flash programmed per append as LittleFS would copy it: never more than the
+// segment being appended to, however long the log is
+void test_append_cost_is_bounded_by_a_segment() {
+  unsigned long long worst = 0, total = 0;
+  for (uint32_t i = 0; i < 3 * DOSE_LOG_SEGMENT_RECORDS; i++) {
+    unsigned long long before = LittleFS.flashBytes();
+    unsigned long erases = LittleFS.blockErases();
+    doseLogAppend(1, 1.0f, 0, 1000);
+    unsigned long long cost = LittleFS.flashBytes() - before;
+    TEST_ASSERT_EQUAL(1, LittleFS.blockErases() - erases);
+    if (cost > worst) worst = cost;
+    total += cost;
+  }
+  TEST_ASSERT_EQUAL(DOSE_LOG_SEGMENT_RECORDS * 16, worst);
+  File f = LittleFS.open(segmentPath(2), "r");
+  TEST_ASSERT_EQUAL(DOSE_LOG_SEGMENT_RECORDS * 16, f.size());
+  f.close();
+
+  // The same 16 bytes written in place into the middle of a full 32 KB ring file
+  f = LittleFS.open("/ring.bin", "w");
+  uint8_t zeros[256] = {0};
+  for (uint32_t i = 0; i < DOSE_LOG_CAPACITY * 16; i += sizeof(zeros)) f.write(zeros, sizeof(zeros));
+  f.close();
+  unsigned long long before = LittleFS.flashBytes();
+  f = LittleFS.open("/ring.bin", "r+");
+  f.seek(DOSE_LOG_CAPACITY * 16 / 2);
+  f.write(zeros, 16);
+  f.close();
+  unsigned long long inPlace = LittleFS.flashBytes() - before;
+  LittleFS.remove("/ring.bin");
+  printf("[BENCH] dose log append: %llu bytes programmed on average, %llu at most; in place in a ring file: %llu\n",
+         total / (3 * DOSE_LOG_SEGMENT_RECORDS), worst, inPlace);
+  TEST_ASSERT_TRUE(inPlace > worst);
+}
+
+// A record cut short by a power cut is dropped and the next append takes its place
+void test_torn_record_is_dropped() {
+  for (int i = 0; i < 5; i++) doseLogAppend(1, 1.0f, 0, 1000 + i);
+  File f = LittleFS.open(segmentPath(0), "a");
+  uint8_t partial[7] = {6, 0, 0, 0, 1, 2, 3};
+  f.write(partial, sizeof(partial));
+  f.close();
+  doseLogFirst = doseLogLast = 0;
+  doseLogBegin();
+  TEST_ASSERT_EQUAL(1, doseLogFirst);
+  TEST_ASSERT_EQUAL(5, doseLogLast);
+  doseLogAppend(2, 2.0f, 0, 2000);
+  DoseEvent e;
+  TEST_ASSERT_TRUE(doseLogRead(6, e));
+  TEST_ASSERT_EQUAL(2000, e.durationMs);
+  TEST_ASSERT_TRUE(doseLogRead(5, e));
+  TEST_ASSERT_EQUAL(1004, e.durationMs);
+}
+
+// Starting a segment drops the oldest one; the other seven are kept whole
+void test_wraps_and_recovers_after_reboot() {
+  uint32_t total = DOSE_LOG_CAPACITY + 300;
+  for (uint32_t i = 1; i <= total; i++) doseLogAppend(1 + (i & 1), i / 100.0f, 1, i);
+  uint32_t newestStart = total - (total - 1) % DOSE_LOG_SEGMENT_RECORDS;
+  uint32_t first = newestStart - (DOSE_LOG_SEGMENTS - 1) * DOSE_LOG_SEGMENT_RECORDS;
+  TEST_ASSERT_EQUAL(total, doseLogLast);
+  TEST_ASSERT_EQUAL(first, doseLogFirst);
+
+  doseLogFirst = doseLogLast = 0;
+  doseLogBegin();
+  TEST_ASSERT_EQUAL(total, doseLogLast);
+  TEST_ASSERT_EQUAL(first, doseLogFirst);
+  DoseEvent e;
+  TEST_ASSERT_FALSE(doseLogRead(doseLogFirst - 1, e));
+  TEST_ASSERT_TRUE(doseLogRead(doseLogFirst, e));
+  TEST_ASSERT_EQUAL(doseLogFirst, e.durationMs);
+  TEST_ASSERT_TRUE(doseLogRead(total, e));
+  TEST_ASSERT_EQUAL(total, e.durationMs);
+}
+
+void test_history_range_query() {
+  timeSynced = true;
+  // Manual doses through the real handler, one per simulated day
+  for (int day = 0; day < 10; day++) {
+    server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "0.5"}});
+    hal::advanceMillis(86400UL * 1000UL);
+  }
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/history", {{"limit", "3"}});
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_TRUE(r.body.indexOf("\"seq\":3,") > 0);
+  TEST_ASSERT_TRUE(r.body.indexOf("\"seq\":4,") < 0);
+  TEST_ASSERT_TRUE(r.body.endsWith("\"next\":3}"));
+
+  r = server.inject(HTTP_GET, "/api/v1/history", {{"after", "8"}});
+  TEST_ASSERT_TRUE(r.body.indexOf("\"seq\":9,") > 0);
+  TEST_ASSERT_TRUE(r.body.indexOf("\"seq\":8,") < 0);
+  TEST_ASSERT_TRUE(r.body.endsWith("\"next\":null}"));
+
+  DoseEvent e5, e7;
+  TEST_ASSERT_TRUE(doseLogRead(5, e5));
+  TEST_ASSERT_TRUE(doseLogRead(7, e7));
+  TEST_ASSERT_EQUAL(2 * 86400, e7.epoch - e5.epoch);
+  r = server.inject(HTTP_GET, "/api/v1/history", {{"from", String(e5.epoch)}, {"to", String(e7.epoch)}});
+  TEST_ASSERT_TRUE(r.body.indexOf("\"seq\":4,") < 0);
+  TEST_ASSERT_TRUE(r.body.indexOf("\"seq\":5,") > 0);
+  TEST_ASSERT_TRUE(r.body.indexOf("\"seq\":7,") > 0);
+  TEST_ASSERT_TRUE(r.body.indexOf("\"seq\":8,") < 0);
+  TEST_ASSERT_TRUE(r.body.indexOf("\"source\":\"manual\"") > 0);
+
+  r = server.inject(HTTP_GET, "/api/v1/history", {{"source", "prime"}});
+  TEST_ASSERT_TRUE(r.body.indexOf("\"events\":[]") > 0);
+  r = server.inject(HTTP_GET, "/api/v1/history", {{"source", "bogus"}});
+  TEST_ASSERT_EQUAL(400, r.code);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_dose_log");
+  LittleFS.begin();
+  hal::formatFs();
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_log);
+  RUN_TEST(test_append_and_read_back);
+  RUN_TEST(test_append_cost_is_bounded_by_a_segment);
+  RUN_TEST(test_torn_record_is_dropped);
+  RUN_TEST(test_wraps_and_recovers_after_reboot);
+  RUN_TEST(test_history_range_query);
+  return UNITY_END();
+}
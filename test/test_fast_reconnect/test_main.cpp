@@ -0,0 +1,135 @@
+// Fast reconnect: after a warm reboot the station joins the AP it had, by
+// BSSID and channel, with the DHCP lease as a static config. A power cycle,
+// damaged RTC memory or a changed AP fall back to a full scan.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <ESP8266WebServer.h>
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+
+void setup();
+void loop();
+void writeChannels(int channels);
+
+extern ESP8266WebServer server;
+extern unsigned long netConnectMs;
+extern bool netConnectedFast;
+extern unsigned long netFastFallbacks;
+
+// Typical for a home router: scan all channels, associate, DHCP
+static const unsigned long SCAN_MS = 2500;
+static const unsigned long ASSOCIATE_MS = 300;
+static const unsigned long DHCP_MS = 1200;
+
+static void boot(bool powerCycle) {
+  hal::reset();
+  if (powerCycle) hal::clearRtcMemory();
+  hal::setWiFiJoinTiming(SCAN_MS, ASSOCIATE_MS, DHCP_MS);
+  setup();
+}
+
+// Runs loop() until the station is up; returns the reported join time
+static unsigned long waitForWiFi() {
+  for (int i = 0; i < 3000 && netConnectMs == 0; i++) {
+    loop();
+    hal::advanceMillis(10);
+  }
+  return netConnectMs;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_cold_boot_scans() {
+  boot(true);
+  unsigned long ms = waitForWiFi();
+  TEST_ASSERT_EQUAL(SCAN_MS + ASSOCIATE_MS + DHCP_MS, ms);
+  TEST_ASSERT_FALSE(netConnectedFast);
+  TEST_ASSERT_EQUAL(1, hal::wifiScanCount());
+}
+
+void test_warm_boot_joins_cached_ap() {
+  boot(true);
+  unsigned long cold = waitForWiFi();
+  IPAddress lease = WiFi.localIP();
+  boot(false);
+  unsigned long warm = waitForWiFi();
+  printf("[BENCH] WiFi join: cold boot %lu ms, warm reboot %lu ms (simulated scan %lu, associate %lu, DHCP %lu)\n",
+         cold, warm, SCAN_MS, ASSOCIATE_MS, DHCP_MS);
+  TEST_ASSERT_TRUE(netConnectedFast);
+  TEST_ASSERT_LESS_THAN(1000, warm);
+  TEST_ASSERT_EQUAL(0, hal::wifiScanCount());
+  TEST_ASSERT_TRUE(lease == WiFi.localIP());
+
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/status");
+  JsonDocument doc;
+  deserializeJson(doc, r.body);
+  TEST_ASSERT_TRUE(doc["boot"]["fastReconnect"].as<bool>());
+  TEST_ASSERT_EQUAL(warm, doc["boot"]["wifiConnectMs"].as<unsigned long>());
+}
+
+void test_changed_ap_falls_back_to_scan() {
+  boot(true);
+  waitForWiFi();
+  unsigned long fallbacks = netFastFallbacks;
+  hal::reset();
+  const uint8_t replaced[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+  hal::setWiFiAccessPoint(replaced, 11);
+  hal::setWiFiJoinTiming(SCAN_MS, ASSOCIATE_MS, DHCP_MS);
+  setup();
+  unsigned long ms = waitForWiFi();
+  TEST_ASSERT_FALSE(netConnectedFast);
+  TEST_ASSERT_EQUAL(fallbacks + 1, netFastFallbacks);
+  TEST_ASSERT_EQUAL(1, hal::wifiScanCount());
+  TEST_ASSERT_TRUE(ms < 2000 + SCAN_MS + ASSOCIATE_MS + DHCP_MS + 100);
+
+  // The new AP is cached for the next warm reboot
+  hal::reset();
+  hal::setWiFiAccessPoint(replaced, 11);
+  hal::setWiFiJoinTiming(SCAN_MS, ASSOCIATE_MS, DHCP_MS);
+  setup();
+  waitForWiFi();
+  TEST_ASSERT_TRUE(netConnectedFast);
+}
+
+void test_damaged_cache_is_ignored() {
+  boot(true);
+  waitForWiFi();
+  uint32_t word;
+  ESP.rtcUserMemoryRead(3, &word, sizeof(word));
+  word ^= 0x100;
+  ESP.rtcUserMemoryWrite(3, &word, sizeof(word));
+  unsigned long fallbacks = netFastFallbacks;
+  boot(false);
+  TEST_ASSERT_EQUAL(SCAN_MS + ASSOCIATE_MS + DHCP_MS, waitForWiFi());
+  TEST_ASSERT_FALSE(netConnectedFast);
+  TEST_ASSERT_EQUAL(fallbacks, netFastFallbacks); // Not even tried
+  TEST_ASSERT_EQUAL(1, hal::wifiScanCount());
+}
+
+void test_power_cycle_forgets_the_ap() {
+  boot(true);
+  waitForWiFi();
+  boot(true);
+  waitForWiFi();
+  TEST_ASSERT_FALSE(netConnectedFast);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_fast_reconnect");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_cold_boot_scans);
+  RUN_TEST(test_warm_boot_joins_cached_ap);
+  RUN_TEST(test_changed_ap_falls_back_to_scan);
+  RUN_TEST(test_damaged_cache_is_ignored);
+  RUN_TEST(test_power_cycle_forgets_the_ap);
+  return UNITY_END();
+}
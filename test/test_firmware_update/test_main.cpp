@@ -0,0 +1,283 @@
+// Firmware update: uploads and pulls take raw or gzipped images, a SHA-256
+// digest given with the image is checked before the update is committed, and
+// a pull from a LAN server resumes with a Range request where a dropped
+// connection left off. Progress and KB/s are served by /api/v1/firmware.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <Updater.h>
+#include <ArduinoJson.h>
+#include <bearssl/bearssl_hash.h>
+#include <unity.h>
+
+void writeChannels(int channels);
+
+static const char* URL = "http://192.168.1.10/firmware.bin";
+static const size_t OTA_PULL_CHUNK = 8192;
+
+// Random bytes behind an image (0xE9) or gzip (1F 8B) header
+static std::vector<uint8_t> makeImage(size_t size, bool gzip, uint32_t seed = 1) {
+  std::vector<uint8_t> image(size);
+  for (size_t i = 0; i < size; i++) {
+    seed = seed * 1103515245 + 12345;
+    image[i] = seed >> 16;
+  }
+  if (gzip) {
+    image[0] = 0x1F;
+    image[1] = 0x8B;
+  } else {
+    image[0] = 0xE9;
+  }
+  return image;
+}
+
+static String sha256Hex(const std::vector<uint8_t>& data) {
+  br_sha256_context ctx;
+  br_sha256_init(&ctx);
+  br_sha256_update(&ctx, data.data(), data.size());
+  uint8_t digest[32];
+  br_sha256_out(&ctx, digest);
+  char hex[65];
+  for (int i = 0; i < 32; i++) snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+  return String(hex);
+}
+
+static HttpResponse upload(const std::vector<uint8_t>& image, const String& sha256) {
+  return server.injectUpload("/update", "firmware.bin", image.data(), image.size(), {{"sha256", sha256}});
+}
+
+// Runs loop() until the pull is over; returns its final status
+static JsonDocument runPull(unsigned long limitMs = 600000) {
+  unsigned long start = millis();
+  while (millis() - start < limitMs) {
+    loop();
+    hal::advanceMillis(10);
+    JsonDocument status = api("/api/v1/firmware");
+    if (strcmp(status["state"] | "", "pulling") != 0) return status;
+  }
+  return api("/api/v1/firmware");
+}
+
+// Start byte of each Range request made so far
+static std::vector<unsigned long> rangeStarts() {
+  std::vector<unsigned long> starts;
+  for (const hal::HttpCall& call : hal::httpCalls()) {
+    for (auto& h : call.headers) {
+      unsigned long first;
+      if (h.first == "Range" && sscanf(h.second.c_str(), "bytes=%lu-", &first) == 1) starts.push_back(first);
+    }
+  }
+  return starts;
+}
+
+void setUp() {
+  hal::clearHttpCalls();
+  hal::clearRestartRequest();
+}
+void tearDown() {
+  hal::setHttpRangeSupport(true);
+  hal::setHttpBandwidthKBps(0);
+  hal::dropHttpAfter(-1);
+}
+
+void test_sha256_matches_known_digest() {
+  std::vector<uint8_t> abc = {'a', 'b', 'c'};
+  TEST_ASSERT_EQUAL_STRING("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sha256Hex(abc).c_str());
+}
+
+void test_upload_with_digest_is_committed() {
+  std::vector<uint8_t> image = makeImage(300 * 1024, false);
+  unsigned long successes = Update.successCount();
+  HttpResponse r = upload(image, sha256Hex(image));
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_TRUE(hal::restartRequested());
+  TEST_ASSERT_EQUAL(successes + 1, Update.successCount());
+  TEST_ASSERT_TRUE(Update.image() == image);
+  JsonDocument status = api("/api/v1/firmware");
+  TEST_ASSERT_EQUAL_STRING("done", status["state"] | "");
+  TEST_ASSERT_EQUAL_STRING("upload", status["source"] | "");
+  TEST_ASSERT_TRUE(status["verified"].as<bool>());
+  TEST_ASSERT_FALSE(status["gzip"].as<bool>());
+}
+
+// Stored as it is; the bootloader inflates it
+void test_gzipped_upload_is_stored_compressed() {
+  std::vector<uint8_t> image = makeImage(120 * 1024, true);
+  HttpResponse r = upload(image, sha256Hex(image));
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_TRUE(Update.image() == image);
+  TEST_ASSERT_TRUE(api("/api/v1/firmware")["gzip"].as<bool>());
+}
+
+void test_upload_without_digest_is_not_verified() {
+  std::vector<uint8_t> image = makeImage(64 * 1024, false);
+  HttpResponse r = upload(image, "");
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_FALSE(api("/api/v1/firmware")["verified"].as<bool>());
+}
+
+void test_digest_mismatch_is_not_committed() {
+  std::vector<uint8_t> image = makeImage(200 * 1024, false);
+  String digest = sha256Hex(image);
+  image[150000] ^= 0x01;
+  unsigned long successes = Update.successCount();
+  HttpResponse r = upload(image, digest);
+  TEST_ASSERT_EQUAL(400, r.code);
+  TEST_ASSERT_TRUE(r.body.indexOf("SHA-256 mismatch") >= 0);
+  TEST_ASSERT_FALSE(hal::restartRequested());
+  TEST_ASSERT_EQUAL(successes, Update.successCount());
+  TEST_ASSERT_FALSE(Update.isRunning());
+  TEST_ASSERT_EQUAL_STRING("failed", api("/api/v1/firmware")["state"] | "");
+}
+
+void test_bad_input_is_refused() {
+  std::vector<uint8_t> image = makeImage(16 * 1024, false);
+  image[0] = '<'; // An HTML error page saved as firmware.bin
+  HttpResponse r = upload(image, "");
+  TEST_ASSERT_EQUAL(400, r.code);
+  TEST_ASSERT_TRUE(r.body.indexOf("not a firmware image") >= 0);
+
+  r = upload(makeImage(16 * 1024, false), "abc");
+  TEST_ASSERT_EQUAL(400, r.code);
+  TEST_ASSERT_TRUE(r.body.indexOf("64 hex digits") >= 0);
+
+  r = server.inject(HTTP_POST, "/api/v1/firmware/pull", {{"url", "https://example.com/firmware.bin"}});
+  TEST_ASSERT_EQUAL(400, r.code);
+  TEST_ASSERT_FALSE(hal::restartRequested());
+}
+
+void test_pull_fetches_in_ranges() {
+  std::vector<uint8_t> image = makeImage(300 * 1024, true);
+  hal::setHttpFile(URL, image);
+  hal::setHttpBandwidthKBps(100);
+  HttpResponse r = server.inject(HTTP_POST, "/api/v1/firmware/pull", {{"url", URL}, {"sha256", sha256Hex(image)}});
+  TEST_ASSERT_EQUAL(200, r.code);
+
+  // Requests wait for loop(); the web server stays free meanwhile
+  TEST_ASSERT_EQUAL(0, hal::httpCalls().size());
+  TEST_ASSERT_EQUAL(409, upload(image, "").code);
+
+  JsonDocument status = runPull();
+  TEST_ASSERT_EQUAL_STRING("done", status["state"] | "");
+  TEST_ASSERT_TRUE(Update.image() == image);
+  TEST_ASSERT_EQUAL((image.size() + OTA_PULL_CHUNK - 1) / OTA_PULL_CHUNK, rangeStarts().size());
+  TEST_ASSERT_EQUAL(100, status["percent"].as<int>());
+  TEST_ASSERT_EQUAL(image.size(), status["total"].as<size_t>());
+  TEST_ASSERT_TRUE(status["kbps"].as<float>() > 80 && status["kbps"].as<float>() <= 100);
+
+  // Restarts once the page has had time to see it
+  TEST_ASSERT_FALSE(hal::restartRequested());
+  for (int i = 0; i < 30 && !hal::restartRequested(); i++) {
+    loop();
+    hal::advanceMillis(100);
+  }
+  TEST_ASSERT_TRUE(hal::restartRequested());
+}
+
+void test_pull_resumes_after_a_dropped_connection() {
+  std::vector<uint8_t> image = makeImage(200 * 1024, false);
+  hal::setHttpFile(URL, image);
+  hal::dropHttpAfter(100000);
+  server.inject(HTTP_POST, "/api/v1/firmware/pull", {{"url", URL}, {"sha256", sha256Hex(image)}});
+  JsonDocument status = runPull();
+  TEST_ASSERT_EQUAL_STRING("done", status["state"] | "");
+  TEST_ASSERT_EQUAL(1, status["resumes"].as<int>());
+  TEST_ASSERT_TRUE(Update.image() == image);
+
+  // The retry asked for the first byte that had not arrived, nothing again
+  std::vector<unsigned long> starts = rangeStarts();
+  bool resumedThere = false;
+  for (size_t i = 1; i < starts.size(); i++) {
+    TEST_ASSERT_TRUE(starts[i] > starts[i - 1]);
+    if (starts[i] == 100000) resumedThere = true;
+  }
+  TEST_ASSERT_TRUE(resumedThere);
+}
+
+void test_pull_digest_mismatch_is_not_committed() {
+  std::vector<uint8_t> image = makeImage(40 * 1024, false);
+  hal::setHttpFile(URL, image);
+  unsigned long successes = Update.successCount();
+  server.inject(HTTP_POST, "/api/v1/firmware/pull", {{"url", URL}, {"sha256", sha256Hex(makeImage(40 * 1024, false, 2))}});
+  JsonDocument status = runPull();
+  TEST_ASSERT_EQUAL_STRING("failed", status["state"] | "");
+  TEST_ASSERT_EQUAL_STRING("SHA-256 mismatch", status["error"] | "");
+  TEST_ASSERT_EQUAL(successes, Update.successCount());
+  runPull(10000);
+  TEST_ASSERT_FALSE(hal::restartRequested());
+}
+
+// Without Range support the image comes in one request, which cannot resume.
+// It is still read a chunk per loop(), so nothing else waits for the download.
+void test_server_without_ranges() {
+  std::vector<uint8_t> image = makeImage(100 * 1024, false);
+  hal::setHttpFile(URL, image);
+  hal::setHttpRangeSupport(false);
+  server.inject(HTTP_POST, "/api/v1/firmware/pull", {{"url", URL}});
+  loop();
+  JsonDocument status = api("/api/v1/firmware");
+  TEST_ASSERT_EQUAL_STRING("pulling", status["state"] | "");
+  TEST_ASSERT_EQUAL(OTA_PULL_CHUNK, status["bytes"].as<size_t>());
+  TEST_ASSERT_EQUAL(image.size(), status["total"].as<size_t>());
+  TEST_ASSERT_EQUAL_STRING("done", runPull()["state"] | "");
+  TEST_ASSERT_TRUE(Update.image() == image);
+  TEST_ASSERT_EQUAL(1, hal::httpCalls().size());
+
+  hal::dropHttpAfter(50000);
+  server.inject(HTTP_POST, "/api/v1/firmware/pull", {{"url", URL}});
+  status = runPull();
+  TEST_ASSERT_EQUAL_STRING("failed", status["state"] | "");
+  TEST_ASSERT_TRUE(String(status["error"] | "").indexOf("Range") >= 0);
+}
+
+// A ~500 KB image over weak WiFi that drops twice: resuming against starting over
+void test_resume_cost() {
+  const unsigned long kbps = 40;
+  std::vector<uint8_t> image = makeImage(500 * 1024, false);
+  hal::setHttpFile(URL, image);
+  hal::setHttpBandwidthKBps(kbps);
+  hal::dropHttpAfter(180 * 1024);
+  server.inject(HTTP_POST, "/api/v1/firmware/pull", {{"url", URL}, {"sha256", sha256Hex(image)}});
+  unsigned long start = millis();
+  JsonDocument status = runPull(8000);
+  TEST_ASSERT_EQUAL_STRING("pulling", status["state"] | ""); // Still going
+  hal::dropHttpAfter(200 * 1024);
+  status = runPull();
+  unsigned long ms = millis() - start;
+  TEST_ASSERT_EQUAL_STRING("done", status["state"] | "");
+  TEST_ASSERT_EQUAL(2, status["resumes"].as<int>());
+  TEST_ASSERT_TRUE(Update.image() == image);
+
+  // Starting over would fetch what came before each drop again, with the same waits
+  unsigned long refetched = 180 * 1024 + (180 + 200) * 1024;
+  unsigned long restartMs = ms + refetched * 1000 / (kbps * 1024);
+  float reported = status["kbps"].as<float>();
+  printf("[BENCH] 500 KB pull at %lu KB/s with 2 drops: resumed in %lu ms (%.1f KB/s), starting over ~%lu ms\n", kbps,
+         ms, reported, restartMs);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 500.0 * 1000 / ms, reported);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_firmware_update");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_sha256_matches_known_digest);
+  RUN_TEST(test_upload_with_digest_is_committed);
+  RUN_TEST(test_gzipped_upload_is_stored_compressed);
+  RUN_TEST(test_upload_without_digest_is_not_verified);
+  RUN_TEST(test_digest_mismatch_is_not_committed);
+  RUN_TEST(test_bad_input_is_refused);
+  RUN_TEST(test_pull_fetches_in_ranges);
+  RUN_TEST(test_pull_resumes_after_a_dropped_connection);
+  RUN_TEST(test_pull_digest_mismatch_is_not_committed);
+  RUN_TEST(test_server_without_ranges);
+  RUN_TEST(test_resume_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,132 @@
+// Home Assistant discovery: a retained config per channel entity, sent once
+// per connection from PROGMEM templates without touching the heap.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+
+void writeChannels(int channels);
+bool mqttPublishDiscovery(int index);
+
+static const char* NODE = "homeassistant/%s/doser_5CCF7F1234AB/ch%d_%s/config";
+static const char* BASE = "doser/5CCF7F1234AB";
+
+static String configTopic(const char* component, int channel, const char* object) {
+  char topic[96];
+  snprintf(topic, sizeof(topic), NODE, component, channel, object);
+  return topic;
+}
+
+static JsonDocument config(const char* component, int channel, const char* object) {
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, hal::mqttRetained(configTopic(component, channel, object)));
+  if (error) printf("  %s ch%d_%s: %s\n", component, channel, object, error.c_str());
+  return doc;
+}
+
+static int configPublishes() {
+  int count = 0;
+  for (const hal::MqttMessage& m : hal::mqttPublished()) {
+    if (m.topic.startsWith("homeassistant/")) count++;
+  }
+  return count;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_every_channel_entity_is_announced() {
+  const struct {
+    const char* component;
+    const char* object;
+  } entities[] = {{"sensor", "remaining"}, {"sensor", "days"}, {"number", "dose"}, {"switch", "prime"},
+                  {"binary_sensor", "calibrated"}};
+  for (int channel = 1; channel <= 2; channel++) {
+    for (const auto& e : entities) {
+      JsonDocument doc = config(e.component, channel, e.object);
+      TEST_ASSERT_EQUAL_STRING(BASE, doc["~"] | "");
+      String uniqueId = String("doser_5CCF7F1234AB_ch") + String(channel) + "_" + e.object;
+      TEST_ASSERT_EQUAL_STRING(uniqueId.c_str(), doc["uniq_id"] | "");
+      TEST_ASSERT_EQUAL_STRING("~/status", doc["avty_t"] | "");
+      TEST_ASSERT_EQUAL_STRING("doser_5CCF7F1234AB", doc["dev"]["ids"][0] | "");
+      TEST_ASSERT_EQUAL_STRING("Doser_4A", doc["dev"]["name"] | "");
+    }
+  }
+  TEST_ASSERT_EQUAL(10, configPublishes()); // Nothing else announced
+}
+
+void test_entities_point_at_state_and_command_topics() {
+  JsonDocument remaining = config("sensor", 2, "remaining");
+  TEST_ASSERT_EQUAL_STRING("Channel 2 remaining", remaining["name"] | "");
+  TEST_ASSERT_EQUAL_STRING("~/channel/2/remaining_ml", remaining["stat_t"] | "");
+  TEST_ASSERT_EQUAL_STRING("mL", remaining["unit_of_meas"] | "");
+  TEST_ASSERT_EQUAL_STRING("~/channel/1/days_remaining", config("sensor", 1, "days")["stat_t"] | "");
+
+  JsonDocument dose = config("number", 1, "dose");
+  TEST_ASSERT_EQUAL_STRING("~/channel/1/dose/set", dose["cmd_t"] | "");
+  JsonDocument prime = config("switch", 1, "prime");
+  TEST_ASSERT_EQUAL_STRING("~/channel/1/prime/set", prime["cmd_t"] | "");
+  TEST_ASSERT_EQUAL_STRING("~/channel/1/priming", prime["stat_t"] | "");
+  JsonDocument calibrated = config("binary_sensor", 1, "calibrated");
+  TEST_ASSERT_EQUAL_STRING("true", calibrated["pl_on"] | "");
+
+  // Home Assistant setting the number doses through the command topic
+  hal::mqttInject(String(BASE) + "/channel/1/dose/set", "1.5");
+  runLoopFor(500);
+  TEST_ASSERT_EQUAL_STRING("1.50", hal::mqttRetained(String(BASE) + "/channel/1/last_dose_ml").c_str());
+}
+
+void test_sent_once_per_connection() {
+  hal::clearMqttPublished();
+  runLoopFor(10000);
+  TEST_ASSERT_EQUAL(0, configPublishes());
+
+  hal::setMqttBrokerReachable(false);
+  runLoopFor(1000);
+  hal::setMqttBrokerReachable(true);
+  runLoopFor(30000);
+  TEST_ASSERT_EQUAL(10, configPublishes());
+}
+
+void test_rename_is_announced_with_escaping() {
+  hal::clearMqttPublished();
+  server.inject(HTTP_POST, "/renameChannel", {{"channel", "1"}, {"name", "Iron \"Fe\""}});
+  runLoopFor(1000);
+  TEST_ASSERT_EQUAL(10, configPublishes());
+  TEST_ASSERT_EQUAL_STRING("Iron \"Fe\" remaining", config("sensor", 1, "remaining")["name"] | "");
+}
+
+void test_payloads_use_a_fixed_buffer() {
+  unsigned int largest = 0;
+  hal::clearMqttPublished();
+  hal::resetHeapStats();
+  for (int i = 0; i < 10; i++) TEST_ASSERT_TRUE(mqttPublishDiscovery(i));
+  hal::HeapStats heap = hal::heapStats();
+  for (const hal::MqttMessage& m : hal::mqttPublished()) {
+    if (m.payload.length() > largest) largest = m.payload.length();
+  }
+  printf("[BENCH] 10 discovery configs: %lu allocations, largest payload %u bytes\n", heap.allocations, largest);
+  TEST_ASSERT_EQUAL(0, heap.allocations);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_ha_discovery");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+  server.inject(HTTP_POST, "/systemSettings", {{"mqttHost", "broker.local"}});
+  runLoopFor(2000);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_every_channel_entity_is_announced);
+  RUN_TEST(test_entities_point_at_state_and_command_topics);
+  RUN_TEST(test_sent_once_per_connection);
+  RUN_TEST(test_rename_is_announced_with_escaping);
+  RUN_TEST(test_payloads_use_a_fixed_buffer);
+  return UNITY_END();
+}
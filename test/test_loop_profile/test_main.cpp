@@ -0,0 +1,106 @@
+// Loop profiler: per-stage and loop period histograms from the cycle counter,
+// reported by /api/v1/profile and the "profile" serial command. A blocking
+// ntfy send shows up as the ntfy stage's max without moving its p50.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <chrono>
+
+void writeChannels(int channels);
+void loopProfileReset();
+
+extern bool notifyLowFert;
+
+// Short enough that every stage runs many times
+static const unsigned long STEP_MS = 10;
+
+static JsonDocument profile() {
+  return api("/api/v1/profile");
+}
+
+void setUp() {
+  hal::setHttpClientLatencyMs(0);
+  runLoopFor(60000); // Let setup()'s notifications go out first
+  loopProfileReset();
+}
+void tearDown() {
+  hal::setHttpClientLatencyMs(0);
+}
+
+void test_loop_period() {
+  runLoopFor(5000, STEP_MS);
+  JsonDocument doc = profile();
+  TEST_ASSERT_EQUAL(60000, doc["windowMs"].as<int>());
+  JsonObject period = doc["stages"]["period"];
+  TEST_ASSERT_EQUAL(499, period["samples"].as<int>());
+  TEST_ASSERT_EQUAL(10000, period["maxUs"].as<int>());
+  TEST_ASSERT_EQUAL(10000, period["p50Us"].as<int>()); // Bucket bound capped at the max
+  TEST_ASSERT_EQUAL(500, doc["stages"]["web"]["samples"].as<int>());
+}
+
+void test_blocking_send_is_charged_to_ntfy() {
+  notifyLowFert = true;
+  hal::setHttpClientLatencyMs(2500);
+  server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "0.1"}});
+  runLoopFor(5000, STEP_MS);
+  JsonObject ntfy = profile()["stages"]["ntfy"];
+  TEST_ASSERT_EQUAL(2500000, ntfy["maxUs"].as<int>());
+  TEST_ASSERT_LESS_THAN(10, ntfy["p50Us"].as<int>());
+  JsonObject period = profile()["stages"]["period"];
+  TEST_ASSERT_TRUE(period["maxUs"].as<unsigned long>() >= 2500000);
+  // Half-octave buckets: 10 ms lands in 8192..12287 us
+  TEST_ASSERT_TRUE(period["p50Us"].as<int>() >= 10000 && period["p50Us"].as<int>() <= 12287);
+
+  // The stall ages out after a full window with no repeat
+  hal::setHttpClientLatencyMs(0);
+  runLoopFor(2 * 60000 + 100);
+  ntfy = profile()["stages"]["ntfy"];
+  TEST_ASSERT_LESS_THAN(10, ntfy["maxUs"].as<int>());
+}
+
+void test_serial_console() {
+  runLoopFor(1000, STEP_MS);
+  hal::captureSerial(true);
+  hal::serialInput("profile\n");
+  loop();
+  String out = hal::serialOutput();
+  TEST_ASSERT_TRUE(out.indexOf("[PROFILE] stage") >= 0);
+  TEST_ASSERT_TRUE(out.indexOf("[PROFILE] ntfy") >= 0);
+  TEST_ASSERT_TRUE(out.indexOf("[PROFILE] period") >= 0);
+
+  hal::clearSerialOutput();
+  hal::serialInput("profile reset\n");
+  loop();
+  TEST_ASSERT_TRUE(hal::serialOutput().indexOf("[PROFILE] Cleared") >= 0);
+  hal::captureSerial(false);
+  TEST_ASSERT_EQUAL(0, profile()["stages"]["period"]["samples"].as<int>());
+}
+
+// Host cost of the instrumentation itself, for comparing with LOOP_PROFILER=0
+void test_overhead() {
+  const int passes = 100000;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < passes; i++) loop();
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  printf("[BENCH] loop() %.0f ns per pass on the host, profiler included\n", (double)ns / passes);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_loop_profile");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_loop_period);
+  RUN_TEST(test_blocking_send_is_charged_to_ntfy);
+  RUN_TEST(test_serial_console);
+  RUN_TEST(test_overhead);
+  return UNITY_END();
+}
@@ -0,0 +1,126 @@
+// /metrics: Prometheus text with heap gauges, the since-boot heap low-water
+// mark and per-route latency and heap cost measured around each handler.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+void setup();
+void loop();
+void writeChannels(int channels);
+
+extern ESP8266WebServer server;
+
+static HttpResponse scrape() {
+  return server.inject(HTTP_GET, "/metrics");
+}
+
+// Value of the sample whose name and labels are exactly series, -1 if absent
+static double sample(const String& body, const String& series) {
+  int at = body.indexOf("\n" + series + " ");
+  if (at < 0) return -1;
+  return body.substring(at + series.length() + 2).toDouble();
+}
+
+static String routeSeries(const char* name, const char* route, const char* method) {
+  return String(name) + "{route=\"" + route + "\",method=\"" + method + "\"}";
+}
+
+// Comment, or "name value" / "name{labels} value"
+static bool validLine(const String& line) {
+  if (line.length() == 0 || line.startsWith("# HELP ") || line.startsWith("# TYPE ")) return true;
+  int space = line.lastIndexOf(' ');
+  if (space <= 0) return false;
+  for (int i = 0; i < space; i++) {
+    char c = line[i];
+    if (c == '{') return line[space - 1] == '}';
+    if (!(isalnum(c) || c == '_')) return false;
+  }
+  for (unsigned int i = space + 1; i < line.length(); i++) {
+    if (!(isdigit(line[i]) || line[i] == '.')) return false;
+  }
+  return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_exposition_format() {
+  HttpResponse r = scrape();
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_TRUE(r.contentType.startsWith("text/plain"));
+  int start = 0;
+  while (start < (int)r.body.length()) {
+    int end = r.body.indexOf('\n', start);
+    TEST_ASSERT_TRUE(end >= 0); // Every line is terminated
+    String line = r.body.substring(start, end);
+    if (!validLine(line)) printf("  bad line: %s\n", line.c_str());
+    TEST_ASSERT_TRUE(validLine(line));
+    start = end + 1;
+  }
+  double freeHeap = sample(r.body, "doser_heap_free_bytes");
+  TEST_ASSERT_TRUE(freeHeap > 0);
+  TEST_ASSERT_TRUE(sample(r.body, "doser_heap_free_min_bytes") <= freeHeap);
+  TEST_ASSERT_TRUE(sample(r.body, "doser_heap_max_free_block_bytes") <= freeHeap);
+  TEST_ASSERT_EQUAL(20, (int)sample(r.body, "doser_heap_fragmentation_percent"));
+  TEST_ASSERT_TRUE(sample(r.body, "doser_stack_free_min_bytes") > 0);
+  printf("[METRICS] free heap after boot %.0f bytes, %u bytes of metrics\n", freeHeap, r.body.length());
+}
+
+void test_requests_are_counted_per_route() {
+  for (int i = 0; i < 3; i++) server.inject(HTTP_GET, "/summary");
+  server.inject(HTTP_GET, "/api/v1/status");
+  String body = scrape().body;
+  TEST_ASSERT_EQUAL(3, (int)sample(body, routeSeries("doser_http_request_duration_seconds_count", "/summary", "GET")));
+  TEST_ASSERT_EQUAL(1, (int)sample(body, routeSeries("doser_http_request_duration_seconds_count", "/api/v1/status", "GET")));
+  // Routes nobody has called are left out
+  TEST_ASSERT_TRUE(body.indexOf("route=\"/factoryReset\"") < 0);
+}
+
+void test_latency_is_measured() {
+  // The restart handler waits half a second before rebooting
+  server.inject(HTTP_POST, "/restart");
+  hal::clearRestartRequest();
+  String body = scrape().body;
+  double maxSeconds = sample(body, routeSeries("doser_http_request_duration_max_seconds", "/restart", "POST"));
+  TEST_ASSERT_TRUE(maxSeconds >= 0.5 && maxSeconds < 0.6);
+  TEST_ASSERT_TRUE(sample(body, routeSeries("doser_http_request_duration_seconds_sum", "/restart", "POST")) >= 0.5);
+}
+
+void test_heap_peak_and_low_water_mark() {
+  double freeBefore = sample(scrape().body, "doser_heap_free_bytes");
+  String longName = "A channel name well past the small string buffer";
+  server.inject(HTTP_POST, "/renameChannel", {{"channel", "1"}, {"name", longName}});
+  String body = scrape().body;
+  double peak = sample(body, routeSeries("doser_http_request_heap_peak_bytes", "/renameChannel", "POST"));
+  TEST_ASSERT_TRUE(peak >= longName.length());
+  double minAfter = sample(body, "doser_heap_free_min_bytes");
+  TEST_ASSERT_TRUE(minAfter <= freeBefore - longName.length());
+
+  // The name's memory comes back, the low-water mark stays
+  server.inject(HTTP_POST, "/renameChannel", {{"channel", "1"}, {"name", "Iron"}});
+  for (int i = 0; i < 10; i++) {
+    loop();
+    hal::advanceMillis(100);
+  }
+  body = scrape().body;
+  TEST_ASSERT_TRUE(sample(body, "doser_heap_free_bytes") > minAfter);
+  TEST_ASSERT_EQUAL((int)minAfter, (int)sample(body, "doser_heap_free_min_bytes"));
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_metrics");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_exposition_format);
+  RUN_TEST(test_requests_are_counted_per_route);
+  RUN_TEST(test_latency_is_measured);
+  RUN_TEST(test_heap_peak_and_low_water_mark);
+  return UNITY_END();
+}
@@ -0,0 +1,183 @@
+// MQTT: retained per-channel state published only on change, dose/prime/
+// schedule commands, and a broker outage that neither stalls loop() nor
+// loses the latest values.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+
+void writeChannels(int channels);
+
+extern unsigned long mqttConnectFailures;
+extern unsigned long mqttCommands;
+
+static const char* TOPIC = "doser/5CCF7F1234AB";
+
+static String channelTopic(int channel, const char* leaf) {
+  return String(TOPIC) + "/channel/" + String(channel) + "/" + leaf;
+}
+
+static int publishesTo(const String& topic) {
+  int count = 0;
+  for (const hal::MqttMessage& m : hal::mqttPublished()) {
+    if (m.topic == topic) count++;
+  }
+  return count;
+}
+
+static void command(int channel, const char* what, const String& payload) {
+  hal::mqttInject(channelTopic(channel, what) + "/set", payload);
+  runLoopFor(500);
+}
+
+void setUp() {}
+void tearDown() {
+  hal::setMqttBrokerReachable(true);
+}
+
+void test_connects_and_publishes_retained_state() {
+  TEST_ASSERT_EQUAL(1, hal::mqttConnectCount());
+  TEST_ASSERT_EQUAL_STRING("doser-5CCF7F1234AB", hal::mqttClientId().c_str());
+  TEST_ASSERT_EQUAL_STRING("doser", hal::mqttUser().c_str());
+  TEST_ASSERT_EQUAL_STRING("secret", hal::mqttPassword().c_str());
+  TEST_ASSERT_EQUAL_STRING("online", hal::mqttRetained(String(TOPIC) + "/status").c_str());
+  for (int channel = 1; channel <= 2; channel++) {
+    TEST_ASSERT_EQUAL_STRING("100.00", hal::mqttRetained(channelTopic(channel, "remaining_ml")).c_str());
+    TEST_ASSERT_EQUAL_STRING("false", hal::mqttRetained(channelTopic(channel, "calibrated")).c_str());
+    TEST_ASSERT_EQUAL_STRING("OFF", hal::mqttRetained(channelTopic(channel, "priming")).c_str());
+    TEST_ASSERT_EQUAL_STRING("N/A", hal::mqttRetained(channelTopic(channel, "last_dose_time")).c_str());
+  }
+}
+
+void test_publishes_only_changes() {
+  hal::clearMqttPublished();
+  runLoopFor(10000);
+  TEST_ASSERT_EQUAL(0, hal::mqttPublished().size());
+
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "2"}, {"volume", "80"}});
+  runLoopFor(1000);
+  TEST_ASSERT_EQUAL(1, publishesTo(channelTopic(2, "remaining_ml")));
+  TEST_ASSERT_EQUAL_STRING("80.00", hal::mqttRetained(channelTopic(2, "remaining_ml")).c_str());
+  TEST_ASSERT_EQUAL(0, publishesTo(channelTopic(1, "remaining_ml")));
+
+  // An idle pass neither publishes nor allocates
+  hal::clearMqttPublished();
+  hal::resetHeapStats();
+  for (int i = 0; i < 100; i++) loop();
+  TEST_ASSERT_EQUAL(0, hal::heapStats().allocations);
+  TEST_ASSERT_EQUAL(0, hal::mqttPublished().size());
+}
+
+void test_dose_command() {
+  unsigned long before = mqttCommands;
+  command(1, "dose", "2.5");
+  TEST_ASSERT_EQUAL(before + 1, mqttCommands);
+  TEST_ASSERT_EQUAL_STRING("97.50", hal::mqttRetained(channelTopic(1, "remaining_ml")).c_str());
+  TEST_ASSERT_EQUAL_STRING("2.50", hal::mqttRetained(channelTopic(1, "last_dose_ml")).c_str());
+  TEST_ASSERT_TRUE(hal::mqttRetained(channelTopic(1, "last_dose_time")) != "N/A");
+
+  // Nonsense is ignored
+  command(1, "dose", "lots");
+  command(9, "dose", "1");
+  TEST_ASSERT_EQUAL_STRING("97.50", hal::mqttRetained(channelTopic(1, "remaining_ml")).c_str());
+}
+
+void test_prime_command() {
+  command(2, "prime", "ON");
+  TEST_ASSERT_EQUAL_STRING("ON", hal::mqttRetained(channelTopic(2, "priming")).c_str());
+  TEST_ASSERT_EQUAL(HIGH, hal::pinLevel(D5));
+  command(2, "prime", "OFF");
+  TEST_ASSERT_EQUAL_STRING("OFF", hal::mqttRetained(channelTopic(2, "priming")).c_str());
+  TEST_ASSERT_EQUAL(LOW, hal::pinLevel(D5));
+}
+
+void test_schedule_command() {
+  command(1, "schedule",
+          "{\"missedDoseCompensation\":true,\"days\":[{\"day\":\"Tuesday\",\"enabled\":true,\"time\":\"07:30\",\"volumeMl\":10}]}");
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/schedules", {{"channel", "1"}});
+  JsonDocument doc;
+  deserializeJson(doc, r.body);
+  JsonObject schedule = doc["schedules"][0];
+  TEST_ASSERT_TRUE(schedule["missedDoseCompensation"].as<bool>());
+  JsonObject tuesday = schedule["days"][1];
+  TEST_ASSERT_TRUE(tuesday["enabled"].as<bool>());
+  TEST_ASSERT_EQUAL_STRING("07:30", tuesday["time"].as<const char*>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 10, tuesday["volumeMl"].as<float>());
+  TEST_ASSERT_FALSE(schedule["days"][0]["enabled"].as<bool>());
+  // 97.5 ml covers 9 doses of 10 ml
+  TEST_ASSERT_EQUAL_STRING("9", hal::mqttRetained(channelTopic(1, "days_remaining")).c_str());
+}
+
+void test_broker_outage() {
+  hal::setMqttBrokerReachable(false);
+  TEST_ASSERT_EQUAL_STRING("offline", hal::mqttRetained(String(TOPIC) + "/status").c_str());
+  unsigned long failures = mqttConnectFailures;
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "50"}});
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "40"}});
+  // Each failed attempt waits out the connect timeout; backoff keeps them rare
+  unsigned long start = millis();
+  int passes = 0;
+  while (millis() - start < 60000) {
+    loop();
+    hal::advanceMillis(10);
+    passes++;
+  }
+  unsigned long attempts = mqttConnectFailures - failures;
+  TEST_ASSERT_TRUE(attempts >= 3 && attempts <= 5);
+  TEST_ASSERT_TRUE(passes > 5000);
+
+  hal::clearMqttPublished();
+  hal::setMqttBrokerReachable(true);
+  runLoopFor(60000);
+  TEST_ASSERT_EQUAL_STRING("online", hal::mqttRetained(String(TOPIC) + "/status").c_str());
+  TEST_ASSERT_EQUAL_STRING("40.00", hal::mqttRetained(channelTopic(1, "remaining_ml")).c_str());
+  // Only the latest value was sent
+  TEST_ASSERT_EQUAL(1, publishesTo(channelTopic(1, "remaining_ml")));
+}
+
+void test_settings() {
+  HttpResponse page = server.inject(HTTP_GET, "/systemSettings");
+  TEST_ASSERT_TRUE(page.body.indexOf("name='mqttHost' value='broker.local'") > 0);
+  TEST_ASSERT_TRUE(page.body.indexOf("secret") < 0);
+
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/settings");
+  JsonDocument doc;
+  deserializeJson(doc, r.body);
+  TEST_ASSERT_EQUAL_STRING("broker.local", doc["mqtt"]["host"].as<const char*>());
+  TEST_ASSERT_EQUAL(1883, doc["mqtt"]["port"].as<int>());
+  TEST_ASSERT_FALSE(doc["mqtt"]["password"].is<const char*>());
+
+  // A new topic reconnects and republishes under it
+  server.inject(HTTP_POST, "/systemSettings", {{"mqttHost", "broker.local"}, {"mqttUser", "doser"}, {"mqttTopic", "tank/doser/"}});
+  runLoopFor(5000);
+  TEST_ASSERT_EQUAL_STRING("secret", hal::mqttPassword().c_str());
+  TEST_ASSERT_EQUAL_STRING("online", hal::mqttRetained("tank/doser/status").c_str());
+  TEST_ASSERT_EQUAL_STRING("40.00", hal::mqttRetained("tank/doser/channel/1/remaining_ml").c_str());
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_mqtt");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+  server.inject(HTTP_POST, "/systemSettings",
+                {{"mqttHost", "broker.local"}, {"mqttUser", "doser"}, {"mqttPassword", "secret"}});
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "100"}});
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "2"}, {"volume", "100"}});
+  runLoopFor(2000);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_connects_and_publishes_retained_state);
+  RUN_TEST(test_publishes_only_changes);
+  RUN_TEST(test_dose_command);
+  RUN_TEST(test_prime_command);
+  RUN_TEST(test_schedule_command);
+  RUN_TEST(test_broker_outage);
+  RUN_TEST(test_settings);
+  return UNITY_END();
+}
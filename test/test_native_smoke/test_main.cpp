@@ -0,0 +1,155 @@
+// Boots the firmware on the simulated HAL and exercises a few pages and a dose.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+void writeChannels(int channels);
+
+extern bool persistentDataDirty;
+extern unsigned long persistentDataWrites;
+extern unsigned long persistentDataWritesSaved;
+
+static const uint8_t MOTOR1 = D1;
+static const uint8_t MOTOR4 = D8;
+// Every millisecond, so no motor edge is missed
+static const unsigned long STEP_MS = 1;
+
+void setUp() {}
+void tearDown() {}
+
+static int motorEdges(uint8_t pin, uint8_t level) {
+  int n = 0;
+  for (const auto& e : hal::gpioEdges()) {
+    if (e.pin == pin && e.level == level) n++;
+  }
+  return n;
+}
+
+void test_boot_serves_summary() {
+  HttpResponse r = server.inject(HTTP_GET, "/summary");
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_TRUE(r.body.indexOf("Doser Summary") >= 0);
+  TEST_ASSERT_TRUE(r.body.indexOf("</html>") >= 0);
+}
+
+void test_root_redirects() {
+  HttpResponse r = server.inject(HTTP_GET, "/");
+  TEST_ASSERT_EQUAL(302, r.code);
+  TEST_ASSERT_EQUAL_STRING("/summary", r.header("Location").c_str());
+}
+
+void test_static_assets_cached() {
+  HttpResponse page = server.inject(HTTP_GET, "/summary");
+  TEST_ASSERT_TRUE(page.body.indexOf("/static/app.css?v=") >= 0);
+  TEST_ASSERT_TRUE(page.body.indexOf("<style") < 0);
+
+  HttpResponse css = server.inject(HTTP_GET, "/static/app.css");
+  TEST_ASSERT_EQUAL(200, css.code);
+  TEST_ASSERT_EQUAL_STRING("gzip", css.header("Content-Encoding").c_str());
+  String etag = css.header("ETag");
+  TEST_ASSERT_TRUE(etag.length() > 2);
+  TEST_ASSERT_EQUAL(0x1f, (uint8_t)css.body[0]);
+
+  HttpResponse again = server.inject(HTTP_GET, "/static/app.css", {}, {{"If-None-Match", etag}});
+  TEST_ASSERT_EQUAL(304, again.code);
+  TEST_ASSERT_EQUAL(0, again.body.length());
+}
+
+void test_api_streams_json() {
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/channels");
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_EQUAL_STRING("application/json", r.contentType.c_str());
+  TEST_ASSERT_TRUE(r.body.startsWith("{\"channels\":[{\"channel\":1,"));
+  TEST_ASSERT_TRUE(r.body.endsWith("]}"));
+  r = server.inject(HTTP_GET, "/api/v1/status");
+  TEST_ASSERT_TRUE(r.body.indexOf("\"version\":") > 0);
+}
+
+void test_manual_dose_returns_before_motor_stops() {
+  // 5 s calibration run measured as 5 ml: 1 s per ml
+  server.inject(HTTP_POST, "/calibrate", {{"channel", "1"}, {"dispensedML", "5"}});
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "100"}});
+  hal::clearGpioEdges();
+  unsigned long before = millis();
+  HttpResponse r = server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "2"}});
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_LESS_THAN(100UL, millis() - before);
+  TEST_ASSERT_EQUAL(1, motorEdges(MOTOR1, HIGH));
+  TEST_ASSERT_EQUAL(0, motorEdges(MOTOR1, LOW));
+
+  runLoopFor(2500, STEP_MS);
+  TEST_ASSERT_EQUAL(1, motorEdges(MOTOR1, LOW));
+  const auto& edges = hal::gpioEdges();
+  unsigned long long onUs = 0, offUs = 0;
+  for (const auto& e : edges) {
+    if (e.pin != MOTOR1) continue;
+    if (e.level == HIGH) onUs = e.us;
+    else offUs = e.us;
+  }
+  TEST_ASSERT_EQUAL(2000000ULL, offUs - onUs);
+  HttpResponse ch = server.inject(HTTP_GET, "/api/v1/channels", {{"channel", "1"}});
+  TEST_ASSERT_TRUE(ch.body.indexOf("\"remainingMl\":98") > 0);
+}
+
+void test_four_channel_board() {
+  HttpResponse r = server.inject(HTTP_GET, "/summary");
+  TEST_ASSERT_TRUE(r.body.indexOf("Manage Channel 4") > 0);
+  r = server.inject(HTTP_GET, "/api/v1/channels");
+  TEST_ASSERT_TRUE(r.body.indexOf("\"channel\":4") > 0);
+
+  server.inject(HTTP_POST, "/calibrate", {{"channel", "4"}, {"dispensedML", "5"}});
+  runLoopFor(5000, STEP_MS);
+  hal::clearGpioEdges();
+  r = server.inject(HTTP_POST, "/manual", {{"channel", "4"}, {"ml", "0.5"}});
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_EQUAL(1, motorEdges(MOTOR4, HIGH));
+  TEST_ASSERT_EQUAL(0, motorEdges(MOTOR1, HIGH));
+  r = server.inject(HTTP_POST, "/manual", {{"channel", "5"}, {"ml", "0.5"}});
+  TEST_ASSERT_EQUAL(400, r.code);
+}
+
+void test_settings_write_data_once() {
+  runLoopFor(1000, STEP_MS);
+  unsigned long writes = persistentDataWrites;
+  unsigned long saved = persistentDataWritesSaved;
+  server.inject(HTTP_POST, "/renameChannel", {{"channel", "1"}, {"name", "Iron"}});
+  server.inject(HTTP_POST, "/timezone", {{"offset", "19800"}});
+  TEST_ASSERT_TRUE(persistentDataDirty);
+  TEST_ASSERT_EQUAL(writes, persistentDataWrites);
+  runLoopFor(1500, STEP_MS);
+  TEST_ASSERT_FALSE(persistentDataDirty);
+  TEST_ASSERT_EQUAL(writes + 1, persistentDataWrites);
+  TEST_ASSERT_GREATER_THAN(saved, persistentDataWritesSaved);
+
+  // Doses only append to the counter journal
+  server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "1"}});
+  TEST_ASSERT_FALSE(persistentDataDirty);
+}
+
+void test_state_persisted_to_fs() {
+  TEST_ASSERT_TRUE(LittleFS.exists("/state0.bin") || LittleFS.exists("/state1.bin"));
+  TEST_ASSERT_FALSE(LittleFS.exists("/data.json"));
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_smoke");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(4);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_serves_summary);
+  RUN_TEST(test_root_redirects);
+  RUN_TEST(test_static_assets_cached);
+  RUN_TEST(test_api_streams_json);
+  RUN_TEST(test_manual_dose_returns_before_motor_stops);
+  RUN_TEST(test_settings_write_data_once);
+  RUN_TEST(test_four_channel_board);
+  RUN_TEST(test_state_persisted_to_fs);
+  return UNITY_END();
+}
@@ -0,0 +1,127 @@
+// Network bring-up: setup() returns without waiting for WiFi or NTP, doses
+// run on the saved clock through a router outage, the config portal opens
+// next to normal operation and boot-to-ready time is reported.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+
+void writeChannels(int channels);
+
+extern bool timeSynced;
+
+static const uint32_t START_UTC = 1752634800; // Wed 16-Jul-2025 03:00:00 UTC
+static const int WIFI_RETRY_LIMIT = 30;
+
+static void reboot(bool wifi, uint32_t utc = START_UTC) {
+  reboot([&] {
+    hal::setUtcEpoch(utc);
+    hal::setWiFiConnected(wifi);
+  });
+}
+
+static float remainingMl(int n) {
+  return api("/api/v1/channels")["channels"][n - 1]["remainingMl"].as<float>();
+}
+
+void setUp() {}
+void tearDown() {
+  hal::setWiFiConnected(true);
+}
+
+void test_setup_does_not_wait_for_the_network() {
+  reboot(false);
+  TEST_ASSERT_LESS_THAN(1000, millis());
+  TEST_ASSERT_FALSE(timeSynced);
+  JsonObject boot = api("/api/v1/status")["boot"];
+  TEST_ASSERT_EQUAL_STRING("connecting", boot["network"] | "");
+  TEST_ASSERT_EQUAL(0, boot["readyMs"].as<unsigned long>());
+}
+
+// Router down across a reboot: the 03:10 dose still runs, on the saved clock
+void test_doses_on_saved_clock_while_offline() {
+  reboot(true);
+  runLoopFor(1000);
+  TEST_ASSERT_TRUE(timeSynced);
+  server.inject(HTTP_POST, "/timezone", {{"offset", "0"}});
+  server.inject(HTTP_POST, "/calibrate", {{"channel", "1"}, {"dispensedML", "5"}});
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "100"}});
+  std::vector<std::pair<String, String>> args = {{"channel", "1"}};
+  for (int day = 0; day < 7; day++) {
+    args.push_back({"enabled" + String(day), "on"});
+    args.push_back({"time" + String(day), "03:10"});
+    args.push_back({"vol" + String(day), "1"});
+  }
+  server.inject(HTTP_POST, "/manageSchedule", args);
+  runLoopFor(5000);
+
+  reboot(false, START_UTC + 60);
+  JsonObject clock = api("/api/v1/status")["clock"];
+  TEST_ASSERT_TRUE(clock["estimated"].as<bool>());
+  runLoopFor(15 * 60000UL, 1000);
+  TEST_ASSERT_FALSE(timeSynced);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 99, remainingMl(1));
+}
+
+void test_portal_runs_next_to_normal_operation() {
+  reboot(false);
+  runLoopFor(25000);
+  JsonObject boot = api("/api/v1/status")["boot"];
+  TEST_ASSERT_EQUAL_STRING("portal", boot["network"] | "");
+  TEST_ASSERT_TRUE(boot["portal"].as<bool>());
+
+  // Retries once a minute up to the limit, and no pass of loop() waits
+  for (int i = 0; i < 40 * 60 * 10; i++) {
+    unsigned long before = millis();
+    loop();
+    TEST_ASSERT_EQUAL(before, millis());
+    hal::advanceMillis(100);
+  }
+  TEST_ASSERT_EQUAL(WIFI_RETRY_LIMIT, api("/api/v1/status")["boot"]["wifiAttempts"].as<int>());
+  HttpResponse page = server.inject(HTTP_GET, "/summary");
+  TEST_ASSERT_EQUAL(200, page.code);
+
+  hal::setWiFiConnected(true);
+  runLoopFor(1000);
+  boot = api("/api/v1/status")["boot"];
+  TEST_ASSERT_EQUAL_STRING("ready", boot["network"] | "");
+  TEST_ASSERT_FALSE(boot["portal"].as<bool>());
+  TEST_ASSERT_TRUE(timeSynced);
+}
+
+void test_boot_to_ready_is_reported() {
+  reboot(true);
+  while (!timeSynced && millis() < 5000) {
+    loop();
+    hal::advanceMillis(10);
+  }
+  loop();
+  JsonDocument status = api("/api/v1/status");
+  JsonObject boot = status["boot"];
+  TEST_ASSERT_EQUAL_STRING("ready", boot["network"] | "");
+  unsigned long setupMs = boot["setupMs"].as<unsigned long>();
+  unsigned long readyMs = boot["readyMs"].as<unsigned long>();
+  printf("[BENCH] boot: setup() %lu ms, WiFi up at %lu ms, ready at %lu ms (virtual clock)\n", setupMs,
+         boot["onlineMs"].as<unsigned long>(), readyMs);
+  TEST_ASSERT_TRUE(readyMs > 0 && readyMs < 1000);
+  TEST_ASSERT_TRUE(setupMs <= readyMs);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_net_boot");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_setup_does_not_wait_for_the_network);
+  RUN_TEST(test_doses_on_saved_clock_while_offline);
+  RUN_TEST(test_portal_runs_next_to_normal_operation);
+  RUN_TEST(test_boot_to_ready_is_reported);
+  return UNITY_END();
+}
@@ -0,0 +1,138 @@
+// ntfy notification queue: handlers never wait on the network, duplicate
+// alerts coalesce, failures back off and the backlog survives a reboot.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+void writeChannels(int channels);
+void loadNtfyQueue();
+
+extern bool notifyLowFert;
+extern int ntfyQueueCount;
+extern unsigned long ntfySent;
+extern unsigned long ntfyFailed;
+extern unsigned long ntfyDropped;
+extern unsigned long ntfyCoalesced;
+
+// Drain whatever setup() queued and start from clean counters
+static void drain() {
+  hal::setHttpClientResult(200);
+  hal::setHttpClientLatencyMs(0);
+  runLoopFor(60000);
+  TEST_ASSERT_EQUAL(0, ntfyQueueCount);
+  hal::clearHttpCalls();
+  ntfySent = ntfyFailed = ntfyDropped = ntfyCoalesced = 0;
+}
+
+void setUp() {
+  notifyLowFert = true;
+  drain();
+}
+void tearDown() {
+  hal::setHttpClientResult(200);
+  hal::setHttpClientLatencyMs(0);
+}
+
+void test_manual_dose_does_not_wait_for_ntfy() {
+  hal::setHttpClientLatencyMs(2500);
+  unsigned long before = millis();
+  HttpResponse r = server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "0.1"}});
+  TEST_ASSERT_EQUAL(200, r.code);
+  TEST_ASSERT_LESS_THAN(100UL, millis() - before);
+  TEST_ASSERT_EQUAL(0, hal::httpCalls().size());
+  TEST_ASSERT_EQUAL(1, ntfyQueueCount);
+
+  runLoopFor(1000);
+  TEST_ASSERT_EQUAL(1, hal::httpCalls().size());
+  TEST_ASSERT_EQUAL_STRING("Low Fertilizer Alert", hal::httpCalls()[0].headers[0].second.c_str());
+  TEST_ASSERT_EQUAL(1, ntfySent);
+  TEST_ASSERT_EQUAL(0, ntfyQueueCount);
+}
+
+void test_duplicate_low_fertilizer_alerts_coalesce() {
+  hal::setWiFiConnected(false);
+  for (int i = 0; i < 5; i++) {
+    server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "0.1"}});
+    runLoopFor(1000);
+  }
+  TEST_ASSERT_EQUAL(1, ntfyQueueCount);
+  TEST_ASSERT_EQUAL(4, ntfyCoalesced);
+  hal::setWiFiConnected(true);
+  runLoopFor(1000);
+  TEST_ASSERT_EQUAL(1, hal::httpCalls().size());
+}
+
+void test_sends_are_spaced_out() {
+  hal::setWiFiConnected(false);
+  server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "0.1"}});
+  server.inject(HTTP_POST, "/manual", {{"channel", "2"}, {"ml", "0.1"}});
+  TEST_ASSERT_EQUAL(2, ntfyQueueCount);
+  hal::setWiFiConnected(true);
+  runLoopFor(4000);
+  TEST_ASSERT_EQUAL(1, hal::httpCalls().size());
+  runLoopFor(2000);
+  TEST_ASSERT_EQUAL(2, hal::httpCalls().size());
+}
+
+void test_failures_back_off_then_give_up() {
+  hal::setHttpClientResult(-1);
+  server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "0.1"}});
+  runLoopFor(1000);
+  TEST_ASSERT_EQUAL(1, hal::httpCalls().size());
+  // First retry waits 10 s, the next one 20 s
+  runLoopFor(9000);
+  TEST_ASSERT_EQUAL(1, hal::httpCalls().size());
+  runLoopFor(2000);
+  TEST_ASSERT_EQUAL(2, hal::httpCalls().size());
+  runLoopFor(15000);
+  TEST_ASSERT_EQUAL(2, hal::httpCalls().size());
+  runLoopFor(10 * 60000UL);
+  TEST_ASSERT_EQUAL(6, hal::httpCalls().size());
+  TEST_ASSERT_EQUAL(6, ntfyFailed);
+  TEST_ASSERT_EQUAL(1, ntfyDropped);
+  TEST_ASSERT_EQUAL(0, ntfyQueueCount);
+}
+
+void test_backlog_survives_reboot() {
+  hal::setWiFiConnected(false);
+  server.inject(HTTP_POST, "/manual", {{"channel", "2"}, {"ml", "0.1"}});
+  runLoopFor(1000);
+  TEST_ASSERT_TRUE(LittleFS.exists("/ntfy_queue.json"));
+
+  loadNtfyQueue();
+  TEST_ASSERT_EQUAL(1, ntfyQueueCount);
+  hal::setWiFiConnected(true);
+  runLoopFor(1000);
+  TEST_ASSERT_EQUAL(1, hal::httpCalls().size());
+  TEST_ASSERT_TRUE(hal::httpCalls()[0].body.indexOf("Refill") >= 0);
+  runLoopFor(1000);
+  TEST_ASSERT_FALSE(LittleFS.exists("/ntfy_queue.json"));
+}
+
+void test_status_reports_counters() {
+  server.inject(HTTP_POST, "/manual", {{"channel", "1"}, {"ml", "0.1"}});
+  runLoopFor(1000);
+  HttpResponse r = server.inject(HTTP_GET, "/api/v1/status", {});
+  TEST_ASSERT_TRUE(r.body.indexOf("\"notifications\":{\"queued\":0,\"sent\":1,") > 0);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_ntfy_queue");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_manual_dose_does_not_wait_for_ntfy);
+  RUN_TEST(test_duplicate_low_fertilizer_alerts_coalesce);
+  RUN_TEST(test_sends_are_spaced_out);
+  RUN_TEST(test_failures_back_off_then_give_up);
+  RUN_TEST(test_backlog_survives_reboot);
+  RUN_TEST(test_status_reports_counters);
+  return UNITY_END();
+}
@@ -0,0 +1,115 @@
+// HTML pages: every page renders from its PROGMEM template straight into the
+// response without heap allocations. The benchmark reports allocations, heap
+// bytes and response bytes per page.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+void setup();
+void loop();
+void writeChannels(int channels);
+
+extern ESP8266WebServer server;
+
+struct PageCost {
+  hal::HeapStats heap;
+  HttpResponse response;
+};
+
+static PageCost render(HTTPMethod method, const char* uri, const ESP8266WebServer::Args& args = {}) {
+  PageCost cost;
+  String path(uri);
+  hal::resetHeapStats();
+  cost.response = server.inject(method, path, args);
+  cost.heap = hal::heapStats();
+  return cost;
+}
+
+static void report(const char* name, const PageCost& cost) {
+  TEST_ASSERT_EQUAL(200, cost.response.code);
+  TEST_ASSERT_TRUE(cost.response.body.indexOf("</html>") > 0);
+  printf("[BENCH] %-22s %3lu allocations %6llu heap bytes %6u response bytes %3u chunks\n", name,
+         cost.heap.allocations, cost.heap.bytes, cost.response.body.length(), cost.response.contentChunks);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_pages_render_without_allocating() {
+  struct Page {
+    const char* name;
+    const char* uri;
+  } pages[] = {
+    {"/summary", "/summary"},
+    {"/manageChannel", "/manageChannel?channel=1"},
+    {"/manageSchedule", "/manageSchedule?channel=2"},
+    {"/systemSettings", "/systemSettings"},
+    {"/calibrate", "/calibrate?channel=1"},
+    {"/prime", "/prime?channel=2"},
+    {"/reset", "/reset"},
+  };
+  for (const Page& page : pages) {
+    PageCost cost = render(HTTP_GET, page.uri);
+    report(page.name, cost);
+    TEST_ASSERT_EQUAL(0, cost.heap.allocations);
+  }
+}
+
+void test_form_responses() {
+  // These also run the pump, log the dose or arm a reset; the counts include that work
+  PageCost measure = render(HTTP_POST, "/calibrate", {{"channel", "1"}});
+  report("/calibrate (run)", measure);
+  TEST_ASSERT_TRUE(measure.response.body.indexOf("Motor is running for 5 seconds") > 0);
+  for (int i = 0; i < 600; i++) {
+    loop();
+    hal::advanceMillis(10);
+  }
+  PageCost done = render(HTTP_POST, "/calibrate", {{"channel", "1"}, {"dispensedML", "5"}});
+  report("/calibrate (done)", done);
+  TEST_ASSERT_TRUE(done.response.body.indexOf("/manageChannel?channel=1") > 0);
+  PageCost wifi = render(HTTP_POST, "/wifiReset");
+  report("/wifiReset", wifi);
+  TEST_ASSERT_TRUE(wifi.response.body.indexOf("http://Doser-Tank.local/") > 0);
+  PageCost factory = render(HTTP_POST, "/factoryReset");
+  report("/factoryReset", factory);
+  TEST_ASSERT_TRUE(factory.response.body.indexOf("http://doser_4A.local/") > 0);
+}
+
+void test_values_are_filled_in() {
+  server.inject(HTTP_POST, "/renameChannel", {{"channel", "2"}, {"name", "Iron"}});
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "2"}, {"volume", "12.5"}});
+  HttpResponse summary = server.inject(HTTP_GET, "/summary");
+  TEST_ASSERT_TRUE(summary.body.indexOf("<title>Doser Summary</title>") > 0);
+  TEST_ASSERT_TRUE(summary.body.indexOf("<h2 style='display:flex;align-items:center;gap:8px;'>Iron") > 0);
+  TEST_ASSERT_TRUE(summary.body.indexOf("<p>Remaining Volume: 12.50 ml</p>") > 0);
+  TEST_ASSERT_TRUE(summary.body.indexOf("Manage Channel 2</button>") > 0);
+  TEST_ASSERT_TRUE(summary.body.indexOf("{{") < 0);
+
+  HttpResponse channel = server.inject(HTTP_GET, "/manageChannel", {{"channel", "2"}});
+  TEST_ASSERT_TRUE(channel.body.indexOf("Channel Management: Iron</div>") > 0);
+  TEST_ASSERT_TRUE(channel.body.indexOf("value='Iron' maxlength='15'") > 0);
+
+  HttpResponse settings = server.inject(HTTP_GET, "/systemSettings");
+  TEST_ASSERT_TRUE(settings.body.indexOf("<option value='19800' selected>UTC+05:30 (IST)</option>") > 0);
+  TEST_ASSERT_TRUE(settings.body.indexOf("value='5CCF7F1234AB' readonly") > 0);
+  TEST_ASSERT_TRUE(settings.body.indexOf("{{") < 0);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_page_render");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+  server.inject(HTTP_POST, "/timezone", {{"offset", "19800"}});
+  server.inject(HTTP_POST, "/systemSettings", {{"deviceName", "Doser Tank"}, {"timezone", "19800"}});
+
+  UNITY_BEGIN();
+  RUN_TEST(test_pages_render_without_allocating);
+  RUN_TEST(test_form_responses);
+  RUN_TEST(test_values_are_filled_in);
+  return UNITY_END();
+}
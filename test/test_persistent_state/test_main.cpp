@@ -0,0 +1,225 @@
+// Persistent state: one CRC-checked binary record written alternately to two
+// slots. A write cut short or a damaged slot falls back to the other slot, the
+// JSON files of earlier firmware are migrated, and /api/v1/state exports it.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <chrono>
+
+void writeChannels(int channels);
+void loadPersistentDataFromSPIFFS();
+bool loadLegacyData();
+bool loadLegacySchedules();
+
+extern int stateSlot;
+extern uint32_t stateSeq;
+extern unsigned long stateWriteFailures;
+
+static const char* SLOTS[2] = {"/state0.bin", "/state1.bin"};
+
+static void setVolume(int channel, const char* volume) {
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", String(channel)}, {"volume", volume}});
+  runLoopFor(1000);
+}
+
+// A setting that lives in the state record
+static void setTimezone(int32_t offset) {
+  server.inject(HTTP_POST, "/timezone", {{"offset", String(offset)}});
+  runLoopFor(1000);
+}
+
+// Sequence number in a slot's header, 0 if the slot is missing
+static uint32_t slotSeq(int slot) {
+  File file = LittleFS.open(SLOTS[slot], "r");
+  if (!file) return 0;
+  uint8_t header[10];
+  file.read(header, sizeof(header));
+  file.close();
+  return header[6] | (header[7] << 8) | (header[8] << 16) | ((uint32_t)header[9] << 24);
+}
+
+static void writeFile(const char* path, const char* text) {
+  File file = LittleFS.open(path, "w");
+  file.write((const uint8_t*)text, strlen(text));
+  file.close();
+}
+
+// As written by firmware before the binary record
+static const char* LEGACY_DATA =
+    "{\"name1\":\"Iron\",\"channel1\":75.5,\"calibration1\":1200,\"calibratedChannel1\":true,"
+    "\"lastDispensedVolume1\":1.5,\"lastDispensedTime1\":\"Mon 08:00\",\"timezone\":3600,"
+    "\"deviceName\":\"Tank\",\"mqttHost\":\"mq\",\"mqttPassword\":\"pw\",\"ledBrightness\":40}";
+static const char* LEGACY_SCHEDULES =
+    "{\"ch1\":{\"channelName\":\"Iron\",\"missedDoseCompensation\":true,\"days\":["
+    "{\"enabled\":true,\"hour\":8,\"minute\":0,\"volume\":1.5}]}}";
+
+void setUp() {}
+void tearDown() {
+  hal::cutFsWritesAfter(-1);
+}
+
+void test_state_survives_reboot() {
+  server.inject(HTTP_POST, "/renameChannel", {{"channel", "2"}, {"name", "Potassium"}});
+  server.inject(HTTP_POST, "/timezone", {{"offset", "-18000"}});
+  server.inject(HTTP_POST, "/calibrate", {{"channel", "1"}, {"dispensedML", "5"}});
+  server.inject(HTTP_POST, "/systemSettings", {{"mqttHost", "broker.local"}, {"mqttPassword", "secret"}});
+  server.inject(HTTP_POST, "/manageSchedule",
+                {{"channel", "2"}, {"enabled3", "on"}, {"time3", "21:15"}, {"vol3", "2.5"}, {"missedDose", "on"}});
+  setVolume(2, "321.5");
+  TEST_ASSERT_FALSE(LittleFS.exists("/data.json"));
+  TEST_ASSERT_FALSE(LittleFS.exists("/weekly_schedules.json"));
+
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL(-18000, timezoneOffset);
+  TEST_ASSERT_EQUAL_STRING("secret", mqttPassword.c_str());
+  TEST_ASSERT_EQUAL_STRING("Doser_4A", deviceName.c_str());
+  JsonDocument channels = api("/api/v1/channels");
+  TEST_ASSERT_TRUE(channels["channels"][0]["calibrated"].as<bool>());
+  TEST_ASSERT_EQUAL_STRING("Potassium", channels["channels"][1]["name"] | "");
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 321.5, channels["channels"][1]["remainingMl"].as<float>());
+  JsonObject schedule = api("/api/v1/schedules")["schedules"][1];
+  TEST_ASSERT_TRUE(schedule["missedDoseCompensation"].as<bool>());
+  TEST_ASSERT_TRUE(schedule["days"][3]["enabled"].as<bool>());
+  TEST_ASSERT_EQUAL_STRING("21:15", schedule["days"][3]["time"] | "");
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 2.5, schedule["days"][3]["volumeMl"].as<float>());
+}
+
+void test_writes_alternate_slots() {
+  setTimezone(3600);
+  int slot = stateSlot;
+  uint32_t seq = slotSeq(slot);
+  TEST_ASSERT_EQUAL(stateSeq, seq);
+  TEST_ASSERT_EQUAL(seq - 1, slotSeq(1 - slot)); // Previous record kept
+
+  setTimezone(7200);
+  TEST_ASSERT_EQUAL(1 - slot, stateSlot);
+  TEST_ASSERT_EQUAL(seq + 1, slotSeq(1 - slot));
+  TEST_ASSERT_EQUAL(seq, slotSeq(slot));
+}
+
+// Cut power at points across the record: boot always finds the old value
+void test_power_cut_during_write_keeps_previous_record() {
+  setTimezone(5000);
+  size_t size = api("/api/v1/state")["bytes"].as<size_t>();
+  const long cuts[] = {0, 1, 9, 10, 64, 128, 200, (long)size - 4, (long)size - 1};
+  for (long cut : cuts) {
+    unsigned long failures = stateWriteFailures;
+    hal::cutFsWritesAfter(cut);
+    setTimezone(3000);
+    TEST_ASSERT_EQUAL(failures + 1, stateWriteFailures);
+    reboot(forgetSettings);
+    TEST_ASSERT_EQUAL(5000, timezoneOffset);
+  }
+  // Power back: the torn slot is simply written again
+  setTimezone(3000);
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL(3000, timezoneOffset);
+}
+
+void test_damaged_slot_falls_back() {
+  setTimezone(2000);
+  setTimezone(1000);
+  File file = LittleFS.open(SLOTS[stateSlot], "r+");
+  file.seek(12, SeekSet);
+  uint8_t b = file.read();
+  file.seek(12, SeekSet);
+  file.write((uint8_t)(b ^ 0x01));
+  file.close();
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL(2000, timezoneOffset);
+
+  // Both slots bad: defaults, as on a new device
+  writeFile(SLOTS[0], "garbage");
+  writeFile(SLOTS[1], "");
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL(-1, stateSlot);
+  TEST_ASSERT_EQUAL_STRING("Channel 2", api("/api/v1/state")["channels"][1]["name"] | "");
+}
+
+void test_json_files_are_migrated() {
+  hal::formatFs();
+  writeFile("/data.json", LEGACY_DATA);
+  writeFile("/weekly_schedules.json", LEGACY_SCHEDULES);
+  reboot(forgetSettings);
+  TEST_ASSERT_FALSE(LittleFS.exists("/data.json"));
+  TEST_ASSERT_FALSE(LittleFS.exists("/weekly_schedules.json"));
+  TEST_ASSERT_TRUE(stateSlot >= 0);
+
+  reboot(forgetSettings); // Now from the binary record
+  JsonDocument state = api("/api/v1/state");
+  JsonObject ch = state["channels"][0];
+  TEST_ASSERT_EQUAL_STRING("Iron", ch["name"] | "");
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 75.5, ch["remainingMl"].as<float>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 1200, ch["calibrationFactor"].as<float>());
+  TEST_ASSERT_EQUAL_STRING("Mon 08:00", ch["lastDispensedTime"] | "");
+  TEST_ASSERT_TRUE(ch["schedule"]["missedDoseCompensation"].as<bool>());
+  TEST_ASSERT_TRUE(ch["schedule"]["days"][0]["enabled"].as<bool>());
+  TEST_ASSERT_FALSE(ch["schedule"]["days"][1]["enabled"].as<bool>());
+  TEST_ASSERT_EQUAL(3600, timezoneOffset);
+  TEST_ASSERT_EQUAL_STRING("Tank", state["settings"]["deviceName"] | "");
+  TEST_ASSERT_EQUAL(40, state["settings"]["ledBrightness"].as<int>());
+  TEST_ASSERT_EQUAL_STRING("pw", mqttPassword.c_str());
+}
+
+void test_json_export() {
+  runLoopFor(1000); // Boot noted the new IP
+  JsonDocument state = api("/api/v1/state");
+  TEST_ASSERT_EQUAL(1, state["format"].as<int>());
+  TEST_ASSERT_EQUAL(stateSlot, state["slot"].as<int>());
+  TEST_ASSERT_EQUAL(stateSeq, state["seq"].as<uint32_t>());
+  TEST_ASSERT_FALSE(state["dirty"].as<bool>());
+  TEST_ASSERT_EQUAL(4, state["channels"].size());
+  TEST_ASSERT_EQUAL(7, state["channels"][0]["schedule"]["days"].size());
+  TEST_ASSERT_EQUAL_STRING("mq", state["settings"]["mqttHost"] | "");
+  TEST_ASSERT_FALSE(state["settings"]["mqttPassword"].is<const char*>());
+}
+
+// Host cost of reading the state at boot, binary record against the old JSON
+void test_load_cost() {
+  const int runs = 200;
+  hal::resetHeapStats();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) loadPersistentDataFromSPIFFS();
+  auto binaryNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  unsigned long binaryAllocs = hal::heapStats().allocations;
+
+  writeFile("/data.json", LEGACY_DATA);
+  writeFile("/weekly_schedules.json", LEGACY_SCHEDULES);
+  hal::resetHeapStats();
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) {
+    loadLegacyData();
+    loadLegacySchedules();
+  }
+  auto jsonNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  unsigned long jsonAllocs = hal::heapStats().allocations;
+  LittleFS.remove("/data.json");
+  LittleFS.remove("/weekly_schedules.json");
+
+  printf("[BENCH] state load: binary %.1f us, %lu allocations; JSON %.1f us, %lu allocations (host)\n",
+         binaryNs / 1000.0 / runs, binaryAllocs / runs, jsonNs / 1000.0 / runs, jsonAllocs / runs);
+  TEST_ASSERT_LESS_THAN(jsonAllocs, binaryAllocs);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_persistent_state");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_state_survives_reboot);
+  RUN_TEST(test_writes_alternate_slots);
+  RUN_TEST(test_power_cut_during_write_keeps_previous_record);
+  RUN_TEST(test_damaged_slot_falls_back);
+  RUN_TEST(test_json_files_are_migrated);
+  RUN_TEST(test_json_export);
+  RUN_TEST(test_load_cost);
+  return UNITY_END();
+}
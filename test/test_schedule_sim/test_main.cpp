@@ -0,0 +1,266 @@
+// Time-accelerated schedule simulator.
+// Drives the firmware's loop() on the virtual clock through months of weekly
+// schedules, reboots, NTP outages and timezone changes, then reports every motor
+// activation against the doses the schedule asked for.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include <map>
+
+void setup();
+void loop();
+void writeChannels(int channels);
+
+extern ESP8266WebServer server;
+
+// Loop granularity. Motor run time stays exact because the stop is a Ticker.
+static const unsigned long SIM_STEP_MS = 1000;
+static const uint32_t SIM_START_UTC = 1735689600; // Wed Jan 1, 2025 00:00 UTC
+static const uint8_t MOTOR_PINS[2] = {D1, D5};
+
+struct Activation {
+  int channel;
+  uint32_t utc;
+  unsigned long long durationUs;
+};
+
+struct OffsetChange {
+  uint32_t utc;
+  int32_t offset;
+};
+
+struct SimDay {
+  bool enabled;
+  int hour;
+  int minute;
+  float volume;
+};
+
+struct SimReport {
+  unsigned long simulatedDays = 0;
+  unsigned long expected = 0;
+  unsigned long activations = 0;
+  unsigned long missed = 0;
+  unsigned long duplicates = 0;
+  unsigned long unexpected = 0;
+  long maxLateSec = 0;
+  double wallSeconds = 0;
+};
+
+static std::vector<Activation> activations;
+static unsigned long long motorOnUs[2];
+static std::vector<OffsetChange> offsets;
+static SimDay schedules[2][7];
+
+static void onGpioEdge(const hal::GpioEdge& edge) {
+  for (int ch = 0; ch < 2; ++ch) {
+    if (edge.pin != MOTOR_PINS[ch]) continue;
+    if (edge.level == HIGH) {
+      motorOnUs[ch] = edge.us;
+    } else {
+      activations.push_back(Activation{ch + 1, (uint32_t)(hal::utcEpoch() - (edge.us - motorOnUs[ch]) / 1000000ULL), edge.us - motorOnUs[ch]});
+    }
+  }
+}
+
+static int32_t offsetAt(uint32_t utc) {
+  int32_t offset = offsets.front().offset;
+  for (const auto& c : offsets) {
+    if (c.utc <= utc) offset = c.offset;
+  }
+  return offset;
+}
+
+static void setTimezone(int32_t offset) {
+  offsets.push_back(OffsetChange{hal::utcEpoch(), offset});
+  server.inject(HTTP_POST, "/timezone", {{"offset", String(offset)}});
+}
+
+static void setSchedule(int channel, const SimDay days[7], bool missedDoseCompensation) {
+  ESP8266WebServer::Args args;
+  args.push_back({"channel", String(channel)});
+  for (int i = 0; i < 7; ++i) {
+    schedules[channel - 1][i] = days[i];
+    char t[6];
+    snprintf(t, sizeof(t), "%02d:%02d", days[i].hour, days[i].minute);
+    if (days[i].enabled) args.push_back({"enabled" + String(i), "on"});
+    args.push_back({"time" + String(i), t});
+    args.push_back({"vol" + String(i), String(days[i].volume)});
+  }
+  if (missedDoseCompensation) args.push_back({"missedDose", "on"});
+  server.inject(HTTP_POST, "/manageSchedule", args);
+}
+
+static void runFor(unsigned long long ms) {
+  for (unsigned long long t = 0; t < ms; t += SIM_STEP_MS) {
+    loop();
+    hal::advanceMillis(SIM_STEP_MS);
+  }
+}
+
+// Power-cycle style reboot: RAM-side globals are not cleared, but setup() reloads
+// everything persisted in LittleFS and the clock starts unset.
+static void reboot(unsigned long downtimeMs) {
+  uint32_t utc = hal::utcEpoch() + downtimeMs / 1000;
+  hal::reset();
+  hal::setUtcEpoch(utc);
+  setup();
+}
+
+static void bootFresh(int32_t offset) {
+  hal::reset();
+  hal::formatFs();
+  hal::setUtcEpoch(SIM_START_UTC);
+  writeChannels(2);
+  activations.clear();
+  offsets.clear();
+  offsets.push_back(OffsetChange{SIM_START_UTC, offset});
+  setup();
+  server.inject(HTTP_POST, "/timezone", {{"offset", String(offset)}});
+  // 1000 ms per ml, plenty of fertilizer so low alerts stay quiet
+  for (int ch = 1; ch <= 2; ++ch) {
+    server.inject(HTTP_POST, "/calibrate", {{"channel", String(ch)}, {"dispensedML", "5"}});
+    server.inject(HTTP_POST, "/updateVolume", {{"channel", String(ch)}, {"volume", "100000"}});
+  }
+}
+
+static SimReport evaluate(uint32_t startUtc, uint32_t endUtc, double wallSeconds, bool verbose) {
+  SimReport report;
+  report.simulatedDays = (endUtc - startUtc) / 86400;
+  report.activations = activations.size();
+  report.wallSeconds = wallSeconds;
+
+  // Doses seen per (channel, local day)
+  std::map<std::pair<int, long>, std::vector<const Activation*>> seen;
+  for (const auto& a : activations) {
+    long localDay = (long)((int64_t)a.utc + offsetAt(a.utc)) / 86400;
+    seen[std::make_pair(a.channel, localDay)].push_back(&a);
+  }
+
+  std::map<std::pair<int, long>, bool> wanted;
+  long firstDay = (long)(((int64_t)startUtc + offsetAt(startUtc)) / 86400);
+  long lastDay = (long)(((int64_t)endUtc + offsetAt(endUtc)) / 86400);
+  for (long day = firstDay; day <= lastDay; ++day) {
+    int weekday = (int)((day + 3) % 7); // 1970-01-01 was a Thursday, 0 = Monday
+    for (int ch = 1; ch <= 2; ++ch) {
+      const SimDay& d = schedules[ch - 1][weekday];
+      if (!d.enabled || d.volume <= 0.0f) continue;
+      int64_t localDue = (int64_t)day * 86400 + d.hour * 3600 + d.minute * 60;
+      uint32_t due = (uint32_t)(localDue - offsetAt((uint32_t)(localDue - offsets.front().offset)));
+      if (due < startUtc || due + 60 > endUtc) continue;
+      report.expected++;
+      wanted[std::make_pair(ch, day)] = true;
+      auto it = seen.find(std::make_pair(ch, day));
+      size_t count = (it == seen.end()) ? 0 : it->second.size();
+      if (count == 0) {
+        report.missed++;
+        if (verbose) printf("  MISSED     ch%d local day %ld (weekday %d)\n", ch, day, weekday);
+        continue;
+      }
+      if (count > 1) {
+        report.duplicates += count - 1;
+        if (verbose) printf("  DUPLICATE  ch%d local day %ld: %u doses\n", ch, day, (unsigned)count);
+      }
+      long late = (long)it->second.front()->utc - (long)due;
+      if (late > report.maxLateSec) report.maxLateSec = late;
+    }
+  }
+  for (const auto& kv : seen) {
+    if (!wanted.count(kv.first)) {
+      report.unexpected += kv.second.size();
+      if (verbose) printf("  UNEXPECTED ch%d local day %ld\n", kv.first.first, kv.first.second);
+    }
+  }
+  return report;
+}
+
+static void printReport(const char* name, const SimReport& r) {
+  printf("[SIM] %s: %lu days, %lu expected, %lu activations, %lu missed, %lu duplicate, %lu unexpected, max start delay %ld s\n",
+         name, r.simulatedDays, r.expected, r.activations, r.missed, r.duplicates, r.unexpected, r.maxLateSec);
+  printf("[SIM] %s: %.2f s wall, %.0f simulated days per wall second\n", name, r.wallSeconds,
+         r.wallSeconds > 0 ? r.simulatedDays / r.wallSeconds : 0.0);
+}
+
+static void dailyAndAlternate(SimDay ch1[7], SimDay ch2[7]) {
+  for (int i = 0; i < 7; ++i) {
+    ch1[i] = SimDay{true, 8, 0, 2.0f};
+    // Mon/Wed/Fri in the same minute as channel 1
+    ch2[i] = SimDay{i == 0 || i == 2 || i == 4, 8, 0, 3.0f};
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_year_steady_state() {
+  bootFresh(19800);
+  SimDay ch1[7], ch2[7];
+  dailyAndAlternate(ch1, ch2);
+  setSchedule(1, ch1, false);
+  setSchedule(2, ch2, false);
+  activations.clear();
+
+  uint32_t start = hal::utcEpoch();
+  auto t0 = std::chrono::steady_clock::now();
+  runFor(365ULL * 86400ULL * 1000ULL);
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  SimReport r = evaluate(start, hal::utcEpoch(), wall, true);
+  printReport("steady year", r);
+  TEST_ASSERT_EQUAL(0, r.missed);
+  TEST_ASSERT_EQUAL(0, r.duplicates);
+  TEST_ASSERT_EQUAL(0, r.unexpected);
+  TEST_ASSERT_GREATER_THAN(0UL, r.expected);
+}
+
+void test_quarter_with_reboots_ntp_gaps_and_timezone_change() {
+  bootFresh(19800);
+  SimDay ch1[7], ch2[7];
+  dailyAndAlternate(ch1, ch2);
+  setSchedule(1, ch1, true);
+  setSchedule(2, ch2, false);
+  activations.clear();
+
+  uint32_t start = hal::utcEpoch();
+  auto t0 = std::chrono::steady_clock::now();
+  for (int week = 0; week < 13; ++week) {
+    runFor(2ULL * 86400ULL * 1000ULL);
+    // Reboot shortly before channel 1's dose (08:00 IST = 02:30 UTC), down for 10 minutes
+    runFor((uint64_t)(((2 * 3600 + 25 * 60) - (hal::utcEpoch() % 86400) + 86400) % 86400) * 1000ULL);
+    reboot(10UL * 60UL * 1000UL);
+    runFor(2ULL * 86400ULL * 1000ULL);
+    // Six hour NTP outage across the dose time, then a reboot inside it
+    hal::setNtpReachable(false);
+    runFor(3ULL * 3600ULL * 1000ULL);
+    reboot(30UL * 1000UL);
+    runFor(3ULL * 3600ULL * 1000ULL);
+    hal::setNtpReachable(true);
+    if (week == 6) setTimezone(3600);
+    if (week == 9) setTimezone(19800);
+    runFor((uint64_t)(7 * 86400 - ((hal::utcEpoch() - start) % (7 * 86400))) * 1000ULL);
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  SimReport r = evaluate(start, hal::utcEpoch(), wall, true);
+  printReport("disrupted quarter", r);
+  // Disruptions may cost doses (channel 2 has no compensation) but must never overdose
+  TEST_ASSERT_EQUAL(0, r.duplicates);
+  TEST_ASSERT_EQUAL(0, r.unexpected);
+  TEST_ASSERT_GREATER_THAN(0UL, r.expected);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_schedule_sim");
+  hal::setGpioListener(onGpioEdge);
+  LittleFS.begin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_year_steady_state);
+  RUN_TEST(test_quarter_with_reboots_ntp_gaps_and_timezone_change);
+  return UNITY_END();
+}
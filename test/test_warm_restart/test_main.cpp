@@ -0,0 +1,183 @@
+// Warm-restart snapshot: an intentional restart leaves the runtime state in
+// RTC memory and the next boot takes it from there instead of flash. It is
+// used once, and a power cycle, a damaged snapshot or one too big for RTC
+// memory fall back to flash with the same result.
+#include <Arduino.h>
+#include <NativeHAL.h>
+#include <TestSupport.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <chrono>
+
+void writeChannels(int channels);
+void counterDose(int channel, float ml, unsigned long durationMs, bool scheduled);
+void loadPersistentDataFromSPIFFS();
+void counterBegin();
+void snapshotSave();
+bool snapshotRestore();
+uint32_t clockUtc();
+
+extern long clockDriftPpm;
+extern unsigned long snapshotTooBig;
+extern size_t snapshotBytes;
+
+static void restart() {
+  server.inject(HTTP_POST, "/restart");
+  TEST_ASSERT_TRUE(hal::restartRequested());
+}
+
+static const char* stateSource() {
+  static String source;
+  source = api("/api/v1/status")["boot"]["stateSource"] | "";
+  return source.c_str();
+}
+
+// Everything the device keeps, as the API shows it
+static String snapshotOfState() {
+  JsonDocument state = api("/api/v1/state");
+  state.remove("loadUs");
+  state.remove("writes");
+  String out;
+  serializeJson(state, out);
+  serializeJson(api("/api/v1/channels"), out);
+  return out;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_restart_restores_from_rtc() {
+  server.inject(HTTP_POST, "/renameChannel", {{"channel", "2"}, {"name", "Potassium"}});
+  server.inject(HTTP_POST, "/timezone", {{"offset", "-18000"}});
+  server.inject(HTTP_POST, "/calibrate", {{"channel", "1"}, {"dispensedML", "5"}});
+  server.inject(HTTP_POST, "/updateVolume", {{"channel", "1"}, {"volume", "250"}});
+  server.inject(HTTP_POST, "/systemSettings", {{"mqttHost", "broker.local"}, {"mqttPassword", "secret"}});
+  server.inject(HTTP_POST, "/manageSchedule",
+                {{"channel", "2"}, {"enabled3", "on"}, {"time3", "21:15"}, {"vol3", "2.5"}, {"missedDose", "on"}});
+  counterDose(1, 1.25f, 1250, false);
+  runLoopFor(5000);
+  String before = snapshotOfState();
+
+  restart();
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL_STRING("snapshot", stateSource());
+  TEST_ASSERT_EQUAL_STRING("secret", mqttPassword.c_str());
+  TEST_ASSERT_EQUAL_STRING(before.c_str(), snapshotOfState().c_str());
+
+  // Used once: the next boot reads flash and finds the same
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL_STRING("flash", stateSource());
+  TEST_ASSERT_EQUAL_STRING(before.c_str(), snapshotOfState().c_str());
+}
+
+// Doses and settings after a snapshot boot land in flash as usual
+void test_changes_after_snapshot_boot_are_kept() {
+  restart();
+  reboot(forgetSettings);
+  counterDose(1, 1.0f, 1000, false);
+  server.inject(HTTP_POST, "/timezone", {{"offset", "3600"}});
+  runLoopFor(5000);
+  String before = snapshotOfState();
+  hal::clearRtcMemory();
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL_STRING("flash", stateSource());
+  TEST_ASSERT_EQUAL_STRING(before.c_str(), snapshotOfState().c_str());
+}
+
+void test_power_cycle_reads_flash() {
+  String before = snapshotOfState();
+  restart();
+  hal::clearRtcMemory();
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL_STRING("flash", stateSource());
+  TEST_ASSERT_EQUAL_STRING(before.c_str(), snapshotOfState().c_str());
+}
+
+void test_damaged_snapshot_reads_flash() {
+  String before = snapshotOfState();
+  restart();
+  uint32_t word;
+  ESP.rtcUserMemoryRead(40, &word, sizeof(word));
+  word ^= 0x10000;
+  ESP.rtcUserMemoryWrite(40, &word, sizeof(word));
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL_STRING("flash", stateSource());
+  TEST_ASSERT_EQUAL_STRING(before.c_str(), snapshotOfState().c_str());
+}
+
+void test_too_big_for_rtc_reads_flash() {
+  String topic;
+  for (int i = 0; i < 50; i++) topic += "aquarium/";
+  server.inject(HTTP_POST, "/systemSettings", {{"mqttHost", "broker.local"}, {"mqttTopic", topic}});
+  runLoopFor(5000);
+  String before = snapshotOfState();
+  unsigned long tooBig = snapshotTooBig;
+  restart();
+  TEST_ASSERT_EQUAL(tooBig + 1, snapshotTooBig);
+  reboot(forgetSettings);
+  TEST_ASSERT_EQUAL_STRING("flash", stateSource());
+  TEST_ASSERT_EQUAL_STRING(before.c_str(), snapshotOfState().c_str());
+  server.inject(HTTP_POST, "/systemSettings", {{"mqttHost", "broker.local"}, {"mqttTopic", "tank/doser"}});
+  runLoopFor(5000);
+}
+
+// The clock and its drift estimate carry on without waiting for NTP
+void test_clock_carries_on() {
+  clockDriftPpm = 120;
+  uint32_t utc = clockUtc();
+  restart();
+  reboot([&] {
+    hal::setUtcEpoch(utc);
+    hal::setNtpReachable(false);
+  });
+  JsonDocument status = api("/api/v1/status");
+  TEST_ASSERT_TRUE(status["clock"]["estimated"].as<bool>());
+  TEST_ASSERT_FALSE(status["timeSynced"].as<bool>());
+  TEST_ASSERT_EQUAL(120, clockDriftPpm);
+  TEST_ASSERT_TRUE(clockUtc() - utc <= 1);
+  hal::setNtpReachable(true);
+}
+
+// Host cost of each path, repeated so the timer can see it
+void test_restore_cost() {
+  const int runs = 200;
+  snapshotSave();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) {
+    snapshotSave();
+    TEST_ASSERT_TRUE(snapshotRestore());
+  }
+  auto snapshotNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  hal::resetHeapStats();
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) {
+    loadPersistentDataFromSPIFFS();
+    counterBegin();
+  }
+  auto flashNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  printf("[BENCH] boot state: RTC snapshot (%u of 480 bytes) save+restore %.1f us, flash slots+journal %.1f us (host)\n",
+         (unsigned)snapshotBytes, snapshotNs / 1000.0 / runs, flashNs / 1000.0 / runs);
+  TEST_ASSERT_LESS_THAN(flashNs, snapshotNs);
+}
+
+int main() {
+  hal::setSerialEnabled(false);
+  hal::setFsRoot(".pio/test_fs_warm_restart");
+  LittleFS.begin();
+  hal::formatFs();
+  writeChannels(2);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_restart_restores_from_rtc);
+  RUN_TEST(test_changes_after_snapshot_boot_are_kept);
+  RUN_TEST(test_power_cycle_reads_flash);
+  RUN_TEST(test_damaged_snapshot_reads_flash);
+  RUN_TEST(test_too_big_for_rtc_reads_flash);
+  RUN_TEST(test_clock_carries_on);
+  RUN_TEST(test_restore_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,73 @@
+"""Embed the web UI assets from web/ as gzipped PROGMEM arrays.
+
+Writes include/web_assets.h with, for every asset, the gzipped bytes, their
+length and a strong ETag (truncated SHA-256 of the gzipped bytes). The firmware
+serves them from /static/<name> with Content-Encoding: gzip.
+
+Runs before every PlatformIO build (extra_scripts = pre:...) and can be run by
+hand: python tools/embed_web_assets.py
+The header is only rewritten when its content changes.
+"""
+import gzip
+import hashlib
+import os
+import re
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+ASSETS = [
+    ("app.css", "text/css"),
+    ("app.js", "application/javascript"),
+]
+
+
+def symbol(name):
+    return "WEB_" + re.sub(r"[^A-Za-z0-9]", "_", name).upper()
+
+
+def render():
+    out = [
+        "// Generated by tools/embed_web_assets.py from web/. Do not edit.",
+        "#pragma once",
+        "",
+        "#include <Arduino.h>",
+        "",
+    ]
+    for name, content_type in ASSETS:
+        with open(os.path.join(PROJECT_DIR, "web", name), "rb") as f:
+            raw = f.read()
+        # mtime=0 keeps the output (and the ETag) stable between builds
+        gz = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = hashlib.sha256(gz).hexdigest()[:16]
+        sym = symbol(name)
+        out.append("// %s: %d bytes, %d gzipped" % (name, len(raw), len(gz)))
+        out.append('#define %s_PATH "/static/%s"' % (sym, name))
+        out.append('#define %s_TYPE "%s"' % (sym, content_type))
+        out.append('#define %s_ETAG "%s"' % (sym, etag))
+        out.append("const size_t %s_GZ_LEN = %d;" % (sym, len(gz)))
+        out.append("const uint8_t %s_GZ[] PROGMEM = {" % sym)
+        for i in range(0, len(gz), 16):
+            out.append("  " + ", ".join("0x%02x" % b for b in gz[i:i + 16]) + ",")
+        out.append("};")
+        out.append("")
+    return "\n".join(out)
+
+
+def main():
+    path = os.path.join(PROJECT_DIR, "include", "web_assets.h")
+    text = render()
+    old = None
+    if os.path.exists(path):
+        with open(path) as f:
+            old = f.read()
+    if old != text:
+        with open(path, "w") as f:
+            f.write(text)
+        print("embed_web_assets: wrote include/web_assets.h")
+
+
+main()
@@ -0,0 +1,249 @@
+// Shared scripts for all pages. Served gzipped from /static/app.js.
+// Values that differ per request are passed in as arguments or data- attributes.
+
+// --- Calibrate ---
+function startCountdown(seconds) {
+  var btn = document.getElementById('calibBtn');
+  var homeBtn = document.getElementById('homeBtn');
+  var backBtn = document.getElementById('backBtn');
+  var countdown = document.getElementById('countdown');
+  btn.disabled = true;
+  homeBtn.disabled = true;
+  backBtn.disabled = true;
+  var timeLeft = seconds;
+  countdown.innerText = 'Calibrating... ' + timeLeft + 's remaining';
+  var interval = setInterval(function() {
+    timeLeft--;
+    countdown.innerText = 'Calibrating... ' + timeLeft + 's remaining';
+    if (timeLeft <= 0) {
+      clearInterval(interval);
+      countdown.innerText = '';
+      btn.disabled = false;
+      homeBtn.disabled = false;
+      backBtn.disabled = false;
+    }
+  }, 1000);
+}
+
+// --- Prime ---
+function togglePrime(channel) {
+  var btn = document.getElementById('primeButton');
+  var state = btn.getAttribute('data-state') === '1' ? '0' : '1';
+  var xhr = new XMLHttpRequest();
+  xhr.open('POST', '/prime', true);
+  xhr.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');
+  xhr.send('channel=' + channel + '&state=' + state);
+  btn.setAttribute('data-state', state);
+  btn.value = state === '1' ? 'Done' : 'Start';
+  btn.className = state === '1' ? 'prime-btn stop' : 'prime-btn';
+}
+
+window.addEventListener('load', function() {
+  var btn = document.getElementById('primeButton');
+  if (!btn) return;
+  btn.value = 'Start';
+  btn.className = 'prime-btn';
+});
+
+// --- Summary: manual dose ---
+function showManualDose(ch) {
+  var s = document.getElementById('manualDoseSection' + ch);
+  s.innerHTML = `<div style='display:flex;gap:8px;align-items:center;justify-content:center;'><input id='doseVol${ch}' type='number' min='0.1' step='0.1' placeholder='Volume (ml)' style='width:40%;padding:8px;font-size:1em;border-radius:6px;border:1px solid #ccc;'><button id='doseBtn${ch}' style="width:25%;padding:10px 0;font-size:1em;background:#007BFF;color:#fff;border:none;border-radius:6px;" onclick='doseNow(${ch})'>Dose</button><button id='cancelBtn${ch}' style="width:25%;padding:10px 0;font-size:1em;background:#aaa;color:#fff;border:none;border-radius:6px;" onclick='cancelManualDose(${ch})'>Cancel</button></div><div id='doseCountdown${ch}' style='margin-top:8px;font-size:1.1em;color:#007BFF;'></div>`;
+}
+
+function cancelManualDose(ch) {
+  var s = document.getElementById('manualDoseSection' + ch);
+  s.innerHTML = `<button class='card-btn' style='width:100%;padding:12px 0;font-size:1.1em;background:#28a745;color:#fff;border:none;border-radius:6px;margin-bottom:10px;' onclick='showManualDose(${ch})'>Manual Dose</button>`;
+}
+
+function doseNow(ch) {
+  var vol = parseFloat(document.getElementById('doseVol' + ch).value);
+  if (!vol || vol <= 0) { alert('Enter a valid volume'); return; }
+  var btn = document.getElementById('doseBtn' + ch);
+  var cancel = document.getElementById('cancelBtn' + ch);
+  btn.disabled = true; cancel.disabled = true;
+  var countdown = document.getElementById('doseCountdown' + ch);
+  // data-factor holds the channel's calibration in ms per ml
+  var factor = parseFloat(document.getElementById('manualDoseSection' + ch).getAttribute('data-factor'));
+  var duration = Math.ceil(vol * factor / 1000);
+  countdown.innerText = 'Dosing... ' + duration + 's remaining';
+  var interval = setInterval(function() {
+    duration--;
+    countdown.innerText = 'Dosing... ' + duration + 's remaining';
+    if (duration <= 0) { clearInterval(interval); countdown.innerText = ''; window.location.reload(); }
+  }, 1000);
+  var xhr = new XMLHttpRequest();
+  xhr.open('POST', '/manual', true);
+  xhr.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');
+  xhr.send('channel=' + ch + '&ml=' + encodeURIComponent(vol));
+}
+
+// --- Channel management ---
+function showRenameBox() {
+  document.getElementById('rename-row').style.display = 'flex';
+  document.getElementById('rename-btn-row').style.display = 'none';
+}
+
+function cancelRename() {
+  document.getElementById('rename-row').style.display = 'none';
+  document.getElementById('rename-btn-row').style.display = 'block';
+}
+
+function saveRename(channel) {
+  var newName = document.getElementById('rename-input').value;
+  if (!newName) { alert('Name cannot be empty'); return; }
+  var xhr = new XMLHttpRequest();
+  xhr.open('POST', '/renameChannel', true);
+  xhr.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');
+  xhr.onreadystatechange = function() {
+    if (xhr.readyState == 4 && xhr.status == 200) { location.reload(); }
+  };
+  xhr.send('channel=' + channel + '&name=' + encodeURIComponent(newName));
+}
+
+function showUpdateVolumeBox() {
+  document.getElementById('update-volume-row').style.display = 'flex';
+  document.getElementById('update-volume-btn-row').style.display = 'none';
+}
+
+function cancelUpdateVolume() {
+  document.getElementById('update-volume-row').style.display = 'none';
+  document.getElementById('update-volume-btn-row').style.display = 'inline';
+}
+
+function saveUpdateVolume(channel) {
+  var newVol = document.getElementById('update-volume-input').value;
+  if (!newVol || isNaN(newVol) || Number(newVol) < 0) { alert('Enter a valid volume'); return; }
+  var xhr = new XMLHttpRequest();
+  xhr.open('POST', '/updateVolume', true);
+  xhr.setRequestHeader('Content-Type', 'application/x-www-form-urlencoded');
+  xhr.onreadystatechange = function() {
+    if (xhr.readyState == 4 && xhr.status == 200) { location.reload(); }
+  };
+  xhr.send('channel=' + channel + '&volume=' + encodeURIComponent(newVol));
+}
+
+// --- Schedule ---
+function copyMondayToOthers() {
+  var enabled = document.getElementById('enabled0').checked;
+  var time = document.getElementById('time0').value;
+  var vol = document.getElementById('vol0').value;
+  for (var i = 1; i < 7; i++) {
+    document.getElementById('enabled' + i).checked = enabled;
+    document.getElementById('time' + i).value = time;
+    document.getElementById('vol' + i).value = vol;
+  }
+}
+
+function onCopyChange(cb) { if (cb.checked) { copyMondayToOthers(); } }
+
+window.addEventListener('DOMContentLoaded', function() {
+  var form = document.getElementById('scheduleForm');
+  if (!form) return;
+  var copying = function() { if (document.getElementById('copyMonday').checked) { copyMondayToOthers(); } };
+  document.getElementById('enabled0').addEventListener('change', copying);
+  document.getElementById('time0').addEventListener('change', copying);
+  document.getElementById('vol0').addEventListener('input', copying);
+  form.addEventListener('submit', copying);
+});
+
+// --- System settings ---
+window.addEventListener('DOMContentLoaded', function() {
+  var slider = document.getElementById('ledBrightness');
+  if (!slider) return;
+  slider.addEventListener('input', function() {
+    document.getElementById('ledBrightnessValue').innerText = Math.round(this.value * 100 / 255) + '%';
+  });
+});
+
+function handleRestart(e) {
+  var btn = document.getElementById('restartBtn');
+  btn.disabled = true;
+  btn.innerText = 'Restarting..';
+  setTimeout(function() { window.location.href = '/summary'; }, 10000);
+  return true;
+}
+
+function showFirmwareUpdate() {
+  document.getElementById('firmwareUpdateSection').style.display = 'block';
+}
+
+function hideFirmwareUpdate() {
+  document.getElementById('firmwareUpdateSection').style.display = 'none';
+  document.getElementById('updateProgress').style.display = 'none';
+}
+
+// http:// URLs (a server on the LAN) are pulled by the device itself with
+// resumable Range requests; others are fetched here and uploaded
+async function updateFirmware() {
+  const url = document.getElementById('firmwareUrl').value;
+  const sha256 = document.getElementById('firmwareSha256').value.trim();
+  if (!url) { alert('Please enter firmware URL'); return; }
+  document.getElementById('updateProgress').style.display = 'block';
+  const progressFill = document.getElementById('progressFill');
+  const progressText = document.getElementById('progressText');
+  try {
+    if (url.startsWith('http://')) {
+      await pullFirmware(url, sha256, progressFill, progressText);
+      return;
+    }
+    const response = await fetch(url);
+    if (!response.ok) throw new Error('Failed to download firmware');
+    const total = parseInt(response.headers.get('content-length') || '0');
+    const reader = response.body.getReader();
+    const chunks = []; let loaded = 0;
+    while (true) {
+      const { done, value } = await reader.read();
+      if (done) break;
+      chunks.push(value); loaded += value.length;
+      if (total) {
+        const progress = (loaded / total) * 100;
+        progressFill.style.width = progress + '%';
+        progressText.textContent = Math.round(progress) + '%';
+      }
+    }
+    const firmwareData = new Uint8Array(loaded);
+    let offset = 0;
+    for (const chunk of chunks) {
+      firmwareData.set(chunk, offset); offset += chunk.length;
+    }
+    progressText.textContent = 'Flashing firmware...';
+    const formData = new FormData();
+    formData.append('firmware', new Blob([firmwareData]), url.endsWith('.gz') ? 'firmware.bin.gz' : 'firmware.bin');
+    const uploadResponse = await fetch('/update?sha256=' + encodeURIComponent(sha256), {
+      method: 'POST', body: formData
+    });
+    if (uploadResponse.ok) {
+      progressText.textContent = 'Firmware updated successfully! Device will restart...';
+      setTimeout(() => { window.location.href = '/summary'; }, 3000);
+    } else {
+      const result = await uploadResponse.json().catch(() => ({}));
+      throw new Error(result.error || 'Failed to flash firmware');
+    }
+  } catch (error) {
+    alert('Firmware update failed: ' + error.message);
+    hideFirmwareUpdate();
+  }
+}
+
+async function pullFirmware(url, sha256, progressFill, progressText) {
+  const body = new URLSearchParams({ url: url, sha256: sha256 });
+  const start = await fetch('/api/v1/firmware/pull', { method: 'POST', body: body });
+  if (!start.ok) {
+    const result = await start.json().catch(() => ({}));
+    throw new Error(result.error || 'Failed to start download');
+  }
+  while (true) {
+    await new Promise(resolve => setTimeout(resolve, 1000));
+    const status = await (await fetch('/api/v1/firmware')).json();
+    progressFill.style.width = status.percent + '%';
+    progressText.textContent = status.percent + '% at ' + status.kbps + ' KB/s' +
+      (status.resumes ? ', resumed ' + status.resumes + 'x' : '');
+    if (status.state === 'failed') throw new Error(status.error);
+    if (status.state === 'done') {
+      progressText.textContent = 'Firmware updated successfully! Device will restart...';
+      setTimeout(() => { window.location.href = '/summary'; }, 5000);
+      return;
+    }
+  }
+}